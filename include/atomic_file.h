@@ -0,0 +1,48 @@
+#ifndef ATOMIC_FILE_H
+#define ATOMIC_FILE_H
+
+#include <Arduino.h>
+#include <vector>
+#include "flash_fs.h"
+
+// Запись файлов, устойчивая к сбросу питания.
+//
+// Новое содержимое пишется в <path>.tmp с концевиком (поколение, длина,
+// CRC32), читается обратно для проверки, затем текущий файл становится
+// <path>.bak, а временный переименовывается в <path>. В любой момент на
+// флеше есть хотя бы одно целое поколение:
+//   - сброс во время записи .tmp - цел старый <path>;
+//   - сброс между переименованиями - цел .tmp (восстанавливает recover());
+//   - поврежденный <path> - читается .bak.
+// Файлы старого формата без концевика читаются как есть (поколение 0), пока
+// рядом нет .bak: после первой записи основной файл всегда с концевиком.
+class AtomicFile {
+public:
+    static const uint32_t TRAILER_MAGIC = 0x31465741; // "AWF1"
+    static const size_t TRAILER_SIZE = 16;
+
+    static bool write(FlashFS& fs, const char* path, const uint8_t* data, size_t length);
+    static bool write(FlashFS& fs, const char* path, const String& content);
+
+    // Содержимое последнего целого поколения (без концевика); false - нет ни одного
+    static bool read(FlashFS& fs, const char* path, std::vector<uint8_t>& out);
+
+    // При загрузке: доводит прерванную запись до конца или откатывает ее
+    static void recover(FlashFS& fs, const char* path);
+
+    static bool exists(FlashFS& fs, const char* path);
+    // Удаляет файл вместе с резервной копией и временным файлом
+    static void remove(FlashFS& fs, const char* path);
+
+    static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+
+private:
+    enum class Check { MISSING, LEGACY, VALID, CORRUPT };
+
+    // Проверяет файл и при out != nullptr читает содержимое без концевика
+    static Check load(FlashFS& fs, const String& path, uint32_t& generation, std::vector<uint8_t>* out);
+    // То же для <path>: файл без концевика рядом с .bak - это поврежденный концевик
+    static Check loadCurrent(FlashFS& fs, const char* path, uint32_t& generation, std::vector<uint8_t>* out);
+};
+
+#endif // ATOMIC_FILE_H
@@ -0,0 +1,115 @@
+#ifndef BACKUP_FILE_H
+#define BACKUP_FILE_H
+
+#include <Arduino.h>
+#include <functional>
+#include "mbedtls/gcm.h"
+#include "mbedtls/sha256.h"
+
+#define BACKUP_CHUNK_SIZE 1024          // Открытого текста в одном зашифрованном блоке
+#define BACKUP_MAX_RECORD 512           // Предел длины одной записи (строки ключа)
+#define BACKUP_KDF_TARGET_MS 1000       // Время вывода ключа из пароля при экспорте
+#define BACKUP_KDF_MIN_ITERATIONS 10000
+#define BACKUP_KDF_MAX_ITERATIONS 1000000 // Предел формата, больше не пишется и не читается
+// Импорт принимает не больше стольких итераций, сколько этот же экспорт
+// калибрует на устройстве (около BACKUP_KDF_TARGET_MS каждые): ключ выводится
+// в задаче AsyncTCP, и ее сторожевой таймер (5 с) не должен сработать
+#define BACKUP_KDF_IMPORT_FACTOR 3
+#define BACKUP_MIN_PASSPHRASE 8
+#define BACKUP_HEADER_SIZE 36
+#define BACKUP_MANIFEST_SIZE 48
+
+// Переносимая зашифрованная резервная копия ключей. Не зависит от MAC и
+// пароля администратора - только от пароля резервной копии.
+//
+//   Заголовок (36 байт): "TBK1", версия 1, KDF 1 (PBKDF2-HMAC-SHA256), 0, 0,
+//                        число итераций (u32 LE), соль (16), префикс nonce (8)
+//   Блоки: слово u32 LE (бит 31 - последний блок, остальные - длина открытого
+//          текста, не больше BACKUP_CHUNK_SIZE), шифротекст AES-256-GCM, тег (16)
+//
+// Nonce блока - префикс и номер блока (u32 BE), в AAD - заголовок и слово
+// блока: блоки нельзя переставить, выбросить или перенести в другой файл.
+// Открытый текст обычных блоков - записи, каждая завершается '\n' и может
+// переходить через границу блока. Последний блок - манифест (48 байт):
+// "MNFT", число записей, число байт записей, время создания (u32 LE) и
+// SHA-256 всего открытого текста записей.
+//
+// Писатель и читатель держат в памяти не больше одного блока, так что размер
+// копии ограничен не RAM, а только источником записей.
+class BackupWriter {
+public:
+    // Следующая запись без '\n'; false - записи кончились
+    typedef std::function<bool(String& record)> RecordSource;
+
+    // Выводит ключ из пароля (долго: около BACKUP_KDF_TARGET_MS)
+    BackupWriter(const String& passphrase, uint32_t iterations, RecordSource source);
+    ~BackupWriter();
+
+    // Следующие байты файла; 0 - файл закончен
+    size_t read(uint8_t* buffer, size_t maxLen);
+
+private:
+    RecordSource _source;
+    mbedtls_gcm_context _gcm;
+    mbedtls_sha256_context _sha;
+    uint8_t _header[BACKUP_HEADER_SIZE];
+    uint32_t _chunkIndex = 0;
+    uint32_t _records = 0;
+    uint32_t _bytes = 0;
+    bool _sourceDone = false;
+    bool _finished = false;
+
+    uint8_t _plain[BACKUP_CHUNK_SIZE]; // Накопление открытого текста блока
+    size_t _plainLength = 0;
+    String _pending;                   // Остаток записи, не поместившийся в блок
+    size_t _pendingOffset = 0;
+    uint8_t _out[4 + BACKUP_CHUNK_SIZE + 16]; // Готовый зашифрованный блок
+    size_t _outLength = 0;
+    size_t _outOffset = 0;
+
+    bool sealNext();
+    void seal(const uint8_t* plain, size_t length, bool final);
+};
+
+class BackupReader {
+public:
+    // Очередная запись; false прерывает чтение
+    typedef std::function<bool(const String& record)> RecordSink;
+
+    // Копия с числом итераций больше maxIterations отклоняется до вывода ключа
+    BackupReader(const String& passphrase, uint32_t maxIterations, RecordSink sink);
+    ~BackupReader();
+
+    // Очередная порция файла; false - ошибка (см. error()), дальше читать бессмысленно
+    bool feed(const uint8_t* data, size_t length);
+    // После последней порции: true, если прочитан и сошелся манифест
+    bool finish();
+    const String& error() const { return _error; }
+
+private:
+    RecordSink _sink;
+    String _passphrase; // Затирается сразу после вывода ключа
+    uint32_t _maxIterations;
+    mbedtls_gcm_context _gcm;
+    mbedtls_sha256_context _sha;
+    bool _keyReady = false;
+    uint8_t _header[BACKUP_HEADER_SIZE];
+    uint32_t _chunkIndex = 0;
+    uint32_t _records = 0;
+    uint32_t _bytes = 0;
+    bool _finished = false;
+    String _error;
+
+    // Входной буфер: заголовок, затем по одному блоку
+    uint8_t _in[4 + BACKUP_CHUNK_SIZE + 16];
+    size_t _inLength = 0;
+    uint8_t _plain[BACKUP_CHUNK_SIZE];
+    String _record;
+
+    bool fail(const char* error);
+    bool readHeader();
+    bool openChunk(uint32_t word, size_t length, bool final);
+    bool checkManifest(const uint8_t* plain, size_t length);
+};
+
+#endif // BACKUP_FILE_H
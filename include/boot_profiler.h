@@ -0,0 +1,38 @@
+#ifndef BOOT_PROFILER_H
+#define BOOT_PROFILER_H
+
+#include <Arduino.h>
+
+// Замеряет длительность этапов загрузки. Этапы могут выполняться
+// параллельно в разных задачах FreeRTOS, поэтому доступ к таблице защищен.
+class BootProfiler {
+public:
+    BootProfiler();
+
+    // Открывает этап и возвращает его идентификатор (-1, если таблица заполнена)
+    int beginStage(const char* name);
+    void endStage(int stageId);
+
+    // Отмечает момент, когда на экране появился первый TOTP-код
+    void markFirstCode();
+    bool isFirstCodeMarked() const { return _firstCodeMs != 0; }
+
+    // Печатает сводку по этапам в журнал
+    void report();
+
+private:
+    struct Stage {
+        const char* name;
+        unsigned long startMs;
+        unsigned long endMs;
+        const char* task;
+    };
+
+    static const int MAX_STAGES = 16;
+    Stage _stages[MAX_STAGES];
+    int _stageCount = 0;
+    unsigned long _firstCodeMs = 0;
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+};
+
+#endif // BOOT_PROFILER_H
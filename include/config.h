@@ -9,6 +9,16 @@
 #define WEB_SERVER_PORT 80
 #define ADMIN_USERNAME "admin"
 #define ADMIN_PASSWORD "your_secure_password"
+#define AUTH_FILE "/auth.json"
+#define ADMIN_KDF_TARGET_MS 250    // Время одной проверки пароля администратора
+#define KDF_MIN_ITERATIONS 1000    // Нижняя граница числа итераций PBKDF2
+#define MAX_EVENT_CLIENTS 3        // Одновременных подписчиков /api/events
+#define WEB_RATE_CAPACITY 20       // Корзина токенов на IP-адрес (запросов подряд)
+#define WEB_RATE_REFILL_PER_SEC 4  // Пополнение корзины, токенов в секунду
+#define WEB_HEAVY_REQUEST_COST 5   // Цена /scan, /api/import, /api/export в токенах
+#define WEB_MAX_IN_FLIGHT 4        // Одновременно обрабатываемых запросов
+#define WEB_MIN_FREE_HEAP 24576    // Ниже этого свободной кучи - 503
+#define WEB_MIN_HEAP_BLOCK 8192    // Ниже этого наибольшего блока - 503
 
 // Дисплей - правильные пины для T-Display
 #define TFT_WIDTH 135 
@@ -26,14 +36,33 @@
 #define BUTTON_2 0
 
 // TOTP настройки
-#define CONFIG_TOTP_STEP_SIZE 30
+#define CONFIG_TOTP_STEP_SIZE 30  // Период по умолчанию; период ключа должен быть ему кратен
 #define CONFIG_TOTP_DIGITS 6
+#define CONFIG_TOTP_MAX_PERIOD 300
+#define TOTP_MAX_SECRET_BYTES 64  // Секрет после декодирования Base32 (хватает на HMAC-SHA512)
+#define QR_DISPLAY_MS 60000UL    // Сколько держится QR-код ключа на экране
+
+// Синхронизация времени
+#define NTP_SERVER "pool.ntp.org"
+#define NTP_SYNC_INTERVAL_MS 3600000UL       // Фоновая ресинхронизация раз в час
+#define MIN_VALID_EPOCH 1704067200L          // 2024-01-01: время раньше считается не установленным
+#define TIME_CONFIDENCE_MAX_AGE_SEC 86400L   // Сколько времени после синхронизации оно считается точным
+#define DRIFT_PERSIST_DELTA_PPM 1.0f         // Изменение дрейфа, при котором он сохраняется во флеш
+#define DRIFT_CORRECTION_INTERVAL_MS 60000UL // Как часто применять коррекцию дрейфа
 
 // Файловая система
 #define KEYS_FILE "/keys.json"
 #define CONFIG_FILE "/config.json"
+#define PIN_FILE "/pincode.json"
+#define WIFI_CONFIG_FILE "/wifi_config.json"
+#define THEMES_FILE "/themes.json"
 #define SPLASH_IMAGE_PATH "/splash.raw"
-#define THEME_CONFIG_KEY "theme" // New: Key for theme setting in config.json
+#define THEME_CONFIG_KEY "theme" // Имя активной темы в config.json
+#define LAST_SYNC_CONFIG_KEY "last_sync"
+#define DRIFT_CONFIG_KEY "drift_ppm"
+#define DRIFT_WEIGHT_CONFIG_KEY "drift_hours"
+#define CONFIG_WRITE_DELAY_MS 2000UL      // Пауза после последнего изменения настроек до записи во флеш
+#define CONFIG_WRITE_MAX_DELAY_MS 10000UL // Предел ожидания с первого несохраненного изменения
 
 #endif
 
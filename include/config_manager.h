@@ -2,21 +2,64 @@
 #define CONFIG_MANAGER_H
 
 #include <Arduino.h>
-#include <LittleFS.h>
 #include <ArduinoJson.h>
+#include <functional>
 #include "config.h"
 #include "ui_themes.h"
 
+// Разделы настроек. У каждого свой файл во флеше, формат файлов прежний.
+enum class ConfigSection : uint8_t {
+    GENERAL, // CONFIG_FILE: тема, синхронизация времени
+    PIN,     // PIN_FILE
+    AUTH,    // AUTH_FILE: пароль администратора
+    WIFI,    // WIFI_CONFIG_FILE: сохраненные сети
+    COUNT
+};
+
+// Реестр всех настроек устройства. Файлы читаются и разбираются один раз
+// в begin(), дальше настройки отдаются из памяти. Изменения копятся и
+// пишутся пачкой из update() через CONFIG_WRITE_DELAY_MS после последнего
+// изменения (не позже CONFIG_WRITE_MAX_DELAY_MS после первого). Запись
+// атомарная, с резервным поколением (см. AtomicFile).
+// Доступ из любой задачи защищен мьютексом.
 class ConfigManager {
 public:
     ConfigManager();
     void begin();
-    Theme loadTheme();
-    void saveTheme(Theme theme);
+    // Отложенная запись измененных разделов (вызывается из основного цикла)
+    void update();
+    // Немедленная запись всего несохраненного: перед перезагрузкой и сном
+    void flush();
+
+    // Имя активной темы (см. ThemeManager)
+    String getThemeName();
+    void setThemeName(const String& name);
+
+    // Последняя синхронизация времени и калибровка дрейфа часов
+    // (оценка в ppm и сколько часов наблюдения за ней стоит)
+    bool getTimeSync(time_t& lastSyncEpoch, float& driftPpm, float& driftWeightHours);
+    void setTimeSync(time_t lastSyncEpoch, float driftPpm, float driftWeightHours);
+
+    // Разделы со своим форматом (PIN, пароль, сети WiFi) разбирают их владельцы.
+    // Обработчик вызывается под мьютексом и не должен обращаться к ConfigManager.
+    void readSection(ConfigSection section, const std::function<void(const JsonDocument&)>& reader);
+    // После writer раздел помечается измененным. immediate - записать сразу
+    // (счетчик ошибок PIN, учетные данные); возвращает false при ошибке записи.
+    bool writeSection(ConfigSection section, const std::function<void(JsonDocument&)>& writer, bool immediate = false);
 
 private:
-    // Internal state for configuration values
-    Theme _currentTheme = Theme::DARK; // Default theme
+    static const int SECTION_COUNT = (int)ConfigSection::COUNT;
+
+    JsonDocument _docs[SECTION_COUNT];
+    SemaphoreHandle_t _mutex = nullptr;
+    uint8_t _dirtyMask = 0;
+    unsigned long _firstDirtyMs = 0;
+    unsigned long _lastDirtyMs = 0;
+
+    static const char* sectionPath(int section);
+    void loadSection(int section);
+    bool saveSection(int section);
+    void markDirty(int section);
 };
 
 #endif // CONFIG_MANAGER_H
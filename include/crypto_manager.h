@@ -3,6 +3,16 @@
 
 #include <Arduino.h>
 
+#define KDF_SALT_LENGTH 16
+#define KDF_HASH_LENGTH 32
+
+// Запись пароля для PBKDF2-HMAC-SHA256: соль, число итераций и результат
+struct PasswordRecord {
+    uint8_t salt[KDF_SALT_LENGTH];
+    uint8_t hash[KDF_HASH_LENGTH];
+    uint32_t iterations = 0;
+};
+
 class CryptoManager {
 public:
     // Хеширует пароль с использованием SHA-256
@@ -11,6 +21,25 @@ public:
     // Проверяет, соответствует ли пароль заданному хешу
     static bool verifyPassword(const String& password, const String& hash);
 
+    // Создает запись со случайной солью из аппаратного ГСЧ
+    static void createPasswordRecord(const String& password, uint32_t iterations, PasswordRecord& record);
+
+    // Проверяет пароль по записи; сравнение выполняется за постоянное время
+    static bool verifyPasswordRecord(const String& password, const PasswordRecord& record);
+
+    // Ключ шифрования KDF_HASH_LENGTH байт из пароля (тот же PBKDF2-HMAC-SHA256)
+    static bool deriveKey(const String& password, const uint8_t* salt, uint32_t iterations, uint8_t* key);
+
+    // Подбирает число итераций так, чтобы одна проверка занимала около targetMs
+    static uint32_t calibrateIterations(uint32_t targetMs, uint32_t minIterations);
+
+    // Преобразования hex <-> байты для хранения записей в JSON
+    static String toHex(const uint8_t* data, size_t length);
+    static bool fromHex(const String& hex, uint8_t* data, size_t length);
+
+    // Сравнение за постоянное время (не зависит от позиции первого отличия)
+    static bool constantTimeEquals(const char* a, const char* b, size_t length);
+
     // Декодирует строку Base64
     static String base64Decode(const String& encoded);
 };
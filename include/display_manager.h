@@ -2,8 +2,12 @@
 #define DISPLAY_MANAGER_H
 
 #include <TFT_eSPI.h>
+#include <functional>
 #include "animation_manager.h"
 #include "ui_themes.h" // Include new theme definitions
+#include "time_manager.h"
+#include "qr_code.h"
+#include "config.h"
 
 class DisplayManager {
 public:
@@ -16,12 +20,33 @@ public:
     
     void drawLayout(const String& serviceName, int batteryPercentage, bool isCharging); 
     void updateBatteryStatus(int percentage, bool isCharging);
-    void updateTOTPCode(const String& code, int timeRemaining);
+    void updateTOTPCode(const String& code, int timeRemaining, int period = CONFIG_TOTP_STEP_SIZE);
+
+    // Список ключей: имя и код запрашиваются только для видимых строк.
+    // false - индекса уже нет (список изменили из веб-интерфейса).
+    typedef std::function<bool(int index, String& name, String& code)> KeyRowProvider;
+    void drawKeyListLayout(int batteryPercentage, bool isCharging);
+    // Выводит только изменившиеся строки; окно списка следует за выбранной строкой
+    void updateKeyList(int keyCount, int selected, int timeRemaining, const KeyRowProvider& rowProvider);
     void turnOff();
     void turnOn();
     bool isCharging() const { return _isCharging; }
 
-    void setTheme(Theme theme); // New method to set the theme
+    // Новая палитра применяется в update(): на экране с кодом - плавным
+    // переходом за THEME_FADE_MS без очистки экрана, иначе сразу.
+    // Можно вызывать из задачи веб-сервера.
+    void setTheme(const ThemeColors& colors);
+
+    // QR-код на весь экран до dismissQrCode() или QR_DISPLAY_MS.
+    // Как и setTheme, выводится в update() и может вызываться из задачи веб-сервера.
+    void showQrCode(const QrCode& qr, const String& caption);
+    bool isShowingQrCode() const { return _qrActive || _hasPendingQr; }
+    void dismissQrCode();
+
+    // Индикатор точности времени в заголовке
+    void setTimeConfidence(TimeConfidence confidence);
+    // Временно показывает текст в заголовке вместо названия сервиса (не блокирует)
+    void showStatus(const String& text, unsigned long durationMs);
 
     // Deprecated, but kept for compatibility with other code
     void showMessage(const String& text, int x, int y, bool isError = false, int size = 1);
@@ -34,21 +59,75 @@ private:
     enum class TotpState { IDLE, SCRAMBLING, REVEALING };
 
     void drawBatteryOnSprite(int percentage, bool isCharging, int chargingValue = 0);
+    void drawTimeConfidenceOnSprite();
     void drawTotpContainer();
     void drawTotpText(const String& textToDraw);
+    void drawProgressBar(int timeRemaining);
+    void drawListRow(int slot, const String& name, const String& code, bool selected);
+    void drawListProgress(int timeRemaining);
+    void invalidateKeyList();
+    void applyPendingQrCode();
+    void drawQrCode();
+    void fillBackground();
+    void applyPendingTheme();
+    void updateThemeFade();
 
     TFT_eSPI tft;
     AnimationManager animationManager;
     TFT_eSprite headerSprite;
     TFT_eSprite totpContainerSprite;
     TFT_eSprite totpSprite;
-    const ThemeColors* _currentThemeColors; // Pointer to the active theme colors
+    TFT_eSprite rowSprite; // Одна строка списка ключей, переиспользуется для всех строк
+    const ThemeColors* _currentThemeColors; // Палитра для отрисовки: _themeColors или шаг перехода
+    ThemeColors _themeColors;
+
+    // Переход между темами: палитры промежуточных шагов считаются один раз
+    // при смене темы, кадр перехода - это перерисовка затронутых элементов
+    // с палитрой шага. Заголовок перерисовывается анимацией сам.
+    static const int THEME_FADE_STEPS = 8;
+    static const unsigned long THEME_FADE_MS = 320;
+    ThemeColors _fadeTable[THEME_FADE_STEPS];
+    uint8_t _fadeChangedMask = 0; // Биты цветов палитры, которые меняются
+    bool _fading = false;
+    int _fadeStep = -1;           // Последний выведенный шаг
+    unsigned long _fadeStartMs = 0;
+    portMUX_TYPE _pendingLock = portMUX_INITIALIZER_UNLOCKED; // Передача темы и QR-кода из других задач
+    ThemeColors _pendingTheme;
+    bool _hasPendingTheme = false;
+    bool _layoutActive = false;   // На экране заголовок, код и полоса времени
+
+    // Список ключей. Аппаратная прокрутка ST7789 идет вдоль 320-пиксельной оси
+    // матрицы, а в альбомной ориентации это горизонталь - поэтому при сдвиге
+    // окна перерисовываются только видимые строки, без очистки экрана.
+    static const int LIST_ROW_HEIGHT = 24;
+    static const int LIST_VISIBLE_ROWS = 4;
+    struct ListRow {
+        int index = -2; // -1 - пустая строка, -2 - не нарисована
+        bool selected = false;
+        String name;
+        String code;
+    };
+    ListRow _listRows[LIST_VISIBLE_ROWS];
+    bool _listActive = false;
+    int _listFirst = 0;           // Индекс ключа в верхней видимой строке
+    int _listTimeRemaining = -1;
+
+    QrCode _qrCode;
+    char _qrCaption[48];
+    QrCode _pendingQr;
+    char _pendingQrCaption[48];
+    bool _hasPendingQr = false;
+    bool _qrActive = false;
+    unsigned long _qrShownAt = 0;
 
     // State Machine Variables
     HeaderState _headerState = HeaderState::STATIC;
     String _currentServiceName;
     int _currentBatteryPercentage = 0;
     bool _isCharging = false;
+    TimeConfidence _timeConfidence = TimeConfidence::NONE;
+    String _statusText;
+    unsigned long _statusUntil = 0;
 
     // Animation-specific variables
     unsigned long _introAnimStartTime = 0;
@@ -57,6 +136,7 @@ private:
     // Variables for flicker-free TOTP updates
     String lastDisplayedCode;
     int lastTimeRemaining;
+    int _totpPeriod = CONFIG_TOTP_STEP_SIZE;
 
     // --- New variables for the premium TOTP animation ---
     TotpState _totpState = TotpState::IDLE;
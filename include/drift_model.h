@@ -0,0 +1,53 @@
+#ifndef DRIFT_MODEL_H
+#define DRIFT_MODEL_H
+
+#include <stdint.h>
+
+// Модель дрейфа кварца устройства.
+// Сравнивает монотонное время устройства (esp_timer) с эталонным (NTP) и
+// методом наименьших квадратов оценивает скорость ухода часов в ppm.
+// Оценка из прошлых сессий (сохраненная в /config.json) используется как
+// априорная и смешивается с текущей пропорционально длительности наблюдения.
+// Не зависит от Arduino, поэтому модель можно прогонять на хосте
+// на синтетических последовательностях синхронизаций.
+class DriftModel {
+public:
+    static const int MAX_SAMPLES = 8;
+    static constexpr float MAX_PPM = 500.0f;
+    static constexpr float MAX_WEIGHT_HOURS = 48.0f;  // Предел веса накопленной оценки
+    static const int64_t MIN_SPAN_US = 600LL * 1000000LL;   // Меньше 10 минут - оценка ненадежна
+    static const int64_t JITTER_US = 1000000LL;             // Допустимая погрешность одной синхронизации
+
+    DriftModel();
+
+    // Оценка из прошлых сессий и ее вес (часы наблюдения)
+    void setPrior(float ppm, float weightHours);
+    // Новая пара "монотонное время / эталонное время". Возвращает false для выброса.
+    bool addSample(int64_t localUs, int64_t referenceUs);
+    void resetSession();
+
+    // Положительное значение - часы устройства отстают
+    float getDriftPpm() const;
+    float getWeightHours() const;
+    int getSampleCount() const { return _count; }
+
+    // Поправка (мкс), которую нужно добавить к часам за интервал localElapsedUs
+    int64_t correctionUs(int64_t localElapsedUs) const;
+
+private:
+    struct Sample {
+        int64_t localUs;
+        int64_t referenceUs;
+    };
+
+    const Sample& sampleAt(int i) const;
+    bool fitSession(float& ppm, float& spanHours) const;
+
+    Sample _samples[MAX_SAMPLES];
+    int _count = 0;
+    int _head = 0; // Индекс самого старого отсчета
+    float _priorPpm = 0.0f;
+    float _priorWeightHours = 0.0f;
+};
+
+#endif // DRIFT_MODEL_H
@@ -0,0 +1,93 @@
+#ifndef FLASH_FS_H
+#define FLASH_FS_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+#define FLASH_ERASE_BLOCK_SIZE 4096   // Блок LittleFS на ESP32 = сектор стирания
+#define FLASH_ENDURANCE_CYCLES 100000 // Паспортный ресурс NOR-флеша, циклов стирания на блок
+
+// Учет ввода-вывода по одному логическому файлу. Временный (.tmp) и
+// резервный (.bak) файлы AtomicFile считаются вместе с основным - так
+// видно, во сколько раз запись дороже самих данных.
+struct FlashFileStats {
+    static const size_t PATH_LENGTH = 31;
+
+    char path[PATH_LENGTH + 1];
+    uint32_t opens;
+    uint32_t bytesRead;
+    uint32_t bytesWritten;
+    uint32_t eraseBlocks;  // Записи, равные стиранию блока: на каждую сессию записи ceil(байт / блок), минимум 1
+    uint32_t metadataOps;  // Удаления и переименования
+};
+
+class FlashFS;
+
+// Открытый файл. Считает байты и при закрытии записывает сессию записи в FlashFS.
+// Только перемещается: у сессии записи один владелец.
+class FlashFile {
+public:
+    FlashFile() {}
+    FlashFile(FlashFile&& other);
+    FlashFile& operator=(FlashFile&& other);
+    FlashFile(const FlashFile&) = delete;
+    FlashFile& operator=(const FlashFile&) = delete;
+    ~FlashFile();
+
+    explicit operator bool() { return (bool)_file; }
+    size_t size() { return _file.size(); }
+    size_t read(uint8_t* buffer, size_t length);
+    size_t write(const uint8_t* buffer, size_t length);
+    void flush() { _file.flush(); }
+    void close();
+
+private:
+    friend class FlashFS;
+    FlashFile(FlashFS* owner, fs::File file, int stats, bool writing);
+
+    FlashFS* _owner = nullptr;
+    fs::File _file;
+    int _stats = -1;
+    bool _writing = false;
+    uint32_t _sessionBytes = 0;
+};
+
+// Тонкая обертка над файловой системой, через которую работают все менеджеры.
+// Счетчики живут в RAM с момента загрузки: сохранять их во флеш значило бы
+// самим изнашивать то, что измеряем.
+class FlashFS {
+public:
+    static const int MAX_TRACKED_FILES = 16; // Остальные пути учитываются строкой "other"
+
+    explicit FlashFS(fs::FS& fs);
+    // Размер раздела для оценки износа (после монтирования)
+    void begin(size_t partitionBytes);
+
+    FlashFile open(const String& path, const char* mode);
+    bool exists(const String& path);
+    bool remove(const String& path);
+    bool rename(const String& from, const String& to);
+
+    // Счетчики по файлам, итоги и оценка износа в формате Prometheus
+    void appendPrometheus(String& out);
+
+private:
+    friend class FlashFile;
+
+    fs::FS& _fs;
+    size_t _partitionBytes = 0;
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    FlashFileStats _files[MAX_TRACKED_FILES + 1]; // Последний - "other"
+    int _fileCount = 0;
+
+    int statsIndex(const String& path);
+    void addRead(int stats, size_t bytes);
+    void addWrite(int stats, size_t bytes);
+    void endWriteSession(int stats, uint32_t bytes);
+    void addMetadataOp(const String& path);
+};
+
+// Файловая система устройства (LittleFS)
+extern FlashFS flashFS;
+
+#endif // FLASH_FS_H
@@ -3,34 +3,125 @@
 
 #include <vector>
 #include <Arduino.h>
+#include <ArduinoJson.h>
+#include "totp_generator.h"
+#include "secret_store.h"
 
 // Структура для хранения ключа
 struct TOTPKey {
     String name;
-    String secret;
+    String secret; // Base32; у ключей внутри KeyManager пустой - секреты лежат в SecretStore
+    String group; // Необязательная группа ("" - без группы)
+    OtpAlgorithm algorithm;
+    uint8_t digits;
+    uint16_t period; // Кратен CONFIG_TOTP_STEP_SIZE
 };
 
+#define KEY_CHANGE_LOG_SIZE 16 // Сколько последних изменений помнит журнал для дельта-ответов
+
+// Одно изменение списка ключей. Клиент повторяет изменения по порядку:
+// ADD добавляет name в конец, REMOVE удаляет ключ index, RESET - список заменен целиком
+enum class KeyChangeType : uint8_t { ADD, REMOVE, RESET };
+
+struct KeyChange {
+    uint32_t revision; // Версия списка после изменения
+    KeyChangeType type;
+    int index;
+    String name;
+    String group;
+    uint16_t period;
+};
+
+// Список меняют обработчики веб-сервера (задача AsyncTCP), а читают основной
+// цикл и рассылка событий. Параметры ключей, индексы, журнал изменений и
+// секреты защищены одним рекурсивным мьютексом: каждый открытый метод видит
+// их согласованными, а computeCode() берет параметры и секрет одного ключа.
+// Номера ключей между вызовами могут устареть - проверяйте getRevision().
 class KeyManager {
 public:
     KeyManager();
     bool begin(); // Загружает ключи в память при старте
     
     // Функции для управления ключами
-    bool addKey(const String& name, const String& secret);
+    bool addKey(const String& name, const String& secret, const String& group = "");
+    bool addKey(const TOTPKey& key);
+    // Добавляет ключи одной записью во флеш; в rejected - номера отклоненных (имя занято или секрет не Base32)
+    int addKeys(const std::vector<TOTPKey>& newKeys, std::vector<int>& rejected);
+    // Слияние импорта с текущим списком одной записью во флеш: ключ пропускается,
+    // если его имя или секрет уже есть (в списке или раньше в том же импорте).
+    // В duplicates - номера пропущенных повторов, в rejected - ключей, которые не
+    // удалось сохранить (секрет не Base32 или не хватило памяти).
+    int mergeKeys(const std::vector<TOTPKey>& newKeys, std::vector<int>& duplicates, std::vector<int>& rejected);
     bool removeKey(int index);
+    // Копии ключей без секретов
     std::vector<TOTPKey> getAllKeys();
+
+    // Текущий код ключа; "" - нет такого индекса. Секрет копируется во временный
+    // буфер на стеке только на время вычисления и сразу затирается.
+    String computeCode(int index);
+    // Ключ вместе с секретом в Base32 - только для экспорта, резервной копии и QR-кода.
+    // Вызывающий затирает out.secret через SecretStore::wipe().
+    bool exportKey(int index, TOTPKey& out);
+
+    // Формат ключа в файле, экспорте и импорте; параметры по умолчанию не пишутся
+    static void keyFromJson(JsonObjectConst obj, TOTPKey& key);
+    static void keyToJson(const TOTPKey& key, JsonObject obj);
+    // Затирает строку секрета на месте в пуле документа (после сериализации или разбора).
+    // Пул хранит одинаковые строки один раз: затирать можно, только когда все
+    // секреты документа уже скопированы или сериализованы.
+    static void wipeSecret(JsonObject obj);
+    size_t getKeyCount();
+    // Копия одного ключа без секрета; false, если такого индекса уже нет
+    bool getKey(int index, TOTPKey& out);
+
+    // Упорядоченный показ: по группе, затем по имени, без учета регистра
+    // (ключи без группы первые). Позиция - место ключа в этом порядке.
+    // Индексы пересобираются при изменении списка, поиск по ним - O(log n).
+    int getKeyAtPosition(int position);
+    int getPositionOf(int index);
+    // Соседний ключ в этом порядке (step = +1/-1) с переходом через край
+    int nextInOrder(int index, int step);
+    // Первый ключ следующей группы
+    int nextGroup(int index);
+    // Первый по алфавиту ключ, имя которого начинается с prefix; -1 - нет
+    int findByPrefix(const String& prefix);
+    // Ключи, чье имя начинается с query или чья группа равна query, в порядке показа
+    void findMatching(const String& query, std::vector<int>& out);
     bool replaceAllKeys(const String& jsonContent); // Новая функция
+    bool replaceAllKeys(const std::vector<TOTPKey>& newKeys);
+
+    // Номер версии списка ключей: растет при каждом изменении.
+    // Начальное значение случайное, чтобы версии до перезагрузки не совпадали с новыми.
+    uint32_t getRevision();
+    // Изменения после версии since; false, если журнал их уже не содержит
+    bool getChangesSince(uint32_t since, std::vector<KeyChange>& changes);
 
 private:
     bool loadKeys();
     bool saveKeys();
+    bool insertKey(const TOTPKey& key);
+    bool storeKey(const TOTPKey& key); // Без проверки имени и без записи в журнал
 
     // Шифрование/дешифрование с помощью внутреннего ключа
     void generateDeviceKey(unsigned char* key);
     bool encryptData(const uint8_t* plain, size_t plain_len, std::vector<uint8_t>& output);
     bool decryptData(const uint8_t* encrypted, size_t encrypted_len, std::vector<uint8_t>& output);
 
-    std::vector<TOTPKey> keys; // Ключи хранятся в памяти в расшифрованном виде
+    SemaphoreHandle_t mutex;
+    StaticSemaphore_t mutexBuffer; // Мьютекс создается в конструкторе, без кучи
+
+    std::vector<TOTPKey> keys; // Имена и параметры ключей, без секретов
+    SecretStore secrets;       // Секреты в том же порядке, что и keys
+    volatile uint32_t revision = 0;
+    KeyChange changeLog[KEY_CHANGE_LOG_SIZE];
+    int changeCount = 0; // Всего записей в журнале (не больше KEY_CHANGE_LOG_SIZE)
+    void recordChange(KeyChangeType type, int index, const String& name, const String& group = "",
+                      uint16_t period = CONFIG_TOTP_STEP_SIZE);
+
+    std::vector<uint16_t> byName;     // Индексы ключей, отсортированные по имени
+    std::vector<uint16_t> byGroup;    // ... по группе и имени (порядок показа)
+    std::vector<uint16_t> groupPosition; // Обратный к byGroup: индекс ключа -> позиция
+    void rebuildIndex();
 };
 
 #endif // KEY_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef KEYS_RESPONSE_H
+#define KEYS_RESPONSE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+#include <vector>
+#include "key_manager.h"
+
+// Тело GET /api/keys. Номер и остаток шага CONFIG_TOTP_STEP_SIZE, затем имена,
+// группы и периоды по индексу и коды в том же порядке:
+//   {"rev":R,"step":S,"left":L,"names":[...],"groups":[...],"periods":[...],"codes":[...]}
+// Периоды кратны шагу; остаток времени ключа с периодом P клиент считает как
+// P - ((S % (P / шаг)) * шаг + шаг - L). Дельта (?since=<rev>) вместо names,
+// groups и periods передает изменения по порядку:
+//   "ops":[["+",name,group,period],["-",index]]
+// Совпавший ETag (версия + шаг) - ответ 304 без тела.
+class KeysResponse {
+public:
+    // Код ключа по индексу
+    typedef std::function<String(int index)> CodeSource;
+
+    static String etag(uint32_t revision, time_t now);
+    // rev, step и left - общие для всех ответов, в том числе для поиска (?q=)
+    static void header(JsonDocument& doc, uint32_t revision, time_t now);
+    static void full(JsonDocument& doc, uint32_t revision, time_t now, const std::vector<TOTPKey>& keys, CodeSource code);
+    static void delta(JsonDocument& doc, uint32_t revision, time_t now, const std::vector<KeyChange>& changes,
+                      size_t keyCount, CodeSource code);
+
+private:
+    static void codes(JsonDocument& doc, size_t keyCount, CodeSource code);
+};
+
+#endif // KEYS_RESPONSE_H
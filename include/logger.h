@@ -0,0 +1,58 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+
+// Уровни журнала. Порог задается флагом сборки -DAPP_LOG_LEVEL=<n>
+// (см. platformio.ini): вызовы выше порога убираются препроцессором
+// вместе с аргументами и ничего не стоят.
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef APP_LOG_LEVEL
+#define APP_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Журнал в кольцевом буфере. Запись только форматирует строку и копирует
+// ее в буфер; в Serial буфер выводит фоновая задача, а /api/logs отдает
+// последние LOG_BUFFER_SIZE байт. Безопасен для вызова из любой задачи.
+class Logger {
+public:
+    static const size_t LOG_BUFFER_SIZE = 4096;
+    static const size_t MAX_LINE_LENGTH = 160;
+
+    // Запускает задачу вывода в Serial; записи до вызова сохраняются в буфере
+    static void begin();
+    static void write(int level, const char* tag, const char* format, ...) __attribute__((format(printf, 3, 4)));
+    // Текущее содержимое буфера (целые строки)
+    static String dump();
+};
+
+#if APP_LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(tag, format, ...) Logger::write(LOG_LEVEL_ERROR, tag, format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(tag, format, ...) ((void)0)
+#endif
+
+#if APP_LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(tag, format, ...) Logger::write(LOG_LEVEL_WARN, tag, format, ##__VA_ARGS__)
+#else
+#define LOG_WARN(tag, format, ...) ((void)0)
+#endif
+
+#if APP_LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(tag, format, ...) Logger::write(LOG_LEVEL_INFO, tag, format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(tag, format, ...) ((void)0)
+#endif
+
+#if APP_LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(tag, format, ...) Logger::write(LOG_LEVEL_DEBUG, tag, format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(tag, format, ...) ((void)0)
+#endif
+
+#endif // LOGGER_H
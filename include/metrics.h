@@ -0,0 +1,55 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Счетчики и таймеры горячих путей для /api/metrics.
+// Включаются флагом сборки -DMETRICS_ENABLED=1 (см. platformio.ini); без него
+// макросы ниже раскрываются в пустоту и модуль не попадает в прошивку.
+
+enum MetricCounter {
+    METRIC_TOTP_GENERATED,
+    METRIC_FRAMES_RENDERED,
+    METRIC_SPI_BYTES,
+    METRIC_COUNTER_COUNT
+};
+
+enum MetricTimer {
+    METRIC_TIMER_TOTP,
+    METRIC_TIMER_FRAME,
+    METRIC_TIMER_COUNT
+};
+
+#if METRICS_ENABLED
+
+class Metrics {
+public:
+    static const int MAX_ENDPOINTS = 28;
+    static const size_t MAX_PATH_LENGTH = 31;
+
+    static void add(MetricCounter counter, uint32_t value);
+    static void recordTime(MetricTimer timer, uint32_t us);
+    // Запросы считаются по маршруту; nullptr (неизвестный путь) и переполнение
+    // таблицы - в строку "other"
+    static void countRequest(const char* path);
+
+    // Дописывает все метрики в текстовом формате Prometheus
+    static void appendPrometheus(String& out);
+};
+
+#define METRIC_ADD(counter, value) Metrics::add(counter, value)
+#define METRIC_TIMER_BEGIN(name) int64_t name##MetricStart = esp_timer_get_time()
+#define METRIC_TIMER_END(timer, name) Metrics::recordTime(timer, (uint32_t)(esp_timer_get_time() - name##MetricStart))
+#define METRIC_WEB_REQUEST(path) Metrics::countRequest(path)
+
+#else
+
+#define METRIC_ADD(counter, value) ((void)0)
+#define METRIC_TIMER_BEGIN(name) ((void)0)
+#define METRIC_TIMER_END(timer, name) ((void)0)
+#define METRIC_WEB_REQUEST(path) ((void)0)
+
+#endif // METRICS_ENABLED
+
+#endif // METRICS_H
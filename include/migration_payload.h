@@ -0,0 +1,28 @@
+#ifndef MIGRATION_PAYLOAD_H
+#define MIGRATION_PAYLOAD_H
+
+#include <Arduino.h>
+#include <vector>
+#include "key_manager.h"
+
+#define MIGRATION_MAX_TEXT 128 // Предел длины имени и издателя в записи экспорта
+
+// Экспорт Google Authenticator ("Перенос аккаунтов"):
+//   otpauth-migration://offline?data=<Base64 сообщения MigrationPayload>
+// Большой экспорт разбит на несколько QR-кодов (batch_size/batch_index),
+// каждый URI разбирается отдельно.
+//
+// Разбор потоковый: Base64 (вместе с %-кодированием) разворачивается по
+// байту прямо в декодер protobuf, и в памяти не бывает ни декодированного
+// сообщения целиком, ни вложенных записей - только поля текущей записи.
+class MigrationPayload {
+public:
+    static bool isMigrationUri(const String& uri);
+
+    // Ключи из одного URI. Записи, которые устройство не поддерживает (HOTP, MD5),
+    // пропускаются с пояснением в skipped; false - URI или сообщение повреждены,
+    // тогда keys не меняется: ключи до поврежденного места тоже отбрасываются.
+    static bool parse(const String& uri, std::vector<TOTPKey>& keys, std::vector<String>& skipped, String& error);
+};
+
+#endif // MIGRATION_PAYLOAD_H
@@ -0,0 +1,34 @@
+#ifndef OTPAUTH_H
+#define OTPAUTH_H
+
+#include <Arduino.h>
+#include "key_manager.h"
+
+// Параметры из URI формата Google Authenticator:
+//   otpauth://totp/Issuer:account?secret=BASE32&issuer=Issuer&algorithm=SHA1&digits=6&period=30
+//   otpauth://hotp/label?secret=BASE32&counter=0
+struct OtpAuthParams {
+    bool hotp;
+    String issuer;  // Из параметра issuer, иначе из префикса метки до ':'
+    String account;
+    String secret;  // Base32 в верхнем регистре, без пробелов и '='
+    OtpAlgorithm algorithm;
+    uint8_t digits;
+    uint32_t period;
+    uint64_t counter;
+};
+
+class OtpAuthUri {
+public:
+    static bool parse(const String& uri, OtpAuthParams& params, String& error);
+    // Ключ из параметров: HOTP и периоды, не кратные CONFIG_TOTP_STEP_SIZE, не поддерживаются
+    static bool toKey(const OtpAuthParams& params, TOTPKey& key, String& error);
+    // URI для переноса ключа на другое устройство (QR-код)
+    static String build(const TOTPKey& key);
+
+private:
+    static bool percentDecode(const String& text, bool plusIsSpace, String& out);
+    static void percentEncode(const String& text, String& out);
+};
+
+#endif // OTPAUTH_H
@@ -0,0 +1,70 @@
+#ifndef PIN_ENTRY_H
+#define PIN_ENTRY_H
+
+#include <stdint.h>
+
+enum class PinEntryState {
+    IDLE,       // Ввод не запрошен
+    LOCKED,     // Задержка после неверных попыток
+    INPUT,      // Выбор и подтверждение цифр
+    VERIFY,     // PIN набран, владелец должен проверить его и вызвать setResult()
+    ACCEPTED,   // "PIN OK" на экране
+    REJECTED,   // "WRONG PIN" на экране
+    DONE        // Доступ открыт
+};
+
+enum class PinButton {
+    NEXT,       // Следующая цифра
+    CONFIRM     // Принять цифру
+};
+
+// Логика экрана ввода PIN-кода без ожиданий и без обращения к дисплею.
+// Кнопки и время передаются снаружи, а отрисовщик забирает флаги
+// изменившихся ячеек и перерисовывает только их. Не зависит от Arduino,
+// поэтому сценарии нажатий можно прогонять на хосте.
+class PinEntry {
+public:
+    static const int MAX_LENGTH = 10;
+    static const unsigned long ACCEPTED_MS = 1000;
+    static const unsigned long REJECTED_MS = 1000;
+
+    PinEntry();
+
+    void start(int length, unsigned long lockoutMs, unsigned long now);
+    void press(PinButton button, unsigned long now);
+    void update(unsigned long now);
+    // Результат проверки для состояния VERIFY; lockoutMs - задержка перед следующей попыткой
+    void setResult(bool ok, unsigned long lockoutMs, unsigned long now);
+
+    PinEntryState getState() const { return _state; }
+    bool isActive() const { return _state != PinEntryState::IDLE && _state != PinEntryState::DONE; }
+    int getLength() const { return _length; }
+    int getEnteredCount() const { return _entered; }
+    int getCurrentDigit() const { return _currentDigit; }
+    // Набранный PIN (строка из _entered цифр), действителен до setResult()
+    const char* getPin() const { return _pin; }
+    unsigned long getLockoutRemainingMs(unsigned long now) const;
+
+    // Флаги перерисовки; чтение сбрасывает флаг
+    bool takeScreenDirty();     // Сменилось состояние - нужен полный экран
+    uint16_t takeDirtyCells();  // Бит i - ячейка маски i
+    bool takeDigitDirty();      // Цифра в селекторе
+
+private:
+    void enter(PinEntryState state, unsigned long now);
+    void clearPin();
+
+    PinEntryState _state;
+    int _length;
+    int _entered;
+    int _currentDigit;
+    char _pin[MAX_LENGTH + 1];
+    unsigned long _stateStart;
+    unsigned long _lockoutMs;
+
+    bool _screenDirty;
+    uint16_t _dirtyCells;
+    bool _digitDirty;
+};
+
+#endif // PIN_ENTRY_H
@@ -2,37 +2,75 @@
 #define PIN_MANAGER_H
 
 #include "display_manager.h"
+#include "crypto_manager.h"
+#include "pin_entry.h"
+#include "config.h"
+#include "config_manager.h"
 
-#define PIN_FILE "/pincode.json"
 #define DEFAULT_PIN_LENGTH 6
 #define MAX_PIN_LENGTH 10
 
+#define PIN_KDF_TARGET_MS 500          // Время одной проверки PIN-кода
+#define PIN_BACKOFF_FREE_ATTEMPTS 3    // Ошибок без задержки
+#define PIN_BACKOFF_BASE_MS 2000UL     // Задержка после первой "платной" ошибки, дальше удваивается
+#define PIN_BACKOFF_MAX_MS 300000UL    // Верхняя граница задержки (5 минут)
+#define PIN_WIPE_MIN_ATTEMPTS 5        // Минимальный порог стирания ключей (0 - стирание выключено)
+
 class PinManager {
 public:
-    PinManager(DisplayManager& display);
+    PinManager(DisplayManager& display, ConfigManager& config);
     void begin();
     bool isPinEnabled();
     bool isPinSet();
-    void requestPin();
+    // Неблокирующий ввод PIN-кода: startEntry() один раз, затем update()
+    // в каждом кадре основного цикла, пока isEntryActive()
+    void startEntry();
+    void update();
+    bool isEntryActive();
     
     // Methods for web server interaction
     void setPin(const String& newPin);
     void setEnabled(bool enabled);
     int getPinLength();
     void setPinLength(int newLength);
+    // Настройки пишутся с задержкой через ConfigManager
     void saveConfig();
-    void loadPinConfig();
+
+    // Стирание ключей после N неверных PIN подряд (0 - выключено)
+    int getWipeAfter();
+    void setWipeAfter(int attempts);
+    int getFailedAttempts();
+
+    // Задержка перед следующей попыткой по числу ошибок подряд
+    static unsigned long backoffForFailures(int failures);
 
 private:
     DisplayManager& displayManager;
+    ConfigManager& configManager;
     int currentPinLength = DEFAULT_PIN_LENGTH;
     bool enabled = false;
-    String pinHash = "";
+    PasswordRecord pinRecord;
+    String legacyPinHash = ""; // Несоленый SHA-256 из старого файла до первого ввода
+    int failedAttempts = 0;
+    int wipeAfter = 0;
+    unsigned long lockoutUntil = 0;
 
-    void savePinConfig();
+    void loadPinConfig();
+    // immediate - счетчик ошибок должен попасть во флеш до проверки PIN
+    void savePinConfig(bool immediate = false);
     bool checkPin(const String& pin);
-    void drawPinScreen();
-    void updatePinScreen(int currentPosition, int currentDigit, const String& enteredPin);
+    void startLockout();
+    void wipeKeys();
+
+    PinEntry entry;
+    bool button1Down = false;
+    bool button2Down = false;
+    unsigned long lastButtonPress = 0;
+    unsigned long shownLockoutSeconds = 0;
+
+    void renderEntry(unsigned long now);
+    void drawPinCell(int index);
+    void drawSelectorDigit();
 };
 
 #endif // PIN_MANAGER_H
@@ -0,0 +1,52 @@
+#ifndef QR_CODE_H
+#define QR_CODE_H
+
+#include <Arduino.h>
+
+#define QR_MAX_VERSION 10                          // До 213 байт: хватает на otpauth:// URI
+#define QR_MAX_SIZE (17 + 4 * QR_MAX_VERSION)
+#define QR_BUFFER_BYTES ((QR_MAX_SIZE * QR_MAX_SIZE + 7) / 8)
+#define QR_MAX_CODEWORDS 346                       // Всего кодовых слов версии 10
+
+// Кодировщик QR-кода (ISO/IEC 18004): байтовый режим, уровень коррекции M,
+// наименьшая подходящая версия 1..QR_MAX_VERSION, маска с минимальным штрафом.
+// Модули хранятся по биту (1 - темный) построчно, без динамической памяти,
+// поэтому объект можно собрать в одной задаче и скопировать в другую.
+class QrCode {
+public:
+    bool encode(const uint8_t* data, size_t length);
+    bool encode(const String& text) { return encode((const uint8_t*)text.c_str(), text.length()); }
+
+    int version() const { return _version; }
+    int size() const { return _size; }
+    int mask() const { return _mask; }
+    bool module(int x, int y) const { return getBit(_modules, x, y); }
+
+private:
+    uint8_t _modules[QR_BUFFER_BYTES];
+    uint8_t _function[QR_BUFFER_BYTES]; // Служебные модули: не заполняются данными и не маскируются
+    int _version = 0;
+    int _size = 0;
+    int _mask = 0;
+
+    bool getBit(const uint8_t* buffer, int x, int y) const {
+        int i = y * _size + x;
+        return (buffer[i >> 3] >> (7 - (i & 7))) & 1;
+    }
+    void setBit(uint8_t* buffer, int x, int y, bool dark);
+    void setFunction(int x, int y, bool dark);
+
+    void drawFunctionPatterns();
+    void drawFinder(int x, int y);
+    void drawAlignment(int x, int y);
+    void drawFormatBits(int mask);
+    void drawVersion();
+    void drawCodewords(const uint8_t* codewords, int count);
+    void applyMask(int mask);
+    long penalty() const;
+};
+
+// Коды коррекции Рида-Соломона над GF(256) с полиномом 0x11D (открыты для проверки на хосте)
+void qrReedSolomon(const uint8_t* data, int length, int degree, uint8_t* result);
+
+#endif // QR_CODE_H
@@ -0,0 +1,63 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <stdint.h>
+
+// Решение по входящему запросу
+enum class Admission {
+    ALLOW,
+    RATE_LIMITED,   // У адреса кончились токены - 429
+    BUSY,           // Слишком много запросов обрабатывается одновременно - 503
+    LOW_MEMORY      // Куча ниже порога - 503 до того, как обработчик начнет выделять память
+};
+
+struct RateLimiterStats {
+    uint32_t allowed = 0;
+    uint32_t rateLimited = 0;
+    uint32_t busy = 0;
+    uint32_t lowMemory = 0;
+    uint16_t inFlight = 0;
+    uint16_t peakInFlight = 0;
+};
+
+// Ограничитель запросов веб-сервера: корзина токенов на каждый IP-адрес,
+// предел одновременно обрабатываемых запросов и порог свободной кучи.
+// Таблица адресов фиксированного размера, при переполнении вытесняется
+// давно не активный адрес. Состояние кучи и время передаются снаружи,
+// поэтому класс не зависит от Arduino и проверяется на хосте.
+class RateLimiter {
+public:
+    static const int MAX_CLIENTS = 8;
+
+    RateLimiter(uint16_t capacity, uint16_t refillPerSec, uint16_t maxInFlight,
+                uint32_t minFreeHeap, uint32_t minLargestBlock);
+
+    // cost - сколько токенов стоит запрос; countInFlight=false для долгих
+    // потоков (SSE), у которых свой предел подписчиков
+    Admission admit(uint32_t ip, uint16_t cost, unsigned long nowMs,
+                    uint32_t freeHeap, uint32_t largestBlock, bool countInFlight);
+    // Запрос, допущенный с countInFlight=true, завершен
+    void release();
+
+    const RateLimiterStats& getStats() const { return _stats; }
+
+private:
+    struct Bucket {
+        uint32_t ip;
+        uint32_t milliTokens;   // Токены * 1000, чтобы пополнять без float
+        unsigned long lastMs;
+    };
+
+    Bucket* findBucket(uint32_t ip, unsigned long nowMs);
+
+    uint32_t _capacityMilli;
+    uint16_t _refillPerSec;
+    uint16_t _maxInFlight;
+    uint32_t _minFreeHeap;
+    uint32_t _minLargestBlock;
+    Bucket _buckets[MAX_CLIENTS];
+    int _bucketCount;
+    RateLimiterStats _stats;
+};
+
+#endif // RATE_LIMITER_H
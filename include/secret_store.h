@@ -0,0 +1,42 @@
+#ifndef SECRET_STORE_H
+#define SECRET_STORE_H
+
+#include <Arduino.h>
+
+// Декодированные секреты всех ключей в одной области внутренней RAM
+// (не PSRAM): счетчик, таблица смещений и байты секретов подряд.
+//
+// Область не меняется на месте: добавление и удаление собирают новую и
+// затирают старую перед освобождением. Наружу секрет выдается только копией
+// в буфер вызывающего. Собственной блокировки нет: доступ из разных задач
+// упорядочивает владелец (KeyManager держит ее под своим мьютексом вместе
+// с параметрами ключей).
+class SecretStore {
+public:
+    SecretStore() {}
+    ~SecretStore();
+    SecretStore(const SecretStore&) = delete;
+    SecretStore& operator=(const SecretStore&) = delete;
+
+    size_t count();
+    bool append(const uint8_t* secret, size_t length);
+    bool remove(int index);
+    void clear();
+
+    // Копирует секрет в buffer (TOTP_MAX_SECRET_BYTES байт); 0 - нет такого индекса.
+    // Вызывающий затирает копию через wipe(), как только она не нужна.
+    size_t copy(int index, uint8_t* buffer);
+
+    // Затирание, которое компилятор не выбросит как мертвую запись
+    static void wipe(void* data, size_t length);
+    static void wipe(String& text);
+
+private:
+    uint8_t* _region = nullptr;
+    size_t _regionSize = 0;
+
+    // Новая область без секрета skip (-1 - без удаления) и с extra в конце (nullptr - без добавления)
+    bool rebuild(int skip, const uint8_t* extra, size_t extraLength);
+};
+
+#endif // SECRET_STORE_H
@@ -0,0 +1,39 @@
+#ifndef SESSION_MANAGER_H
+#define SESSION_MANAGER_H
+
+#include <Arduino.h>
+
+// Таблица сессий веб-интерфейса фиксированного размера.
+// Токен = 2 hex-символа номера слота + 30 hex-символов случайных данных
+// из аппаратного ГСЧ. Номер слота дает поиск за O(1), а сравнение
+// токена выполняется за постоянное время. Проверка не выделяет память.
+class SessionManager {
+public:
+    static const int MAX_SESSIONS = 4;
+    static const size_t TOKEN_LENGTH = 32;
+    static const unsigned long SESSION_TIMEOUT = 3600000; // 1 час в миллисекундах
+
+    SessionManager();
+
+    // Создает сессию (вытесняя самую старую при заполненной таблице)
+    // и возвращает ее токен
+    const char* create();
+    bool validate(const char* token, size_t length);
+    void revoke(const char* token, size_t length);
+
+    // Ищет значение cookie name в заголовке Cookie без копирования строки
+    static bool findCookie(const char* header, const char* name, const char** value, size_t* length);
+
+private:
+    struct Session {
+        bool active;
+        unsigned long createdMs;
+        char token[TOKEN_LENGTH + 1];
+    };
+
+    int findSlot(const char* token, size_t length);
+
+    Session _sessions[MAX_SESSIONS];
+};
+
+#endif // SESSION_MANAGER_H
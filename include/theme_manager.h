@@ -0,0 +1,43 @@
+#ifndef THEME_MANAGER_H
+#define THEME_MANAGER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include "ui_themes.h"
+
+#define MAX_CUSTOM_THEMES 6
+
+struct ThemeDefinition {
+    char name[THEME_NAME_LENGTH + 1];
+    ThemeColors colors;
+    bool builtin;
+};
+
+// Темы как данные: встроенные dark/light плюс загруженные через веб-интерфейс,
+// которые хранятся в THEMES_FILE. Формат темы (он же формат загрузки):
+//   {"name":"ocean","colors":{"background_dark":"#102030", ...}}
+// Нужны все THEME_COLOR_COUNT полей ThemeColors; цвет - "#RRGGBB" или число RGB565.
+// Список меняется только из обработчиков веб-сервера.
+class ThemeManager {
+public:
+    ThemeManager();
+    void begin();
+
+    // nullptr, если темы с таким именем нет
+    const ThemeColors* find(const String& name);
+    // Добавляет тему или заменяет загруженную с тем же именем
+    bool importTheme(const String& json, String& error);
+    // Встроенные темы удалить нельзя
+    bool removeTheme(const String& name);
+    // [{"name","builtin"}] в порядке показа
+    void listThemes(JsonArray out);
+
+private:
+    std::vector<ThemeDefinition> _themes; // Встроенные идут первыми
+
+    bool save();
+    static bool parseTheme(JsonObjectConst obj, ThemeDefinition& theme, String& error);
+};
+
+#endif // THEME_MANAGER_H
@@ -0,0 +1,54 @@
+#ifndef TIME_MANAGER_H
+#define TIME_MANAGER_H
+
+#include <Arduino.h>
+#include <sys/time.h>
+#include "config_manager.h"
+#include "drift_model.h"
+
+// Насколько можно доверять текущему системному времени
+enum class TimeConfidence {
+    NONE,      // Времени нет (холодный старт без синхронизации)
+    ESTIMATED, // Время из RTC или задано вручную, давно не сверялось с NTP
+    SYNCED     // Недавно синхронизировано с NTP
+};
+
+class TimeManager {
+public:
+    TimeManager(ConfigManager& configManager);
+    void begin();     // Восстанавливает состояние из RTC-памяти или /config.json
+    void startSync(); // Запускает SNTP в фоне (после подключения к WiFi)
+    void update();    // Вызывается из loop(): коррекция дрейфа и сохранение
+
+    // Ручная установка времени (портал настройки или Serial) для работы без сети
+    bool setManualTime(time_t epoch);
+    bool isManualTimeSet() const { return _manualTimeSet; }
+
+    bool isTimeValid();
+    TimeConfidence getConfidence();
+    float getDriftPpm();
+    time_t getLastSyncTime() const { return _lastSyncEpoch; }
+
+private:
+    static void onTimeSync(struct timeval* tv);
+    void handleSync(const struct timeval* tv);
+    void applyDriftCorrection();
+    void persist();
+
+    ConfigManager& _configManager;
+
+    // Поля ниже пишутся из колбэка SNTP (задача tcpip), поэтому под блокировкой
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    time_t _lastSyncEpoch = 0;
+    DriftModel _driftModel;
+    volatile uint32_t _syncCount = 0;
+    volatile bool _persistPending = false;
+    volatile bool _manualTimeSet = false;
+
+    float _persistedDriftPpm = 0.0f;
+    time_t _persistedSyncEpoch = 0;
+    unsigned long _lastCorrectionMs = 0;
+    float _pendingCorrectionUs = 0.0f;
+};
+
+#endif // TIME_MANAGER_H
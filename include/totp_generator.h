@@ -2,20 +2,33 @@
 #define TOTP_GENERATOR_H
 
 #include <Arduino.h>
+#include "config.h"
+
+enum class OtpAlgorithm : uint8_t { SHA1, SHA256, SHA512 };
 
 class TOTPGenerator {
 public:
     // Генерация TOTP кода из секрета в формате Base32
-    String generateTOTP(const String& base32Secret);
+    String generateTOTP(const String& base32Secret, uint8_t digits = CONFIG_TOTP_DIGITS,
+                        uint32_t period = CONFIG_TOTP_STEP_SIZE, OtpAlgorithm algorithm = OtpAlgorithm::SHA1);
+    // То же из декодированного секрета (буфер затирает вызывающий)
+    static String generateTOTP(const uint8_t* key, size_t keyLen, uint8_t digits, uint32_t period, OtpAlgorithm algorithm);
 
     // Получение оставшегося времени до следующего кода
-    int getTimeRemaining();
+    int getTimeRemaining(uint32_t period = CONFIG_TOTP_STEP_SIZE);
+
+    // Код HOTP (RFC 4226) для счетчика; для TOTP счетчик - номер периода
+    static String generateCode(const uint8_t* key, size_t keyLen, uint64_t counter, uint8_t digits, OtpAlgorithm algorithm);
+
+    // Декодирует не больше maxLen байт; 0 - ошибка или пустой секрет
+    static size_t base32Decode(const String& base32, uint8_t* output, size_t maxLen);
+    // Base32 без дополнения '='
+    static String base32Encode(const uint8_t* data, size_t length);
 
 private:
     // Вспомогательные функции
-    void hmacSha1(const uint8_t* key, size_t keyLen, const uint8_t* data, size_t dataLen, uint8_t* output);
-    uint32_t dynamicTruncation(uint8_t* hash);
-    size_t base32Decode(const String& base32, uint8_t* output);
+    static size_t hmac(OtpAlgorithm algorithm, const uint8_t* key, size_t keyLen, const uint8_t* data, size_t dataLen, uint8_t* output);
+    static uint32_t dynamicTruncation(const uint8_t* hash, size_t hashLen);
 };
 
-#endif
\ No newline at end of file
+#endif
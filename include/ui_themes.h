@@ -3,13 +3,13 @@
 
 #include <TFT_eSPI.h> // For uint16_t color definitions
 
-// Enum for available themes
-enum class Theme {
-    DARK,
-    LIGHT
-};
+#define THEME_NAME_LENGTH 15  // Имя темы: латиница, цифры, '-' и '_'
+#define THEME_COLOR_COUNT 8
+#define DEFAULT_THEME_NAME "dark"
 
-// Structure to hold all theme-specific colors
+// Structure to hold all theme-specific colors.
+// Поля идут подряд, поэтому палитру можно обходить как массив из
+// THEME_COLOR_COUNT цветов RGB565 (см. таблицы перехода в DisplayManager).
 struct ThemeColors {
     uint16_t background_dark;
     uint16_t background_light;
@@ -20,8 +20,9 @@ struct ThemeColors {
     uint16_t shadow_color;
     uint16_t error_color;
 };
+static_assert(sizeof(ThemeColors) == THEME_COLOR_COUNT * sizeof(uint16_t), "ThemeColors must be a plain palette");
 
-// Define color sets for each theme
+// Встроенные темы. Дополнительные загружаются из THEMES_FILE (см. ThemeManager).
 const ThemeColors DARK_THEME_COLORS = {
     .background_dark    = 0x0841, // Dark grey (from previous revert)
     .background_light   = 0x18E3, // Slightly lighter blue-grey (from previous revert)
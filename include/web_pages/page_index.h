@@ -10,15 +10,19 @@ const char index_html[] PROGMEM = R"rawliteral(
             <input type="text" id="key-name" name="name" required>
             <label for="key-secret">Secret (Base32):</label>
             <input type="text" id="key-secret" name="secret" required>
+            <label for="key-group">Group (optional):</label>
+            <input type="text" id="key-group" name="group">
             <button type="submit" class="button">Add Key</button>
         </form>
     </div>
     <div class="content-box">
         <h4>Current Keys</h4>
+        <input type="text" id="key-search" placeholder="Search: name prefix or group">
         <table id="keys-table">
             <thead>
                 <tr>
                     <th>Name</th>
+                    <th>Group</th>
                     <th>Code</th>
                     <th>Time Left</th>
                     <th>Actions</th>
@@ -35,27 +39,63 @@ const char index_html[] PROGMEM = R"rawliteral(
         <button id="import-keys-btn" class="button-action">Import Keys</button>
         <input type="file" id="import-file" style="display: none;" accept=".json">
     </div>
+    <div class="form-container">
+        <h4>Encrypted Backup</h4>
+        <p>The backup is encrypted with a passphrase and can be restored on any device. The passphrase cannot be recovered.</p>
+        <form id="backup-form">
+            <input type="password" id="backup-passphrase" placeholder="Passphrase (min. 8 characters)" minlength="8" required>
+            <button type="submit" class="button">Download Backup</button>
+        </form>
+        <form id="restore-form">
+            <input type="file" id="restore-file" accept=".tbk" required>
+            <input type="password" id="restore-passphrase" placeholder="Backup passphrase" required>
+            <label><input type="checkbox" id="restore-merge" checked> Merge with current keys (otherwise replace them)</label>
+            <button type="submit" class="button">Restore Backup</button>
+        </form>
+    </div>
+    <div class="form-container">
+        <h4>Import otpauth:// URIs</h4>
+        <p>Paste <code>otpauth://</code> URIs or Google Authenticator <code>otpauth-migration://</code> exports, one per line. Keys that already exist (same name or secret) are skipped.</p>
+        <form id="import-uris-form">
+            <textarea id="import-uris" rows="4" placeholder="One URI per line" required></textarea>
+            <button type="submit" class="button">Import URIs</button>
+        </form>
+    </div>
 </div>
 <div id="Display" class="tab-content">
     <h3>Display Settings</h3>
     <div class="form-container">
         <h4>Theme Selection</h4>
         <form id="theme-selection-form">
-            <label>
-                <input type="radio" name="theme" value="light" id="theme-light"> Light Theme
-            </label><br>
-            <label>
-                <input type="radio" name="theme" value="dark" id="theme-dark"> Dark Theme
-            </label><br>
+            <div id="theme-list"></div>
             <button type="submit" class="button">Apply Theme</button>
         </form>
     </div>
+    <div class="form-container">
+        <h4>Custom Theme</h4>
+        <form id="upload-theme-form">
+            <label for="theme-file">Upload theme (JSON):</label>
+            <input type="file" id="theme-file" accept=".json">
+            <button type="submit" class="button">Upload</button>
+        </form>
+    </div>
 </div><div id="Settings" class="tab-content"><h3>Device Settings</h3><div class="form-container"><h4>Change Admin Password</h4><form id="change-password-form"><input type="password" id="new-password" placeholder="New Password" required><input type="password" id="confirm-password" placeholder="Confirm New Password" required><button type="submit" class="button">Change Password</button></form></div><div class="form-container"><h4>Splash Screen</h4><form id="upload-splash-form" enctype="multipart/form-data"><label for="splash-file">Upload new splash screen (RAW, 135x240):</label><input type="file" id="splash-file" accept=".raw"><button type="submit" class="button">Upload</button></form><button id="delete-splash-btn" class="button-delete">Delete Splash</button></div><div class="form-container"><h4>System</h4><button id="reboot-btn" class="button-action">Reboot Device</button><button onclick="logout()" class="button-delete">Logout</button></div></div><div id="Pin" class="tab-content"><h3>PIN Code Settings</h3><div class="form-container"><form id="pincode-settings-form"><label for="pin-enabled">Enable PIN on startup:</label><input type="checkbox" id="pin-enabled" name="enabled"><br><br><label for="pin-length">PIN Length (4-10):</label><input type="number" id="pin-length" name="length" min="4" max="10" required><br><br><label for="new-pin">New PIN:</label><input type="password" id="new-pin" name="pin" placeholder="Leave blank to keep current"><label for="confirm-pin">Confirm New PIN:</label><input type="password" id="confirm-pin" name="pin_confirm" placeholder="Leave blank to keep current"><button type="submit" class="button">Save PIN Settings</button></form></div></div><script>function getCookie(name){const value=`; ${document.cookie}`;const parts=value.split(`; ${name}=`);if(parts.length===2)return parts.pop().split(';').shift();return null}
 function logout(){window.location.href='/logout'}
 function openTab(evt,tabName){var i,tabcontent,tablinks;tabcontent=document.getElementsByClassName("tab-content");for(i=0;i<tabcontent.length;i++){tabcontent[i].style.display="none"}tablinks=document.getElementsByClassName("tab-link");for(i=0;i<tablinks.length;i++){tablinks[i].className=tablinks[i].className.replace(" active","")}document.getElementById(tabName).style.display="block";evt.currentTarget.className+=" active"}
 function showStatus(message,isError=false){const statusDiv=document.getElementById('status');statusDiv.textContent=message;statusDiv.className='status-message '+(isError?'status-err':'status-ok');statusDiv.style.display='block';setTimeout(()=>statusDiv.style.display='none',5000)}
-function fetchKeys(){fetch('/api/keys').then(response=>response.json()).then(data=>{const tbody=document.querySelector('#keys-table tbody');tbody.innerHTML='';data.forEach((key,index)=>{const row=tbody.insertRow();row.innerHTML=`<td>${key.name}</td><td class="code">${key.code}</td><td><progress value="${key.timeLeft}" max="30"></progress></td><td><button class="button-delete" onclick="removeKey(${index})">Remove</button></td>`})}).catch(err=>showStatus('Error fetching keys.',true))}
-document.getElementById('add-key-form').addEventListener('submit',function(e){e.preventDefault();const name=document.getElementById('key-name').value;const secret=document.getElementById('key-secret').value;const formData=new FormData();formData.append('name',name);formData.append('secret',secret);fetch('/api/add',{method:'POST',body:new URLSearchParams(formData)}).then(res=>{if(res.ok){showStatus('Key added successfully!');fetchKeys();this.reset()}else{showStatus('Failed to add key.',true)}}).catch(err=>showStatus('Error: '+err,true))});
+let keyNames=[],keyGroups=[],keyPeriods=[],keyRev=null,keyQuery='',searchTimer=null;
+function applyKeyOps(ops){ops.forEach(op=>{if(op[0]==='+'){keyNames.push(op[1]);keyGroups.push(op[2]||'');keyPeriods.push(op[3]||30)}else{keyNames.splice(op[1],1);keyGroups.splice(op[1],1);keyPeriods.splice(op[1],1)}})}
+function rowLeft(period,step,left){return period-((step%(period/30))*30+30-left)}
+function keyButton(row,cls,text,handler){const b=document.createElement('button');b.className=cls;b.textContent=text;b.addEventListener('click',handler);row.appendChild(b)}
+function renderKeys(rows,step,left){const tbody=document.querySelector('#keys-table tbody');tbody.innerHTML='';rows.forEach(r=>{const row=tbody.insertRow();row.insertCell().textContent=r.name;row.insertCell().textContent=r.group;const code=row.insertCell();code.className='code';code.dataset.i=r.index;code.textContent=r.code;const bar=document.createElement('progress');bar.max=r.period;bar.value=rowLeft(r.period,step,left);row.insertCell().appendChild(bar);const actions=row.insertCell();keyButton(actions,'button-action','QR',()=>showQr(r.index));actions.append(' ');keyButton(actions,'button-delete','Remove',()=>removeKey(r.index))})}
+function fetchKeys(){if(keyQuery){fetch('/api/keys?q='+encodeURIComponent(keyQuery)).then(response=>response.json()).then(data=>renderKeys(data.indices.map((index,i)=>({index,name:data.names[i],group:data.groups[i],period:data.periods[i],code:data.codes[i]})),data.step,data.left)).catch(err=>showStatus('Error fetching keys.',true));return}
+fetch('/api/keys'+(keyRev!==null?'?since='+keyRev:'')).then(response=>response.json()).then(data=>{if(data.names){keyNames=data.names;keyGroups=data.groups;keyPeriods=data.periods}else applyKeyOps(data.ops);keyRev=data.rev;renderKeys(keyNames.map((name,index)=>({index,name,group:keyGroups[index],period:keyPeriods[index],code:data.codes[index]})),data.step,data.left)}).catch(err=>showStatus('Error fetching keys.',true))}
+document.getElementById('key-search').addEventListener('input',function(){clearTimeout(searchTimer);searchTimer=setTimeout(()=>{keyQuery=this.value.trim();fetchKeys()},250)});
+document.getElementById('add-key-form').addEventListener('submit',function(e){e.preventDefault();const name=document.getElementById('key-name').value;const secret=document.getElementById('key-secret').value;const formData=new FormData();formData.append('name',name);formData.append('secret',secret);formData.append('group',document.getElementById('key-group').value);fetch('/api/add',{method:'POST',body:new URLSearchParams(formData)}).then(res=>{if(res.ok){showStatus('Key added successfully!');fetchKeys();this.reset()}else{showStatus('Failed to add key.',true)}}).catch(err=>showStatus('Error: '+err,true))});
+document.getElementById('import-uris-form').addEventListener('submit',function(e){e.preventDefault();const formData=new FormData();formData.append('uris',document.getElementById('import-uris').value);fetch('/api/import_uris',{method:'POST',body:new URLSearchParams(formData)}).then(res=>res.json()).then(data=>{if(data.errors.length){showStatus(`Added ${data.added}, duplicates ${data.duplicates}, failed: `+data.errors.map(e=>`line ${e.line}: ${e.error}`).join('; '),true)}else{showStatus(`Added ${data.added} keys, skipped ${data.duplicates} duplicates.`);this.reset()}fetchKeys()}).catch(err=>showStatus('Error: '+err,true))});
+document.getElementById('backup-form').addEventListener('submit',function(e){e.preventDefault();const formData=new FormData();formData.append('passphrase',document.getElementById('backup-passphrase').value);showStatus('Preparing backup...');fetch('/api/backup',{method:'POST',body:new URLSearchParams(formData)}).then(res=>{if(!res.ok)return res.text().then(text=>{throw text});return res.blob()}).then(blob=>{const a=document.createElement('a');a.href=URL.createObjectURL(blob);a.download='keys_backup.tbk';a.click();URL.revokeObjectURL(a.href);showStatus('Backup downloaded.');this.reset()}).catch(err=>showStatus('Backup failed: '+err,true))});
+document.getElementById('restore-form').addEventListener('submit',function(e){e.preventDefault();const merge=document.getElementById('restore-merge').checked;if(!merge&&!confirm('This will overwrite all current keys. Are you sure?'))return;const formData=new FormData();formData.append('passphrase',document.getElementById('restore-passphrase').value);formData.append('mode',merge?'merge':'replace');formData.append('backup',document.getElementById('restore-file').files[0]);showStatus('Restoring...');fetch('/api/restore',{method:'POST',body:formData}).then(res=>res.text().then(text=>{showStatus(text,!res.ok);if(res.ok){this.reset();fetchKeys()}})).catch(err=>showStatus('Error: '+err,true))});
+function showQr(index){const formData=new FormData();formData.append('index',index);fetch('/api/show_qr',{method:'POST',body:new URLSearchParams(formData)}).then(res=>res.text().then(text=>showStatus(text,!res.ok))).catch(err=>showStatus('Error: '+err,true))}
 function removeKey(index){if(!confirm('Are you sure?'))return;const formData=new FormData();formData.append('index',index);fetch('/api/remove',{method:'POST',body:new URLSearchParams(formData)}).then(res=>{if(res.ok){showStatus('Key removed successfully!');fetchKeys()}else{showStatus('Failed to remove key.',true)}}).catch(err=>showStatus('Error: '+err,true))};
 document.getElementById('change-password-form').addEventListener('submit',function(e){e.preventDefault();const newPass=document.getElementById('new-password').value;const confirmPass=document.getElementById('confirm-password').value;if(newPass!==confirmPass){showStatus('Passwords do not match!',true);return}
 const formData=new FormData();formData.append('password',newPass);fetch('/api/change_password',{method:'POST',body:new URLSearchParams(formData)}).then(res=>res.text().then(text=>{if(res.ok)showStatus(text);else showStatus(text,true)}))});
@@ -74,11 +114,23 @@ function fetchThemeSettings(){
     fetch('/api/theme')
         .then(response => response.json())
         .then(data => {
-            if(data.theme === 'light'){
-                document.getElementById('theme-light').checked = true;
-            } else {
-                document.getElementById('theme-dark').checked = true;
-            }
+            const list = document.getElementById('theme-list');
+            list.innerHTML = '';
+            data.themes.forEach(theme => {
+                const label = document.createElement('label');
+                label.innerHTML = `<input type="radio" name="theme" value="${theme.name}"> ${theme.name}`;
+                label.querySelector('input').checked = (theme.name === data.theme);
+                list.appendChild(label);
+                if(!theme.builtin){
+                    const del = document.createElement('button');
+                    del.type = 'button';
+                    del.className = 'button-delete';
+                    del.textContent = 'Delete';
+                    del.onclick = () => deleteTheme(theme.name);
+                    list.appendChild(del);
+                }
+                list.appendChild(document.createElement('br'));
+            });
         })
         .catch(err => showStatus('Error fetching theme settings.', true));
 }
@@ -102,6 +154,39 @@ document.getElementById('theme-selection-form').addEventListener('submit', funct
     .catch(err => showStatus('Error applying theme: ' + err, true));
 });
 
+function deleteTheme(name){
+    if(!confirm('Delete theme "' + name + '"?')) return;
+    const formData = new FormData();
+    formData.append('name', name);
+    fetch('/api/theme_delete', {method: 'POST', body: new URLSearchParams(formData)})
+        .then(res => res.text().then(text => {
+            showStatus(text, !res.ok);
+            fetchThemeSettings();
+        }));
+}
+
+document.getElementById('upload-theme-form').addEventListener('submit', function(e){
+    e.preventDefault();
+    const fileInput = document.getElementById('theme-file');
+    if(fileInput.files.length === 0){
+        showStatus('Please select a file first.', true);
+        return;
+    }
+    fileInput.files[0].text().then(json => {
+        const formData = new FormData();
+        formData.append('theme', json);
+        return fetch('/api/theme_upload', {method: 'POST', body: new URLSearchParams(formData)});
+    })
+    .then(res => res.text().then(text => {
+        showStatus(text, !res.ok);
+        if(res.ok){
+            this.reset();
+            fetchThemeSettings();
+        }
+    }))
+    .catch(err => showStatus('Error uploading theme: ' + err, true));
+});
+
 function openTab(evt,tabName){
     var i,tabcontent,tablinks;
     tabcontent=document.getElementsByClassName("tab-content");
@@ -119,6 +204,8 @@ function openTab(evt,tabName){
     }
 }
 
-document.addEventListener('DOMContentLoaded',function(){fetchKeys();fetchPinSettings();document.querySelector('.tab-link').click()});
+function setTimeLeft(step,left){document.querySelectorAll('#keys-table progress').forEach(p=>p.value=rowLeft(p.max,step,left))}
+function startEvents(){if(!window.EventSource)return;const es=new EventSource('/api/events');es.addEventListener('codes',e=>{const d=JSON.parse(e.data);document.querySelectorAll('#keys-table td.code').forEach(td=>{const code=d.codes[td.dataset.i];if(code!==undefined)td.textContent=code});setTimeLeft(d.step,d.left)});es.addEventListener('tick',e=>{const d=JSON.parse(e.data);setTimeLeft(d.step,d.left)});es.addEventListener('keys',()=>fetchKeys());es.onerror=()=>{if(es.readyState===EventSource.CLOSED)setTimeout(startEvents,10000)}}
+document.addEventListener('DOMContentLoaded',function(){fetchKeys();startEvents();fetchPinSettings();document.querySelector('.tab-link').click()});
 </script></body></html>
 )rawliteral";
\ No newline at end of file
@@ -42,6 +42,9 @@ const char pin_settings_html[] PROGMEM = R"rawliteral(
             <label for="pin_length">PIN Length (4-10)</label>
             <input type="number" id="pin_length" name="length" min="4" max="10">
 
+            <label for="wipe_after">Wipe keys after N wrong PINs (0 = never, min 5)</label>
+            <input type="number" id="wipe_after" name="wipe_after" min="0" max="100">
+
             <label for="new_pin">Set/Change PIN</label>
             <input type="password" id="new_pin" name="pin" pattern="\d{4,10}" title="4 to 10 digits">
             
@@ -67,6 +70,7 @@ const char pin_settings_html[] PROGMEM = R"rawliteral(
                 .then(data => {
                     document.getElementById('pin_enabled').checked = data.enabled;
                     document.getElementById('pin_length').value = data.length;
+                    document.getElementById('wipe_after').value = data.wipe_after;
                 })
                 .catch(error => console.error('Error loading PIN status:', error));
         });
@@ -82,6 +86,7 @@ const char pin_settings_html[] PROGMEM = R"rawliteral(
             const formData = new FormData();
             formData.append('enabled', isEnabled);
             formData.append('length', length);
+            formData.append('wipe_after', document.getElementById('wipe_after').value);
 
             if (isEnabled && newPin.length > 0) {
                 if (newPin.length < 4 || newPin.length > 10) {
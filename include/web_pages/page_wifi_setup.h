@@ -1,5 +1,5 @@
 #pragma once
 
 const char wifi_setup_html[] PROGMEM = R"rawliteral(
-<!DOCTYPE HTML><html><head><title>WiFi Setup</title><meta name="viewport" content="width=device-width, initial-scale=1"><style>body{font-family:Arial,sans-serif;background-color:#f0f0f0;text-align:center;}.container{max-width:400px;margin:50px auto;padding:20px;background-color:#fff;border-radius:8px;box-shadow:0 2px 4px rgba(0,0,0,0.1);}select,input[type="password"]{width:90%;padding:10px;margin:10px 0;border:1px solid #ccc;border-radius:4px;}input[type="submit"]{background-color:#4CAF50;color:white;padding:14px 20px;border:none;border-radius:4px;cursor:pointer;width:90%;}h2{color:#333;}</style></head><body><div class="container"><h2>WiFi Setup</h2><form action="/save" method="POST"><select id="ssid" name="ssid"></select><br><input type="password" name="password" placeholder="Password"><br><input type="submit" value="Save and Reboot"></form></div><script>fetch('/scan').then(response=>response.json()).then(data=>{const select=document.getElementById('ssid');data.forEach(net=>{const option=document.createElement('option');option.value=net.ssid;option.innerText=`${net.ssid} (${net.rssi}dBm)`;select.appendChild(option);});});</script></body></html>
+<!DOCTYPE HTML><html><head><title>WiFi Setup</title><meta name="viewport" content="width=device-width, initial-scale=1"><style>body{font-family:Arial,sans-serif;background-color:#f0f0f0;text-align:center;}.container{max-width:400px;margin:50px auto;padding:20px;background-color:#fff;border-radius:8px;box-shadow:0 2px 4px rgba(0,0,0,0.1);}select,input[type="password"]{width:90%;padding:10px;margin:10px 0;border:1px solid #ccc;border-radius:4px;}input[type="submit"]{background-color:#4CAF50;color:white;padding:14px 20px;border:none;border-radius:4px;cursor:pointer;width:90%;}h2{color:#333;}</style></head><body><div class="container"><h2>WiFi Setup</h2><form action="/save" method="POST"><select id="ssid" name="ssid"><option disabled>Scanning...</option></select><br><input type="password" name="password" placeholder="Password"><br><select name="priority"><option value="2">High priority</option><option value="1">Normal priority</option><option value="0" selected>Low priority</option></select><br><input type="submit" value="Save and Reboot"></form><h2>Offline Mode</h2><p>No WiFi? Set the clock from this device and use codes offline.</p><button id="settime" style="background-color:#008CBA;color:white;padding:14px 20px;border:none;border-radius:4px;cursor:pointer;width:90%;">Set Time and Go Offline</button><p id="time-msg"></p></div><script>document.getElementById('settime').addEventListener('click',()=>{const fd=new URLSearchParams();fd.append('epoch',Math.floor(Date.now()/1000));fetch('/settime',{method:'POST',body:fd}).then(res=>res.text()).then(text=>{document.getElementById('time-msg').innerText=text;});});function loadNetworks(attempt){fetch('/scan').then(response=>response.json()).then(data=>{if(data.length===0&&attempt<10){setTimeout(()=>loadNetworks(attempt+1),1500);return;}const select=document.getElementById('ssid');select.innerHTML='';data.forEach(net=>{const option=document.createElement('option');option.value=net.ssid;option.innerText=`${net.ssid} (${net.rssi}dBm)`;select.appendChild(option);});});}loadNetworks(0);</script></body></html>
 )rawliteral";
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Страница веб-интерфейса, сжатая gzip при сборке (scripts/gzip_web_pages.py)
+struct WebAsset {
+    const uint8_t* data;   // gzip-поток в PROGMEM
+    size_t length;
+    const char* etag;      // Строгий ETag (в кавычках) - хеш сжатых данных
+};
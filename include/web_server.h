@@ -7,20 +7,40 @@
 #include "display_manager.h"
 #include "pin_manager.h"
 #include "config_manager.h" // New: Include ConfigManager
+#include "time_manager.h"
+#include "wifi_manager.h"
+#include "theme_manager.h"
+#include "session_manager.h"
+#include "crypto_manager.h"
 
 class WebServerManager {
 public:
-    WebServerManager(KeyManager& keyManager, SplashScreenManager& splashManager, DisplayManager& displayManager, PinManager& pinManager, ConfigManager& configManager); // Added ConfigManager
+    WebServerManager(KeyManager& keyManager, SplashScreenManager& splashManager, DisplayManager& displayManager, PinManager& pinManager, ConfigManager& configManager, TimeManager& timeManager, WifiManager& wifiManager, ThemeManager& themeManager);
     void start();
     void stop();
     void startConfigServer();
 
 private:
-    String getAdminPasswordHash();
+    void loadAdminCredentials();
+    bool saveAdminCredentials();
+    void setAdminPassword(const String& password);
+    bool verifyAdminPassword(const String& password);
     bool isAuthenticated(AsyncWebServerRequest *request);
-    String session_id = ""; // Хранилище для ID сессии
-    unsigned long session_created_time = 0; // <-- ДОБАВИТЬ ЭТУ СТРОКУ
-    static const unsigned long SESSION_TIMEOUT = 3600000; // <-- ДОБАВИТЬ ЭТУ СТРОКУ (1 час в миллисекундах)
+    String buildCodesEvent(time_t now);
+    // Рассылка кодов подписчикам /api/events; только в задаче AsyncTCP
+    void broadcastEvents();
+    SessionManager sessions; // Таблица активных сессий
+
+    // Запись пароля администратора, загружается один раз при старте
+    PasswordRecord adminRecord;
+    String legacyAdminHash; // Несоленый SHA-256 из старого /auth.json до первого входа
+
+    // Последние разосланные события: коды считаются один раз на шаг для всех клиентов
+    String lastCodesEvent;
+    time_t lastEventStep = 0;
+    uint32_t lastEventRevision = 0;
+    long lastTickSecond = -1;
+    bool eventClientJoined = false;
 };
 
 #endif // WEBSERVER_MANAGER_H
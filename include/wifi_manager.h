@@ -2,24 +2,125 @@
 #define WIFI_MANAGER_H
 
 #include <Arduino.h>
+#include <WiFi.h>
+#include <vector>
 #include "display_manager.h"
+#include "config.h"
+#include "config_manager.h"
 
+#define MAX_WIFI_NETWORKS 8
+
+// Состояния подключения к WiFi
+enum class WifiState {
+    IDLE,
+    NO_CONFIG,     // Нет сохраненных сетей
+    SCANNING,      // Асинхронное сканирование эфира
+    CONNECTING,    // Идет попытка подключения
+    CONNECTED,     // Получен IP-адрес
+    WAITING_RETRY, // Пауза перед следующим кругом попыток (экспоненциальная)
+    PORTAL         // Запущен портал настройки, переподключение остановлено
+};
+
+// Сохраненная сеть. Больший priority пробуется раньше.
+struct WifiNetwork {
+    String ssid;
+    String password;
+    int priority;
+};
+
+// Неблокирующий менеджер подключения. Состояние меняется по событиям WiFi,
+// а сканирование, таймауты и повторы обрабатывает update(), который
+// вызывается периодически из фоновой сетевой задачи.
 class WifiManager {
 public:
-    // Передаем DisplayManager для вывода статуса
-    WifiManager(DisplayManager& display);
-    // Основная функция подключения. Возвращает true, если удалось подключиться.
-    bool connect(); 
-    // Запускает портал настройки
+    // Передаем DisplayManager для вывода статуса, сети хранятся в ConfigManager
+    WifiManager(DisplayManager& display, ConfigManager& config);
+    // Загружает сохраненные сети и запускает подключение. Не блокирует.
+    bool begin();
+    void update();
+    // Показывает экран настройки и запрашивает портал; точку доступа
+    // поднимает следующий update() в сетевой задаче
     void startConfigPortal();
+
+    WifiState getState() const { return _state; }
+    bool isConnected() const { return _state == WifiState::CONNECTED; }
+    // Первые попытки после загрузки не удались (нужен портал или автономный режим)
+    bool hasInitialConnectFailed() const { return _connectCount == 0 && _failedRounds >= WIFI_INITIAL_ROUNDS; }
+    // Счетчик успешных подключений - по нему видно переподключения
+    uint32_t getConnectCount() const { return _connectCount; }
+    bool hasCredentials();
     String getIP();
 
+    // Для портала настройки: добавляет или обновляет сеть в списке
+    bool saveNetwork(const String& ssid, const String& password, int priority);
+    // Результаты последнего сканирования в JSON. Не блокирует: при устаревшем
+    // кэше запрашивает новое сканирование в фоне.
+    String getScanResultsJson();
+
 private:
-    bool loadCredentials(String& ssid, String& password);
-    void saveCredentials(const String& ssid, const String& password);
+    static constexpr const char* PORTAL_SSID = "ESP32-TOTP-Setup";
+    static const uint32_t WIFI_INITIAL_ROUNDS = 2;
+    static const unsigned long CONNECT_TIMEOUT_MS = 10000;
+    static const unsigned long STALE_EVENT_MS = 500;
+    static const unsigned long SCAN_TIMEOUT_MS = 15000;
+    static const unsigned long SCAN_CACHE_MAX_AGE_MS = 30000;
+    static const unsigned long RETRY_BASE_MS = 1000;
+    static const unsigned long RETRY_MAX_MS = 60000;
+
+    bool loadNetworks(std::vector<WifiNetwork>& networks);
+    bool writeConfig(const std::vector<WifiNetwork>& networks);
+    void loadConnectionCache();
+    void saveConnectionCache();
+    void onWifiEvent(arduino_event_id_t event, arduino_event_info_t info);
+    void startScan();
+    void handleScanResults(int count);
+    void startAttempt(int networkIndex, bool fast);
+    void attemptNextCandidate();
+    void scheduleRetry();
+    void enterPortal();
     
     DisplayManager& _display;
-    String _ipAddress;
+    ConfigManager& _config;
+    std::vector<WifiNetwork> _networks;
+
+    volatile WifiState _state = WifiState::IDLE;
+    volatile bool _portalActive = false;
+    volatile uint32_t _ipAddress = 0;
+    volatile uint32_t _connectCount = 0;
+    uint32_t _failedRounds = 0;
+    unsigned long _attemptStartMs = 0;
+    unsigned long _retryAtMs = 0;
+
+    // Очередь кандидатов текущего круга (индексы в _networks по рангу)
+    std::vector<int> _candidates;
+    size_t _nextCandidate = 0;
+    int _currentNetwork = -1;
+
+    // Кэш результатов сканирования для портала (защищен мьютексом)
+    SemaphoreHandle_t _scanMutex;
+    String _scanJson = "[]";
+    unsigned long _scanCompletedMs = 0;
+    bool _hasScanResults = false;
+    volatile bool _scanRequested = false;
+    unsigned long _scanStartMs = 0;
+    bool _scanInProgress = false;
+
+    // Флаги событий: выставляются в задаче событий WiFi (запрос портала - в
+    // основной задаче), обрабатываются в update(). _state и _portalActive
+    // меняет только сетевая задача.
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    volatile bool _evPortal = false;
+    volatile bool _evGotIp = false;
+    volatile bool _evDisconnected = false;
+    uint8_t _evDisconnectReason = 0;
+    uint8_t _evBssid[6];
+    uint8_t _evChannel = 0;
+
+    // BSSID и канал последней точки доступа для быстрого переподключения
+    bool _fastAttempt = false;
+    int _cachedNetwork = -1;
+    uint8_t _cachedBssid[6];
+    uint8_t _cachedChannel = 0;
 };
 
 #endif // WIFI_MANAGER_H
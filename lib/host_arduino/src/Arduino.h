@@ -0,0 +1,33 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Заменитель ядра Arduino ESP32 для сборки модулей на хосте ([env:native]).
+// Только то, что нужно модулям без железа: String, время, критические
+// секции (на хосте тесты однопоточные, поэтому они пустые) и типы FreeRTOS.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include "WString.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+using std::abs;
+using std::max;
+using std::min;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+
+// Только на хосте: сдвигает часы millis()/esp_timer_get_time() вперед,
+// чтобы тесты проверяли таймауты без ожидания
+void hostAdvanceMillis(unsigned long ms);
+
+#endif // HOST_ARDUINO_H
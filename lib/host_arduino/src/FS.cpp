@@ -0,0 +1,93 @@
+#include "FS.h"
+#include "LittleFS.h"
+
+fs::FS LittleFS;
+
+namespace fs {
+
+size_t File::size() const {
+    if (!_fs) return 0;
+    auto found = _fs->_files.find(_path);
+    return found == _fs->_files.end() ? 0 : found->second.size();
+}
+
+size_t File::read(uint8_t* buffer, size_t length) {
+    if (!_fs) return 0;
+    auto found = _fs->_files.find(_path);
+    if (found == _fs->_files.end() || _position >= found->second.size()) return 0;
+    size_t count = std::min(length, found->second.size() - _position);
+    memcpy(buffer, found->second.data() + _position, count);
+    _position += count;
+    return count;
+}
+
+size_t File::write(const uint8_t* buffer, size_t length) {
+    if (!_fs) return 0;
+    auto found = _fs->_files.find(_path);
+    if (found == _fs->_files.end()) return 0;
+    size_t written = 0;
+    while (written < length && _fs->step()) {
+        found->second.push_back(buffer[written++]);
+    }
+    return written;
+}
+
+bool FS::step() {
+    if (_powerLost) return false;
+    if (_stepsLeft == 0) {
+        _powerLost = true;
+        return false;
+    }
+    if (_stepsLeft > 0) _stepsLeft--;
+    return true;
+}
+
+File FS::open(const String& path, const char* mode) {
+    std::string key = path.c_str();
+    if (mode[0] == 'r') {
+        if (_files.find(key) == _files.end()) return File();
+    } else {
+        if (!step()) return File();
+        std::vector<uint8_t>& data = _files[key];
+        if (mode[0] == 'w') data.clear();
+    }
+    File file(this, path);
+    return file;
+}
+
+bool FS::exists(const String& path) {
+    return _files.find(path.c_str()) != _files.end();
+}
+
+bool FS::remove(const String& path) {
+    auto found = _files.find(path.c_str());
+    if (found == _files.end() || !step()) return false;
+    _files.erase(found);
+    return true;
+}
+
+bool FS::rename(const String& from, const String& to) {
+    auto found = _files.find(from.c_str());
+    if (found == _files.end() || !step()) return false;
+    std::vector<uint8_t> data = std::move(found->second);
+    _files.erase(found);
+    _files[to.c_str()] = std::move(data);
+    return true;
+}
+
+void FS::cutPowerAfter(long steps) {
+    _stepsLeft = steps;
+    _powerLost = false;
+}
+
+void FS::restorePower() {
+    _stepsLeft = -1;
+    _powerLost = false;
+}
+
+std::vector<uint8_t>* FS::contents(const String& path) {
+    auto found = _files.find(path.c_str());
+    return found == _files.end() ? nullptr : &found->second;
+}
+
+} // namespace fs
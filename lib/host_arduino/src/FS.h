@@ -0,0 +1,74 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+namespace fs {
+
+class FS;
+
+// Открытый файл in-memory файловой системы. Как и в ядре, копируется
+// свободно; запись идет сразу в содержимое файла.
+class File {
+public:
+    File() {}
+
+    explicit operator bool() const { return _fs != nullptr; }
+    size_t size() const;
+    size_t read(uint8_t* buffer, size_t length);
+    size_t write(const uint8_t* buffer, size_t length);
+    size_t write(uint8_t value) { return write(&value, 1); }
+    void flush() {}
+    void close() { _fs = nullptr; }
+
+private:
+    friend class FS;
+    File(FS* fs, const String& path) : _fs(fs), _path(path.c_str()) {}
+
+    FS* _fs = nullptr;
+    std::string _path;
+    size_t _position = 0;
+};
+
+// Файловая система в памяти вместо LittleFS для тестов на хосте.
+//
+// Умеет имитировать сброс питания: каждый записанный байт, открытие на
+// запись (усечение), удаление и переименование - один шаг, и после
+// cutPowerAfter(n) выполняются только первые n шагов. Остальные операции
+// записи молча не действуют, как будто устройство уже выключилось;
+// чтение продолжает работать. Переименование, как в LittleFS, атомарно
+// и заменяет существующий файл назначения.
+class FS {
+public:
+    File open(const String& path, const char* mode = "r");
+    bool exists(const String& path);
+    bool remove(const String& path);
+    bool rename(const String& from, const String& to);
+
+    // Только на хосте: внедрение сбоев и доступ к содержимому
+    void cutPowerAfter(long steps);
+    bool powerLost() const { return _powerLost; }
+    void restorePower();
+    std::vector<uint8_t>* contents(const String& path);
+    size_t fileCount() const { return _files.size(); }
+
+private:
+    friend class File;
+
+    // false - питание уже пропало, операция не выполняется
+    bool step();
+
+    std::map<std::string, std::vector<uint8_t>> _files;
+    long _stepsLeft = -1; // -1 - без ограничения
+    bool _powerLost = false;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif // HOST_FS_H
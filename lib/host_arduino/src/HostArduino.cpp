@@ -0,0 +1,41 @@
+#include "Arduino.h"
+#include <chrono>
+#include <thread>
+
+static const auto startTime = std::chrono::steady_clock::now();
+static int64_t clockOffsetUs = 0;
+
+int64_t esp_timer_get_time() {
+    auto elapsed = std::chrono::steady_clock::now() - startTime;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + clockOffsetUs;
+}
+
+unsigned long millis() {
+    return (unsigned long)(esp_timer_get_time() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)esp_timer_get_time();
+}
+
+void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void hostAdvanceMillis(unsigned long ms) {
+    clockOffsetUs += (int64_t)ms * 1000;
+}
+
+void esp_fill_random(void* buffer, size_t length) {
+    FILE* source = fopen("/dev/urandom", "rb");
+    size_t got = source ? fread(buffer, 1, length, source) : 0;
+    if (source) fclose(source);
+    // Без /dev/urandom (не POSIX-хост) - псевдослучайные байты: на хосте это только тесты
+    for (size_t i = got; i < length; i++) ((uint8_t*)buffer)[i] = (uint8_t)rand();
+}
+
+uint32_t esp_random() {
+    uint32_t value;
+    esp_fill_random(&value, sizeof(value));
+    return value;
+}
@@ -0,0 +1,9 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include "FS.h"
+
+// На хосте "раздел" LittleFS - та же файловая система в памяти
+extern fs::FS LittleFS;
+
+#endif // HOST_LITTLEFS_H
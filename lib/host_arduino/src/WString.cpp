@@ -0,0 +1,228 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static std::string formatInteger(unsigned long long value, bool negative, unsigned char base) {
+    char buffer[70];
+    char* p = buffer + sizeof(buffer);
+    *--p = '\0';
+    do {
+        unsigned digit = value % base;
+        *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value);
+    if (negative) *--p = '-';
+    return p;
+}
+
+static std::string formatSigned(long long value, unsigned char base) {
+    // Как в ядре: знак только у десятичных, остальные основания - дополнительный код
+    if (base == 10 && value < 0) return formatInteger(0ULL - (unsigned long long)value, true, base);
+    return formatInteger((unsigned long long)value, false, base);
+}
+
+static std::string formatFloat(double value, unsigned int decimalPlaces) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimalPlaces, value);
+    return buffer;
+}
+
+String::String(const char* cstr) : _data(cstr ? cstr : "") {}
+String::String(const char* cstr, unsigned int length) : _data(cstr ? std::string(cstr, length) : std::string()) {}
+String::String(char c) : _data(1, c) {}
+String::String(unsigned char value, unsigned char base) : _data(formatInteger(value, false, base)) {}
+String::String(int value, unsigned char base) : _data(base == 10 ? formatSigned(value, base) : formatInteger((unsigned int)value, false, base)) {}
+String::String(unsigned int value, unsigned char base) : _data(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base) : _data(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _data(formatInteger(value, false, base)) {}
+String::String(long long value, unsigned char base) : _data(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : _data(formatInteger(value, false, base)) {}
+String::String(float value, unsigned int decimalPlaces) : _data(formatFloat(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : _data(formatFloat(value, decimalPlaces)) {}
+
+String& String::operator=(const char* cstr) {
+    if (cstr) _data = cstr;
+    else _data.clear();
+    return *this;
+}
+
+bool String::reserve(unsigned int size) {
+    _data.reserve(size);
+    return true;
+}
+
+bool String::concat(const String& other) {
+    _data += other._data;
+    return true;
+}
+
+bool String::concat(const char* cstr) {
+    if (!cstr) return false;
+    _data += cstr;
+    return true;
+}
+
+bool String::concat(const char* cstr, unsigned int length) {
+    if (!cstr) return false;
+    _data.append(cstr, length);
+    return true;
+}
+
+bool String::concat(char c) {
+    _data += c;
+    return true;
+}
+
+StringSumHelper operator+(const String& lhs, const String& rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+StringSumHelper operator+(const String& lhs, const char* rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+StringSumHelper operator+(const char* lhs, const String& rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+StringSumHelper operator+(const String& lhs, char rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+int String::compareTo(const String& other) const {
+    return strcmp(c_str(), other.c_str());
+}
+
+bool String::equalsIgnoreCase(const String& other) const {
+    if (length() != other.length()) return false;
+    for (unsigned int i = 0; i < length(); i++) {
+        if (tolower((unsigned char)_data[i]) != tolower((unsigned char)other._data[i])) return false;
+    }
+    return true;
+}
+
+bool String::startsWith(const String& prefix) const {
+    return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+    if (offset > length() || prefix.length() > length() - offset) return false;
+    return _data.compare(offset, prefix.length(), prefix._data) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    if (suffix.length() > length()) return false;
+    return _data.compare(length() - suffix.length(), suffix.length(), suffix._data) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+    return index < length() ? _data[index] : '\0';
+}
+
+void String::setCharAt(unsigned int index, char c) {
+    if (index < length()) _data[index] = c;
+}
+
+char& String::operator[](unsigned int index) {
+    static char dummy;
+    if (index >= length()) {
+        dummy = '\0';
+        return dummy;
+    }
+    return _data[index];
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t found = _data.find(c, from);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::indexOf(const String& text, unsigned int from) const {
+    if (from > length()) return -1;
+    size_t found = _data.find(text._data, from);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::lastIndexOf(char c) const {
+    size_t found = _data.rfind(c);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::lastIndexOf(const String& text) const {
+    size_t found = _data.rfind(text._data);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+        unsigned int swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from >= length()) return String();
+    if (to > length()) to = length();
+    return String(_data.c_str() + from, to - from);
+}
+
+void String::replace(char find, char replacement) {
+    for (char& c : _data) {
+        if (c == find) c = replacement;
+    }
+}
+
+void String::replace(const String& find, const String& replacement) {
+    if (find.isEmpty()) return;
+    size_t pos = 0;
+    while ((pos = _data.find(find._data, pos)) != std::string::npos) {
+        _data.replace(pos, find.length(), replacement._data);
+        pos += replacement.length();
+    }
+}
+
+void String::remove(unsigned int index) {
+    remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index >= length()) return;
+    if (count > length() - index) count = length() - index;
+    _data.erase(index, count);
+}
+
+void String::toLowerCase() {
+    for (char& c : _data) c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+    for (char& c : _data) c = toupper((unsigned char)c);
+}
+
+void String::trim() {
+    size_t first = 0;
+    while (first < _data.size() && isspace((unsigned char)_data[first])) first++;
+    size_t last = _data.size();
+    while (last > first && isspace((unsigned char)_data[last - 1])) last--;
+    _data = _data.substr(first, last - first);
+}
+
+long String::toInt() const {
+    return atol(c_str());
+}
+
+float String::toFloat() const {
+    return (float)atof(c_str());
+}
+
+double String::toDouble() const {
+    return atof(c_str());
+}
@@ -0,0 +1,114 @@
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class StringSumHelper;
+
+// Подмножество String из ядра Arduino ESP32 с той же семантикой:
+// substring/indexOf/remove не выходят за границы, trim и регистр меняют
+// строку на месте, сравнения без учета регистра - только ASCII.
+class String {
+public:
+    String(const char* cstr = "");
+    String(const char* cstr, unsigned int length);
+    String(const uint8_t* cstr, unsigned int length) : String((const char*)cstr, length) {}
+    String(const String& other) = default;
+    String(String&& other) = default;
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    String& operator=(const String& other) = default;
+    String& operator=(String&& other) = default;
+    String& operator=(const char* cstr);
+
+    bool reserve(unsigned int size);
+    unsigned int length() const { return (unsigned int)_data.size(); }
+    bool isEmpty() const { return _data.empty(); }
+    const char* c_str() const { return _data.c_str(); }
+    char* begin() { return &_data[0]; }
+    char* end() { return &_data[0] + _data.size(); }
+    const char* begin() const { return _data.c_str(); }
+    const char* end() const { return _data.c_str() + _data.size(); }
+
+    bool concat(const String& other);
+    bool concat(const char* cstr);
+    bool concat(const char* cstr, unsigned int length);
+    bool concat(char c);
+    bool concat(unsigned char value) { return concat(String(value)); }
+    bool concat(int value) { return concat(String(value)); }
+    bool concat(unsigned int value) { return concat(String(value)); }
+    bool concat(long value) { return concat(String(value)); }
+    bool concat(unsigned long value) { return concat(String(value)); }
+
+    template <typename T>
+    String& operator+=(const T& value) {
+        concat(value);
+        return *this;
+    }
+
+    friend StringSumHelper operator+(const String& lhs, const String& rhs);
+    friend StringSumHelper operator+(const String& lhs, const char* rhs);
+    friend StringSumHelper operator+(const char* lhs, const String& rhs);
+    friend StringSumHelper operator+(const String& lhs, char rhs);
+
+    int compareTo(const String& other) const;
+    bool equals(const String& other) const { return _data == other._data; }
+    bool equals(const char* cstr) const { return _data == (cstr ? cstr : ""); }
+    bool equalsIgnoreCase(const String& other) const;
+    bool operator==(const String& other) const { return equals(other); }
+    bool operator==(const char* cstr) const { return equals(cstr); }
+    bool operator!=(const String& other) const { return !equals(other); }
+    bool operator!=(const char* cstr) const { return !equals(cstr); }
+    bool operator<(const String& other) const { return compareTo(other) < 0; }
+    bool operator>(const String& other) const { return compareTo(other) > 0; }
+    bool startsWith(const String& prefix) const;
+    bool startsWith(const String& prefix, unsigned int offset) const;
+    bool endsWith(const String& suffix) const;
+
+    char charAt(unsigned int index) const;
+    void setCharAt(unsigned int index, char c);
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index);
+
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String& text, unsigned int from = 0) const;
+    int lastIndexOf(char c) const;
+    int lastIndexOf(const String& text) const;
+    String substring(unsigned int from) const { return substring(from, length()); }
+    String substring(unsigned int from, unsigned int to) const;
+
+    void replace(char find, char replacement);
+    void replace(const String& find, const String& replacement);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+private:
+    std::string _data;
+};
+
+// Временный результат "a" + b; отдельный тип нужен ArduinoJson
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& s) : String(s) {}
+    StringSumHelper(const char* p) : String(p) {}
+};
+
+#endif // HOST_WSTRING_H
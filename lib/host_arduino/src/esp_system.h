@@ -0,0 +1,11 @@
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// На хосте случайные байты берутся из /dev/urandom
+void esp_fill_random(void* buffer, size_t length);
+uint32_t esp_random();
+
+#endif // HOST_ESP_SYSTEM_H
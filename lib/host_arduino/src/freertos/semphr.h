@@ -0,0 +1,12 @@
+#ifndef HOST_SEMPHR_H
+#define HOST_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+// Только типы для объявлений классов; модули с мьютексами на хосте не собираются
+typedef void* SemaphoreHandle_t;
+typedef struct {
+    void* storage[10];
+} StaticSemaphore_t;
+
+#endif // HOST_SEMPHR_H
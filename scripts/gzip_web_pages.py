@@ -0,0 +1,80 @@
+# Сжимает страницы веб-интерфейса из include/web_pages/page_*.h при сборке.
+#
+# Каждая страница - C++ строка вида
+#     const char NAME[] PROGMEM = R"rawliteral(...)rawliteral";
+# Скрипт сжимает ее gzip и пишет include/web_pages/generated/NAME_gz.h
+# с массивом байтов и строгим ETag (хеш сжатых данных). Сервер отдает
+# эти массивы с Content-Encoding: gzip и отвечает 304 на If-None-Match.
+#
+# Подключается в platformio.ini как extra_scripts = pre:scripts/gzip_web_pages.py,
+# а также запускается вручную: python3 scripts/gzip_web_pages.py
+
+import glob
+import gzip
+import hashlib
+import os
+import re
+
+PAGE_PATTERN = re.compile(
+    r'const\s+char\s+(\w+)\[\]\s+PROGMEM\s*=\s*R"rawliteral\((.*?)\)rawliteral"', re.S)
+
+
+def render_header(name, compressed, etag):
+    lines = [
+        "// Сгенерировано scripts/gzip_web_pages.py - не редактировать",
+        "#pragma once",
+        "",
+        '#include "web_pages/web_asset.h"',
+        "",
+        "const uint8_t %s_gz[] PROGMEM = {" % name,
+    ]
+    for i in range(0, len(compressed), 16):
+        chunk = compressed[i:i + 16]
+        lines.append("    " + ", ".join("0x%02x" % b for b in chunk) + ",")
+    lines.append("};")
+    lines.append("")
+    lines.append('const WebAsset %s_asset = { %s_gz, sizeof(%s_gz), "\\"%s\\"" };' % (name, name, name, etag))
+    lines.append("")
+    return "\n".join(lines)
+
+
+def write_if_changed(path, content):
+    if os.path.exists(path):
+        with open(path, "r", encoding="utf-8") as f:
+            if f.read() == content:
+                return
+    with open(path, "w", encoding="utf-8") as f:
+        f.write(content)
+
+
+def generate(project_dir):
+    pages_dir = os.path.join(project_dir, "include", "web_pages")
+    out_dir = os.path.join(pages_dir, "generated")
+    os.makedirs(out_dir, exist_ok=True)
+
+    total_raw = 0
+    total_gz = 0
+    for path in sorted(glob.glob(os.path.join(pages_dir, "page_*.h"))):
+        with open(path, "r", encoding="utf-8") as f:
+            source = f.read()
+        for name, html in PAGE_PATTERN.findall(source):
+            raw = html.encode("utf-8")
+            # mtime=0: одинаковый вход дает одинаковый gzip и тот же ETag
+            compressed = gzip.compress(raw, compresslevel=9, mtime=0)
+            etag = hashlib.sha256(compressed).hexdigest()[:16]
+            write_if_changed(os.path.join(out_dir, name + "_gz.h"), render_header(name, compressed, etag))
+
+            total_raw += len(raw)
+            total_gz += len(compressed)
+            print("web asset %-18s %7d -> %6d bytes (%d%%)" % (
+                name, len(raw), len(compressed), len(compressed) * 100 // max(len(raw), 1)))
+
+    print("web assets total     %7d -> %6d bytes" % (total_raw, total_gz))
+
+
+try:
+    Import("env")  # noqa: F821 - определен PlatformIO
+    generate(env["PROJECT_DIR"])  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        generate(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
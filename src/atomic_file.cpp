@@ -0,0 +1,176 @@
+#include "atomic_file.h"
+#include "logger.h"
+
+static void putLe32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint32_t getLe32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// CRC-32 (IEEE 802.3), побитно: файлы настроек маленькие, таблица не нужна
+uint32_t AtomicFile::crc32(const uint8_t* data, size_t length, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+AtomicFile::Check AtomicFile::load(FlashFS& fs, const String& path, uint32_t& generation, std::vector<uint8_t>* out) {
+    generation = 0;
+    if (!fs.exists(path)) return Check::MISSING;
+    FlashFile file = fs.open(path, "r");
+    if (!file) return Check::MISSING;
+
+    size_t size = file.size();
+    std::vector<uint8_t> buffer(size);
+    size_t readBytes = size > 0 ? file.read(buffer.data(), size) : 0;
+    file.close();
+    if (readBytes != size) return Check::CORRUPT;
+
+    if (size < TRAILER_SIZE || getLe32(&buffer[size - TRAILER_SIZE]) != TRAILER_MAGIC) {
+        // Файл, записанный до появления концевика
+        if (out) out->swap(buffer);
+        return Check::LEGACY;
+    }
+
+    const uint8_t* trailer = &buffer[size - TRAILER_SIZE];
+    size_t length = size - TRAILER_SIZE;
+    if (getLe32(trailer + 8) != length || getLe32(trailer + 12) != crc32(buffer.data(), length)) {
+        return Check::CORRUPT;
+    }
+    generation = getLe32(trailer + 4);
+    if (out) {
+        buffer.resize(length);
+        out->swap(buffer);
+    }
+    return Check::VALID;
+}
+
+AtomicFile::Check AtomicFile::loadCurrent(FlashFS& fs, const char* path, uint32_t& generation, std::vector<uint8_t>* out) {
+    Check check = load(fs, path, generation, out);
+    // .bak появляется только при записи через AtomicFile, а она оставляет основной
+    // файл с концевиком. Старый формат рядом с .bak - это испорченный концевик
+    // или обрезанный файл, и брать нужно резервное поколение.
+    if (check == Check::LEGACY && fs.exists(String(path) + ".bak")) {
+        if (out) out->clear();
+        return Check::CORRUPT;
+    }
+    return check;
+}
+
+bool AtomicFile::write(FlashFS& fs, const char* path, const String& content) {
+    return write(fs, path, (const uint8_t*)content.c_str(), content.length());
+}
+
+bool AtomicFile::write(FlashFS& fs, const char* path, const uint8_t* data, size_t length) {
+    String tempPath = String(path) + ".tmp";
+    String backupPath = String(path) + ".bak";
+
+    uint32_t currentGeneration, backupGeneration;
+    Check current = loadCurrent(fs, path, currentGeneration, nullptr);
+    load(fs, backupPath, backupGeneration, nullptr);
+    uint32_t generation = (currentGeneration > backupGeneration ? currentGeneration : backupGeneration) + 1;
+
+    uint8_t trailer[TRAILER_SIZE];
+    putLe32(trailer, TRAILER_MAGIC);
+    putLe32(trailer + 4, generation);
+    putLe32(trailer + 8, length);
+    putLe32(trailer + 12, crc32(data, length));
+
+    FlashFile file = fs.open(tempPath, "w");
+    if (!file) return false;
+    size_t written = length > 0 ? file.write(data, length) : 0;
+    written += file.write(trailer, TRAILER_SIZE);
+    file.flush();
+    file.close();
+
+    // Проверка чтением: в <path> попадает только целое поколение
+    uint32_t tempGeneration;
+    if (written != length + TRAILER_SIZE ||
+        load(fs, tempPath, tempGeneration, nullptr) != Check::VALID || tempGeneration != generation) {
+        LOG_ERROR("File", "verify failed for %s", tempPath.c_str());
+        fs.remove(tempPath);
+        return false;
+    }
+
+    // Целое текущее поколение становится резервным, поврежденное просто удаляется
+    if (current == Check::VALID || current == Check::LEGACY) {
+        fs.remove(backupPath);
+        fs.rename(path, backupPath);
+    } else if (current == Check::CORRUPT) {
+        fs.remove(path);
+    }
+    if (!fs.rename(tempPath, path)) {
+        LOG_ERROR("File", "rename failed for %s", path);
+        return false;
+    }
+    return true;
+}
+
+bool AtomicFile::read(FlashFS& fs, const char* path, std::vector<uint8_t>& out) {
+    uint32_t generation;
+    Check current = loadCurrent(fs, path, generation, &out);
+    if (current == Check::VALID || current == Check::LEGACY) return true;
+
+    Check backup = load(fs, String(path) + ".bak", generation, &out);
+    if (backup == Check::VALID || backup == Check::LEGACY) {
+        LOG_WARN("File", "%s unreadable, using backup generation %lu", path, (unsigned long)generation);
+        return true;
+    }
+    out.clear();
+    return false;
+}
+
+void AtomicFile::recover(FlashFS& fs, const char* path) {
+    String tempPath = String(path) + ".tmp";
+    String backupPath = String(path) + ".bak";
+
+    uint32_t currentGeneration, tempGeneration, backupGeneration;
+    Check current = loadCurrent(fs, path, currentGeneration, nullptr);
+    Check temp = load(fs, tempPath, tempGeneration, nullptr);
+
+    // Сброс между проверкой и переименованием: новое поколение цело, доводим запись
+    bool currentUsable = current == Check::VALID || current == Check::LEGACY;
+    if (temp == Check::VALID && (!currentUsable || tempGeneration > currentGeneration)) {
+        if (currentUsable) {
+            fs.remove(backupPath);
+            fs.rename(path, backupPath);
+        } else {
+            fs.remove(path);
+        }
+        if (fs.rename(tempPath, path)) {
+            LOG_WARN("File", "%s: finished interrupted write, generation %lu", path, (unsigned long)tempGeneration);
+            return;
+        }
+    }
+    if (temp != Check::MISSING) {
+        fs.remove(tempPath);
+        LOG_WARN("File", "%s: discarded unfinished write", path);
+    }
+
+    if (!currentUsable) {
+        Check backup = load(fs, backupPath, backupGeneration, nullptr);
+        if (backup == Check::VALID || backup == Check::LEGACY) {
+            fs.remove(path);
+            fs.rename(backupPath, path);
+            LOG_WARN("File", "%s: restored backup generation %lu", path, (unsigned long)backupGeneration);
+        }
+    }
+}
+
+bool AtomicFile::exists(FlashFS& fs, const char* path) {
+    return fs.exists(path) || fs.exists(String(path) + ".bak");
+}
+
+void AtomicFile::remove(FlashFS& fs, const char* path) {
+    // Сначала копии: после сброса посередине recover() не вернет удаленное
+    fs.remove(String(path) + ".tmp");
+    fs.remove(String(path) + ".bak");
+    fs.remove(path);
+}
@@ -0,0 +1,273 @@
+#include "backup_file.h"
+#include <esp_system.h>
+#include <time.h>
+#include <algorithm>
+#include "crypto_manager.h"
+#include "logger.h"
+#include "secret_store.h"
+
+static const uint8_t BACKUP_MAGIC[4] = {'T', 'B', 'K', '1'};
+static const uint8_t BACKUP_VERSION = 1;
+static const uint8_t BACKUP_KDF_PBKDF2_SHA256 = 1;
+static const uint32_t MANIFEST_MAGIC = 0x54464E4D; // "MNFT" при записи в LE
+static const uint32_t FINAL_CHUNK = 0x80000000;
+static const size_t TAG_SIZE = 16;
+
+static void putLE32(uint8_t* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) p[i] = value >> (8 * i);
+}
+
+static uint32_t getLE32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Nonce блока: префикс из заголовка и номер блока
+static void chunkNonce(const uint8_t* header, uint32_t index, uint8_t* nonce) {
+    memcpy(nonce, header + 28, 8);
+    for (int i = 0; i < 4; i++) nonce[8 + i] = index >> (24 - 8 * i);
+}
+
+// --- ЗАПИСЬ ---
+
+BackupWriter::BackupWriter(const String& passphrase, uint32_t iterations, RecordSource source)
+    : _source(source) {
+    mbedtls_gcm_init(&_gcm);
+    mbedtls_sha256_init(&_sha);
+    mbedtls_sha256_starts(&_sha, 0);
+
+    memcpy(_header, BACKUP_MAGIC, 4);
+    _header[4] = BACKUP_VERSION;
+    _header[5] = BACKUP_KDF_PBKDF2_SHA256;
+    _header[6] = _header[7] = 0;
+    putLE32(_header + 8, iterations);
+    esp_fill_random(_header + 12, 16 + 8); // Соль и префикс nonce
+
+    uint8_t key[KDF_HASH_LENGTH];
+    bool ok = CryptoManager::deriveKey(passphrase, _header + 12, iterations, key)
+              && mbedtls_gcm_setkey(&_gcm, MBEDTLS_CIPHER_ID_AES, key, 256) == 0;
+    SecretStore::wipe(key, sizeof(key));
+    if (!ok) {
+        LOG_ERROR("Backup", "key derivation failed");
+        _finished = true; // Пустой ответ вместо файла, который не прочитать
+        return;
+    }
+    memcpy(_out, _header, BACKUP_HEADER_SIZE);
+    _outLength = BACKUP_HEADER_SIZE;
+}
+
+BackupWriter::~BackupWriter() {
+    mbedtls_gcm_free(&_gcm);
+    mbedtls_sha256_free(&_sha);
+    SecretStore::wipe(_plain, sizeof(_plain));
+    SecretStore::wipe(_pending);
+}
+
+size_t BackupWriter::read(uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
+    while (written < maxLen) {
+        if (_outOffset == _outLength && !sealNext()) break;
+        size_t count = std::min(maxLen - written, _outLength - _outOffset);
+        memcpy(buffer + written, _out + _outOffset, count);
+        _outOffset += count;
+        written += count;
+    }
+    return written;
+}
+
+// Шифрует следующий блок записей или, когда они кончились, манифест
+bool BackupWriter::sealNext() {
+    if (_finished) return false;
+
+    while (_plainLength < BACKUP_CHUNK_SIZE && !_sourceDone) {
+        if (_pendingOffset == _pending.length()) {
+            SecretStore::wipe(_pending);
+            _pendingOffset = 0;
+            if (!_source(_pending)) {
+                _sourceDone = true;
+                break;
+            }
+            if (_pending.length() >= BACKUP_MAX_RECORD) {
+                LOG_WARN("Backup", "record of %u bytes skipped", (unsigned)_pending.length());
+                SecretStore::wipe(_pending);
+                continue;
+            }
+            _pending += '\n';
+            _records++;
+        }
+        size_t count = std::min((size_t)(BACKUP_CHUNK_SIZE - _plainLength), (size_t)(_pending.length() - _pendingOffset));
+        memcpy(_plain + _plainLength, _pending.c_str() + _pendingOffset, count);
+        _plainLength += count;
+        _pendingOffset += count;
+    }
+
+    if (_plainLength > 0) {
+        mbedtls_sha256_update(&_sha, _plain, _plainLength);
+        _bytes += _plainLength;
+        seal(_plain, _plainLength, false);
+        SecretStore::wipe(_plain, _plainLength);
+        _plainLength = 0;
+        return true;
+    }
+
+    uint8_t manifest[BACKUP_MANIFEST_SIZE];
+    putLE32(manifest, MANIFEST_MAGIC);
+    putLE32(manifest + 4, _records);
+    putLE32(manifest + 8, _bytes);
+    putLE32(manifest + 12, (uint32_t)time(nullptr));
+    mbedtls_sha256_finish(&_sha, manifest + 16);
+    seal(manifest, sizeof(manifest), true);
+    return true;
+}
+
+void BackupWriter::seal(const uint8_t* plain, size_t length, bool final) {
+    putLE32(_out, length | (final ? FINAL_CHUNK : 0));
+    uint8_t nonce[12];
+    chunkNonce(_header, _chunkIndex++, nonce);
+    uint8_t aad[BACKUP_HEADER_SIZE + 4];
+    memcpy(aad, _header, BACKUP_HEADER_SIZE);
+    memcpy(aad + BACKUP_HEADER_SIZE, _out, 4);
+
+    mbedtls_gcm_crypt_and_tag(&_gcm, MBEDTLS_GCM_ENCRYPT, length, nonce, sizeof(nonce), aad, sizeof(aad),
+                              plain, _out + 4, TAG_SIZE, _out + 4 + length);
+    _outLength = 4 + length + TAG_SIZE;
+    _outOffset = 0;
+    _finished = final;
+}
+
+// --- ЧТЕНИЕ ---
+
+BackupReader::BackupReader(const String& passphrase, uint32_t maxIterations, RecordSink sink)
+    : _sink(sink), _passphrase(passphrase), _maxIterations(std::min(maxIterations, (uint32_t)BACKUP_KDF_MAX_ITERATIONS)) {
+    mbedtls_gcm_init(&_gcm);
+    mbedtls_sha256_init(&_sha);
+    mbedtls_sha256_starts(&_sha, 0);
+}
+
+BackupReader::~BackupReader() {
+    mbedtls_gcm_free(&_gcm);
+    mbedtls_sha256_free(&_sha);
+    SecretStore::wipe(_in, sizeof(_in));
+    SecretStore::wipe(_plain, sizeof(_plain));
+    SecretStore::wipe(_passphrase);
+    SecretStore::wipe(_record);
+}
+
+bool BackupReader::fail(const char* error) {
+    if (_error.isEmpty()) _error = error;
+    return false;
+}
+
+bool BackupReader::feed(const uint8_t* data, size_t length) {
+    if (!_error.isEmpty()) return false;
+
+    while (length > 0) {
+        if (_finished) return fail("Unexpected data after the manifest.");
+
+        size_t need;
+        if (!_keyReady) {
+            need = BACKUP_HEADER_SIZE;
+        } else if (_inLength < 4) {
+            need = 4;
+        } else {
+            need = 4 + (getLE32(_in) & ~FINAL_CHUNK) + TAG_SIZE;
+        }
+        size_t count = std::min(need - _inLength, length);
+        memcpy(_in + _inLength, data, count);
+        _inLength += count;
+        data += count;
+        length -= count;
+        if (_inLength < need) break;
+
+        if (!_keyReady) {
+            if (!readHeader()) return false;
+            _inLength = 0;
+            continue;
+        }
+        uint32_t word = getLE32(_in);
+        size_t chunkLength = word & ~FINAL_CHUNK;
+        if (_inLength == 4) {
+            // Слово блока проверяется до того, как под блок читаются данные
+            if (chunkLength == 0 || chunkLength > BACKUP_CHUNK_SIZE) return fail("Corrupted backup.");
+            continue;
+        }
+        if (!openChunk(word, chunkLength, word & FINAL_CHUNK)) return false;
+        _inLength = 0;
+    }
+    return true;
+}
+
+bool BackupReader::finish() {
+    if (!_error.isEmpty()) return false;
+    if (!_finished) return fail("Backup is truncated.");
+    return true;
+}
+
+bool BackupReader::readHeader() {
+    memcpy(_header, _in, BACKUP_HEADER_SIZE);
+    if (memcmp(_header, BACKUP_MAGIC, 4) != 0) return fail("Not a backup file.");
+    if (_header[4] != BACKUP_VERSION || _header[5] != BACKUP_KDF_PBKDF2_SHA256) return fail("Unsupported backup version.");
+
+    uint32_t iterations = getLE32(_header + 8);
+    if (iterations < BACKUP_KDF_MIN_ITERATIONS) return fail("Unsupported key derivation parameters.");
+    if (iterations > _maxIterations) return fail("Key derivation is too slow for this device.");
+
+    uint8_t key[KDF_HASH_LENGTH];
+    bool ok = CryptoManager::deriveKey(_passphrase, _header + 12, iterations, key)
+              && mbedtls_gcm_setkey(&_gcm, MBEDTLS_CIPHER_ID_AES, key, 256) == 0;
+    SecretStore::wipe(key, sizeof(key));
+    SecretStore::wipe(_passphrase);
+    if (!ok) return fail("Key derivation failed.");
+    _keyReady = true;
+    return true;
+}
+
+bool BackupReader::openChunk(uint32_t word, size_t length, bool final) {
+    uint8_t nonce[12];
+    chunkNonce(_header, _chunkIndex++, nonce);
+    uint8_t aad[BACKUP_HEADER_SIZE + 4];
+    memcpy(aad, _header, BACKUP_HEADER_SIZE);
+    putLE32(aad + BACKUP_HEADER_SIZE, word);
+
+    if (mbedtls_gcm_auth_decrypt(&_gcm, length, nonce, sizeof(nonce), aad, sizeof(aad),
+                                 _in + 4 + length, TAG_SIZE, _in + 4, _plain) != 0) {
+        // Неверный пароль и поврежденный файл неотличимы: тег не сходится в обоих случаях
+        return fail("Wrong passphrase or corrupted backup.");
+    }
+    if (final) {
+        _finished = true;
+        bool ok = checkManifest(_plain, length);
+        SecretStore::wipe(_plain, length);
+        return ok;
+    }
+
+    mbedtls_sha256_update(&_sha, _plain, length);
+    _bytes += length;
+    bool ok = true;
+    for (size_t i = 0; i < length && ok; i++) {
+        char c = _plain[i];
+        if (c != '\n') {
+            if (_record.length() >= BACKUP_MAX_RECORD) ok = fail("Record is too long.");
+            _record += c;
+            continue;
+        }
+        _records++;
+        if (!_sink(_record)) ok = fail("Invalid record.");
+        SecretStore::wipe(_record);
+    }
+    SecretStore::wipe(_plain, length);
+    return ok;
+}
+
+bool BackupReader::checkManifest(const uint8_t* plain, size_t length) {
+    if (length != BACKUP_MANIFEST_SIZE || getLE32(plain) != MANIFEST_MAGIC) return fail("Invalid manifest.");
+    if (!_record.isEmpty()) return fail("Backup ends inside a record.");
+    if (getLE32(plain + 4) != _records || getLE32(plain + 8) != _bytes) return fail("Manifest does not match the records.");
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&_sha, digest);
+    if (!CryptoManager::constantTimeEquals((const char*)digest, (const char*)plain + 16, sizeof(digest))) {
+        return fail("Manifest checksum mismatch.");
+    }
+    LOG_INFO("Backup", "%u records verified, created %u", (unsigned)_records, (unsigned)getLE32(plain + 12));
+    return true;
+}
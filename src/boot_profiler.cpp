@@ -0,0 +1,55 @@
+#include "boot_profiler.h"
+#include "logger.h"
+
+BootProfiler::BootProfiler() {}
+
+int BootProfiler::beginStage(const char* name) {
+    unsigned long now = millis();
+    const char* task = pcTaskGetTaskName(NULL);
+
+    portENTER_CRITICAL(&_lock);
+    int id = -1;
+    if (_stageCount < MAX_STAGES) {
+        id = _stageCount++;
+        _stages[id] = {name, now, 0, task};
+    }
+    portEXIT_CRITICAL(&_lock);
+    return id;
+}
+
+void BootProfiler::endStage(int stageId) {
+    if (stageId < 0 || stageId >= MAX_STAGES) return;
+    unsigned long now = millis();
+
+    portENTER_CRITICAL(&_lock);
+    _stages[stageId].endMs = now;
+    portEXIT_CRITICAL(&_lock);
+}
+
+void BootProfiler::markFirstCode() {
+    if (_firstCodeMs == 0) {
+        _firstCodeMs = millis();
+    }
+}
+
+void BootProfiler::report() {
+    // Копируем таблицу, чтобы не держать блокировку во время вывода в журнал
+    Stage stages[MAX_STAGES];
+    portENTER_CRITICAL(&_lock);
+    int count = _stageCount;
+    memcpy(stages, _stages, sizeof(Stage) * count);
+    portEXIT_CRITICAL(&_lock);
+
+    LOG_INFO("Boot", "stage            task        start    dur");
+    for (int i = 0; i < count; i++) {
+        if (stages[i].endMs == 0) {
+            LOG_INFO("Boot", "%-16s %-10s %6lu    ...", stages[i].name, stages[i].task, stages[i].startMs);
+        } else {
+            LOG_INFO("Boot", "%-16s %-10s %6lu %6lu", stages[i].name, stages[i].task,
+                     stages[i].startMs, stages[i].endMs - stages[i].startMs);
+        }
+    }
+    if (_firstCodeMs != 0) {
+        LOG_INFO("Boot", "time-to-first-code: %lu ms", _firstCodeMs);
+    }
+}
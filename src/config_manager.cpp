@@ -1,71 +1,129 @@
 #include "config_manager.h"
+#include "atomic_file.h"
+#include "logger.h"
 
 ConfigManager::ConfigManager() {
     // Constructor
 }
 
+const char* ConfigManager::sectionPath(int section) {
+    switch ((ConfigSection)section) {
+        case ConfigSection::GENERAL: return CONFIG_FILE;
+        case ConfigSection::PIN:     return PIN_FILE;
+        case ConfigSection::AUTH:    return AUTH_FILE;
+        case ConfigSection::WIFI:    return WIFI_CONFIG_FILE;
+        default:                     return nullptr;
+    }
+}
+
+// Вызывается после LittleFS.begin() и до остальных менеджеров
 void ConfigManager::begin() {
-    // No specific begin logic needed for now, LittleFS is initialized elsewhere
+    _mutex = xSemaphoreCreateMutex();
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        loadSection(i);
+    }
 }
 
-Theme ConfigManager::loadTheme() {
-    Serial.println("ConfigManager::loadTheme() called.");
-    if (LittleFS.exists(CONFIG_FILE)) {
-        Serial.println("Config file exists. Opening...");
-        fs::File configFile = LittleFS.open(CONFIG_FILE, "r");
-        if (configFile) {
-            JsonDocument doc;
-            DeserializationError error = deserializeJson(doc, configFile);
-            if (error == DeserializationError::Ok) {
-                String themeStr = doc[THEME_CONFIG_KEY] | "dark"; // Default to "dark"
-                Serial.println("Loaded theme string: " + themeStr);
-                if (themeStr == "light") {
-                    _currentTheme = Theme::LIGHT;
-                } else {
-                    _currentTheme = Theme::DARK;
-                }
-                Serial.println("Current theme set to: " + String((_currentTheme == Theme::LIGHT) ? "LIGHT" : "DARK"));
-            } else {
-                Serial.println("Failed to deserialize config file: " + String(error.c_str()));
-            }
-            configFile.close();
-        } else {
-            Serial.println("Failed to open config file for reading.");
-        }
-    } else {
-        Serial.println("Config file does not exist. Using default theme.");
+void ConfigManager::loadSection(int section) {
+    const char* path = sectionPath(section);
+    _docs[section].clear();
+
+    AtomicFile::recover(flashFS, path);
+    std::vector<uint8_t> content;
+    if (!AtomicFile::read(flashFS, path, content)) {
+        LOG_DEBUG("Config", "%s not found, using defaults", path);
+        return;
+    }
+    DeserializationError error = deserializeJson(_docs[section], content.data(), content.size());
+    if (error) {
+        LOG_ERROR("Config", "failed to parse %s: %s", path, error.c_str());
+        _docs[section].clear();
     }
-    return _currentTheme;
 }
 
-void ConfigManager::saveTheme(Theme theme) {
-    Serial.println("ConfigManager::saveTheme() called with theme: " + String((theme == Theme::LIGHT) ? "LIGHT" : "DARK"));
-    _currentTheme = theme;
-    JsonDocument doc;
+void ConfigManager::markDirty(int section) {
+    unsigned long now = millis();
+    if (_dirtyMask == 0) _firstDirtyMs = now;
+    _lastDirtyMs = now;
+    _dirtyMask |= 1 << section;
+}
 
-    // Load existing config to preserve other settings
-    if (LittleFS.exists(CONFIG_FILE)) {
-        Serial.println("Config file exists. Loading existing settings...");
-        fs::File configFile = LittleFS.open(CONFIG_FILE, "r");
-        if (configFile) {
-            deserializeJson(doc, configFile);
-            configFile.close();
-            Serial.println("Existing config loaded.");
-        } else {
-            Serial.println("Failed to open config file for reading during save. Creating new doc.");
-        }
-    } else {
-        Serial.println("Config file does not exist. Creating new doc.");
+bool ConfigManager::saveSection(int section) {
+    String content;
+    serializeJson(_docs[section], content);
+    if (!AtomicFile::write(flashFS, sectionPath(section), content)) {
+        LOG_ERROR("Config", "failed to write %s", sectionPath(section));
+        return false;
     }
+    _dirtyMask &= ~(1 << section);
+    return true;
+}
 
-    doc[THEME_CONFIG_KEY] = (theme == Theme::LIGHT) ? "light" : "dark"; // Use lowercase
+void ConfigManager::update() {
+    if (_dirtyMask == 0) return;
+    unsigned long now = millis();
+    if (now - _lastDirtyMs >= CONFIG_WRITE_DELAY_MS || now - _firstDirtyMs >= CONFIG_WRITE_MAX_DELAY_MS) {
+        flush();
+    }
+}
 
-    fs::File configFile = LittleFS.open(CONFIG_FILE, "w");
-    if (configFile) {
-        serializeJson(doc, configFile);
-        configFile.close();
-        Serial.println("Theme saved successfully to config file.");
-    } else {
-        Serial.println("Failed to open config file for writing.");
+void ConfigManager::flush() {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        if (_dirtyMask & (1 << i)) {
+            saveSection(i);
+        }
     }
+    if (_dirtyMask != 0) {
+        // Неудачная запись повторится после следующей паузы
+        _firstDirtyMs = _lastDirtyMs = millis();
+    }
+    xSemaphoreGive(_mutex);
+}
+
+void ConfigManager::readSection(ConfigSection section, const std::function<void(const JsonDocument&)>& reader) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    reader(_docs[(int)section]);
+    xSemaphoreGive(_mutex);
+}
+
+bool ConfigManager::writeSection(ConfigSection section, const std::function<void(JsonDocument&)>& writer, bool immediate) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    writer(_docs[(int)section]);
+    markDirty((int)section);
+    bool ok = immediate ? saveSection((int)section) : true;
+    xSemaphoreGive(_mutex);
+    return ok;
+}
+
+String ConfigManager::getThemeName() {
+    String name = DEFAULT_THEME_NAME;
+    readSection(ConfigSection::GENERAL, [&name](const JsonDocument& doc) {
+        name = doc[THEME_CONFIG_KEY] | DEFAULT_THEME_NAME;
+    });
+    return name;
+}
+
+void ConfigManager::setThemeName(const String& name) {
+    writeSection(ConfigSection::GENERAL, [&name](JsonDocument& doc) {
+        doc[THEME_CONFIG_KEY] = name;
+    });
+    LOG_DEBUG("Config", "theme set: %s", name.c_str());
+}
+
+bool ConfigManager::getTimeSync(time_t& lastSyncEpoch, float& driftPpm, float& driftWeightHours) {
+    readSection(ConfigSection::GENERAL, [&](const JsonDocument& doc) {
+        lastSyncEpoch = doc[LAST_SYNC_CONFIG_KEY] | (time_t)0;
+        driftPpm = doc[DRIFT_CONFIG_KEY] | 0.0f;
+        driftWeightHours = doc[DRIFT_WEIGHT_CONFIG_KEY] | 0.0f;
+    });
+    return lastSyncEpoch > 0;
+}
+
+void ConfigManager::setTimeSync(time_t lastSyncEpoch, float driftPpm, float driftWeightHours) {
+    writeSection(ConfigSection::GENERAL, [&](JsonDocument& doc) {
+        doc[LAST_SYNC_CONFIG_KEY] = lastSyncEpoch;
+        doc[DRIFT_CONFIG_KEY] = driftPpm;
+        doc[DRIFT_WEIGHT_CONFIG_KEY] = driftWeightHours;
+    });
 }
@@ -1,6 +1,26 @@
 #include "crypto_manager.h"
 #include "mbedtls/sha256.h"
 #include "mbedtls/base64.h"
+#include "mbedtls/md.h"
+#include "mbedtls/pkcs5.h"
+#include <esp_system.h>
+#include <esp_timer.h>
+#include "secret_store.h"
+
+// Число итераций пробного прогона при калибровке
+#define KDF_CALIBRATION_ITERATIONS 1000
+
+static bool pbkdf2Sha256(const String& password, const uint8_t* salt, uint32_t iterations, uint8_t* out) {
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    int ret = mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
+    if (ret == 0) {
+        ret = mbedtls_pkcs5_pbkdf2_hmac(&ctx, (const unsigned char*)password.c_str(), password.length(),
+                                        salt, KDF_SALT_LENGTH, iterations, KDF_HASH_LENGTH, out);
+    }
+    mbedtls_md_free(&ctx);
+    return ret == 0;
+}
 
 String CryptoManager::hashPassword(const String& password) {
     uint8_t hashResult[32];
@@ -23,7 +43,79 @@ String CryptoManager::hashPassword(const String& password) {
 
 bool CryptoManager::verifyPassword(const String& password, const String& hash) {
     String hashedPassword = hashPassword(password);
-    return hashedPassword.equals(hash);
+    if (hashedPassword.length() != hash.length()) return false;
+    return constantTimeEquals(hashedPassword.c_str(), hash.c_str(), hash.length());
+}
+
+void CryptoManager::createPasswordRecord(const String& password, uint32_t iterations, PasswordRecord& record) {
+    esp_fill_random(record.salt, KDF_SALT_LENGTH);
+    record.iterations = iterations;
+    pbkdf2Sha256(password, record.salt, iterations, record.hash);
+}
+
+bool CryptoManager::verifyPasswordRecord(const String& password, const PasswordRecord& record) {
+    if (record.iterations == 0) return false;
+
+    uint8_t computed[KDF_HASH_LENGTH];
+    bool ok = pbkdf2Sha256(password, record.salt, record.iterations, computed)
+              && constantTimeEquals((const char*)computed, (const char*)record.hash, KDF_HASH_LENGTH);
+    memset(computed, 0, sizeof(computed));
+    return ok;
+}
+
+bool CryptoManager::deriveKey(const String& password, const uint8_t* salt, uint32_t iterations, uint8_t* key) {
+    return iterations > 0 && pbkdf2Sha256(password, salt, iterations, key);
+}
+
+uint32_t CryptoManager::calibrateIterations(uint32_t targetMs, uint32_t minIterations) {
+    uint8_t salt[KDF_SALT_LENGTH] = {0};
+    uint8_t out[KDF_HASH_LENGTH];
+
+    int64_t start = esp_timer_get_time();
+    pbkdf2Sha256("calibration", salt, KDF_CALIBRATION_ITERATIONS, out);
+    int64_t elapsedUs = esp_timer_get_time() - start;
+    if (elapsedUs <= 0) elapsedUs = 1;
+
+    uint64_t iterations = (uint64_t)KDF_CALIBRATION_ITERATIONS * targetMs * 1000 / elapsedUs;
+    if (iterations < minIterations) iterations = minIterations;
+    if (iterations > 10000000) iterations = 10000000;
+    return (uint32_t)iterations;
+}
+
+String CryptoManager::toHex(const uint8_t* data, size_t length) {
+    static const char digits[] = "0123456789abcdef";
+    String hex;
+    hex.reserve(length * 2);
+    for (size_t i = 0; i < length; i++) {
+        hex += digits[data[i] >> 4];
+        hex += digits[data[i] & 0x0F];
+    }
+    return hex;
+}
+
+bool CryptoManager::fromHex(const String& hex, uint8_t* data, size_t length) {
+    if (hex.length() != length * 2) return false;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t value = 0;
+        for (int j = 0; j < 2; j++) {
+            char c = hex[i * 2 + j];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return false;
+        }
+        data[i] = value;
+    }
+    return true;
+}
+
+bool CryptoManager::constantTimeEquals(const char* a, const char* b, size_t length) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < length; i++) {
+        diff |= (uint8_t)a[i] ^ (uint8_t)b[i];
+    }
+    return diff == 0;
 }
 
 String CryptoManager::base64Decode(const String& encoded) {
@@ -43,11 +135,13 @@ String CryptoManager::base64Decode(const String& encoded) {
     // Вторым вызовом декодируем
     int ret = mbedtls_base64_decode(decoded_buf, output_len, &output_len, (const unsigned char*)encoded.c_str(), encoded.length());
     if (ret != 0) {
+        SecretStore::wipe(decoded_buf, output_len);
         free(decoded_buf);
         return "";
     }
 
     String decoded_str = String((char*)decoded_buf, output_len);
+    SecretStore::wipe(decoded_buf, output_len); // Здесь бывают пароли из заголовка Authorization
     free(decoded_buf);
     return decoded_str;
 }
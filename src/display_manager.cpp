@@ -1,5 +1,9 @@
 #include "display_manager.h"
+#include <vector>
 #include "config.h"
+#include "metrics.h"
+#include "logger.h"
+#include "secret_store.h"
 
 // Helper for the animation loop
 void schedule_next_update(DisplayManager* dm, AnimationManager* am);
@@ -18,37 +22,161 @@ void schedule_next_update(DisplayManager* dm, AnimationManager* am) {
 }
 
 
+// Биты цветов палитры в порядке полей ThemeColors
+static const uint8_t COLOR_BACKGROUND_DARK  = 1 << 0;
+static const uint8_t COLOR_BACKGROUND_LIGHT = 1 << 1;
+static const uint8_t COLOR_ACCENT_PRIMARY   = 1 << 2;
+static const uint8_t COLOR_TEXT_PRIMARY     = 1 << 4;
+static const uint8_t COLOR_TEXT_SECONDARY   = 1 << 5;
+static const uint8_t COLOR_SHADOW           = 1 << 6;
+// Цвета, которыми нарисованы контейнер кода и полоса времени
+static const uint8_t CONTAINER_COLORS = COLOR_BACKGROUND_DARK | COLOR_BACKGROUND_LIGHT | COLOR_TEXT_PRIMARY |
+                                        COLOR_TEXT_SECONDARY | COLOR_SHADOW;
+static const uint8_t PROGRESS_BAR_COLORS = COLOR_BACKGROUND_DARK | COLOR_BACKGROUND_LIGHT | COLOR_ACCENT_PRIMARY |
+                                           COLOR_TEXT_SECONDARY | COLOR_SHADOW;
+
+// Смешение RGB565 по каналам, alpha от 0 (from) до 32 (to)
+static uint16_t blend565(uint16_t from, uint16_t to, int alpha) {
+    int r = ((from >> 11) * (32 - alpha) + (to >> 11) * alpha) >> 5;
+    int g = (((from >> 5) & 0x3F) * (32 - alpha) + ((to >> 5) & 0x3F) * alpha) >> 5;
+    int b = ((from & 0x1F) * (32 - alpha) + (to & 0x1F) * alpha) >> 5;
+    return (r << 11) | (g << 5) | b;
+}
+
+// Геометрия полосы времени: область, которую она перерисовывает вместе с фоном
+struct ProgressBarLayout {
+    int x, y, width, height;
+};
+static const int PROGRESS_BAR_SHADOW = 2;
+static const int PROGRESS_BAR_TEXT_WIDTH = 40;
+
+static ProgressBarLayout progressBarLayout(int screenWidth, int screenHeight) {
+    ProgressBarLayout layout;
+    layout.width = (screenWidth - 64) * 0.8;
+    layout.height = 10;
+    layout.x = (screenWidth - layout.width) / 2;
+    layout.y = screenHeight - 30;
+    return layout;
+}
+
 DisplayManager::DisplayManager() : tft(TFT_eSPI()), animationManager(), headerSprite(&tft), totpContainerSprite(&tft), totpSprite(&tft) {
-    _currentThemeColors = &DARK_THEME_COLORS;
+    _themeColors = DARK_THEME_COLORS;
+    _currentThemeColors = &_themeColors;
     _totpState = TotpState::IDLE;
     _lastDrawnTotpString = "";
     _lastScrambleFrameTime = 0;
     _totpContainerNeedsRedraw = true;
 }
 
-void DisplayManager::setTheme(Theme theme) {
-    Serial.println("DisplayManager::setTheme() called with theme: " + String((theme == Theme::LIGHT) ? "LIGHT" : "DARK"));
-    switch (theme) {
-        case Theme::DARK:
-            _currentThemeColors = &DARK_THEME_COLORS;
-            break;
-        case Theme::LIGHT:
-            _currentThemeColors = &LIGHT_THEME_COLORS;
-            break;
+void DisplayManager::setTheme(const ThemeColors& colors) {
+    portENTER_CRITICAL(&_pendingLock);
+    _pendingTheme = colors;
+    _hasPendingTheme = true;
+    portEXIT_CRITICAL(&_pendingLock);
+}
+
+void DisplayManager::applyPendingTheme() {
+    if (!_hasPendingTheme) return;
+    portENTER_CRITICAL(&_pendingLock);
+    ThemeColors target = _pendingTheme;
+    _hasPendingTheme = false;
+    portEXIT_CRITICAL(&_pendingLock);
+
+    if (!_layoutActive) {
+        // Экран все равно будет перерисован целиком тем, кто его покажет
+        _themeColors = target;
+        _currentThemeColors = &_themeColors;
+        _fading = false;
+        lastTimeRemaining = -1;
+        _lastDrawnTotpString = "";
+        _totpContainerNeedsRedraw = true;
+        invalidateKeyList();
+        return;
     }
-    Serial.println("Applying new theme colors to display...");
-    tft.fillScreen(_currentThemeColors->background_dark);
-    updateHeader(); 
-    lastDisplayedCode = ""; 
-    lastTimeRemaining = -1;
-    _lastDrawnTotpString = ""; 
-    _totpState = TotpState::IDLE;
-    _totpContainerNeedsRedraw = true; // Force redraw of container with new theme
-    Serial.println("Theme applied. Screen should update on next loop.");
+
+    // Переход начинается с того, что сейчас на экране (в том числе с середины другого перехода)
+    ThemeColors from = *_currentThemeColors;
+    const uint16_t* fromSlots = reinterpret_cast<const uint16_t*>(&from);
+    const uint16_t* toSlots = reinterpret_cast<const uint16_t*>(&target);
+    _fadeChangedMask = 0;
+    for (int step = 0; step < THEME_FADE_STEPS; step++) {
+        uint16_t* slots = reinterpret_cast<uint16_t*>(&_fadeTable[step]);
+        int alpha = (step + 1) * 32 / THEME_FADE_STEPS;
+        for (int i = 0; i < THEME_COLOR_COUNT; i++) {
+            slots[i] = blend565(fromSlots[i], toSlots[i], alpha);
+            if (fromSlots[i] != toSlots[i]) _fadeChangedMask |= 1 << i;
+        }
+    }
+    _themeColors = target;
+    _currentThemeColors = &_fadeTable[0];
+    _fading = true;
+    _fadeStep = -1;
+    _fadeStartMs = millis();
+    LOG_DEBUG("Display", "theme fade, changed colors 0x%02x", _fadeChangedMask);
+}
+
+void DisplayManager::updateThemeFade() {
+    int step = (millis() - _fadeStartMs) * THEME_FADE_STEPS / THEME_FADE_MS;
+    if (step >= THEME_FADE_STEPS) step = THEME_FADE_STEPS - 1;
+    if (step == _fadeStep) return;
+    _fadeStep = step;
+    _currentThemeColors = &_fadeTable[step];
+
+    // Перерисовываются только элементы, чьи цвета меняются
+    if (_fadeChangedMask & COLOR_BACKGROUND_DARK) {
+        fillBackground();
+    }
+    if (_fadeChangedMask & CONTAINER_COLORS) {
+        String text = _lastDrawnTotpString;
+        drawTotpContainer();
+        drawTotpText(text);
+    }
+    if ((_fadeChangedMask & PROGRESS_BAR_COLORS) && lastTimeRemaining >= 0) {
+        drawProgressBar(lastTimeRemaining);
+    }
+
+    if (step == THEME_FADE_STEPS - 1) {
+        _currentThemeColors = &_themeColors; // Последний шаг равен новой палитре
+        _fading = false;
+    }
+}
+
+// Фон вокруг заголовка, контейнера кода и полосы времени (их фон рисуют они сами)
+void DisplayManager::fillBackground() {
+    uint16_t color = _currentThemeColors->background_dark;
+    int width = tft.width();
+    int height = tft.height();
+    int top = headerSprite.height();
+    int containerW = totpContainerSprite.width();
+    int containerH = totpContainerSprite.height();
+    int containerX = width / 2 - containerW / 2;
+    int containerY = height / 2 - containerH / 2;
+    ProgressBarLayout bar = progressBarLayout(width, height);
+    int barX = bar.x - PROGRESS_BAR_SHADOW;
+    int barY = bar.y - PROGRESS_BAR_SHADOW;
+    int barW = bar.width + PROGRESS_BAR_TEXT_WIDTH + PROGRESS_BAR_SHADOW;
+    int barH = bar.height + PROGRESS_BAR_SHADOW * 2;
+
+    tft.fillRect(0, top, width, containerY - top, color);
+    tft.fillRect(0, containerY, containerX, containerH, color);
+    tft.fillRect(containerX + containerW, containerY, width - containerX - containerW, containerH, color);
+    tft.fillRect(0, containerY + containerH, width, barY - containerY - containerH, color);
+    tft.fillRect(0, barY, barX, barH, color);
+    tft.fillRect(barX + barW, barY, width - barX - barW, barH, color);
+    tft.fillRect(0, barY + barH, width, height - barY - barH, color);
+    METRIC_ADD(METRIC_SPI_BYTES, (width * (height - top) - containerW * containerH - barW * barH) * 2);
 }
 
 void DisplayManager::update() {
     animationManager.update();
+    applyPendingTheme();
+    if (_fading) {
+        updateThemeFade();
+    }
+    applyPendingQrCode();
+    if (_qrActive && millis() - _qrShownAt > QR_DISPLAY_MS) {
+        _qrActive = false; // Владелец экрана увидит это и перерисует его
+    }
 
     if (_totpState == TotpState::IDLE) {
         return;
@@ -81,14 +209,15 @@ void DisplayManager::update() {
     String textToDraw = "";
     const char charset[] = "abcdefghijklmnopqrstuvwxyz0123456789";
 
+    int length = _newCode.length();
     if (elapsedTime < scrambleDuration) {
-        for (int i = 0; i < 6; i++) {
+        for (int i = 0; i < length; i++) {
             textToDraw += charset[random(sizeof(charset) - 1)];
         }
     } else {
         int charsToReveal = (elapsedTime - scrambleDuration) / 25;
         textToDraw = _newCode.substring(0, charsToReveal);
-        for (int i = charsToReveal; i < 6; i++) {
+        for (int i = charsToReveal; i < length; i++) {
             textToDraw += charset[random(sizeof(charset) - 1)];
         }
     }
@@ -101,6 +230,9 @@ void DisplayManager::init() {
     pinMode(TFT_BL, OUTPUT);
     digitalWrite(TFT_BL, HIGH);
 
+    _layoutActive = false;
+    _listActive = false;
+    applyPendingTheme();
     tft.init();
     tft.setRotation(1);
     tft.fillScreen(_currentThemeColors->background_dark); 
@@ -123,6 +255,7 @@ void DisplayManager::init() {
     totpSprite.createSprite(codeAreaWidth - 2, codeAreaHeight - 2);
     totpSprite.setTextDatum(MC_DATUM);
 
+    rowSprite.createSprite(tft.width(), LIST_ROW_HEIGHT);
 
     _totpState = TotpState::IDLE;
     _lastDrawnTotpString = "";
@@ -133,6 +266,8 @@ void DisplayManager::init() {
 
 void DisplayManager::drawLayout(const String& serviceName, int batteryPercentage, bool isCharging) {
     tft.fillScreen(_currentThemeColors->background_dark); 
+    _layoutActive = true;
+    _listActive = false;
     
     _currentServiceName = serviceName;
     _currentBatteryPercentage = batteryPercentage;
@@ -148,6 +283,193 @@ void DisplayManager::drawLayout(const String& serviceName, int batteryPercentage
     _isKeySwitched = true; // Флаг, что мы только что переключили ключ
 }
 
+void DisplayManager::drawKeyListLayout(int batteryPercentage, bool isCharging) {
+    tft.fillScreen(_currentThemeColors->background_dark);
+    _layoutActive = false;
+    _listActive = true;
+    _totpState = TotpState::IDLE;
+
+    _currentBatteryPercentage = batteryPercentage;
+    _isCharging = isCharging;
+    _headerState = HeaderState::INTRO;
+    _introAnimStartTime = millis();
+    invalidateKeyList();
+}
+
+void DisplayManager::invalidateKeyList() {
+    for (int i = 0; i < LIST_VISIBLE_ROWS; i++) {
+        _listRows[i].index = -2;
+    }
+    _listTimeRemaining = -1;
+}
+
+void DisplayManager::updateKeyList(int keyCount, int selected, int timeRemaining, const KeyRowProvider& rowProvider) {
+    if (!_listActive) return;
+
+    // Окно сдвигается ровно настолько, чтобы выбранная строка была видна
+    if (selected < _listFirst) _listFirst = selected;
+    if (selected >= _listFirst + LIST_VISIBLE_ROWS) _listFirst = selected - LIST_VISIBLE_ROWS + 1;
+    int maxFirst = keyCount > LIST_VISIBLE_ROWS ? keyCount - LIST_VISIBLE_ROWS : 0;
+    if (_listFirst > maxFirst) _listFirst = maxFirst;
+    if (_listFirst < 0) _listFirst = 0;
+
+    _currentServiceName = String(selected + 1) + "/" + String(keyCount);
+
+    for (int slot = 0; slot < LIST_VISIBLE_ROWS; slot++) {
+        ListRow& row = _listRows[slot];
+        int index = _listFirst + slot;
+        String name, code;
+        if (index >= keyCount || !rowProvider(index, name, code)) {
+            if (row.index == -1) continue;
+            index = -1;
+        }
+        bool isSelected = (index == selected);
+        if (row.index == index && row.selected == isSelected && row.code == code && row.name == name) continue;
+
+        drawListRow(slot, name, code, isSelected);
+        row.index = index;
+        row.selected = isSelected;
+        row.name = name;
+        row.code = code;
+    }
+
+    if (timeRemaining != _listTimeRemaining) {
+        drawListProgress(timeRemaining);
+        _listTimeRemaining = timeRemaining;
+    }
+}
+
+void DisplayManager::drawListRow(int slot, const String& name, const String& code, bool selected) {
+    uint16_t background = selected ? _currentThemeColors->background_light : _currentThemeColors->background_dark;
+    int width = rowSprite.width();
+    int middle = LIST_ROW_HEIGHT / 2;
+
+    rowSprite.fillSprite(background);
+    if (!name.isEmpty()) {
+        if (selected) {
+            rowSprite.fillRect(0, 2, 3, LIST_ROW_HEIGHT - 4, _currentThemeColors->accent_primary);
+        }
+        rowSprite.setTextSize(2);
+        rowSprite.setTextDatum(MR_DATUM);
+        rowSprite.setTextColor(_currentThemeColors->text_primary, background);
+        rowSprite.drawString(code, width - 6, middle);
+
+        // Имя обрезается по месту, оставшемуся слева от кода
+        int nameSpace = width - 6 - rowSprite.textWidth(code) - 16;
+        String shown = name;
+        while (shown.length() > 1 && rowSprite.textWidth(shown) > nameSpace) {
+            shown.remove(shown.length() - 1);
+        }
+        rowSprite.setTextDatum(ML_DATUM);
+        rowSprite.setTextColor(selected ? _currentThemeColors->text_primary : _currentThemeColors->text_secondary, background);
+        rowSprite.drawString(shown, 8, middle);
+    }
+    rowSprite.drawFastHLine(0, LIST_ROW_HEIGHT - 1, width, _currentThemeColors->shadow_color);
+
+    rowSprite.pushSprite(0, headerSprite.height() + slot * LIST_ROW_HEIGHT);
+    METRIC_ADD(METRIC_SPI_BYTES, width * LIST_ROW_HEIGHT * 2);
+}
+
+// Общая для всех строк полоса времени под списком
+void DisplayManager::drawListProgress(int timeRemaining) {
+    int y = headerSprite.height() + LIST_VISIBLE_ROWS * LIST_ROW_HEIGHT;
+    int height = tft.height() - y;
+    if (height <= 0) return;
+    int width = tft.width();
+    int fillWidth = map(timeRemaining, CONFIG_TOTP_STEP_SIZE, 0, width, 0);
+    tft.fillRect(0, y, fillWidth, height, _currentThemeColors->accent_primary);
+    tft.fillRect(fillWidth, y, width - fillWidth, height, _currentThemeColors->background_dark);
+    METRIC_ADD(METRIC_SPI_BYTES, width * height * 2);
+}
+
+void DisplayManager::showQrCode(const QrCode& qr, const String& caption) {
+    portENTER_CRITICAL(&_pendingLock);
+    _pendingQr = qr;
+    strlcpy(_pendingQrCaption, caption.c_str(), sizeof(_pendingQrCaption));
+    _hasPendingQr = true;
+    portEXIT_CRITICAL(&_pendingLock);
+}
+
+void DisplayManager::dismissQrCode() {
+    portENTER_CRITICAL(&_pendingLock);
+    _hasPendingQr = false;
+    SecretStore::wipe(&_pendingQr, sizeof(_pendingQr));
+    portEXIT_CRITICAL(&_pendingLock);
+    _qrActive = false;
+}
+
+void DisplayManager::applyPendingQrCode() {
+    if (!_hasPendingQr) return;
+    portENTER_CRITICAL(&_pendingLock);
+    _qrCode = _pendingQr;
+    memcpy(_qrCaption, _pendingQrCaption, sizeof(_qrCaption));
+    _hasPendingQr = false;
+    SecretStore::wipe(&_pendingQr, sizeof(_pendingQr));
+    portEXIT_CRITICAL(&_pendingLock);
+
+    _layoutActive = false;
+    _listActive = false;
+    _totpState = TotpState::IDLE;
+    _qrActive = true;
+    _qrShownAt = millis();
+    turnOn();
+    drawQrCode();
+    SecretStore::wipe(&_qrCode, sizeof(_qrCode)); // QR-код несет секрет ключа; на экране он уже есть
+}
+
+// QR-код слева (черный на белом независимо от темы: так его читают камеры),
+// справа - имя ключа. Модули масштабируются в битовый буфер 1 бит/пиксель и
+// выводятся одним drawBitmap.
+void DisplayManager::drawQrCode() {
+    int height = tft.height();
+    int modules = _qrCode.size() + 8; // 4 модуля тихой зоны с каждой стороны
+    int scale = height / modules;
+    if (scale < 1) scale = 1;
+    int side = modules * scale;
+    int rowBytes = (side + 7) / 8;
+
+    std::vector<uint8_t> bitmap(rowBytes * side, 0);
+    for (int y = 0; y < _qrCode.size(); y++) {
+        for (int x = 0; x < _qrCode.size(); x++) {
+            if (!_qrCode.module(x, y)) continue;
+            for (int dy = 0; dy < scale; dy++) {
+                uint8_t* row = bitmap.data() + ((y + 4) * scale + dy) * rowBytes;
+                for (int dx = 0; dx < scale; dx++) {
+                    int px = (x + 4) * scale + dx;
+                    row[px >> 3] |= 0x80 >> (px & 7);
+                }
+            }
+        }
+    }
+
+    int offsetY = (height - side) / 2;
+    tft.fillRect(0, 0, height, height, TFT_WHITE);
+    tft.drawBitmap((height - side) / 2, offsetY, bitmap.data(), side, side, TFT_BLACK, TFT_WHITE);
+    SecretStore::wipe(bitmap.data(), bitmap.size());
+    METRIC_ADD(METRIC_SPI_BYTES, (height * height + side * side) * 2);
+
+    // Подпись: издатель и аккаунт отдельными строками, обрезанные по ширине
+    int textX = height + 6;
+    int textWidth = tft.width() - textX - 4;
+    tft.fillRect(height, 0, tft.width() - height, height, _currentThemeColors->background_dark);
+    tft.setTextDatum(TL_DATUM);
+    tft.setTextSize(1);
+    String caption = _qrCaption;
+    int colon = caption.indexOf(':');
+    String lines[4] = {colon > 0 ? caption.substring(0, colon) : caption,
+                       colon > 0 ? caption.substring(colon + 1) : String(""),
+                       "Scan to import", "Any button: close"};
+    for (int i = 0; i < 4; i++) {
+        while (lines[i].length() > 1 && tft.textWidth(lines[i]) > textWidth) {
+            lines[i].remove(lines[i].length() - 1);
+        }
+        tft.setTextColor(i < 2 ? _currentThemeColors->text_primary : _currentThemeColors->text_secondary,
+                         _currentThemeColors->background_dark);
+        tft.drawString(lines[i], textX, i < 2 ? 10 + i * 14 : height - 34 + (i - 2) * 14);
+    }
+    tft.setTextDatum(MC_DATUM);
+}
+
 void DisplayManager::updateBatteryStatus(int percentage, bool isCharging) {
     _currentBatteryPercentage = percentage;
     _isCharging = isCharging;
@@ -165,6 +487,8 @@ void DisplayManager::updateBatteryStatus(int percentage, bool isCharging) {
 }
 
 void DisplayManager::updateHeader() {
+    if (_qrActive) return; // Заголовок закрыл бы верх QR-кода
+    METRIC_TIMER_BEGIN(frame);
     headerSprite.fillSprite(_currentThemeColors->background_dark);
 
     float titleY = 20;
@@ -183,7 +507,16 @@ void DisplayManager::updateHeader() {
 
     headerSprite.setTextColor(_currentThemeColors->text_primary, _currentThemeColors->background_dark);
     headerSprite.setTextSize(2);
-    headerSprite.drawString(_currentServiceName, headerSprite.width() / 2, (int)titleY);
+    if (_statusUntil != 0 && (long)(millis() - _statusUntil) < 0) {
+        // Статусное сообщение: уменьшаем шрифт, если не помещается рядом с батареей
+        if (headerSprite.textWidth(_statusText) > headerSprite.width() - 80) {
+            headerSprite.setTextSize(1);
+        }
+        headerSprite.drawString(_statusText, headerSprite.width() / 2, (int)titleY);
+    } else {
+        _statusUntil = 0;
+        headerSprite.drawString(_currentServiceName, headerSprite.width() / 2, (int)titleY);
+    }
 
     if (_headerState == HeaderState::CHARGING) {
         unsigned long chargeElapsedTime = millis() - _chargingAnimStartTime;
@@ -192,8 +525,36 @@ void DisplayManager::updateHeader() {
     } else {
         drawBatteryOnSprite(_currentBatteryPercentage, false);
     }
+    drawTimeConfidenceOnSprite();
 
     headerSprite.pushSprite(0, 0);
+    METRIC_TIMER_END(METRIC_TIMER_FRAME, frame);
+    METRIC_ADD(METRIC_FRAMES_RENDERED, 1);
+    METRIC_ADD(METRIC_SPI_BYTES, headerSprite.width() * headerSprite.height() * 2);
+}
+
+void DisplayManager::setTimeConfidence(TimeConfidence confidence) {
+    _timeConfidence = confidence;
+}
+
+void DisplayManager::showStatus(const String& text, unsigned long durationMs) {
+    _statusText = text;
+    _statusUntil = millis() + durationMs;
+    if (_statusUntil == 0) _statusUntil = 1; // 0 означает "нет статуса"
+}
+
+void DisplayManager::drawTimeConfidenceOnSprite() {
+    // Точка слева от батареи: зеленая - NTP, оранжевая - RTC, красная - времени нет
+    uint16_t color;
+    switch (_timeConfidence) {
+        case TimeConfidence::SYNCED:    color = _currentThemeColors->accent_primary; break;
+        case TimeConfidence::ESTIMATED: color = _currentThemeColors->accent_secondary; break;
+        default:                        color = _currentThemeColors->error_color; break;
+    }
+    int x = headerSprite.width() - 36;
+    int y = 10;
+    headerSprite.fillCircle(x + 1, y + 1, 3, _currentThemeColors->shadow_color);
+    headerSprite.fillCircle(x, y, 3, color);
 }
 
 void DisplayManager::drawBatteryOnSprite(int percentage, bool isCharging, int chargingValue) {
@@ -249,10 +610,12 @@ void DisplayManager::drawTotpText(const String& textToDraw) {
         return; 
     }
 
+    METRIC_TIMER_BEGIN(frame);
+
     // 1. Рисуем анимированный текст в свой спрайт
     totpSprite.fillSprite(_currentThemeColors->background_light);
     totpSprite.setTextColor(_currentThemeColors->text_primary, _currentThemeColors->background_light);
-    totpSprite.setTextSize(4);
+    totpSprite.setTextSize(textToDraw.length() > 6 ? 3 : 4); // 7-8 цифр крупным шрифтом не помещаются
     totpSprite.drawString(textToDraw, totpSprite.width() / 2, totpSprite.height() / 2);
 
     // 2. Накладываем спрайт с текстом внутрь рамки контейнера со смещением в 1px
@@ -264,12 +627,16 @@ void DisplayManager::drawTotpText(const String& textToDraw) {
     int containerX = centerX - totpContainerSprite.width() / 2;
     int containerY = codeY - totpContainerSprite.height() / 2;
     totpContainerSprite.pushSprite(containerX, containerY);
+    METRIC_TIMER_END(METRIC_TIMER_FRAME, frame);
+    METRIC_ADD(METRIC_FRAMES_RENDERED, 1);
+    METRIC_ADD(METRIC_SPI_BYTES, totpContainerSprite.width() * totpContainerSprite.height() * 2);
 
     _lastDrawnTotpString = textToDraw;
 }
 
 
-void DisplayManager::updateTOTPCode(const String& code, int timeRemaining) {
+void DisplayManager::updateTOTPCode(const String& code, int timeRemaining, int period) {
+    _totpPeriod = period;
     if (_totpContainerNeedsRedraw) {
         drawTotpContainer();
     }
@@ -301,34 +668,40 @@ void DisplayManager::updateTOTPCode(const String& code, int timeRemaining) {
 
     // Обновление прогресс-бара времени
     if (timeRemaining != lastTimeRemaining) {
-        int barY = tft.height() - 30;
-        int barHeight = 10;
-        int barWidth = (tft.width() - 64) * 0.8;
-        int barX = (tft.width() - barWidth) / 2;
-        int shadowOffset = 2;
-        int barCornerRadius = 5;
-
-        // Очищаем область прогресс-бара
-        tft.fillRect(barX - shadowOffset, barY - shadowOffset, barWidth + 40 + shadowOffset, barHeight + shadowOffset * 2, _currentThemeColors->background_dark);
-        
-        // Рисуем рамку и фон
-        tft.fillRoundRect(barX + shadowOffset, barY + shadowOffset, barWidth, barHeight, barCornerRadius, _currentThemeColors->shadow_color);
-        tft.drawRoundRect(barX, barY, barWidth, barHeight, barCornerRadius, _currentThemeColors->text_secondary);
-        tft.fillRoundRect(barX, barY, barWidth, barHeight, barCornerRadius, _currentThemeColors->background_light);
-
-        // Рисуем заполнение
-        int fillWidth = map(timeRemaining, CONFIG_TOTP_STEP_SIZE, 0, barWidth, 0);
-        tft.fillRoundRect(barX, barY, fillWidth, barHeight, barCornerRadius, _currentThemeColors->accent_primary);
-
-        // Рисуем текст времени
-        tft.setTextColor(_currentThemeColors->text_secondary, _currentThemeColors->background_dark);
-        tft.setTextSize(2);
-        tft.drawString(String(timeRemaining) + "s", barX + barWidth + 20, barY + barHeight / 2);
-        
+        drawProgressBar(timeRemaining);
         lastTimeRemaining = timeRemaining;
     }
 }
 
+void DisplayManager::drawProgressBar(int timeRemaining) {
+    ProgressBarLayout bar = progressBarLayout(tft.width(), tft.height());
+    int barX = bar.x;
+    int barY = bar.y;
+    int barWidth = bar.width;
+    int barHeight = bar.height;
+    int shadowOffset = PROGRESS_BAR_SHADOW;
+    int barCornerRadius = 5;
+
+    // Очищаем область прогресс-бара
+    tft.fillRect(barX - shadowOffset, barY - shadowOffset, barWidth + PROGRESS_BAR_TEXT_WIDTH + shadowOffset, barHeight + shadowOffset * 2, _currentThemeColors->background_dark);
+    
+    // Рисуем рамку и фон
+    tft.fillRoundRect(barX + shadowOffset, barY + shadowOffset, barWidth, barHeight, barCornerRadius, _currentThemeColors->shadow_color);
+    tft.drawRoundRect(barX, barY, barWidth, barHeight, barCornerRadius, _currentThemeColors->text_secondary);
+    tft.fillRoundRect(barX, barY, barWidth, barHeight, barCornerRadius, _currentThemeColors->background_light);
+
+    // Рисуем заполнение
+    int fillWidth = map(timeRemaining, _totpPeriod, 0, barWidth, 0);
+    tft.fillRoundRect(barX, barY, fillWidth, barHeight, barCornerRadius, _currentThemeColors->accent_primary);
+
+    // Рисуем текст времени
+    tft.setTextColor(_currentThemeColors->text_secondary, _currentThemeColors->background_dark);
+    tft.setTextSize(2);
+    tft.drawString(String(timeRemaining) + "s", barX + barWidth + 20, barY + barHeight / 2);
+    // Оценка трафика: очищаемая область полосы перерисовывается целиком
+    METRIC_ADD(METRIC_SPI_BYTES, (barWidth + PROGRESS_BAR_TEXT_WIDTH + shadowOffset) * (barHeight + shadowOffset * 2) * 2);
+}
+
 void DisplayManager::showMessage(const String& text, int x, int y, bool isError, int size) {
     tft.setTextDatum(TL_DATUM);
     tft.setCursor(x, y);
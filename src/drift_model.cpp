@@ -0,0 +1,103 @@
+#include "drift_model.h"
+
+static float clampPpm(float ppm) {
+    if (ppm > DriftModel::MAX_PPM) return DriftModel::MAX_PPM;
+    if (ppm < -DriftModel::MAX_PPM) return -DriftModel::MAX_PPM;
+    return ppm;
+}
+
+DriftModel::DriftModel() {}
+
+void DriftModel::setPrior(float ppm, float weightHours) {
+    _priorPpm = clampPpm(ppm);
+    _priorWeightHours = weightHours < 0 ? 0 : (weightHours > MAX_WEIGHT_HOURS ? MAX_WEIGHT_HOURS : weightHours);
+}
+
+void DriftModel::resetSession() {
+    _count = 0;
+    _head = 0;
+}
+
+const DriftModel::Sample& DriftModel::sampleAt(int i) const {
+    return _samples[(_head + i) % MAX_SAMPLES];
+}
+
+bool DriftModel::addSample(int64_t localUs, int64_t referenceUs) {
+    if (_count > 0) {
+        // Отбрасываем отсчеты, которые требуют дрейфа больше MAX_PPM:
+        // это скачок эталона или сбой, а не уход кварца
+        const Sample& last = sampleAt(_count - 1);
+        int64_t localDelta = localUs - last.localUs;
+        if (localDelta <= 0) return false;
+        int64_t offsetDelta = (referenceUs - last.referenceUs) - localDelta;
+        int64_t allowed = JITTER_US + (int64_t)(localDelta * (double)MAX_PPM / 1e6);
+        if (offsetDelta > allowed || offsetDelta < -allowed) {
+            return false;
+        }
+    }
+
+    if (_count < MAX_SAMPLES) {
+        _samples[(_head + _count) % MAX_SAMPLES] = {localUs, referenceUs};
+        _count++;
+    } else {
+        _samples[_head] = {localUs, referenceUs};
+        _head = (_head + 1) % MAX_SAMPLES;
+    }
+    return true;
+}
+
+bool DriftModel::fitSession(float& ppm, float& spanHours) const {
+    if (_count < 2) return false;
+
+    const Sample& first = sampleAt(0);
+    int64_t span = sampleAt(_count - 1).localUs - first.localUs;
+    if (span < MIN_SPAN_US) return false;
+
+    // Линейная регрессия смещения (мкс) по времени (с): наклон в мкс/с = ppm
+    double sumX = 0, sumY = 0;
+    for (int i = 0; i < _count; i++) {
+        const Sample& s = sampleAt(i);
+        int64_t dx = s.localUs - first.localUs;
+        sumX += dx / 1e6;
+        sumY += (double)((s.referenceUs - first.referenceUs) - dx);
+    }
+    double meanX = sumX / _count;
+    double meanY = sumY / _count;
+
+    double sxy = 0, sxx = 0;
+    for (int i = 0; i < _count; i++) {
+        const Sample& s = sampleAt(i);
+        int64_t dx = s.localUs - first.localUs;
+        double x = dx / 1e6 - meanX;
+        double y = (double)((s.referenceUs - first.referenceUs) - dx) - meanY;
+        sxy += x * y;
+        sxx += x * x;
+    }
+    if (sxx <= 0) return false;
+
+    ppm = clampPpm((float)(sxy / sxx));
+    spanHours = (float)(span / 3.6e9);
+    return true;
+}
+
+float DriftModel::getDriftPpm() const {
+    float sessionPpm, spanHours;
+    if (!fitSession(sessionPpm, spanHours)) {
+        return _priorPpm;
+    }
+    float total = _priorWeightHours + spanHours;
+    return (_priorPpm * _priorWeightHours + sessionPpm * spanHours) / total;
+}
+
+float DriftModel::getWeightHours() const {
+    float sessionPpm, spanHours;
+    float weight = _priorWeightHours;
+    if (fitSession(sessionPpm, spanHours)) {
+        weight += spanHours;
+    }
+    return weight > MAX_WEIGHT_HOURS ? MAX_WEIGHT_HOURS : weight;
+}
+
+int64_t DriftModel::correctionUs(int64_t localElapsedUs) const {
+    return (int64_t)((double)localElapsedUs * getDriftPpm() / 1e6);
+}
@@ -0,0 +1,184 @@
+#include "flash_fs.h"
+#include <LittleFS.h>
+#include <utility>
+
+FlashFS flashFS(LittleFS);
+
+// --- ФАЙЛ ---
+
+FlashFile::FlashFile(FlashFS* owner, fs::File file, int stats, bool writing)
+    : _owner(owner), _file(file), _stats(stats), _writing(writing) {}
+
+FlashFile::FlashFile(FlashFile&& other) {
+    *this = std::move(other);
+}
+
+FlashFile& FlashFile::operator=(FlashFile&& other) {
+    if (this != &other) {
+        close();
+        _owner = other._owner;
+        _file = other._file;
+        _stats = other._stats;
+        _writing = other._writing;
+        _sessionBytes = other._sessionBytes;
+        other._owner = nullptr;
+        other._file = fs::File();
+        other._writing = false;
+    }
+    return *this;
+}
+
+FlashFile::~FlashFile() {
+    close();
+}
+
+size_t FlashFile::read(uint8_t* buffer, size_t length) {
+    size_t bytes = _file.read(buffer, length);
+    if (_owner) _owner->addRead(_stats, bytes);
+    return bytes;
+}
+
+size_t FlashFile::write(const uint8_t* buffer, size_t length) {
+    size_t bytes = _file.write(buffer, length);
+    _sessionBytes += bytes;
+    if (_owner) _owner->addWrite(_stats, bytes);
+    return bytes;
+}
+
+void FlashFile::close() {
+    if (!_file) return;
+    _file.close();
+    if (_owner && _writing) _owner->endWriteSession(_stats, _sessionBytes);
+    _writing = false;
+    _sessionBytes = 0;
+}
+
+// --- ФАЙЛОВАЯ СИСТЕМА ---
+
+FlashFS::FlashFS(fs::FS& fs) : _fs(fs) {
+    memset(_files, 0, sizeof(_files));
+    strcpy(_files[MAX_TRACKED_FILES].path, "other");
+}
+
+void FlashFS::begin(size_t partitionBytes) {
+    _partitionBytes = partitionBytes;
+}
+
+// Вызывается под _lock. Временный и резервный файлы относятся к основному.
+int FlashFS::statsIndex(const String& path) {
+    size_t length = path.length();
+    if (length > 4 && (path.endsWith(".tmp") || path.endsWith(".bak"))) length -= 4;
+    if (length > FlashFileStats::PATH_LENGTH) length = FlashFileStats::PATH_LENGTH;
+
+    for (int i = 0; i < _fileCount; i++) {
+        if (strncmp(_files[i].path, path.c_str(), length) == 0 && _files[i].path[length] == '\0') return i;
+    }
+    if (_fileCount == MAX_TRACKED_FILES) return MAX_TRACKED_FILES;
+    memcpy(_files[_fileCount].path, path.c_str(), length);
+    _files[_fileCount].path[length] = '\0';
+    return _fileCount++;
+}
+
+FlashFile FlashFS::open(const String& path, const char* mode) {
+    fs::File file = _fs.open(path, mode);
+    if (!file) return FlashFile();
+
+    portENTER_CRITICAL(&_lock);
+    int stats = statsIndex(path);
+    _files[stats].opens++;
+    portEXIT_CRITICAL(&_lock);
+    return FlashFile(this, file, stats, mode[0] != 'r');
+}
+
+bool FlashFS::exists(const String& path) {
+    return _fs.exists(path);
+}
+
+bool FlashFS::remove(const String& path) {
+    if (!_fs.remove(path)) return false;
+    addMetadataOp(path);
+    return true;
+}
+
+bool FlashFS::rename(const String& from, const String& to) {
+    if (!_fs.rename(from, to)) return false;
+    addMetadataOp(to);
+    return true;
+}
+
+void FlashFS::addRead(int stats, size_t bytes) {
+    portENTER_CRITICAL(&_lock);
+    _files[stats].bytesRead += bytes;
+    portEXIT_CRITICAL(&_lock);
+}
+
+void FlashFS::addWrite(int stats, size_t bytes) {
+    portENTER_CRITICAL(&_lock);
+    _files[stats].bytesWritten += bytes;
+    portEXIT_CRITICAL(&_lock);
+}
+
+// LittleFS - copy-on-write: каждая сессия записи занимает новые блоки,
+// даже если изменился один байт, плюс фиксация метаданных
+void FlashFS::endWriteSession(int stats, uint32_t bytes) {
+    uint32_t blocks = (bytes + FLASH_ERASE_BLOCK_SIZE - 1) / FLASH_ERASE_BLOCK_SIZE;
+    portENTER_CRITICAL(&_lock);
+    _files[stats].eraseBlocks += blocks > 0 ? blocks : 1;
+    portEXIT_CRITICAL(&_lock);
+}
+
+void FlashFS::addMetadataOp(const String& path) {
+    portENTER_CRITICAL(&_lock);
+    _files[statsIndex(path)].metadataOps++;
+    portEXIT_CRITICAL(&_lock);
+}
+
+// Износ считается в миллионных долях ресурса всего раздела: LittleFS
+// распределяет стирания по всем блокам, поэтому файл изнашивает раздел целиком
+void FlashFS::appendPrometheus(String& out) {
+    FlashFileStats snapshot[MAX_TRACKED_FILES + 1];
+    portENTER_CRITICAL(&_lock);
+    int count = _fileCount;
+    memcpy(snapshot, _files, sizeof(_files));
+    portEXIT_CRITICAL(&_lock);
+    // "other" публикуется, только если таблица переполнилась
+    if (snapshot[MAX_TRACKED_FILES].opens > 0 || snapshot[MAX_TRACKED_FILES].metadataOps > 0) {
+        snapshot[count++] = snapshot[MAX_TRACKED_FILES];
+    }
+
+    double budget = (double)(_partitionBytes / FLASH_ERASE_BLOCK_SIZE) * FLASH_ENDURANCE_CYCLES;
+    uint32_t totalRead = 0, totalWritten = 0, totalErase = 0;
+    char line[256];
+    for (int i = 0; i < count; i++) {
+        const FlashFileStats& s = snapshot[i];
+        snprintf(line, sizeof(line),
+                 "flash_file_opens_total{path=\"%s\"} %u\n"
+                 "flash_file_read_bytes_total{path=\"%s\"} %u\n"
+                 "flash_file_write_bytes_total{path=\"%s\"} %u\n",
+                 s.path, (unsigned)s.opens, s.path, (unsigned)s.bytesRead, s.path, (unsigned)s.bytesWritten);
+        out += line;
+        snprintf(line, sizeof(line),
+                 "flash_file_erase_blocks_total{path=\"%s\"} %u\n"
+                 "flash_file_metadata_ops_total{path=\"%s\"} %u\n"
+                 "flash_file_wear_ppm{path=\"%s\"} %.3f\n",
+                 s.path, (unsigned)s.eraseBlocks, s.path, (unsigned)s.metadataOps,
+                 s.path, budget > 0 ? s.eraseBlocks * 1e6 / budget : 0.0);
+        out += line;
+        totalRead += s.bytesRead;
+        totalWritten += s.bytesWritten;
+        totalErase += s.eraseBlocks;
+    }
+
+    snprintf(line, sizeof(line),
+             "flash_read_bytes_total %u\nflash_write_bytes_total %u\nflash_erase_blocks_total %u\n",
+             (unsigned)totalRead, (unsigned)totalWritten, (unsigned)totalErase);
+    out += line;
+
+    // Прогноз ресурса при текущем темпе записи с момента загрузки
+    uint32_t uptime = millis() / 1000;
+    if (budget > 0 && totalErase > 0 && uptime > 0) {
+        double years = budget / ((double)totalErase / uptime) / (365.25 * 86400);
+        snprintf(line, sizeof(line), "flash_wear_projected_lifetime_years %.1f\n", years);
+        out += line;
+    }
+}
@@ -1,53 +1,381 @@
 #include "key_manager.h"
 #include "config.h"
-#include <LittleFS.h>
 #include <ArduinoJson.h>
 #include "mbedtls/aes.h"
 #include "mbedtls/sha256.h"
 #include <esp_system.h>
+#include <algorithm>
+#include <unordered_map>
+#include "atomic_file.h"
+#include "logger.h"
 
-KeyManager::KeyManager() {}
+// Держит мьютекс ключей до конца области видимости
+class KeyLock {
+public:
+    explicit KeyLock(SemaphoreHandle_t mutex) : _mutex(mutex) { xSemaphoreTakeRecursive(_mutex, portMAX_DELAY); }
+    ~KeyLock() { xSemaphoreGiveRecursive(_mutex); }
+private:
+    SemaphoreHandle_t _mutex;
+};
+
+KeyManager::KeyManager() {
+    revision = esp_random() & 0x7FFF0000;
+    mutex = xSemaphoreCreateRecursiveMutexStatic(&mutexBuffer);
+}
 
 bool KeyManager::begin() {
-    return loadKeys();
+    KeyLock guard(mutex);
+    bool ok = loadKeys();
+    rebuildIndex();
+    return ok;
 }
 
-bool KeyManager::addKey(const String& name, const String& secret) {
-    for (const auto& key : keys) {
-        if (key.name == name) return false;
-    }
-    keys.push_back({name, secret});
+bool KeyManager::addKey(const String& name, const String& secret, const String& group) {
+    return addKey({name, secret, group, OtpAlgorithm::SHA1, CONFIG_TOTP_DIGITS, CONFIG_TOTP_STEP_SIZE});
+}
+
+bool KeyManager::addKey(const TOTPKey& key) {
+    KeyLock guard(mutex);
+    if (!insertKey(key)) return false;
+    rebuildIndex();
     return saveKeys();
 }
 
+int KeyManager::addKeys(const std::vector<TOTPKey>& newKeys, std::vector<int>& rejected) {
+    KeyLock guard(mutex);
+    int added = 0;
+    for (size_t i = 0; i < newKeys.size(); i++) {
+        if (insertKey(newKeys[i])) {
+            added++;
+        } else {
+            rejected.push_back(i);
+        }
+    }
+    if (added == 0) return 0;
+    rebuildIndex();
+    return saveKeys() ? added : 0;
+}
+
+// FNV-1a для поиска повторов: секреты хешируются по декодированным байтам,
+// чтобы регистр, пробелы и '=' в записи Base32 не мешали найти повтор
+static uint64_t fnv1a(const uint8_t* data, size_t length) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+int KeyManager::mergeKeys(const std::vector<TOTPKey>& newKeys, std::vector<int>& duplicates, std::vector<int>& rejected) {
+    KeyLock guard(mutex);
+    // Хеш -> индекс ключа; совпавший хеш подтверждается сравнением самих имен или байтов секрета
+    std::unordered_multimap<uint64_t, int> byNameHash, bySecretHash;
+    byNameHash.reserve(keys.size() + newKeys.size());
+    bySecretHash.reserve(keys.size() + newKeys.size());
+    uint8_t secret[TOTP_MAX_SECRET_BYTES], existing[TOTP_MAX_SECRET_BYTES];
+    for (size_t i = 0; i < keys.size(); i++) {
+        byNameHash.emplace(fnv1a((const uint8_t*)keys[i].name.c_str(), keys[i].name.length()), i);
+        bySecretHash.emplace(fnv1a(secret, secrets.copy(i, secret)), i);
+    }
+    auto hasName = [&](uint64_t hash, const String& name) {
+        auto range = byNameHash.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (keys[it->second].name == name) return true;
+        }
+        return false;
+    };
+    auto hasSecret = [&](uint64_t hash, size_t length) {
+        auto range = bySecretHash.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (secrets.copy(it->second, existing) == length && memcmp(existing, secret, length) == 0) return true;
+        }
+        return false;
+    };
+
+    int added = 0;
+    for (size_t i = 0; i < newKeys.size(); i++) {
+        const TOTPKey& key = newKeys[i];
+        size_t length = TOTPGenerator::base32Decode(key.secret, secret, sizeof(secret));
+        if (length == 0) {
+            rejected.push_back(i);
+            continue;
+        }
+        uint64_t nameHash = fnv1a((const uint8_t*)key.name.c_str(), key.name.length());
+        uint64_t secretHash = fnv1a(secret, length);
+        if (hasName(nameHash, key.name) || hasSecret(secretHash, length)) {
+            duplicates.push_back(i);
+            continue;
+        }
+        if (!storeKey(key)) {
+            rejected.push_back(i);
+            continue;
+        }
+        byNameHash.emplace(nameHash, keys.size() - 1);
+        bySecretHash.emplace(secretHash, keys.size() - 1);
+        recordChange(KeyChangeType::ADD, keys.size() - 1, key.name, key.group, key.period);
+        added++;
+    }
+    SecretStore::wipe(secret, sizeof(secret));
+    SecretStore::wipe(existing, sizeof(existing));
+    if (added == 0) return 0;
+    rebuildIndex();
+    return saveKeys() ? added : 0;
+}
+
+bool KeyManager::insertKey(const TOTPKey& key) {
+    for (const auto& existing : keys) {
+        if (existing.name == key.name) return false;
+    }
+    if (!storeKey(key)) return false;
+    recordChange(KeyChangeType::ADD, keys.size() - 1, key.name, key.group, key.period);
+    return true;
+}
+
+bool KeyManager::storeKey(const TOTPKey& key) {
+    uint8_t secret[TOTP_MAX_SECRET_BYTES];
+    size_t length = TOTPGenerator::base32Decode(key.secret, secret, sizeof(secret));
+    bool ok = length > 0 && secrets.append(secret, length);
+    SecretStore::wipe(secret, sizeof(secret));
+    if (!ok) return false;
+    keys.push_back({key.name, String(), key.group, key.algorithm, key.digits, key.period});
+    return true;
+}
+
+String KeyManager::computeCode(int index) {
+    KeyLock guard(mutex);
+    if (index < 0 || index >= (int)keys.size()) return "";
+    const TOTPKey& key = keys[index];
+    uint8_t secret[TOTP_MAX_SECRET_BYTES];
+    size_t length = secrets.copy(index, secret);
+    String code = length > 0 ? TOTPGenerator::generateTOTP(secret, length, key.digits, key.period, key.algorithm) : String();
+    SecretStore::wipe(secret, sizeof(secret));
+    return code;
+}
+
+bool KeyManager::exportKey(int index, TOTPKey& out) {
+    KeyLock guard(mutex);
+    if (!getKey(index, out)) return false;
+    uint8_t secret[TOTP_MAX_SECRET_BYTES];
+    size_t length = secrets.copy(index, secret);
+    out.secret = TOTPGenerator::base32Encode(secret, length);
+    SecretStore::wipe(secret, sizeof(secret));
+    return length > 0;
+}
+
+static const char* const ALGORITHM_NAMES[] = {"SHA1", "SHA256", "SHA512"};
+
+void KeyManager::keyFromJson(JsonObjectConst obj, TOTPKey& key) {
+    key.name = obj["name"].as<String>();
+    key.secret = obj["secret"].as<String>();
+    key.group = obj["group"] | "";
+    const char* algorithm = obj["algorithm"] | "SHA1";
+    key.algorithm = OtpAlgorithm::SHA1;
+    for (int i = 0; i < 3; i++) {
+        if (strcasecmp(algorithm, ALGORITHM_NAMES[i]) == 0) key.algorithm = (OtpAlgorithm)i;
+    }
+    int digits = obj["digits"] | CONFIG_TOTP_DIGITS;
+    key.digits = (digits >= 6 && digits <= 8) ? digits : CONFIG_TOTP_DIGITS;
+    int period = obj["period"] | CONFIG_TOTP_STEP_SIZE;
+    bool validPeriod = period > 0 && period <= CONFIG_TOTP_MAX_PERIOD && period % CONFIG_TOTP_STEP_SIZE == 0;
+    key.period = validPeriod ? period : CONFIG_TOTP_STEP_SIZE;
+}
+
+void KeyManager::wipeSecret(JsonObject obj) {
+    // Документ хранит свою копию строки; указатель ведет в его пул
+    const char* secret = obj["secret"];
+    if (secret) SecretStore::wipe((void*)secret, strlen(secret));
+}
+
+void KeyManager::keyToJson(const TOTPKey& key, JsonObject obj) {
+    obj["name"] = key.name;
+    obj["secret"] = key.secret;
+    if (!key.group.isEmpty()) obj["group"] = key.group;
+    if (key.algorithm != OtpAlgorithm::SHA1) obj["algorithm"] = ALGORITHM_NAMES[(int)key.algorithm];
+    if (key.digits != CONFIG_TOTP_DIGITS) obj["digits"] = key.digits;
+    if (key.period != CONFIG_TOTP_STEP_SIZE) obj["period"] = key.period;
+}
+
 bool KeyManager::removeKey(int index) {
+    KeyLock guard(mutex);
     if (index < 0 || index >= keys.size()) return false;
     keys.erase(keys.begin() + index);
+    secrets.remove(index);
+    rebuildIndex();
+    recordChange(KeyChangeType::REMOVE, index, "");
     return saveKeys();
 }
 
 std::vector<TOTPKey> KeyManager::getAllKeys() {
+    KeyLock guard(mutex);
     return keys;
 }
 
+size_t KeyManager::getKeyCount() {
+    KeyLock guard(mutex);
+    return keys.size();
+}
+
+bool KeyManager::getKey(int index, TOTPKey& out) {
+    KeyLock guard(mutex);
+    if (index < 0 || index >= keys.size()) return false;
+    out = keys[index];
+    return true;
+}
+
+// --- Упорядоченный индекс ---
+
+static int compareNames(const TOTPKey& a, const TOTPKey& b) {
+    return strcasecmp(a.name.c_str(), b.name.c_str());
+}
+
+static int compareGroups(const TOTPKey& a, const TOTPKey& b) {
+    int result = strcasecmp(a.group.c_str(), b.group.c_str());
+    return result != 0 ? result : compareNames(a, b);
+}
+
+void KeyManager::rebuildIndex() {
+    byName.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) byName[i] = i;
+    byGroup = byName;
+
+    std::sort(byName.begin(), byName.end(), [this](uint16_t a, uint16_t b) {
+        return compareNames(keys[a], keys[b]) < 0;
+    });
+    std::sort(byGroup.begin(), byGroup.end(), [this](uint16_t a, uint16_t b) {
+        return compareGroups(keys[a], keys[b]) < 0;
+    });
+    groupPosition.resize(keys.size());
+    for (size_t p = 0; p < byGroup.size(); p++) groupPosition[byGroup[p]] = p;
+}
+
+int KeyManager::getKeyAtPosition(int position) {
+    KeyLock guard(mutex);
+    if (position < 0 || position >= byGroup.size()) return -1;
+    return byGroup[position];
+}
+
+int KeyManager::getPositionOf(int index) {
+    KeyLock guard(mutex);
+    if (index < 0 || index >= groupPosition.size()) return -1;
+    return groupPosition[index];
+}
+
+int KeyManager::nextInOrder(int index, int step) {
+    KeyLock guard(mutex);
+    int count = byGroup.size();
+    if (count == 0) return -1;
+    int position = getPositionOf(index);
+    if (position < 0) return byGroup[0];
+    return byGroup[((position + step) % count + count) % count];
+}
+
+int KeyManager::nextGroup(int index) {
+    KeyLock guard(mutex);
+    if (index < 0 || index >= keys.size()) return byGroup.empty() ? -1 : byGroup[0];
+    const char* group = keys[index].group.c_str();
+    auto it = std::upper_bound(byGroup.begin(), byGroup.end(), group, [this](const char* value, uint16_t i) {
+        return strcasecmp(value, keys[i].group.c_str()) < 0;
+    });
+    return it == byGroup.end() ? byGroup[0] : *it;
+}
+
+int KeyManager::findByPrefix(const String& prefix) {
+    KeyLock guard(mutex);
+    const char* value = prefix.c_str();
+    auto it = std::lower_bound(byName.begin(), byName.end(), value, [this](uint16_t i, const char* v) {
+        return strcasecmp(keys[i].name.c_str(), v) < 0;
+    });
+    if (it == byName.end() || strncasecmp(keys[*it].name.c_str(), value, prefix.length()) != 0) return -1;
+    return *it;
+}
+
+void KeyManager::findMatching(const String& query, std::vector<int>& out) {
+    KeyLock guard(mutex);
+    out.clear();
+    const char* value = query.c_str();
+    // Совпадения по имени лежат в byName подряд, начиная с lower_bound
+    auto it = std::lower_bound(byName.begin(), byName.end(), value, [this](uint16_t i, const char* v) {
+        return strcasecmp(keys[i].name.c_str(), v) < 0;
+    });
+    for (; it != byName.end() && strncasecmp(keys[*it].name.c_str(), value, query.length()) == 0; ++it) {
+        out.push_back(*it);
+    }
+    // Группа целиком - тоже подряд, в byGroup
+    auto group = std::lower_bound(byGroup.begin(), byGroup.end(), value, [this](uint16_t i, const char* v) {
+        return strcasecmp(keys[i].group.c_str(), v) < 0;
+    });
+    for (; group != byGroup.end() && strcasecmp(keys[*group].group.c_str(), value) == 0; ++group) {
+        out.push_back(*group);
+    }
+    std::sort(out.begin(), out.end(), [this](int a, int b) { return groupPosition[a] < groupPosition[b]; });
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+uint32_t KeyManager::getRevision() {
+    return revision;
+}
+
+void KeyManager::recordChange(KeyChangeType type, int index, const String& name, const String& group, uint16_t period) {
+    KeyChange& change = changeLog[revision % KEY_CHANGE_LOG_SIZE];
+    change.revision = revision + 1;
+    change.type = type;
+    change.index = index;
+    change.name = name;
+    change.group = group;
+    change.period = period;
+    if (changeCount < KEY_CHANGE_LOG_SIZE) changeCount++;
+    revision++;
+}
+
+bool KeyManager::getChangesSince(uint32_t since, std::vector<KeyChange>& changes) {
+    KeyLock guard(mutex);
+    uint32_t current = revision;
+    uint32_t behind = current - since;
+    if (behind > (uint32_t)changeCount) return false;
+
+    changes.clear();
+    for (uint32_t r = since; r != current; r++) {
+        const KeyChange& change = changeLog[r % KEY_CHANGE_LOG_SIZE];
+        // Сброс обрабатывает клиент полной перезагрузкой списка
+        if (change.type == KeyChangeType::RESET) return false;
+        changes.push_back(change);
+    }
+    return true;
+}
+
 // --- Новая функция для импорта ---
 bool KeyManager::replaceAllKeys(const String& jsonContent) {
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, jsonContent);
     if (error) {
-        Serial.print("Import failed, invalid JSON: ");
-        Serial.println(error.c_str());
+        LOG_ERROR("Keys", "import failed, invalid JSON: %s", error.c_str());
         return false;
     }
 
-    keys.clear();
+    std::vector<TOTPKey> newKeys;
     JsonArray array = doc.as<JsonArray>();
-    for (JsonObject obj : array) {
-        keys.push_back({
-            obj["name"].as<String>(),
-            obj["secret"].as<String>()
-        });
+    for (JsonObjectConst obj : array) {
+        TOTPKey key;
+        keyFromJson(obj, key);
+        newKeys.push_back(key);
+    }
+    // Только после того, как скопированы все секреты: одинаковые строки в пуле общие
+    for (JsonObject obj : array) wipeSecret(obj);
+    bool ok = replaceAllKeys(newKeys);
+    for (auto& key : newKeys) SecretStore::wipe(key.secret);
+    return ok;
+}
+
+bool KeyManager::replaceAllKeys(const std::vector<TOTPKey>& newKeys) {
+    KeyLock guard(mutex);
+    keys.clear();
+    secrets.clear();
+    for (const auto& key : newKeys) {
+        if (!storeKey(key)) LOG_WARN("Keys", "key '%s' skipped: invalid secret", key.name.c_str());
     }
+    rebuildIndex();
+
+    recordChange(KeyChangeType::RESET, 0, "");
 
     // Сохраняем новый набор ключей, который будет автоматически зашифрован
     return saveKeys();
@@ -93,6 +421,8 @@ bool KeyManager::encryptData(const uint8_t* plain, size_t plain_len, std::vector
     }
     
     mbedtls_aes_free(&aes);
+    SecretStore::wipe(key, sizeof(key));
+    SecretStore::wipe(padded_input.data(), padded_input.size());
     return true;
 }
 
@@ -111,33 +441,30 @@ bool KeyManager::decryptData(const uint8_t* encrypted, size_t encrypted_len, std
         mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_DECRYPT, encrypted + i, decrypted_padded.data() + i);
     }
     mbedtls_aes_free(&aes);
+    SecretStore::wipe(key, sizeof(key));
 
     // PKCS7 Unpadding
     uint8_t padding_len = decrypted_padded.back();
-    if (padding_len > 16 || padding_len == 0) return false; // Неверное значение дополнения
-
-    size_t plain_len = encrypted_len - padding_len;
-    output.assign(decrypted_padded.begin(), decrypted_padded.begin() + plain_len);
-    
-    return true;
+    bool ok = padding_len > 0 && padding_len <= 16; // Иначе неверное значение дополнения
+    if (ok) {
+        output.assign(decrypted_padded.begin(), decrypted_padded.begin() + (encrypted_len - padding_len));
+    }
+    SecretStore::wipe(decrypted_padded.data(), decrypted_padded.size());
+    return ok;
 }
 
 bool KeyManager::loadKeys() {
-    if (!LittleFS.exists(KEYS_FILE)) return true;
+    AtomicFile::recover(flashFS, KEYS_FILE);
+    if (!AtomicFile::exists(flashFS, KEYS_FILE)) return true;
 
-    File file = LittleFS.open(KEYS_FILE, "r");
-    if (!file) return false;
+    std::vector<uint8_t> file_buffer;
+    if (!AtomicFile::read(flashFS, KEYS_FILE, file_buffer)) return false;
 
-    size_t file_size = file.size();
+    size_t file_size = file_buffer.size();
     if (file_size == 0) {
-        file.close();
         keys.clear();
         return true;
     }
-    
-    std::vector<uint8_t> file_buffer(file_size);
-    file.read(file_buffer.data(), file_size);
-    file.close();
 
     std::vector<uint8_t> decrypted_buffer;
     if (!decryptData(file_buffer.data(), file_size, decrypted_buffer)) {
@@ -146,16 +473,26 @@ bool KeyManager::loadKeys() {
     
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, decrypted_buffer.data(), decrypted_buffer.size());
+    SecretStore::wipe(decrypted_buffer.data(), decrypted_buffer.size());
     if (error) {
-        Serial.print("JSON parsing failed: ");
-        Serial.println(error.c_str());
+        LOG_ERROR("Keys", "failed to parse %s: %s", KEYS_FILE, error.c_str());
         return false;
     }
 
-    keys.clear();
+    std::vector<TOTPKey> loaded;
     JsonArray array = doc.as<JsonArray>();
-    for (JsonObject obj : array) {
-        keys.push_back({obj["name"].as<String>(), obj["secret"].as<String>()});
+    for (JsonObjectConst obj : array) {
+        TOTPKey key;
+        keyFromJson(obj, key);
+        loaded.push_back(key);
+    }
+    for (JsonObject obj : array) wipeSecret(obj);
+
+    keys.clear();
+    secrets.clear();
+    for (auto& key : loaded) {
+        if (!storeKey(key)) LOG_WARN("Keys", "key '%s' skipped: invalid secret", key.name.c_str());
+        SecretStore::wipe(key.secret);
     }
     return true;
 }
@@ -163,24 +500,21 @@ bool KeyManager::loadKeys() {
 bool KeyManager::saveKeys() {
     JsonDocument doc;
     JsonArray array = doc.to<JsonArray>();
-    for (const auto& key : keys) {
-        JsonObject obj = array.add<JsonObject>();
-        obj["name"] = key.name;
-        obj["secret"] = key.secret;
+    for (size_t i = 0; i < keys.size(); i++) {
+        TOTPKey key;
+        if (!exportKey(i, key)) continue;
+        keyToJson(key, array.add<JsonObject>());
+        SecretStore::wipe(key.secret);
     }
     
     String json_string;
     serializeJson(doc, json_string);
+    for (JsonObject obj : array) wipeSecret(obj);
 
     std::vector<uint8_t> encrypted_buffer;
-    if (!encryptData((uint8_t*)json_string.c_str(), json_string.length(), encrypted_buffer)) {
-        return false;
-    }
+    bool ok = encryptData((uint8_t*)json_string.c_str(), json_string.length(), encrypted_buffer);
+    SecretStore::wipe(json_string);
+    if (!ok) return false;
 
-    File file = LittleFS.open(KEYS_FILE, "w");
-    if (!file) return false;
-    
-    file.write(encrypted_buffer.data(), encrypted_buffer.size());
-    file.close();
-    return true;
+    return AtomicFile::write(flashFS, KEYS_FILE, encrypted_buffer.data(), encrypted_buffer.size());
 }
@@ -0,0 +1,51 @@
+#include "keys_response.h"
+#include "config.h"
+
+String KeysResponse::etag(uint32_t revision, time_t now) {
+    return "\"" + String(revision) + "-" + String((uint32_t)(now / CONFIG_TOTP_STEP_SIZE)) + "\"";
+}
+
+void KeysResponse::header(JsonDocument& doc, uint32_t revision, time_t now) {
+    doc["rev"] = revision;
+    doc["step"] = (uint32_t)(now / CONFIG_TOTP_STEP_SIZE);
+    doc["left"] = (int)(CONFIG_TOTP_STEP_SIZE - now % CONFIG_TOTP_STEP_SIZE);
+}
+
+void KeysResponse::codes(JsonDocument& doc, size_t keyCount, CodeSource code) {
+    JsonArray codes = doc["codes"].to<JsonArray>();
+    for (size_t i = 0; i < keyCount; i++) {
+        codes.add(code(i));
+    }
+}
+
+void KeysResponse::full(JsonDocument& doc, uint32_t revision, time_t now, const std::vector<TOTPKey>& keys, CodeSource code) {
+    header(doc, revision, now);
+    JsonArray names = doc["names"].to<JsonArray>();
+    JsonArray groups = doc["groups"].to<JsonArray>();
+    JsonArray periods = doc["periods"].to<JsonArray>();
+    for (const auto& key : keys) {
+        names.add(key.name);
+        groups.add(key.group);
+        periods.add(key.period);
+    }
+    codes(doc, keys.size(), code);
+}
+
+void KeysResponse::delta(JsonDocument& doc, uint32_t revision, time_t now, const std::vector<KeyChange>& changes,
+                         size_t keyCount, CodeSource code) {
+    header(doc, revision, now);
+    JsonArray ops = doc["ops"].to<JsonArray>();
+    for (const auto& change : changes) {
+        JsonArray op = ops.add<JsonArray>();
+        if (change.type == KeyChangeType::ADD) {
+            op.add("+");
+            op.add(change.name);
+            op.add(change.group);
+            op.add(change.period);
+        } else {
+            op.add("-");
+            op.add(change.index);
+        }
+    }
+    codes(doc, keyCount, code);
+}
@@ -0,0 +1,99 @@
+#include "logger.h"
+#include <stdarg.h>
+
+namespace {
+
+const size_t DRAIN_CHUNK = 256;
+const char LEVEL_CHARS[] = "-EWID";
+
+portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+char ring[Logger::LOG_BUFFER_SIZE];
+uint32_t head = 0;        // Всего записано байт (позиция в буфере - по модулю)
+uint32_t serialTail = 0;  // Сколько байт уже выведено в Serial
+uint32_t dropped = 0;     // Байты, перезаписанные до вывода в Serial
+
+// Копирует [from, from + length) из кольца; вызывается под блокировкой
+void copyOut(uint32_t from, char* out, size_t length) {
+    size_t offset = from % Logger::LOG_BUFFER_SIZE;
+    size_t first = Logger::LOG_BUFFER_SIZE - offset;
+    if (first > length) first = length;
+    memcpy(out, ring + offset, first);
+    memcpy(out + first, ring, length - first);
+}
+
+void drainTask(void* param) {
+    char chunk[DRAIN_CHUNK];
+    for (;;) {
+        uint32_t lost = 0;
+        portENTER_CRITICAL(&lock);
+        if (head - serialTail > Logger::LOG_BUFFER_SIZE) {
+            lost = head - serialTail - Logger::LOG_BUFFER_SIZE;
+            dropped += lost;
+            serialTail = head - Logger::LOG_BUFFER_SIZE;
+        }
+        size_t length = head - serialTail;
+        if (length > DRAIN_CHUNK) length = DRAIN_CHUNK;
+        copyOut(serialTail, chunk, length);
+        serialTail += length;
+        portEXIT_CRITICAL(&lock);
+
+        if (lost > 0) {
+            Serial.printf("\n[log: %u bytes dropped]\n", (unsigned)lost);
+        }
+        if (length > 0) {
+            Serial.write((const uint8_t*)chunk, length);
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(20));
+        }
+    }
+}
+
+}
+
+void Logger::begin() {
+    xTaskCreate(drainTask, "log", 3072, NULL, 1, NULL);
+}
+
+void Logger::write(int level, const char* tag, const char* format, ...) {
+    char line[MAX_LINE_LENGTH];
+    int prefix = snprintf(line, sizeof(line), "[%7lu] %c %s: ", millis(), LEVEL_CHARS[level], tag);
+
+    va_list args;
+    va_start(args, format);
+    int body = vsnprintf(line + prefix, sizeof(line) - prefix - 1, format, args);
+    va_end(args);
+
+    size_t length = prefix + (body < 0 ? 0 : body);
+    if (length > sizeof(line) - 2) length = sizeof(line) - 2; // Длинная строка обрезается
+    line[length++] = '\n';
+
+    portENTER_CRITICAL(&lock);
+    size_t offset = head % LOG_BUFFER_SIZE;
+    size_t first = LOG_BUFFER_SIZE - offset;
+    if (first > length) first = length;
+    memcpy(ring + offset, line, first);
+    memcpy(ring, line + first, length - first);
+    head += length;
+    portEXIT_CRITICAL(&lock);
+}
+
+String Logger::dump() {
+    char* copy = (char*)malloc(LOG_BUFFER_SIZE);
+    if (!copy) return String();
+
+    portENTER_CRITICAL(&lock);
+    size_t length = head < LOG_BUFFER_SIZE ? head : LOG_BUFFER_SIZE;
+    copyOut(head - length, copy, length);
+    portEXIT_CRITICAL(&lock);
+
+    // После переполнения первая строка обрезана - пропускаем ее
+    size_t start = 0;
+    if (length == LOG_BUFFER_SIZE) {
+        while (start < length && copy[start] != '\n') start++;
+        start++;
+    }
+
+    String text = start < length ? String(copy + start, length - start) : String();
+    free(copy);
+    return text;
+}
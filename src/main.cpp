@@ -11,21 +11,29 @@
 #include "pin_manager.h"
 #include "battery_manager.h"
 #include "config_manager.h" // New: Include ConfigManager
+#include "boot_profiler.h"
+#include "time_manager.h"
+#include "logger.h"
+#include "atomic_file.h"
+#include "theme_manager.h"
 
 #ifndef LED_BUILTIN
 #define LED_BUILTIN 2 // Стандартный пин для ESP32, если не определен
 #endif
 
 // Глобальные объекты менеджеров
+ConfigManager configManager; // Реестр настроек: нужен остальным менеджерам
 DisplayManager displayManager;
 KeyManager keyManager;
 SplashScreenManager splashManager(displayManager);
-PinManager pinManager(displayManager);
+PinManager pinManager(displayManager, configManager);
 BatteryManager batteryManager(34, 14); // Используем пин 34 для АЦП и 14 для питания
-WifiManager wifiManager(displayManager); 
-ConfigManager configManager; // New: Global ConfigManager object
-WebServerManager webServerManager(keyManager, splashManager, displayManager, pinManager, configManager);
+WifiManager wifiManager(displayManager, configManager); 
+TimeManager timeManager(configManager);
+ThemeManager themeManager;
+WebServerManager webServerManager(keyManager, splashManager, displayManager, pinManager, configManager, timeManager, wifiManager, themeManager);
 TOTPGenerator totpGenerator;
+BootProfiler bootProfiler;
 
 // Глобальные переменные состояния
 static int currentKeyIndex = 0;
@@ -34,6 +42,8 @@ unsigned long lastButtonPressTime = 0;
 const int debounceDelay = 300; 
 const int factoryResetHoldTime = 5000;
 const int powerOffHoldTime = 5000;
+const int listViewHoldTime = 800; // Удержание кнопки 1 - список ключей, кнопки 2 - следующая группа
+static bool listViewActive = false;
 unsigned long lastActivityTime = 0;
 const int screenTimeout = 30000;
 bool isScreenOn = true;
@@ -48,6 +58,38 @@ static int lastBatteryPercentage = -1; // <-- ВОССТАНОВЛЕНО
 unsigned long lastTotpUpdateTime = 0;
 const int totpUpdateInterval = 250; // Обновляем каждые 250 мс
 
+// Фоновая сетевая задача: ведет автомат подключения WiFi и запускает SNTP.
+// Работает параллельно со сплэш-скрином, вводом PIN-кода и основным циклом.
+const int ipNoticeTime = 1500; // Сколько показывать IP-адрес на экране
+int wifiStage = -1;
+int ntpStage = -1;
+bool isMainServerStarted = false;
+
+int pinStage = -1;
+
+void startWifiSetup(const char* reason);
+void handleSerialCommands();
+void onUnlocked();
+
+void networkTask(void* param) {
+    bool syncStarted = false;
+    for (;;) {
+        wifiManager.update();
+
+        if (!syncStarted && wifiManager.isConnected()) {
+            bootProfiler.endStage(wifiStage);
+            // SNTP сам повторяет попытки и периодически ресинхронизирует время
+            ntpStage = bootProfiler.beginStage("ntp");
+            timeManager.startSync();
+            syncStarted = true;
+        }
+        if (ntpStage >= 0 && timeManager.getConfidence() == TimeConfidence::SYNCED) {
+            bootProfiler.endStage(ntpStage);
+            ntpStage = -1;
+        }
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+}
 
 void handleFactoryResetOnBoot() {
     displayManager.init();
@@ -63,12 +105,14 @@ void handleFactoryResetOnBoot() {
             displayManager.init();
             displayManager.showMessage("FACTORY RESET!", 10, 30, true, 2);
             
-            LittleFS.remove(KEYS_FILE);
-            LittleFS.remove("/wifi_config.json");
-            LittleFS.remove(SPLASH_IMAGE_PATH);
-            LittleFS.remove("/auth.json");
-            LittleFS.remove(PIN_FILE);
-            LittleFS.remove(CONFIG_FILE); // New: Remove config file on factory reset
+            // Файлы настроек и ключей удаляются вместе с резервными копиями
+            AtomicFile::remove(flashFS, KEYS_FILE);
+            AtomicFile::remove(flashFS, WIFI_CONFIG_FILE);
+            flashFS.remove(SPLASH_IMAGE_PATH);
+            AtomicFile::remove(flashFS, AUTH_FILE);
+            AtomicFile::remove(flashFS, PIN_FILE);
+            AtomicFile::remove(flashFS, CONFIG_FILE);
+            AtomicFile::remove(flashFS, THEMES_FILE);
             displayManager.showMessage("Done. Rebooting...", 10, 60);
             
             delay(2500);
@@ -84,80 +128,220 @@ void handleFactoryResetOnBoot() {
 
 void setup() {
     Serial.begin(115200);
+    Logger::begin();
     pinMode(BUTTON_1, INPUT_PULLUP);
     pinMode(BUTTON_2, INPUT_PULLUP);
 
     // 1. Инициализация файловой системы и менеджеров
+    int stage = bootProfiler.beginStage("battery");
     batteryManager.begin();
+    bootProfiler.endStage(stage);
+
+    stage = bootProfiler.beginStage("littlefs");
     if (!LittleFS.begin(true)) {
         DisplayManager tempDisplay;
         tempDisplay.init();
         tempDisplay.showMessage("LittleFS Failed", 10, 30, true);
         while(1);
     }
+    flashFS.begin(LittleFS.totalBytes());
+    bootProfiler.endStage(stage);
 
-    // Load theme before displayManager.init() to ensure correct colors from start
-    Theme savedTheme = configManager.loadTheme();
-    displayManager.setTheme(savedTheme);
+    // Все настройки читаются один раз; тема нужна до displayManager.init()
+    stage = bootProfiler.beginStage("config");
+    configManager.begin();
+    themeManager.begin();
+    const ThemeColors* themeColors = themeManager.find(configManager.getThemeName());
+    displayManager.setTheme(themeColors ? *themeColors : DARK_THEME_COLORS);
+    bootProfiler.endStage(stage);
 
+    stage = bootProfiler.beginStage("display");
     displayManager.init();
-    keyManager.begin();
-    pinManager.begin();
+    bootProfiler.endStage(stage);
+
+    stage = bootProfiler.beginStage("time");
+    timeManager.begin();
+    bootProfiler.endStage(stage);
     
-    // 2. Проверка на сброс к заводским настройкам
+    // 2. Проверка на сброс к заводским настройкам (до запуска сети,
+    // так как сброс удаляет конфигурацию WiFi)
     if (digitalRead(BUTTON_1) == LOW && digitalRead(BUTTON_2) == LOW) {
         handleFactoryResetOnBoot();
     }
 
-    // 3. Показ сплэш-скрина
+    // 3. Подключение к WiFi и синхронизация времени в фоне
+    wifiStage = bootProfiler.beginStage("wifi");
+    wifiManager.begin();
+    xTaskCreatePinnedToCore(networkTask, "network", 4096, NULL, 1, NULL, 0);
+
+    stage = bootProfiler.beginStage("keys");
+    keyManager.begin();
+    bootProfiler.endStage(stage);
+
+    stage = bootProfiler.beginStage("pin_config");
+    pinManager.begin();
+    bootProfiler.endStage(stage);
+
+    // 4. Показ сплэш-скрина
+    stage = bootProfiler.beginStage("splash");
     splashManager.displaySplashScreen();
+    bootProfiler.endStage(stage);
     
-    // 4. Запрос ПИН-кода
-    pinManager.requestPin();
-    
-    // 5. Подключение к WiFi
+    // 5. Запрос ПИН-кода: экран ввода ведет основной цикл (см. loop)
+    pinStage = bootProfiler.beginStage("pin_entry");
+    pinManager.startEntry();
+    if (!pinManager.isEntryActive()) {
+        bootProfiler.endStage(pinStage);
+        onUnlocked();
+    }
+}
+
+// Продолжение загрузки после ввода PIN-кода (или сразу, если он выключен)
+void onUnlocked() {
+    // Без сохраненной сети устройство сразу уходит в режим настройки WiFi
+    if (wifiManager.getState() == WifiState::NO_CONFIG) {
+        startWifiSetup("No WiFi config found.");
+    }
+
+    // 6. Если часы RTC уже идут, коды показываются сразу, а сеть
+    // подключается в фоне (см. handleNetworkEvents). Иначе ждем сеть.
     displayManager.init(); // Очищаем экран после "PIN OK"
-    displayManager.showMessage("Initializing...", 10, 10);
-    if (!wifiManager.connect()) {
-        wifiManager.startConfigPortal();
-        webServerManager.startConfigServer();
-        isWebServerRunning = true; // Сервер запущен в режиме конфигурации
-        while(1) { delay(100); }
+    if (!timeManager.isTimeValid()) {
+        int stage = bootProfiler.beginStage("net_wait");
+        displayManager.showMessage("Initializing...", 10, 10);
+
+        while (!wifiManager.isConnected() && !wifiManager.hasInitialConnectFailed()) {
+            delay(50);
+        }
+        if (wifiManager.isConnected()) {
+            // IP показываем, пока в фоне идет синхронизация времени
+            displayManager.init();
+            displayManager.showMessage("WiFi Connected!", 10, 50);
+            displayManager.showMessage(wifiManager.getIP(), 10, 70);
+            delay(ipNoticeTime);
+            displayManager.init();
+        } else {
+            startWifiSetup("Connection Failed!");
+        }
+        bootProfiler.endStage(stage);
     }
 
+    lastActivityTime = millis();
+}
+
+// Запускает портал настройки WiFi. Возвращает управление, только если
+// время задано вручную (через портал или Serial) - это автономный режим.
+void startWifiSetup(const char* reason) {
     displayManager.init();
-    displayManager.showMessage("WiFi Connected!", 10, 50);
-    displayManager.showMessage(wifiManager.getIP(), 10, 70);
-    delay(1500); // Даем пользователю время увидеть IP
-
-    // 6. Синхронизация времени с несколькими попытками
-    configTime(0, 0, "pool.ntp.org");
-    struct tm timeinfo;
-    bool timeSynced = false;
-    for (int i = 0; i < 3; i++) {
-        displayManager.init();
-        displayManager.showMessage("Time Sync... (" + String(i + 1) + "/3)", 10, 30, false, 2);
-        if (getLocalTime(&timeinfo, 5000)) { // Таймаут 5 секунд на попытку
-            timeSynced = true;
-            displayManager.init();
-            displayManager.showMessage("Time Synced!", 10, 50, false, 2);
-            delay(1000);
-            break;
+    displayManager.showMessage(reason, 10, 50, true);
+    if (wifiManager.hasCredentials()) {
+        displayManager.showMessage("Check credentials.", 10, 70);
+    }
+    delay(1500);
+    bootProfiler.report();
+    wifiManager.startConfigPortal();
+    webServerManager.startConfigServer();
+    isWebServerRunning = true; // Сервер запущен в режиме конфигурации
+    while (!timeManager.isManualTimeSet()) {
+        handleSerialCommands();
+        configManager.update();
+        delay(100);
+    }
+
+    // Автономный режим: коды по программным часам, портал продолжает работать
+    displayManager.init();
+    displayManager.showStatus("Offline mode", 5000);
+    previousKeyIndex = -1; // Принудительная перерисовка экрана
+}
+
+// Команды в Serial-консоли:
+//   time          - показать текущее время, дрейф и точность
+//   time <epoch>  - установить время (UNIX-время в секундах)
+//   find <prefix> - показать первый по алфавиту ключ с таким началом имени
+//                   (до ввода PIN-кода отвечает только "Locked.")
+void handleSerialCommands() {
+    static char line[32];
+    static size_t lineLength = 0;
+
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (lineLength < sizeof(line) - 1) line[lineLength++] = c;
+            continue;
+        }
+        if (lineLength == 0) continue;
+        line[lineLength] = '\0';
+        lineLength = 0;
+
+        if (strncmp(line, "find ", 5) == 0) {
+            if (pinManager.isEntryActive()) {
+                Serial.println("Locked.");
+                continue;
+            }
+            int index = keyManager.findByPrefix(line + 5);
+            if (index < 0) {
+                Serial.println("No matching key.");
+                continue;
+            }
+            currentKeyIndex = index;
+            lastActivityTime = millis();
+            TOTPKey key;
+            keyManager.getKey(index, key);
+            Serial.printf("key %d: %s\n", index, key.name.c_str());
+            continue;
+        }
+        if (strncmp(line, "time", 4) != 0) {
+            Serial.println("Unknown command. Usage: time [<unix epoch>] | find <prefix>");
+            continue;
+        }
+        if (line[4] == ' ') {
+            time_t epoch = (time_t)strtoll(line + 5, NULL, 10);
+            if (!timeManager.setManualTime(epoch)) {
+                Serial.println("Invalid epoch.");
+                continue;
+            }
         }
+        const char* confidence[] = {"none", "estimated", "synced"};
+        Serial.printf("time=%ld drift=%.2fppm confidence=%s\n", (long)time(nullptr),
+                      timeManager.getDriftPpm(), confidence[(int)timeManager.getConfidence()]);
     }
+}
+
+// Показывает изменения состояния WiFi в заголовке, не блокируя интерфейс
+void handleNetworkEvents() {
+    static WifiState lastState = WifiState::IDLE;
+    static uint32_t lastConnectCount = 0;
+    static bool isFailureHandled = false;
+
+    WifiState state = wifiManager.getState();
+    if (state == WifiState::PORTAL) return;
 
-    if (!timeSynced) {
-        displayManager.init();
-        displayManager.showMessage("ERROR:", 10, 20, true, 2);
-        displayManager.showMessage("Time sync failed!", 10, 40, false, 2);
-        delay(3000);
-        ESP.restart();
+    uint32_t connectCount = wifiManager.getConnectCount();
+    if (state == WifiState::CONNECTED && connectCount != lastConnectCount) {
+        if (!isMainServerStarted) {
+            // 7. Запуск основного веб-сервера
+            int stage = bootProfiler.beginStage("web_server");
+            webServerManager.start();
+            isWebServerRunning = true; // Устанавливаем флаг, что сервер запущен
+            isMainServerStarted = true;
+            bootProfiler.endStage(stage);
+        }
+        displayManager.showStatus(wifiManager.getIP(), 5000);
+        lastConnectCount = connectCount;
+    } else if (state != lastState && lastState == WifiState::CONNECTED) {
+        displayManager.showStatus("WiFi lost", 3000);
     }
-    
-    // 7. Запуск основного веб-сервера
-    webServerManager.start();
-    isWebServerRunning = true; // Устанавливаем флаг, что сервер запущен
-    lastActivityTime = millis();
+
+    if (!isFailureHandled && wifiManager.hasInitialConnectFailed()) {
+        isFailureHandled = true;
+        if (!timeManager.isTimeValid()) {
+            startWifiSetup("Connection Failed!");
+            return;
+        }
+        // Коды идут по часам RTC, подключение продолжается в фоне
+        displayManager.showStatus("WiFi retrying", 5000);
+    }
+    lastState = state;
 }
 
 void handleButtons() {
@@ -183,11 +367,19 @@ void handleButtons() {
         }
     } else {
         if (button1PressStartTime > 0) { // Была отпущена
-            // Короткое нажатие: переключить ключ
-            if (millis() - button1PressStartTime < powerOffHoldTime) {
-                 auto keys = keyManager.getAllKeys();
-                if (!keys.empty()) {
-                    currentKeyIndex = (currentKeyIndex == 0) ? keys.size() - 1 : currentKeyIndex - 1;
+            unsigned long heldTime = millis() - button1PressStartTime;
+            if (displayManager.isShowingQrCode()) {
+                displayManager.dismissQrCode(); // Любое нажатие закрывает QR-код
+                buttonPressed = true;
+            } else if (heldTime >= listViewHoldTime && heldTime < powerOffHoldTime) {
+                // Среднее удержание: список ключей <-> один ключ (выбор общий)
+                listViewActive = !listViewActive;
+                previousKeyIndex = -1;
+                buttonPressed = true;
+            } else if (heldTime < listViewHoldTime) {
+                // Короткое нажатие: предыдущий ключ (по группе и имени)
+                if (keyManager.getKeyCount() > 0) {
+                    currentKeyIndex = keyManager.nextInOrder(currentKeyIndex, -1);
                     buttonPressed = true;
                 }
             }
@@ -205,18 +397,25 @@ void handleButtons() {
             displayManager.showMessage("Shutting down...", 10, 30, false, 2);
             delay(1000);
             displayManager.turnOff();
+            // Просыпаемся по нажатию кнопки 2: в deep sleep RTC продолжает
+            // отсчитывать время, и после пробуждения коды доступны сразу
+            while (digitalRead(BUTTON_2) == LOW) { delay(10); }
+            configManager.flush();
+            esp_sleep_enable_ext0_wakeup((gpio_num_t)BUTTON_2, 0);
             esp_deep_sleep_start();
         }
     }
     else {
         if (button2PressStartTime > 0) { // Была отпущена
-            // Короткое нажатие: переключить ключ
-            if (millis() - button2PressStartTime < powerOffHoldTime) {
-                auto keys = keyManager.getAllKeys();
-                if (!keys.empty()) {
-                    currentKeyIndex = (currentKeyIndex + 1) % keys.size();
-                    buttonPressed = true;
-                }
+            unsigned long heldTime = millis() - button2PressStartTime;
+            if (displayManager.isShowingQrCode()) {
+                displayManager.dismissQrCode();
+                buttonPressed = true;
+            } else if (heldTime < powerOffHoldTime && keyManager.getKeyCount() > 0) {
+                // Короткое нажатие: следующий ключ, удержание: первый ключ следующей группы
+                currentKeyIndex = heldTime < listViewHoldTime ? keyManager.nextInOrder(currentKeyIndex, 1)
+                                                              : keyManager.nextGroup(currentKeyIndex);
+                buttonPressed = true;
             }
             button2PressStartTime = 0; // Сбрасываем таймер
         }
@@ -228,14 +427,53 @@ void handleButtons() {
             displayManager.turnOn();
             isScreenOn = true;
         }
-        // Принудительное обновление экрана при нажатии
-        previousKeyIndex = -1; 
+        // Принудительное обновление экрана при нажатии; список сам
+        // перерисовывает только изменившиеся строки
+        if (!listViewActive) previousKeyIndex = -1;
+    }
+}
+
+// Опрос батареи по таймеру (работает и во время ввода PIN-кода)
+void updateBatteryStatus() {
+    if (millis() - lastBatteryCheckTime > batteryCheckInterval) {
+        lastBatteryCheckTime = millis();
+        
+        int currentBatteryPercentage = batteryManager.getPercentage();
+        float voltage = batteryManager.getVoltage();
+        bool isCharging = (voltage > 4.15); // Consider charging if voltage is above 4.15V 
+
+        LOG_DEBUG("Main", "battery %d%%, charging %s", currentBatteryPercentage, isCharging ? "yes" : "no");
+
+        displayManager.updateBatteryStatus(currentBatteryPercentage, isCharging);
+        displayManager.setTimeConfidence(timeManager.getConfidence());
     }
 }
 
 void loop() {
+    handleSerialCommands();
+    timeManager.update();
+    configManager.update();
+
+    if (pinManager.isEntryActive()) {
+        // Экран PIN-кода: остальной интерфейс ждет, сеть и батарея работают
+        pinManager.update();
+        updateBatteryStatus();
+        if (!pinManager.isEntryActive()) {
+            bootProfiler.endStage(pinStage);
+            onUnlocked();
+        }
+        return;
+    }
+
     displayManager.update(); // <-- ОБНОВЛЯЕМ АНИМАЦИИ
     handleButtons();
+    handleNetworkEvents();
+
+    if (displayManager.isShowingQrCode()) {
+        // QR-код запрошен из веб-интерфейса: экран не гаснет, пока он показан
+        lastActivityTime = millis();
+        isScreenOn = true;
+    }
 
     if (isScreenOn && (millis() - lastActivityTime > screenTimeout)) {
         displayManager.turnOff();
@@ -243,36 +481,68 @@ void loop() {
     }
 
     if (isScreenOn) {
-        // Обновляем статус батареи по таймеру
-        if (millis() - lastBatteryCheckTime > batteryCheckInterval) {
-            lastBatteryCheckTime = millis();
-            
-            int currentBatteryPercentage = batteryManager.getPercentage();
-            float voltage = batteryManager.getVoltage();
-            bool isCharging = (voltage > 4.15); // Consider charging if voltage is above 4.15V 
-
-            Serial.print("main.cpp - currentBatteryPercentage: ");
-            Serial.print(currentBatteryPercentage);
-            Serial.print("%, isCharging: ");
-            Serial.println(isCharging ? "true" : "false");
-
-            displayManager.updateBatteryStatus(currentBatteryPercentage, isCharging);
-        }
+        updateBatteryStatus();
 
         // Обновляем TOTP и прогресс-бар по таймеру
         if (millis() - lastTotpUpdateTime > totpUpdateInterval) {
             lastTotpUpdateTime = millis();
-            auto keys = keyManager.getAllKeys();
-            if (!keys.empty()) {
-                if (currentKeyIndex != previousKeyIndex) {
+            size_t keyCount = keyManager.getKeyCount();
+            if (currentKeyIndex >= (int)keyCount) currentKeyIndex = keyCount > 0 ? keyCount - 1 : 0;
+            if (displayManager.isShowingQrCode()) {
+                // После QR-кода экран рисуется заново
+                previousKeyIndex = -1;
+            } else if (!timeManager.isTimeValid()) {
+                // Без времени коды были бы неверными - ждем синхронизацию
+                if (previousKeyIndex != -2) {
+                    displayManager.init();
+                    displayManager.showMessage("Waiting for time", 10, 50, false, 2);
+                    displayManager.showMessage("sync...", 10, 70, false, 2);
+                    previousKeyIndex = -2;
+                }
+            } else if (keyCount > 0 && listViewActive) {
+                if (previousKeyIndex < 0) {
+                    displayManager.drawKeyListLayout(batteryManager.getPercentage(), batteryManager.getVoltage() > 4.18);
+                }
+                previousKeyIndex = currentKeyIndex;
+                // Ключи копируются и коды считаются только для видимых строк
+                // Строки списка идут в порядке группа/имя
+                displayManager.updateKeyList(keyCount, keyManager.getPositionOf(currentKeyIndex), totpGenerator.getTimeRemaining(),
+                    [](int position, String& name, String& code) {
+                        int index = keyManager.getKeyAtPosition(position);
+                        TOTPKey key;
+                        if (!keyManager.getKey(index, key)) return false;
+                        name = key.name;
+                        code = keyManager.computeCode(index);
+                        return true;
+                    });
+
+                if (!bootProfiler.isFirstCodeMarked()) {
+                    bootProfiler.markFirstCode();
+                    bootProfiler.report();
+                }
+            } else if (keyCount > 0) {
+                // Имя и период читаются только при смене ключа или списка;
+                // на каждом тике - только код
+                static uint16_t currentPeriod = CONFIG_TOTP_STEP_SIZE;
+                static uint32_t shownRevision = 0;
+                if (currentKeyIndex != previousKeyIndex || keyManager.getRevision() != shownRevision) {
+                    TOTPKey key;
+                    keyManager.getKey(currentKeyIndex, key);
+                    currentPeriod = key.period;
+                    shownRevision = keyManager.getRevision();
                     // При смене ключа, просто сообщаем DisplayManager новое состояние
-                    displayManager.drawLayout(keys[currentKeyIndex].name, batteryManager.getPercentage(), batteryManager.getVoltage() > 4.18);
+                    displayManager.drawLayout(key.name, batteryManager.getPercentage(), batteryManager.getVoltage() > 4.18);
                     previousKeyIndex = currentKeyIndex;
                 }
                 
-                String code = totpGenerator.generateTOTP(keys[currentKeyIndex].secret);
-                int timeLeft = totpGenerator.getTimeRemaining();
-                displayManager.updateTOTPCode(code, timeLeft);
+                String code = keyManager.computeCode(currentKeyIndex);
+                int timeLeft = totpGenerator.getTimeRemaining(currentPeriod);
+                displayManager.updateTOTPCode(code, timeLeft, currentPeriod);
+
+                if (!bootProfiler.isFirstCodeMarked()) {
+                    bootProfiler.markFirstCode();
+                    bootProfiler.report();
+                }
 
             } else {
                 if (previousKeyIndex != -1) {
@@ -281,6 +551,12 @@ void loop() {
                 }
                 displayManager.showMessage("No keys found.", 10, 10);
                 displayManager.showMessage("Add via web UI.", 10, 30);
+
+                // Кодов нет, но отчет о загрузке все равно нужен
+                if (!bootProfiler.isFirstCodeMarked()) {
+                    bootProfiler.markFirstCode();
+                    bootProfiler.report();
+                }
             }
         }
     }
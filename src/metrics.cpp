@@ -0,0 +1,131 @@
+#include "metrics.h"
+
+#if METRICS_ENABLED
+
+#include <esp_heap_caps.h>
+
+namespace {
+
+struct TimerStats {
+    uint32_t count;
+    uint64_t totalUs;
+    uint32_t maxUs;
+};
+
+struct EndpointStats {
+    char path[Metrics::MAX_PATH_LENGTH + 1];
+    uint32_t count;
+};
+
+const char* const COUNTER_NAMES[METRIC_COUNTER_COUNT] = {
+    "totp_generated_total",
+    "display_frames_total",
+    "display_spi_bytes_total",
+};
+
+const char* const TIMER_NAMES[METRIC_TIMER_COUNT] = {
+    "totp_generate",
+    "display_frame",
+};
+
+// Задачи, для которых публикуется минимальный остаток стека
+const char* const TASK_NAMES[] = {"loopTask", "network", "async_tcp"};
+
+// Счетчики обновляются из основного цикла, сетевой задачи и задачи AsyncTCP
+portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+uint32_t counters[METRIC_COUNTER_COUNT];
+TimerStats timers[METRIC_TIMER_COUNT];
+EndpointStats endpoints[Metrics::MAX_ENDPOINTS];
+int endpointCount = 0;
+uint32_t otherRequests = 0;
+
+}
+
+void Metrics::add(MetricCounter counter, uint32_t value) {
+    portENTER_CRITICAL(&lock);
+    counters[counter] += value;
+    portEXIT_CRITICAL(&lock);
+}
+
+void Metrics::recordTime(MetricTimer timer, uint32_t us) {
+    portENTER_CRITICAL(&lock);
+    TimerStats& stats = timers[timer];
+    stats.count++;
+    stats.totalUs += us;
+    if (us > stats.maxUs) stats.maxUs = us;
+    portEXIT_CRITICAL(&lock);
+}
+
+void Metrics::countRequest(const char* path) {
+    portENTER_CRITICAL(&lock);
+    if (path == nullptr) {
+        otherRequests++;
+        portEXIT_CRITICAL(&lock);
+        return;
+    }
+    int i = 0;
+    while (i < endpointCount && strncmp(endpoints[i].path, path, MAX_PATH_LENGTH) != 0) i++;
+    if (i < endpointCount) {
+        endpoints[i].count++;
+    } else if (endpointCount < MAX_ENDPOINTS) {
+        strncpy(endpoints[i].path, path, MAX_PATH_LENGTH);
+        endpoints[i].path[MAX_PATH_LENGTH] = '\0';
+        endpoints[i].count = 1;
+        endpointCount++;
+    } else {
+        otherRequests++;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void Metrics::appendPrometheus(String& out) {
+    // Снимок под блокировкой, форматирование - без нее
+    uint32_t counterSnapshot[METRIC_COUNTER_COUNT];
+    TimerStats timerSnapshot[METRIC_TIMER_COUNT];
+    EndpointStats endpointSnapshot[MAX_ENDPOINTS];
+    portENTER_CRITICAL(&lock);
+    memcpy(counterSnapshot, counters, sizeof(counters));
+    memcpy(timerSnapshot, timers, sizeof(timers));
+    int endpointSnapshotCount = endpointCount;
+    memcpy(endpointSnapshot, endpoints, sizeof(EndpointStats) * endpointCount);
+    uint32_t otherSnapshot = otherRequests;
+    portEXIT_CRITICAL(&lock);
+
+    char line[128];
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        snprintf(line, sizeof(line), "%s %u\n", COUNTER_NAMES[i], (unsigned)counterSnapshot[i]);
+        out += line;
+    }
+    for (int i = 0; i < METRIC_TIMER_COUNT; i++) {
+        snprintf(line, sizeof(line), "%s_us_count %u\n%s_us_sum %llu\n%s_us_max %u\n",
+                 TIMER_NAMES[i], (unsigned)timerSnapshot[i].count,
+                 TIMER_NAMES[i], (unsigned long long)timerSnapshot[i].totalUs,
+                 TIMER_NAMES[i], (unsigned)timerSnapshot[i].maxUs);
+        out += line;
+    }
+    for (int i = 0; i < endpointSnapshotCount; i++) {
+        snprintf(line, sizeof(line), "web_requests_total{path=\"%s\"} %u\n",
+                 endpointSnapshot[i].path, (unsigned)endpointSnapshot[i].count);
+        out += line;
+    }
+    snprintf(line, sizeof(line), "web_requests_total{path=\"other\"} %u\n", (unsigned)otherSnapshot);
+    out += line;
+
+    snprintf(line, sizeof(line), "heap_free_bytes %u\nheap_min_free_bytes %u\nheap_largest_free_block_bytes %u\n",
+             (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMinFreeHeap(),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    out += line;
+
+    for (const char* name : TASK_NAMES) {
+        TaskHandle_t task = xTaskGetHandle(name);
+        if (task == NULL) continue;
+        snprintf(line, sizeof(line), "task_stack_free_min_bytes{task=\"%s\"} %u\n",
+                 name, (unsigned)uxTaskGetStackHighWaterMark(task));
+        out += line;
+    }
+
+    snprintf(line, sizeof(line), "uptime_seconds %lu\n", (unsigned long)(esp_timer_get_time() / 1000000));
+    out += line;
+}
+
+#endif // METRICS_ENABLED
@@ -0,0 +1,328 @@
+#include "migration_payload.h"
+#include "otpauth.h"
+#include "secret_store.h"
+
+namespace {
+
+// Поток байт из Base64 в параметре URI: понимает %-кодирование, URL-safe
+// алфавит и конец по '=' или '&'
+class Base64Stream {
+public:
+    Base64Stream(const char* text, const char* end) : _text(text), _end(end) {}
+
+    // false - данные кончились или повреждены (см. failed())
+    bool read(uint8_t& byte) {
+        while (_bitCount < 8) {
+            int symbol = nextSymbol();
+            if (symbol < 0) return false;
+            _bits = (_bits << 6) | symbol;
+            _bitCount += 6;
+        }
+        _bitCount -= 8;
+        byte = (_bits >> _bitCount) & 0xFF;
+        return true;
+    }
+
+    bool failed() const { return _failed; }
+
+private:
+    const char* _text;
+    const char* _end;
+    uint32_t _bits = 0;
+    int _bitCount = 0;
+    bool _failed = false;
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    int nextSymbol() {
+        while (_text < _end) {
+            char c = *_text++;
+            if (c == '%') {
+                int high = _end - _text >= 2 ? hexValue(_text[0]) : -1;
+                int low = high >= 0 ? hexValue(_text[1]) : -1;
+                if (low < 0) {
+                    _failed = true;
+                    break;
+                }
+                c = (char)(high << 4 | low);
+                _text += 2;
+            }
+            if (c >= 'A' && c <= 'Z') return c - 'A';
+            if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if (c >= '0' && c <= '9') return c - '0' + 52;
+            if (c == '+' || c == '-') return 62;
+            if (c == '/' || c == '_') return 63;
+            if (c == '=' || c == '&') {
+                _text = _end;
+                return -1;
+            }
+            if (c == '\r' || c == '\n') continue;
+            _failed = true;
+            break;
+        }
+        _text = _end;
+        return -1;
+    }
+};
+
+// Минимальный декодер protobuf поверх потока: теги, varint и пропуск полей.
+// Границы вложенных сообщений отслеживаются по числу прочитанных байт.
+class ProtoReader {
+public:
+    explicit ProtoReader(Base64Stream& in) : _in(in) {}
+
+    uint32_t position() const { return _position; }
+
+    bool readByte(uint8_t& byte) {
+        if (!_in.read(byte)) return false;
+        _position++;
+        return true;
+    }
+
+    bool readVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte;
+            if (!readByte(byte)) return false;
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // Длина поля типа 2, не выходящего за границу limit
+    bool readLength(uint32_t limit, uint32_t& length) {
+        uint64_t value;
+        if (!readVarint(value) || value > limit - _position) return false;
+        length = value;
+        return true;
+    }
+
+    bool skip(uint8_t wireType, uint32_t limit) {
+        uint64_t value;
+        uint32_t length;
+        switch (wireType) {
+            case 0: return readVarint(value);
+            case 1: length = 8; break;
+            case 2: if (!readLength(limit, length)) return false; break;
+            case 5: length = 4; break;
+            default: return false; // Группы (3, 4) в этом формате не встречаются
+        }
+        uint8_t byte;
+        while (length-- > 0) {
+            if (!readByte(byte)) return false;
+        }
+        return true;
+    }
+
+private:
+    Base64Stream& _in;
+    uint32_t _position = 0;
+};
+
+// Поля OtpParameters из схемы экспорта
+enum : uint8_t {
+    FIELD_SECRET = 1, FIELD_NAME = 2, FIELD_ISSUER = 3, FIELD_ALGORITHM = 4,
+    FIELD_DIGITS = 5, FIELD_TYPE = 6, FIELD_COUNTER = 7
+};
+enum : uint8_t { ALGORITHM_SHA1 = 1, ALGORITHM_SHA256 = 2, ALGORITHM_SHA512 = 3, ALGORITHM_MD5 = 4 };
+enum : uint8_t { DIGITS_EIGHT = 2 };
+enum : uint8_t { TYPE_HOTP = 1 };
+
+struct MigrationEntry {
+    uint8_t secret[TOTP_MAX_SECRET_BYTES];
+    size_t secretLength;
+    bool secretTooLong;
+    String name;
+    String issuer;
+    uint64_t algorithm;
+    uint64_t digits;
+    uint64_t type;
+};
+
+// Строка или байты поля длины length; лишнее сверх MIGRATION_MAX_TEXT читается и отбрасывается
+bool readText(ProtoReader& reader, uint32_t length, String& out, bool& truncated) {
+    out = "";
+    truncated = length > MIGRATION_MAX_TEXT;
+    out.reserve(truncated ? MIGRATION_MAX_TEXT : length);
+    for (uint32_t i = 0; i < length; i++) {
+        uint8_t byte;
+        if (!reader.readByte(byte)) return false;
+        if (i < MIGRATION_MAX_TEXT) out += (char)byte;
+    }
+    return true;
+}
+
+bool readEntry(ProtoReader& reader, uint32_t end, MigrationEntry& entry, bool& truncated) {
+    entry.secretLength = 0;
+    entry.name = "";
+    entry.issuer = "";
+    entry.secretTooLong = false;
+    entry.algorithm = ALGORITHM_SHA1;
+    entry.digits = 0;
+    entry.type = 0;
+    truncated = false;
+
+    while (reader.position() < end) {
+        uint64_t tag;
+        if (!reader.readVarint(tag)) return false;
+        uint64_t field = tag >> 3; // Номер поля целиком: 257 не должен стать полем 1
+        uint8_t wireType = tag & 0x07;
+        uint32_t length;
+        bool textTruncated = false;
+
+        if (field == FIELD_SECRET && wireType == 2) {
+            if (!reader.readLength(end, length)) return false;
+            entry.secretTooLong = length > sizeof(entry.secret);
+            for (uint32_t i = 0; i < length; i++) {
+                uint8_t byte;
+                if (!reader.readByte(byte)) return false;
+                if (i < sizeof(entry.secret)) entry.secret[i] = byte;
+            }
+            entry.secretLength = entry.secretTooLong ? 0 : length;
+        } else if ((field == FIELD_NAME || field == FIELD_ISSUER) && wireType == 2) {
+            if (!reader.readLength(end, length)) return false;
+            if (!readText(reader, length, field == FIELD_NAME ? entry.name : entry.issuer, textTruncated)) return false;
+            truncated |= textTruncated;
+        } else if (field == FIELD_ALGORITHM && wireType == 0) {
+            if (!reader.readVarint(entry.algorithm)) return false;
+        } else if (field == FIELD_DIGITS && wireType == 0) {
+            if (!reader.readVarint(entry.digits)) return false;
+        } else if (field == FIELD_TYPE && wireType == 0) {
+            if (!reader.readVarint(entry.type)) return false;
+        } else if (!reader.skip(wireType, end)) { // В том числе счетчик HOTP
+            return false;
+        }
+    }
+    return reader.position() == end;
+}
+
+// Запись экспорта -> ключ; false с причиной, если устройство ее не поддерживает
+bool entryToKey(MigrationEntry& entry, bool truncated, TOTPKey& key, String& reason) {
+    if (truncated) {
+        reason = "Name or issuer is too long.";
+        return false;
+    }
+    if (entry.type == TYPE_HOTP) {
+        reason = "HOTP keys are not supported.";
+        return false;
+    }
+    if (entry.algorithm == ALGORITHM_MD5 || entry.algorithm > ALGORITHM_SHA512) {
+        reason = "Unsupported algorithm.";
+        return false;
+    }
+    if (entry.secretLength == 0) {
+        reason = entry.secretTooLong ? "Secret is too long." : "Missing secret.";
+        return false;
+    }
+
+    // Метка собирается так же, как из otpauth:// URI; приложение часто
+    // пишет издателя и в name ("Issuer:account")
+    OtpAuthParams params;
+    params.hotp = false;
+    params.issuer = entry.issuer;
+    params.account = entry.name;
+    if (!params.issuer.isEmpty() && params.account.startsWith(params.issuer + ":")) {
+        params.account = params.account.substring(params.issuer.length() + 1);
+    }
+    params.issuer.trim();
+    params.account.trim();
+    params.secret = TOTPGenerator::base32Encode(entry.secret, entry.secretLength);
+    params.algorithm = entry.algorithm == ALGORITHM_SHA256 ? OtpAlgorithm::SHA256
+                     : entry.algorithm == ALGORITHM_SHA512 ? OtpAlgorithm::SHA512 : OtpAlgorithm::SHA1;
+    params.digits = entry.digits == DIGITS_EIGHT ? 8 : 6;
+    params.period = CONFIG_TOTP_STEP_SIZE; // Период в экспорт не попадает, приложение всегда использует 30 с
+    params.counter = 0;
+
+    if (params.issuer.isEmpty() && params.account.isEmpty()) {
+        reason = "Empty name.";
+        return false;
+    }
+    bool ok = OtpAuthUri::toKey(params, key, reason);
+    SecretStore::wipe(params.secret);
+    return ok;
+}
+
+} // namespace
+
+bool MigrationPayload::isMigrationUri(const String& uri) {
+    return uri.length() >= 20 && strncasecmp(uri.c_str(), "otpauth-migration://", 20) == 0;
+}
+
+bool MigrationPayload::parse(const String& uri, std::vector<TOTPKey>& keys, std::vector<String>& skipped, String& error) {
+    if (!isMigrationUri(uri)) {
+        error = "Not an otpauth-migration:// URI.";
+        return false;
+    }
+    const char* text = uri.c_str();
+    const char* end = text + uri.length();
+    const char* data = nullptr;
+    for (const char* p = strchr(text, '?'); p && p < end; p = strchr(p + 1, '&')) {
+        if (strncmp(p + 1, "data=", 5) == 0) {
+            data = p + 6;
+            break;
+        }
+    }
+    if (!data) {
+        error = "Missing data parameter.";
+        return false;
+    }
+
+    // Ключи копятся отдельно и попадают в keys, только если разобран весь URI
+    std::vector<TOTPKey> parsed;
+    Base64Stream stream(data, end);
+    ProtoReader reader(stream);
+    MigrationEntry entry;
+    size_t found = 0;
+    bool corrupt = false;
+    while (true) {
+        uint64_t tag;
+        uint32_t start = reader.position();
+        if (!reader.readVarint(tag)) {
+            corrupt = reader.position() != start; // Иначе сообщение кончилось на границе поля
+            break;
+        }
+        uint64_t field = tag >> 3;
+        uint8_t wireType = tag & 0x07;
+        if (field != 1 || wireType != 2) { // Нужны только otp_parameters; версия и номер партии пропускаются
+            if (!reader.skip(wireType, UINT32_MAX)) {
+                corrupt = true;
+                break;
+            }
+            continue;
+        }
+
+        uint32_t length;
+        bool truncated;
+        corrupt = !reader.readLength(UINT32_MAX, length) || !readEntry(reader, reader.position() + length, entry, truncated);
+        if (corrupt) break;
+        found++;
+        TOTPKey key;
+        String reason;
+        if (entryToKey(entry, truncated, key, reason)) {
+            parsed.push_back(key);
+        } else {
+            skipped.push_back((entry.name.isEmpty() ? entry.issuer : entry.name) + ": " + reason);
+        }
+        SecretStore::wipe(key.secret);
+        SecretStore::wipe(entry.secret, sizeof(entry.secret));
+    }
+    SecretStore::wipe(entry.secret, sizeof(entry.secret));
+
+    const char* failure = stream.failed() ? "Invalid Base64 data."
+                        : corrupt ? "Corrupted migration data."
+                        : found == 0 ? "No accounts in migration data." : nullptr;
+    if (failure) {
+        for (auto& key : parsed) SecretStore::wipe(key.secret);
+        error = failure;
+        return false;
+    }
+    keys.insert(keys.end(), parsed.begin(), parsed.end());
+    for (auto& key : parsed) SecretStore::wipe(key.secret);
+    return true;
+}
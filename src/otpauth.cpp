@@ -0,0 +1,232 @@
+#include "otpauth.h"
+#include "secret_store.h"
+
+static const char* const ALGORITHMS[] = {"SHA1", "SHA256", "SHA512"};
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool OtpAuthUri::percentDecode(const String& text, bool plusIsSpace, String& out) {
+    out = "";
+    out.reserve(text.length());
+    for (size_t i = 0; i < text.length(); i++) {
+        char c = text[i];
+        if (c == '%') {
+            int high = i + 2 < text.length() ? hexValue(text[i + 1]) : -1;
+            int low = high >= 0 ? hexValue(text[i + 2]) : -1;
+            if (low < 0) return false;
+            out += (char)(high << 4 | low);
+            i += 2;
+        } else {
+            out += (plusIsSpace && c == '+') ? ' ' : c;
+        }
+    }
+    return true;
+}
+
+// Кодируется все, кроме незарезервированных символов RFC 3986 и ':' в метке
+void OtpAuthUri::percentEncode(const String& text, String& out) {
+    const char* hex = "0123456789ABCDEF";
+    for (size_t i = 0; i < text.length(); i++) {
+        uint8_t c = text[i];
+        if (isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~' || c == ':') {
+            out += (char)c;
+        } else {
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 0x0F];
+        }
+    }
+}
+
+static bool parseNumber(const String& text, uint64_t maxValue, uint64_t& value) {
+    if (text.isEmpty() || text.length() > 20) return false;
+    value = 0;
+    for (size_t i = 0; i < text.length(); i++) {
+        if (!isdigit((unsigned char)text[i])) return false;
+        uint64_t next = value * 10 + (text[i] - '0');
+        if (next < value || next > maxValue) return false;
+        value = next;
+    }
+    return true;
+}
+
+bool OtpAuthUri::parse(const String& uri, OtpAuthParams& params, String& error) {
+    params = OtpAuthParams();
+    params.algorithm = OtpAlgorithm::SHA1;
+    params.digits = CONFIG_TOTP_DIGITS;
+    params.period = CONFIG_TOTP_STEP_SIZE;
+    params.counter = 0;
+
+    String text = uri;
+    text.trim();
+    const char* scheme = "otpauth://";
+    if (text.length() < 10 || strncasecmp(text.c_str(), scheme, 10) != 0) {
+        error = "Not an otpauth:// URI.";
+        return false;
+    }
+    int typeEnd = text.indexOf('/', 10);
+    if (typeEnd < 0) {
+        error = "Missing label.";
+        return false;
+    }
+    String type = text.substring(10, typeEnd);
+    if (type.equalsIgnoreCase("totp")) {
+        params.hotp = false;
+    } else if (type.equalsIgnoreCase("hotp")) {
+        params.hotp = true;
+    } else {
+        error = "Unknown OTP type.";
+        return false;
+    }
+
+    int queryStart = text.indexOf('?', typeEnd);
+    String label;
+    if (!percentDecode(text.substring(typeEnd + 1, queryStart < 0 ? text.length() : queryStart), false, label)) {
+        error = "Invalid label encoding.";
+        return false;
+    }
+    int colon = label.indexOf(':');
+    if (colon >= 0) {
+        params.issuer = label.substring(0, colon);
+        params.account = label.substring(colon + 1);
+    } else {
+        params.account = label;
+    }
+    params.issuer.trim();
+    params.account.trim();
+
+    bool hasCounter = false;
+    int position = queryStart < 0 ? text.length() : queryStart + 1;
+    while (position < (int)text.length()) {
+        int end = text.indexOf('&', position);
+        if (end < 0) end = text.length();
+        String pair = text.substring(position, end);
+        position = end + 1;
+        if (pair.isEmpty()) continue;
+
+        int equals = pair.indexOf('=');
+        String name = equals < 0 ? pair : pair.substring(0, equals);
+        String value;
+        if (!percentDecode(equals < 0 ? String("") : pair.substring(equals + 1), true, value)) {
+            error = "Invalid encoding of " + name + ".";
+            return false;
+        }
+
+        uint64_t number;
+        if (name.equalsIgnoreCase("secret")) {
+            params.secret = "";
+            for (size_t i = 0; i < value.length(); i++) {
+                char c = toupper(value[i]);
+                if (c == ' ' || c == '=') continue;
+                if (!((c >= 'A' && c <= 'Z') || (c >= '2' && c <= '7'))) {
+                    error = "Secret is not Base32.";
+                    return false;
+                }
+                params.secret += c;
+            }
+        } else if (name.equalsIgnoreCase("issuer")) {
+            value.trim();
+            if (!value.isEmpty()) params.issuer = value; // Параметр точнее префикса метки
+        } else if (name.equalsIgnoreCase("algorithm")) {
+            int found = -1;
+            for (int i = 0; i < 3; i++) {
+                if (value.equalsIgnoreCase(ALGORITHMS[i])) found = i;
+            }
+            if (found < 0) {
+                error = "Unsupported algorithm.";
+                return false;
+            }
+            params.algorithm = (OtpAlgorithm)found;
+        } else if (name.equalsIgnoreCase("digits")) {
+            if (!parseNumber(value, 8, number) || number < 6) {
+                error = "Digits must be 6 to 8.";
+                return false;
+            }
+            params.digits = number;
+        } else if (name.equalsIgnoreCase("period")) {
+            if (!parseNumber(value, 0xFFFFFFFFULL, number) || number == 0) {
+                error = "Invalid period.";
+                return false;
+            }
+            params.period = number;
+        } else if (name.equalsIgnoreCase("counter")) {
+            if (!parseNumber(value, UINT64_MAX, number)) {
+                error = "Invalid counter.";
+                return false;
+            }
+            params.counter = number;
+            hasCounter = true;
+        }
+        // Прочие параметры (image, color...) игнорируются
+    }
+
+    uint8_t decoded[TOTP_MAX_SECRET_BYTES];
+    bool validSecret = !params.secret.isEmpty() && TOTPGenerator::base32Decode(params.secret, decoded, sizeof(decoded)) > 0;
+    SecretStore::wipe(decoded, sizeof(decoded));
+    if (!validSecret) {
+        error = "Missing or too long secret.";
+        return false;
+    }
+    if (params.hotp && !hasCounter) {
+        error = "HOTP URI without counter.";
+        return false;
+    }
+    if (params.issuer.isEmpty() && params.account.isEmpty()) {
+        error = "Empty label.";
+        return false;
+    }
+    return true;
+}
+
+bool OtpAuthUri::toKey(const OtpAuthParams& params, TOTPKey& key, String& error) {
+    if (params.hotp) {
+        // Счетчик HOTP пришлось бы продвигать и сохранять при каждом показе
+        error = "HOTP keys are not supported.";
+        return false;
+    }
+    if (params.period % CONFIG_TOTP_STEP_SIZE != 0 || params.period > CONFIG_TOTP_MAX_PERIOD) {
+        error = "Unsupported period.";
+        return false;
+    }
+    if (params.issuer.isEmpty()) {
+        key.name = params.account;
+    } else if (params.account.isEmpty()) {
+        key.name = params.issuer;
+    } else {
+        key.name = params.issuer + ":" + params.account;
+    }
+    key.secret = params.secret;
+    key.group = "";
+    key.algorithm = params.algorithm;
+    key.digits = params.digits;
+    key.period = params.period;
+    return true;
+}
+
+String OtpAuthUri::build(const TOTPKey& key) {
+    String uri = "otpauth://totp/";
+    percentEncode(key.name, uri);
+
+    uri += "?secret=";
+    for (size_t i = 0; i < key.secret.length(); i++) {
+        char c = toupper(key.secret[i]);
+        if ((c >= 'A' && c <= 'Z') || (c >= '2' && c <= '7')) uri += c;
+    }
+    int colon = key.name.indexOf(':');
+    if (colon > 0) {
+        uri += "&issuer=";
+        percentEncode(key.name.substring(0, colon), uri);
+    }
+    if (key.algorithm != OtpAlgorithm::SHA1) {
+        uri += "&algorithm=";
+        uri += ALGORITHMS[(int)key.algorithm];
+    }
+    if (key.digits != CONFIG_TOTP_DIGITS) uri += "&digits=" + String(key.digits);
+    if (key.period != CONFIG_TOTP_STEP_SIZE) uri += "&period=" + String(key.period);
+    return uri;
+}
@@ -0,0 +1,102 @@
+#include "pin_entry.h"
+#include <string.h>
+
+PinEntry::PinEntry()
+    : _state(PinEntryState::IDLE), _length(0), _entered(0), _currentDigit(0),
+      _stateStart(0), _lockoutMs(0), _screenDirty(false), _dirtyCells(0), _digitDirty(false) {
+    memset(_pin, 0, sizeof(_pin));
+}
+
+void PinEntry::start(int length, unsigned long lockoutMs, unsigned long now) {
+    if (length < 1) length = 1;
+    if (length > MAX_LENGTH) length = MAX_LENGTH;
+    _length = length;
+    _lockoutMs = lockoutMs;
+    clearPin();
+    enter(lockoutMs > 0 ? PinEntryState::LOCKED : PinEntryState::INPUT, now);
+}
+
+void PinEntry::press(PinButton button, unsigned long now) {
+    if (_state != PinEntryState::INPUT) return;
+
+    if (button == PinButton::NEXT) {
+        _currentDigit = (_currentDigit + 1) % 10;
+        _digitDirty = true;
+        return;
+    }
+
+    _pin[_entered] = '0' + _currentDigit;
+    _dirtyCells |= 1 << _entered;
+    _entered++;
+    _currentDigit = 0;
+    _digitDirty = true;
+
+    if (_entered >= _length) {
+        enter(PinEntryState::VERIFY, now);
+    }
+}
+
+void PinEntry::update(unsigned long now) {
+    unsigned long elapsed = now - _stateStart;
+    switch (_state) {
+        case PinEntryState::LOCKED:
+            if (elapsed >= _lockoutMs) enter(PinEntryState::INPUT, now);
+            break;
+        case PinEntryState::ACCEPTED:
+            if (elapsed >= ACCEPTED_MS) enter(PinEntryState::DONE, now);
+            break;
+        case PinEntryState::REJECTED:
+            if (elapsed >= REJECTED_MS) {
+                enter(_lockoutMs > 0 ? PinEntryState::LOCKED : PinEntryState::INPUT, now);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void PinEntry::setResult(bool ok, unsigned long lockoutMs, unsigned long now) {
+    if (_state != PinEntryState::VERIFY) return;
+    clearPin();
+    _lockoutMs = lockoutMs;
+    enter(ok ? PinEntryState::ACCEPTED : PinEntryState::REJECTED, now);
+}
+
+unsigned long PinEntry::getLockoutRemainingMs(unsigned long now) const {
+    if (_state != PinEntryState::LOCKED) return 0;
+    unsigned long elapsed = now - _stateStart;
+    return elapsed >= _lockoutMs ? 0 : _lockoutMs - elapsed;
+}
+
+bool PinEntry::takeScreenDirty() {
+    bool dirty = _screenDirty;
+    _screenDirty = false;
+    return dirty;
+}
+
+uint16_t PinEntry::takeDirtyCells() {
+    uint16_t cells = _dirtyCells;
+    _dirtyCells = 0;
+    return cells;
+}
+
+bool PinEntry::takeDigitDirty() {
+    bool dirty = _digitDirty;
+    _digitDirty = false;
+    return dirty;
+}
+
+void PinEntry::enter(PinEntryState state, unsigned long now) {
+    _state = state;
+    _stateStart = now;
+    // Полный экран перерисовывается целиком, отдельные ячейки уже не нужны
+    _screenDirty = true;
+    _dirtyCells = 0;
+    _digitDirty = false;
+}
+
+void PinEntry::clearPin() {
+    memset(_pin, 0, sizeof(_pin));
+    _entered = 0;
+    _currentDigit = 0;
+}
@@ -1,142 +1,248 @@
 #include "pin_manager.h"
-#include <FS.h>
 #include "config.h"
 #include "crypto_manager.h"
 #include <ArduinoJson.h>
-#include "LittleFS.h"
+#include "atomic_file.h"
+#include <esp_timer.h>
+#include "logger.h"
 
-PinManager::PinManager(DisplayManager& display) : displayManager(display) {
+PinManager::PinManager(DisplayManager& display, ConfigManager& config) : displayManager(display), configManager(config) {
     // Конструктор пуст
 }
 
 void PinManager::begin() {
     loadPinConfig();
+    // Счетчик ошибок переживает перезагрузку, задержка начинается заново
+    if (failedAttempts >= PIN_BACKOFF_FREE_ATTEMPTS) {
+        startLockout();
+    }
 }
 
 void PinManager::loadPinConfig() {
-    if (LittleFS.exists(PIN_FILE)) {
-        fs::File configFile = LittleFS.open(PIN_FILE, "r");
-        if (configFile) {
-            JsonDocument doc;
-            if (deserializeJson(doc, configFile) == DeserializationError::Ok) {
-                enabled = doc["enabled"] | false;
-                pinHash = doc["hash"].as<String>();
-                currentPinLength = doc["length"] | DEFAULT_PIN_LENGTH;
-            }
-            configFile.close();
+    configManager.readSection(ConfigSection::PIN, [this](const JsonDocument& doc) {
+        enabled = doc["enabled"] | false;
+        currentPinLength = doc["length"] | DEFAULT_PIN_LENGTH;
+        failedAttempts = doc["failures"] | 0;
+        wipeAfter = doc["wipe_after"] | 0;
+
+        pinRecord.iterations = 0;
+        legacyPinHash = "";
+        if (doc["salt"].isNull()) {
+            // Формат до PBKDF2: переводится на новую запись при первом верном вводе
+            legacyPinHash = doc["hash"] | "";
+        } else if (CryptoManager::fromHex(doc["salt"] | "", pinRecord.salt, KDF_SALT_LENGTH) &&
+                   CryptoManager::fromHex(doc["hash"] | "", pinRecord.hash, KDF_HASH_LENGTH)) {
+            pinRecord.iterations = doc["iterations"] | 0;
+        }
+    });
+}
+
+void PinManager::savePinConfig(bool immediate) {
+    configManager.writeSection(ConfigSection::PIN, [this](JsonDocument& doc) {
+        doc.clear();
+        doc["enabled"] = enabled;
+        doc["length"] = currentPinLength;
+        doc["failures"] = failedAttempts;
+        doc["wipe_after"] = wipeAfter;
+        if (legacyPinHash.length() > 0) {
+            doc["hash"] = legacyPinHash;
+        } else if (pinRecord.iterations > 0) {
+            doc["kdf"] = "pbkdf2-sha256";
+            doc["iterations"] = pinRecord.iterations;
+            doc["salt"] = CryptoManager::toHex(pinRecord.salt, KDF_SALT_LENGTH);
+            doc["hash"] = CryptoManager::toHex(pinRecord.hash, KDF_HASH_LENGTH);
         }
+    }, immediate);
+}
+
+// --- ЭКРАН ВВОДА PIN-КОДА ---
+// Логика ввода живет в PinEntry; здесь только опрос кнопок, проверка
+// и отрисовка. Вызывается из основного цикла, поэтому батарея, сеть и
+// синхронизация времени продолжают работать во время ввода.
+
+static const int PIN_CELL_WIDTH = 18;     // Символ шрифта 1 при размере 3
+static const int PIN_MASK_Y = 48;
+static const int PIN_SELECTOR_Y = 87;
+static const int PIN_SELECTOR_CHAR = 12;  // Символ шрифта 1 при размере 2
+static const unsigned long PIN_DEBOUNCE_MS = 50;
+
+void PinManager::startEntry() {
+    if (!enabled || !isPinSet()) {
+        return;
     }
+    // Кнопка, удерживаемая с момента пробуждения, не считается нажатием
+    button1Down = digitalRead(BUTTON_1) == LOW;
+    button2Down = digitalRead(BUTTON_2) == LOW;
+    shownLockoutSeconds = 0;
+
+    unsigned long now = millis();
+    unsigned long lockoutMs = (long)(lockoutUntil - now) > 0 ? lockoutUntil - now : 0;
+    entry.start(currentPinLength, lockoutMs, now);
+}
+
+bool PinManager::isEntryActive() {
+    return entry.isActive();
 }
 
-void PinManager::savePinConfig() {
-    JsonDocument doc;
-    doc["enabled"] = enabled;
-    doc["hash"] = pinHash;
-    doc["length"] = currentPinLength;
+void PinManager::update() {
+    if (!entry.isActive()) return;
+    unsigned long now = millis();
 
-    fs::File configFile = LittleFS.open(PIN_FILE, "w");
-    if (configFile) {
-        serializeJson(doc, configFile);
-        configFile.close();
+    // Нажатие - переход кнопки в LOW
+    bool button1 = digitalRead(BUTTON_1) == LOW;
+    bool button2 = digitalRead(BUTTON_2) == LOW;
+    if (now - lastButtonPress > PIN_DEBOUNCE_MS) {
+        if (button1 && !button1Down) {
+            entry.press(PinButton::NEXT, now);
+            lastButtonPress = now;
+        } else if (button2 && !button2Down) {
+            entry.press(PinButton::CONFIRM, now);
+            lastButtonPress = now;
+        }
+        button1Down = button1;
+        button2Down = button2;
+    }
+
+    entry.update(now);
+    renderEntry(now);
+
+    // Экран "Checking..." уже выведен; проверка занимает около PIN_KDF_TARGET_MS
+    if (entry.getState() == PinEntryState::VERIFY) {
+        bool ok = checkPin(String(entry.getPin()));
+        now = millis();
+        unsigned long lockoutMs = ok ? 0 : lockoutUntil - now;
+        entry.setResult(ok, (long)lockoutMs > 0 ? lockoutMs : 0, now);
+        renderEntry(now);
     }
 }
 
-void PinManager::updatePinScreen(int currentPosition, int currentDigit, const String& enteredPin) {
+void PinManager::renderEntry(unsigned long now) {
     TFT_eSPI* tft = displayManager.getTft();
     int centerX = tft->width() / 2;
+    PinEntryState state = entry.getState();
 
-    // Обновляем только маску PIN-кода
-    String pinMask = "";
-    for (int i = 0; i < enteredPin.length(); i++) pinMask += "*";
-    for (int i = 0; i < (currentPinLength - enteredPin.length()); i++) pinMask += ".";
-    
-    tft->setTextDatum(MC_DATUM);
-    tft->setTextSize(3);
-    // Очищаем предыдущую маску и рисуем новую
-    tft->fillRect(0, 50, tft->width(), 24, TFT_BLACK); // Adjusted Y for clearing
-    tft->drawString(pinMask, centerX, 60); // Adjusted Y for better vertical centering
+    if (entry.takeScreenDirty()) {
+        tft->fillScreen(TFT_BLACK);
+        tft->setTextDatum(MC_DATUM);
+        tft->setTextColor(TFT_WHITE, TFT_BLACK);
 
-    // Обновляем только селектор цифр
-    String selector = "< " + String(currentDigit) + " >";
-    tft->setTextSize(2);
-    // Очищаем предыдущий селектор и рисуем новый
-    tft->fillRect(0, 85, tft->width(), 16, TFT_BLACK); // Adjusted Y for clearing
-    tft->drawString(selector, centerX, 95); // Adjusted Y for better vertical centering
+        switch (state) {
+            case PinEntryState::LOCKED:
+                tft->setTextSize(2);
+                tft->drawString("Too many attempts", centerX, 45);
+                shownLockoutSeconds = 0;
+                break;
+            case PinEntryState::INPUT:
+                tft->setTextSize(2);
+                tft->drawString("Enter PIN Code", centerX, 25);
+                tft->setTextDatum(TL_DATUM);
+                tft->drawString("<", centerX - PIN_SELECTOR_CHAR * 5 / 2, PIN_SELECTOR_Y);
+                tft->drawString(">", centerX + PIN_SELECTOR_CHAR * 3 / 2, PIN_SELECTOR_Y);
+                for (int i = 0; i < entry.getLength(); i++) {
+                    drawPinCell(i);
+                }
+                drawSelectorDigit();
+                break;
+            case PinEntryState::VERIFY:
+                tft->setTextSize(2);
+                tft->drawString("Checking...", centerX, 67);
+                break;
+            case PinEntryState::ACCEPTED:
+                tft->setTextSize(3);
+                tft->drawString("PIN OK", centerX, 67);
+                break;
+            case PinEntryState::REJECTED:
+                tft->setTextSize(2);
+                tft->setTextColor(TFT_RED, TFT_BLACK);
+                tft->drawString("WRONG PIN", centerX, 67);
+                tft->setTextColor(TFT_WHITE, TFT_BLACK);
+                break;
+            default:
+                break;
+        }
+        return;
+    }
+
+    if (state == PinEntryState::INPUT) {
+        uint16_t cells = entry.takeDirtyCells();
+        for (int i = 0; cells != 0; i++, cells >>= 1) {
+            if (cells & 1) drawPinCell(i);
+        }
+        if (entry.takeDigitDirty()) {
+            drawSelectorDigit();
+        }
+    } else if (state == PinEntryState::LOCKED) {
+        unsigned long seconds = (entry.getLockoutRemainingMs(now) + 999) / 1000;
+        if (seconds != shownLockoutSeconds) {
+            shownLockoutSeconds = seconds;
+            tft->setTextDatum(MC_DATUM);
+            tft->setTextSize(2);
+            tft->setTextColor(TFT_WHITE, TFT_BLACK);
+            tft->setTextPadding(tft->width());
+            tft->drawString("Wait " + String(seconds) + "s", centerX, 85);
+            tft->setTextPadding(0);
+        }
+    }
 }
 
-void PinManager::drawPinScreen() {
+// Одна ячейка маски: '*' для набранной цифры, '.' для оставшихся.
+// Фон символа закрашивается самим шрифтом, fillRect не нужен.
+void PinManager::drawPinCell(int index) {
     TFT_eSPI* tft = displayManager.getTft();
-    tft->fillScreen(TFT_BLACK);
-    tft->setTextDatum(MC_DATUM); // Устанавливаем выравнивание по центру
-
-    int centerX = tft->width() / 2;
+    int x = tft->width() / 2 - entry.getLength() * PIN_CELL_WIDTH / 2 + index * PIN_CELL_WIDTH;
+    tft->setTextDatum(TL_DATUM);
+    tft->setTextSize(3);
+    tft->setTextColor(TFT_WHITE, TFT_BLACK);
+    tft->drawString(index < entry.getEnteredCount() ? "*" : ".", x, PIN_MASK_Y);
+}
 
-    // Рисуем заголовок
+void PinManager::drawSelectorDigit() {
+    TFT_eSPI* tft = displayManager.getTft();
+    char digit[2] = {(char)('0' + entry.getCurrentDigit()), '\0'};
+    tft->setTextDatum(TL_DATUM);
     tft->setTextSize(2);
     tft->setTextColor(TFT_WHITE, TFT_BLACK);
-    tft->drawString("Enter PIN Code", centerX, 25); // Adjusted Y for better spacing
+    tft->drawString(digit, tft->width() / 2 - PIN_SELECTOR_CHAR / 2, PIN_SELECTOR_Y);
 }
 
-void PinManager::requestPin() {
-    if (!enabled || !isPinSet()) {
-        return;
-    }
+void PinManager::startLockout() {
+    lockoutUntil = millis() + backoffForFailures(failedAttempts);
+}
 
-    String enteredPin = "";
-    int currentDigit = 0;
-    unsigned long lastButtonPress = 0;
-    const int debounce = 250;
-    
-    drawPinScreen(); // Начальная отрисовка (один раз)
-    updatePinScreen(enteredPin.length(), currentDigit, enteredPin); // Первоначальное отображение маски и селектора
-
-    while (true) {
-        // Кнопка 1 (пин 35) - переключение цифры
-        if (digitalRead(BUTTON_1) == LOW && (millis() - lastButtonPress > debounce)) {
-            lastButtonPress = millis();
-            currentDigit = (currentDigit + 1) % 10;
-            updatePinScreen(enteredPin.length(), currentDigit, enteredPin); // Обновляем только изменяемые части
-        }
+unsigned long PinManager::backoffForFailures(int failures) {
+    if (failures < PIN_BACKOFF_FREE_ATTEMPTS) return 0;
+    int shift = failures - PIN_BACKOFF_FREE_ATTEMPTS;
+    if (shift > 16) return PIN_BACKOFF_MAX_MS;
+    unsigned long backoff = PIN_BACKOFF_BASE_MS << shift;
+    return backoff > PIN_BACKOFF_MAX_MS ? PIN_BACKOFF_MAX_MS : backoff;
+}
 
-        // Кнопка 2 (пин 0) - подтверждение цифры
-        if (digitalRead(BUTTON_2) == LOW && (millis() - lastButtonPress > debounce)) {
-            lastButtonPress = millis();
-            enteredPin += String(currentDigit);
-            currentDigit = 0;
-            updatePinScreen(enteredPin.length(), currentDigit, enteredPin); // Обновляем маску
-
-            if (enteredPin.length() >= currentPinLength) {
-                TFT_eSPI* tft = displayManager.getTft();
-                int centerX = tft->width() / 2;
-                tft->setTextDatum(MC_DATUM);
-
-                if (checkPin(enteredPin)) {
-                    tft->fillScreen(TFT_BLACK);
-                    tft->setTextSize(3);
-                    tft->drawString("PIN OK", centerX, 67); // Centered vertically
-                    delay(1000);
-                    return;
-                } else {
-                    tft->fillScreen(TFT_BLACK);
-                    tft->setTextSize(2);
-                    tft->setTextColor(TFT_RED);
-                    tft->drawString("WRONG PIN", centerX, 67); // Centered vertically
-                    delay(2000);
-                    
-                    // Сбрасываем для повторного ввода
-                    enteredPin = "";
-                    drawPinScreen(); // Перерисовываем экран после ошибки
-                    updatePinScreen(enteredPin.length(), currentDigit, enteredPin);
-                }
-            }
-        }
-        delay(50);
-    }
+void PinManager::wipeKeys() {
+    // Вместе с резервным поколением, иначе ключи восстановятся из .bak
+    AtomicFile::remove(flashFS, KEYS_FILE);
+    failedAttempts = 0;
+    savePinConfig(true);
+    LOG_WARN("PIN", "too many failures, keys wiped");
+
+    TFT_eSPI* tft = displayManager.getTft();
+    tft->fillScreen(TFT_BLACK);
+    tft->setTextDatum(MC_DATUM);
+    tft->setTextSize(2);
+    tft->setTextColor(TFT_RED, TFT_BLACK);
+    tft->drawString("KEYS WIPED", tft->width() / 2, 67);
+    delay(3000);
+    configManager.flush();
+    ESP.restart();
 }
 
 void PinManager::setPin(const String& newPin) {
     if (newPin.length() > 0) {
-        pinHash = CryptoManager::hashPassword(newPin);
+        // Калибровка под текущий чип: перебор 10^4..10^10 PIN-кодов офлайн должен стоить дорого
+        uint32_t iterations = CryptoManager::calibrateIterations(PIN_KDF_TARGET_MS, KDF_MIN_ITERATIONS);
+        CryptoManager::createPasswordRecord(newPin, iterations, pinRecord);
+        legacyPinHash = "";
+        failedAttempts = 0;
+        LOG_INFO("PIN", "KDF: %lu iterations for ~%d ms", (unsigned long)iterations, PIN_KDF_TARGET_MS);
     }
 }
 
@@ -163,9 +269,54 @@ bool PinManager::isPinEnabled() {
 }
 
 bool PinManager::isPinSet() {
-    return pinHash.length() > 0;
+    return pinRecord.iterations > 0 || legacyPinHash.length() > 0;
+}
+
+int PinManager::getWipeAfter() {
+    return wipeAfter;
+}
+
+void PinManager::setWipeAfter(int attempts) {
+    if (attempts == 0 || attempts >= PIN_WIPE_MIN_ATTEMPTS) {
+        wipeAfter = attempts;
+    }
+}
+
+int PinManager::getFailedAttempts() {
+    return failedAttempts;
 }
 
 bool PinManager::checkPin(const String& pin) {
-    return CryptoManager::verifyPassword(pin, pinHash);
+    // Ошибка засчитывается до проверки, чтобы сброс питания во время
+    // проверки не давал бесплатную попытку
+    failedAttempts++;
+    savePinConfig(true);
+
+    bool ok;
+    if (legacyPinHash.length() > 0) {
+        ok = CryptoManager::verifyPassword(pin, legacyPinHash);
+        if (ok) {
+            setPin(pin);
+            LOG_INFO("PIN", "migrated to PBKDF2");
+        }
+    } else {
+        int64_t start = esp_timer_get_time();
+        ok = CryptoManager::verifyPasswordRecord(pin, pinRecord);
+        LOG_INFO("PIN", "verify: %lu ms, %lu iterations",
+                      (unsigned long)((esp_timer_get_time() - start) / 1000), (unsigned long)pinRecord.iterations);
+    }
+
+    if (ok) {
+        failedAttempts = 0;
+        lockoutUntil = 0;
+        savePinConfig(true);
+        return true;
+    }
+
+    LOG_WARN("PIN", "wrong attempt %d", failedAttempts);
+    if (wipeAfter > 0 && failedAttempts >= wipeAfter) {
+        wipeKeys();
+    }
+    startLockout();
+    return false;
 }
@@ -0,0 +1,294 @@
+#include "qr_code.h"
+
+// Таблицы уровня M для версий 1..10 (индекс - версия)
+static const uint8_t EC_PER_BLOCK[QR_MAX_VERSION + 1] = {0, 10, 16, 26, 18, 24, 16, 18, 22, 22, 26};
+static const uint8_t NUM_BLOCKS[QR_MAX_VERSION + 1] = {0, 1, 1, 1, 2, 2, 4, 4, 4, 5, 5};
+static const uint16_t TOTAL_CODEWORDS[QR_MAX_VERSION + 1] = {0, 26, 44, 70, 100, 134, 172, 196, 242, 292, 346};
+static const uint8_t ALIGNMENT_STEP[QR_MAX_VERSION + 1] = {0, 0, 12, 16, 20, 24, 28, 16, 18, 20, 22};
+static const int FORMAT_ECC_M = 0; // Биты уровня коррекции в формате: L=1, M=0, Q=3, H=2
+
+static uint8_t gfMultiply(uint8_t x, uint8_t y) {
+    int z = 0;
+    for (int i = 7; i >= 0; i--) {
+        z = (z << 1) ^ ((z >> 7) * 0x11D);
+        z ^= ((y >> i) & 1) * x;
+    }
+    return z;
+}
+
+void qrReedSolomon(const uint8_t* data, int length, int degree, uint8_t* result) {
+    // Порождающий многочлен (x - a^0)(x - a^1)...(x - a^(degree-1)), старший коэффициент опущен
+    uint8_t divisor[32] = {0};
+    divisor[degree - 1] = 1;
+    uint8_t root = 1;
+    for (int i = 0; i < degree; i++) {
+        for (int j = 0; j < degree; j++) {
+            divisor[j] = gfMultiply(divisor[j], root);
+            if (j + 1 < degree) divisor[j] ^= divisor[j + 1];
+        }
+        root = gfMultiply(root, 0x02);
+    }
+
+    memset(result, 0, degree);
+    for (int i = 0; i < length; i++) {
+        uint8_t factor = data[i] ^ result[0];
+        memmove(result, result + 1, degree - 1);
+        result[degree - 1] = 0;
+        for (int j = 0; j < degree; j++) {
+            result[j] ^= gfMultiply(divisor[j], factor);
+        }
+    }
+}
+
+void QrCode::setBit(uint8_t* buffer, int x, int y, bool dark) {
+    int i = y * _size + x;
+    if (dark) {
+        buffer[i >> 3] |= 0x80 >> (i & 7);
+    } else {
+        buffer[i >> 3] &= ~(0x80 >> (i & 7));
+    }
+}
+
+void QrCode::setFunction(int x, int y, bool dark) {
+    setBit(_modules, x, y, dark);
+    setBit(_function, x, y, true);
+}
+
+bool QrCode::encode(const uint8_t* data, size_t length) {
+    // Наименьшая версия, в которую помещаются режим (4 бита), длина и данные
+    int version = 1;
+    int dataCodewords = 0;
+    for (; version <= QR_MAX_VERSION; version++) {
+        dataCodewords = TOTAL_CODEWORDS[version] - EC_PER_BLOCK[version] * NUM_BLOCKS[version];
+        int countBits = version <= 9 ? 8 : 16;
+        if (4 + countBits + length * 8 <= (size_t)dataCodewords * 8) break;
+    }
+    if (version > QR_MAX_VERSION) return false;
+
+    _version = version;
+    _size = 17 + 4 * version;
+    memset(_modules, 0, sizeof(_modules));
+    memset(_function, 0, sizeof(_function));
+
+    // Поток данных: режим 0100, длина, байты, терминатор, выравнивание, байты-заполнители
+    uint8_t codewords[QR_MAX_CODEWORDS] = {0};
+    int bitLength = 0;
+    auto appendBits = [&](uint32_t value, int count) {
+        for (int i = count - 1; i >= 0; i--, bitLength++) {
+            codewords[bitLength >> 3] |= ((value >> i) & 1) << (7 - (bitLength & 7));
+        }
+    };
+    appendBits(0x4, 4);
+    appendBits(length, version <= 9 ? 8 : 16);
+    for (size_t i = 0; i < length; i++) appendBits(data[i], 8);
+    int capacityBits = dataCodewords * 8;
+    appendBits(0, capacityBits - bitLength < 4 ? capacityBits - bitLength : 4);
+    appendBits(0, (8 - bitLength % 8) % 8);
+    for (uint8_t pad = 0xEC; bitLength < capacityBits; pad ^= 0xEC ^ 0x11) appendBits(pad, 8);
+
+    // Блоки: короткие идут первыми, у длинных на одно слово данных больше.
+    // Слова чередуются по блокам, затем так же чередуются коды коррекции.
+    int numBlocks = NUM_BLOCKS[version];
+    int ecLength = EC_PER_BLOCK[version];
+    int total = TOTAL_CODEWORDS[version];
+    int numShort = numBlocks - total % numBlocks;
+    int shortData = total / numBlocks - ecLength;
+    uint8_t ecc[5][32];
+    int blockStart[5];
+    for (int b = 0, start = 0; b < numBlocks; b++) {
+        int blockData = shortData + (b < numShort ? 0 : 1);
+        blockStart[b] = start;
+        qrReedSolomon(codewords + start, blockData, ecLength, ecc[b]);
+        start += blockData;
+    }
+    uint8_t interleaved[QR_MAX_CODEWORDS];
+    int count = 0;
+    for (int i = 0; i <= shortData; i++) {
+        for (int b = 0; b < numBlocks; b++) {
+            if (i == shortData && b < numShort) continue;
+            interleaved[count++] = codewords[blockStart[b] + i];
+        }
+    }
+    for (int i = 0; i < ecLength; i++) {
+        for (int b = 0; b < numBlocks; b++) interleaved[count++] = ecc[b][i];
+    }
+
+    drawFunctionPatterns();
+    drawCodewords(interleaved, count);
+
+    // Маска с наименьшим штрафом; маскирование обратимо (XOR)
+    long best = -1;
+    for (int mask = 0; mask < 8; mask++) {
+        applyMask(mask);
+        drawFormatBits(mask);
+        long score = penalty();
+        if (best < 0 || score < best) {
+            best = score;
+            _mask = mask;
+        }
+        applyMask(mask);
+    }
+    applyMask(_mask);
+    drawFormatBits(_mask);
+    return true;
+}
+
+void QrCode::drawFunctionPatterns() {
+    for (int i = 0; i < _size; i++) {
+        setFunction(6, i, i % 2 == 0);
+        setFunction(i, 6, i % 2 == 0);
+    }
+    drawFinder(3, 3);
+    drawFinder(_size - 4, 3);
+    drawFinder(3, _size - 4);
+
+    if (_version > 1) {
+        // Центры выравнивающих узоров: 6, затем с шагом до края (size - 7)
+        int positions[7];
+        int count = _version / 7 + 2;
+        positions[0] = 6;
+        for (int i = count - 1, pos = _size - 7; i >= 1; i--, pos -= ALIGNMENT_STEP[_version]) {
+            positions[i] = pos;
+        }
+        for (int i = 0; i < count; i++) {
+            for (int j = 0; j < count; j++) {
+                // Пропускаем три угла с поисковыми узорами
+                if ((i == 0 && j == 0) || (i == 0 && j == count - 1) || (i == count - 1 && j == 0)) continue;
+                drawAlignment(positions[i], positions[j]);
+            }
+        }
+    }
+    drawFormatBits(0); // Резервирует место формата до выбора маски
+    drawVersion();
+}
+
+void QrCode::drawFinder(int x, int y) {
+    for (int dy = -4; dy <= 4; dy++) {
+        for (int dx = -4; dx <= 4; dx++) {
+            int distance = max(abs(dx), abs(dy));
+            int xx = x + dx, yy = y + dy;
+            if (xx >= 0 && xx < _size && yy >= 0 && yy < _size) {
+                setFunction(xx, yy, distance != 2 && distance != 4);
+            }
+        }
+    }
+}
+
+void QrCode::drawAlignment(int x, int y) {
+    for (int dy = -2; dy <= 2; dy++) {
+        for (int dx = -2; dx <= 2; dx++) {
+            setFunction(x + dx, y + dy, max(abs(dx), abs(dy)) != 1);
+        }
+    }
+}
+
+void QrCode::drawFormatBits(int mask) {
+    // 5 бит данных + 10 бит БЧХ, затем XOR с 0x5412
+    int data = FORMAT_ECC_M << 3 | mask;
+    int rem = data;
+    for (int i = 0; i < 10; i++) rem = (rem << 1) ^ ((rem >> 9) * 0x537);
+    int bits = (data << 10 | rem) ^ 0x5412;
+
+    for (int i = 0; i <= 5; i++) setFunction(8, i, (bits >> i) & 1);
+    setFunction(8, 7, (bits >> 6) & 1);
+    setFunction(8, 8, (bits >> 7) & 1);
+    setFunction(7, 8, (bits >> 8) & 1);
+    for (int i = 9; i < 15; i++) setFunction(14 - i, 8, (bits >> i) & 1);
+
+    for (int i = 0; i < 8; i++) setFunction(_size - 1 - i, 8, (bits >> i) & 1);
+    for (int i = 8; i < 15; i++) setFunction(8, _size - 15 + i, (bits >> i) & 1);
+    setFunction(8, _size - 8, true); // Всегда темный модуль
+}
+
+void QrCode::drawVersion() {
+    if (_version < 7) return;
+    int rem = _version;
+    for (int i = 0; i < 12; i++) rem = (rem << 1) ^ ((rem >> 11) * 0x1F25);
+    long bits = (long)_version << 12 | rem;
+    for (int i = 0; i < 18; i++) {
+        bool bit = (bits >> i) & 1;
+        int a = _size - 11 + i % 3;
+        int b = i / 3;
+        setFunction(a, b, bit);
+        setFunction(b, a, bit);
+    }
+}
+
+// Зигзаг парами столбцов справа налево, пропуская столбец синхронизации
+void QrCode::drawCodewords(const uint8_t* codewords, int count) {
+    int bit = 0;
+    for (int right = _size - 1; right >= 1; right -= 2) {
+        if (right == 6) right = 5;
+        for (int vert = 0; vert < _size; vert++) {
+            for (int j = 0; j < 2; j++) {
+                int x = right - j;
+                bool upward = ((right + 1) & 2) == 0;
+                int y = upward ? _size - 1 - vert : vert;
+                if (!getBit(_function, x, y) && bit < count * 8) {
+                    setBit(_modules, x, y, (codewords[bit >> 3] >> (7 - (bit & 7))) & 1);
+                    bit++;
+                }
+            }
+        }
+    }
+}
+
+void QrCode::applyMask(int mask) {
+    for (int y = 0; y < _size; y++) {
+        for (int x = 0; x < _size; x++) {
+            bool invert;
+            switch (mask) {
+                case 0: invert = (x + y) % 2 == 0; break;
+                case 1: invert = y % 2 == 0; break;
+                case 2: invert = x % 3 == 0; break;
+                case 3: invert = (x + y) % 3 == 0; break;
+                case 4: invert = (x / 3 + y / 2) % 2 == 0; break;
+                case 5: invert = x * y % 2 + x * y % 3 == 0; break;
+                case 6: invert = (x * y % 2 + x * y % 3) % 2 == 0; break;
+                default: invert = ((x + y) % 2 + x * y % 3) % 2 == 0; break;
+            }
+            if (invert && !getBit(_function, x, y)) {
+                setBit(_modules, x, y, !getBit(_modules, x, y));
+            }
+        }
+    }
+}
+
+// Штраф по четырем правилам стандарта: серии, квадраты 2x2, ложные поисковые узоры, баланс
+long QrCode::penalty() const {
+    long result = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int a = 0; a < _size; a++) {
+            int run = 0;
+            bool runColor = false;
+            uint16_t history = 0; // Последние 11 модулей строки (столбца)
+            for (int b = 0; b < _size; b++) {
+                bool dark = pass == 0 ? module(b, a) : module(a, b);
+                if (b > 0 && dark == runColor) {
+                    run++;
+                    if (run == 5) result += 3;
+                    else if (run > 5) result++;
+                } else {
+                    run = 1;
+                    runColor = dark;
+                }
+                history = ((history << 1) | dark) & 0x7FF;
+                if (b >= 10 && (history == 0x5D0 || history == 0x05D)) result += 40;
+            }
+        }
+    }
+    for (int y = 0; y + 1 < _size; y++) {
+        for (int x = 0; x + 1 < _size; x++) {
+            bool color = module(x, y);
+            if (color == module(x + 1, y) && color == module(x, y + 1) && color == module(x + 1, y + 1)) result += 3;
+        }
+    }
+    int dark = 0;
+    for (int y = 0; y < _size; y++) {
+        for (int x = 0; x < _size; x++) dark += module(x, y);
+    }
+    int total = _size * _size;
+    int percent = dark * 100 / total;
+    result += 10 * (abs(percent - 50) / 5);
+    return result;
+}
@@ -0,0 +1,59 @@
+#include "rate_limiter.h"
+
+RateLimiter::RateLimiter(uint16_t capacity, uint16_t refillPerSec, uint16_t maxInFlight,
+                         uint32_t minFreeHeap, uint32_t minLargestBlock)
+    : _capacityMilli((uint32_t)capacity * 1000), _refillPerSec(refillPerSec), _maxInFlight(maxInFlight),
+      _minFreeHeap(minFreeHeap), _minLargestBlock(minLargestBlock), _bucketCount(0) {}
+
+RateLimiter::Bucket* RateLimiter::findBucket(uint32_t ip, unsigned long nowMs) {
+    Bucket* oldest = nullptr;
+    for (int i = 0; i < _bucketCount; i++) {
+        if (_buckets[i].ip == ip) return &_buckets[i];
+        if (oldest == nullptr || nowMs - _buckets[i].lastMs > nowMs - oldest->lastMs) {
+            oldest = &_buckets[i];
+        }
+    }
+
+    // Новый адрес начинает с полной корзиной
+    Bucket* bucket = _bucketCount < MAX_CLIENTS ? &_buckets[_bucketCount++] : oldest;
+    bucket->ip = ip;
+    bucket->milliTokens = _capacityMilli;
+    bucket->lastMs = nowMs;
+    return bucket;
+}
+
+Admission RateLimiter::admit(uint32_t ip, uint16_t cost, unsigned long nowMs,
+                             uint32_t freeHeap, uint32_t largestBlock, bool countInFlight) {
+    Bucket* bucket = findBucket(ip, nowMs);
+
+    uint64_t refill = (uint64_t)(nowMs - bucket->lastMs) * _refillPerSec;
+    uint64_t tokens = bucket->milliTokens + refill;
+    bucket->milliTokens = tokens > _capacityMilli ? _capacityMilli : (uint32_t)tokens;
+    bucket->lastMs = nowMs;
+
+    uint32_t costMilli = (uint32_t)cost * 1000;
+    if (bucket->milliTokens < costMilli) {
+        _stats.rateLimited++;
+        return Admission::RATE_LIMITED;
+    }
+    if (freeHeap < _minFreeHeap || largestBlock < _minLargestBlock) {
+        _stats.lowMemory++;
+        return Admission::LOW_MEMORY;
+    }
+    if (countInFlight && _stats.inFlight >= _maxInFlight) {
+        _stats.busy++;
+        return Admission::BUSY;
+    }
+
+    bucket->milliTokens -= costMilli;
+    _stats.allowed++;
+    if (countInFlight) {
+        _stats.inFlight++;
+        if (_stats.inFlight > _stats.peakInFlight) _stats.peakInFlight = _stats.inFlight;
+    }
+    return Admission::ALLOW;
+}
+
+void RateLimiter::release() {
+    if (_stats.inFlight > 0) _stats.inFlight--;
+}
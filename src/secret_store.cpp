@@ -0,0 +1,103 @@
+#include "secret_store.h"
+#include "config.h"
+#include <esp_heap_caps.h>
+#include "mbedtls/platform_util.h"
+
+// Разметка области: u16 число секретов N, N+1 смещений u16 от начала данных, данные
+static size_t regionCount(const uint8_t* region) {
+    return region ? *(const uint16_t*)region : 0;
+}
+
+static const uint16_t* regionOffsets(const uint8_t* region) {
+    return (const uint16_t*)region + 1;
+}
+
+static const uint8_t* regionData(const uint8_t* region) {
+    return region + sizeof(uint16_t) * (regionCount(region) + 2);
+}
+
+SecretStore::~SecretStore() {
+    clear();
+}
+
+void SecretStore::wipe(void* data, size_t length) {
+    mbedtls_platform_zeroize(data, length);
+}
+
+void SecretStore::wipe(String& text) {
+    if (text.length() > 0) wipe((void*)text.c_str(), text.length());
+    text = "";
+}
+
+size_t SecretStore::count() {
+    return regionCount(_region);
+}
+
+bool SecretStore::append(const uint8_t* secret, size_t length) {
+    if (length == 0 || length > TOTP_MAX_SECRET_BYTES) return false;
+    return rebuild(-1, secret, length);
+}
+
+bool SecretStore::remove(int index) {
+    if (index < 0 || index >= (int)count()) return false;
+    return rebuild(index, nullptr, 0);
+}
+
+void SecretStore::clear() {
+    if (_region) {
+        wipe(_region, _regionSize);
+        heap_caps_free(_region);
+    }
+    _region = nullptr;
+    _regionSize = 0;
+}
+
+size_t SecretStore::copy(int index, uint8_t* buffer) {
+    if (index < 0 || index >= (int)regionCount(_region)) return 0;
+    const uint16_t* offsets = regionOffsets(_region);
+    size_t length = offsets[index + 1] - offsets[index];
+    memcpy(buffer, regionData(_region) + offsets[index], length);
+    return length;
+}
+
+bool SecretStore::rebuild(int skip, const uint8_t* extra, size_t extraLength) {
+    const uint8_t* old = _region;
+    size_t oldCount = regionCount(old);
+    const uint16_t* oldOffsets = old ? regionOffsets(old) : nullptr;
+    size_t oldData = old ? oldOffsets[oldCount] : 0;
+
+    size_t newCount = oldCount - (skip >= 0 ? 1 : 0) + (extra ? 1 : 0);
+    size_t dataSize = oldData + extraLength - (skip >= 0 ? oldOffsets[skip + 1] - oldOffsets[skip] : 0);
+    if (newCount > UINT16_MAX - 1 || dataSize > UINT16_MAX) return false;
+
+    uint8_t* region = nullptr;
+    size_t regionSize = 0;
+    if (newCount > 0) {
+        regionSize = sizeof(uint16_t) * (newCount + 2) + dataSize;
+        region = (uint8_t*)heap_caps_malloc(regionSize, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!region) return false;
+
+        uint16_t* offsets = (uint16_t*)region + 1;
+        uint8_t* data = region + sizeof(uint16_t) * (newCount + 2);
+        *(uint16_t*)region = newCount;
+        size_t count = 0, position = 0;
+        for (size_t i = 0; i < oldCount; i++) {
+            if ((int)i == skip) continue;
+            size_t length = oldOffsets[i + 1] - oldOffsets[i];
+            offsets[count++] = position;
+            memcpy(data + position, regionData(old) + oldOffsets[i], length);
+            position += length;
+        }
+        if (extra) {
+            offsets[count++] = position;
+            memcpy(data + position, extra, extraLength);
+            position += extraLength;
+        }
+        offsets[count] = position;
+    }
+
+    clear();
+    _region = region;
+    _regionSize = regionSize;
+    return true;
+}
@@ -0,0 +1,104 @@
+#include "session_manager.h"
+#include "crypto_manager.h"
+#include <esp_system.h>
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+SessionManager::SessionManager() {
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        _sessions[i].active = false;
+        _sessions[i].createdMs = 0;
+        _sessions[i].token[0] = '\0';
+    }
+}
+
+const char* SessionManager::create() {
+    unsigned long now = millis();
+
+    // Свободный или истекший слот, иначе самый старый
+    int slot = 0;
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        if (!_sessions[i].active || now - _sessions[i].createdMs > SESSION_TIMEOUT) {
+            slot = i;
+            break;
+        }
+        if (_sessions[i].createdMs < _sessions[slot].createdMs) {
+            slot = i;
+        }
+    }
+
+    uint8_t random[(TOKEN_LENGTH - 2) / 2];
+    esp_fill_random(random, sizeof(random));
+
+    Session& session = _sessions[slot];
+    session.token[0] = HEX_DIGITS[(slot >> 4) & 0x0F];
+    session.token[1] = HEX_DIGITS[slot & 0x0F];
+    for (size_t i = 0; i < sizeof(random); i++) {
+        session.token[2 + i * 2] = HEX_DIGITS[random[i] >> 4];
+        session.token[3 + i * 2] = HEX_DIGITS[random[i] & 0x0F];
+    }
+    session.token[TOKEN_LENGTH] = '\0';
+    session.createdMs = now;
+    session.active = true;
+    memset(random, 0, sizeof(random));
+
+    return session.token;
+}
+
+int SessionManager::findSlot(const char* token, size_t length) {
+    if (token == nullptr || length != TOKEN_LENGTH) return -1;
+
+    // Номер слота закодирован в первых двух символах
+    int slot = 0;
+    for (int i = 0; i < 2; i++) {
+        char c = token[i];
+        int digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else return -1;
+        slot = (slot << 4) | digit;
+    }
+    if (slot >= MAX_SESSIONS) return -1;
+
+    Session& session = _sessions[slot];
+    if (!session.active) return -1;
+    if (millis() - session.createdMs > SESSION_TIMEOUT) {
+        session.active = false;
+        return -1;
+    }
+    if (!CryptoManager::constantTimeEquals(session.token, token, TOKEN_LENGTH)) return -1;
+    return slot;
+}
+
+bool SessionManager::validate(const char* token, size_t length) {
+    return findSlot(token, length) >= 0;
+}
+
+void SessionManager::revoke(const char* token, size_t length) {
+    int slot = findSlot(token, length);
+    if (slot >= 0) {
+        _sessions[slot].active = false;
+        memset(_sessions[slot].token, 0, sizeof(_sessions[slot].token));
+    }
+}
+
+bool SessionManager::findCookie(const char* header, const char* name, const char** value, size_t* length) {
+    if (header == nullptr) return false;
+    size_t nameLength = strlen(name);
+    const char* p = header;
+
+    while (*p) {
+        // Пропускаем разделители между парами "имя=значение"
+        while (*p == ' ' || *p == ';') p++;
+        const char* pairStart = p;
+        while (*p && *p != ';') p++;
+        const char* pairEnd = p;
+
+        if ((size_t)(pairEnd - pairStart) > nameLength && strncmp(pairStart, name, nameLength) == 0 && pairStart[nameLength] == '=') {
+            *value = pairStart + nameLength + 1;
+            *length = pairEnd - *value;
+            return true;
+        }
+    }
+    return false;
+}
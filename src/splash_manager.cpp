@@ -1,12 +1,12 @@
 #include "splash_manager.h"
-#include "LittleFS.h"
-#include <FS.h>
+#include "flash_fs.h"
+#include "metrics.h"
 
 SplashScreenManager::SplashScreenManager(DisplayManager& displayManager) : _displayManager(displayManager) {}
 
 void SplashScreenManager::displaySplashScreen() {
-    if (LittleFS.exists(SPLASH_IMAGE_PATH)) {
-        fs::File splashFile = LittleFS.open(SPLASH_IMAGE_PATH, "r");
+    if (flashFS.exists(SPLASH_IMAGE_PATH)) {
+        FlashFile splashFile = flashFS.open(SPLASH_IMAGE_PATH, "r");
         if (splashFile) {
             size_t fileSize = splashFile.size();
             // Allocate buffer for the image. RGB565 is 2 bytes per pixel.
@@ -15,6 +15,7 @@ void SplashScreenManager::displaySplashScreen() {
             if (imageBuffer) {
                 splashFile.read((uint8_t*)imageBuffer, fileSize);
                 _displayManager.getTft()->pushImage(0, 0, SPLASH_IMAGE_WIDTH, SPLASH_IMAGE_HEIGHT, imageBuffer);
+                METRIC_ADD(METRIC_SPI_BYTES, SPLASH_IMAGE_WIDTH * SPLASH_IMAGE_HEIGHT * 2);
                 free(imageBuffer); // Free the buffer after use
             }
             
@@ -25,8 +26,8 @@ void SplashScreenManager::displaySplashScreen() {
 }
 
 bool SplashScreenManager::deleteSplashImage() {
-    if (LittleFS.exists(SPLASH_IMAGE_PATH)) {
-        return LittleFS.remove(SPLASH_IMAGE_PATH);
+    if (flashFS.exists(SPLASH_IMAGE_PATH)) {
+        return flashFS.remove(SPLASH_IMAGE_PATH);
     }
     return true; // Return true if file doesn't exist anyway
 }
\ No newline at end of file
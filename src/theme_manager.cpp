@@ -0,0 +1,165 @@
+#include "theme_manager.h"
+#include "config.h"
+#include "atomic_file.h"
+#include "logger.h"
+
+// Имена полей в файле в порядке полей ThemeColors
+static const char* const COLOR_KEYS[THEME_COLOR_COUNT] = {
+    "background_dark", "background_light", "accent_primary", "accent_secondary",
+    "text_primary", "text_secondary", "shadow_color", "error_color"
+};
+
+static uint16_t rgbTo565(uint32_t rgb) {
+    return ((rgb >> 8) & 0xF800) | ((rgb >> 5) & 0x07E0) | ((rgb >> 3) & 0x001F);
+}
+
+// Обратное преобразование повторяет старшие биты, чтобы белый остался 0xFFFFFF
+static uint32_t rgbFrom565(uint16_t color) {
+    uint32_t r = (color >> 11) & 0x1F, g = (color >> 5) & 0x3F, b = color & 0x1F;
+    return (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+}
+
+static bool isValidName(const char* name) {
+    size_t length = strlen(name);
+    if (length == 0 || length > THEME_NAME_LENGTH) return false;
+    for (size_t i = 0; i < length; i++) {
+        char c = name[i];
+        if (!isalnum((unsigned char)c) && c != '-' && c != '_') return false;
+    }
+    return true;
+}
+
+ThemeManager::ThemeManager() {
+    ThemeDefinition dark = {DEFAULT_THEME_NAME, DARK_THEME_COLORS, true};
+    ThemeDefinition light = {"light", LIGHT_THEME_COLORS, true};
+    _themes.push_back(dark);
+    _themes.push_back(light);
+}
+
+void ThemeManager::begin() {
+    AtomicFile::recover(flashFS, THEMES_FILE);
+    std::vector<uint8_t> content;
+    if (!AtomicFile::read(flashFS, THEMES_FILE, content)) return;
+
+    JsonDocument doc;
+    if (deserializeJson(doc, content.data(), content.size())) {
+        LOG_ERROR("Theme", "failed to parse %s", THEMES_FILE);
+        return;
+    }
+    for (JsonObjectConst obj : doc.as<JsonArrayConst>()) {
+        ThemeDefinition theme;
+        String error;
+        if (_themes.size() >= 2 + MAX_CUSTOM_THEMES) break;
+        if (parseTheme(obj, theme, error) && find(theme.name) == nullptr) {
+            _themes.push_back(theme);
+        }
+    }
+    LOG_DEBUG("Theme", "%u custom themes loaded", (unsigned)(_themes.size() - 2));
+}
+
+bool ThemeManager::parseTheme(JsonObjectConst obj, ThemeDefinition& theme, String& error) {
+    const char* name = obj["name"] | "";
+    if (!isValidName(name)) {
+        error = "Invalid theme name.";
+        return false;
+    }
+    strcpy(theme.name, name);
+    theme.builtin = false;
+
+    uint16_t* slots = reinterpret_cast<uint16_t*>(&theme.colors);
+    JsonObjectConst colors = obj["colors"];
+    for (int i = 0; i < THEME_COLOR_COUNT; i++) {
+        JsonVariantConst value = colors[COLOR_KEYS[i]];
+        bool ok = false;
+        if (value.is<const char*>()) {
+            const char* text = value.as<const char*>();
+            char* end;
+            if (text[0] == '#' && strlen(text) == 7) {
+                uint32_t rgb = strtoul(text + 1, &end, 16);
+                if (*end == '\0') {
+                    slots[i] = rgbTo565(rgb);
+                    ok = true;
+                }
+            }
+        } else if (value.is<unsigned int>() && value.as<unsigned int>() <= 0xFFFF) {
+            slots[i] = value.as<unsigned int>();
+            ok = true;
+        }
+        if (!ok) {
+            error = String("Missing or invalid color: ") + COLOR_KEYS[i];
+            return false;
+        }
+    }
+    return true;
+}
+
+const ThemeColors* ThemeManager::find(const String& name) {
+    for (const auto& theme : _themes) {
+        if (name == theme.name) return &theme.colors;
+    }
+    return nullptr;
+}
+
+bool ThemeManager::importTheme(const String& json, String& error) {
+    JsonDocument doc;
+    if (deserializeJson(doc, json) || !doc.is<JsonObject>()) {
+        error = "Invalid JSON.";
+        return false;
+    }
+    ThemeDefinition theme;
+    if (!parseTheme(doc.as<JsonObjectConst>(), theme, error)) return false;
+
+    for (auto& existing : _themes) {
+        if (strcmp(existing.name, theme.name) != 0) continue;
+        if (existing.builtin) {
+            error = "Built-in themes cannot be replaced.";
+            return false;
+        }
+        existing = theme;
+        return save();
+    }
+    if (_themes.size() >= 2 + MAX_CUSTOM_THEMES) {
+        error = "Too many themes.";
+        return false;
+    }
+    _themes.push_back(theme);
+    return save();
+}
+
+bool ThemeManager::removeTheme(const String& name) {
+    for (size_t i = 0; i < _themes.size(); i++) {
+        if (name == _themes[i].name && !_themes[i].builtin) {
+            _themes.erase(_themes.begin() + i);
+            return save();
+        }
+    }
+    return false;
+}
+
+void ThemeManager::listThemes(JsonArray out) {
+    for (const auto& theme : _themes) {
+        JsonObject obj = out.add<JsonObject>();
+        obj["name"] = theme.name;
+        obj["builtin"] = theme.builtin;
+    }
+}
+
+bool ThemeManager::save() {
+    JsonDocument doc;
+    JsonArray array = doc.to<JsonArray>();
+    for (const auto& theme : _themes) {
+        if (theme.builtin) continue;
+        JsonObject obj = array.add<JsonObject>();
+        obj["name"] = theme.name;
+        JsonObject colors = obj["colors"].to<JsonObject>();
+        const uint16_t* slots = reinterpret_cast<const uint16_t*>(&theme.colors);
+        for (int i = 0; i < THEME_COLOR_COUNT; i++) {
+            char hex[8];
+            snprintf(hex, sizeof(hex), "#%06lX", (unsigned long)rgbFrom565(slots[i]));
+            colors[COLOR_KEYS[i]] = hex;
+        }
+    }
+    String content;
+    serializeJson(doc, content);
+    return AtomicFile::write(flashFS, THEMES_FILE, content);
+}
@@ -0,0 +1,164 @@
+#include "time_manager.h"
+#include "logger.h"
+#include "config.h"
+#include "esp_sntp.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+// Состояние синхронизации переживает deep sleep в RTC-памяти
+#define RTC_TIME_MAGIC 0x54494D45
+RTC_DATA_ATTR static uint32_t rtcTimeMagic = 0;
+RTC_DATA_ATTR static time_t rtcLastSyncEpoch = 0;
+RTC_DATA_ATTR static float rtcDriftPpm = 0.0f;
+RTC_DATA_ATTR static float rtcDriftWeight = 0.0f;
+
+static TimeManager* activeTimeManager = nullptr;
+
+TimeManager::TimeManager(ConfigManager& configManager) : _configManager(configManager) {}
+
+void TimeManager::begin() {
+    activeTimeManager = this;
+
+    // Калибровка дрейфа из прошлых сессий служит априорной оценкой
+    float driftPpm = 0.0f;
+    float driftWeight = 0.0f;
+    if (rtcTimeMagic == RTC_TIME_MAGIC) {
+        _lastSyncEpoch = rtcLastSyncEpoch;
+        driftPpm = rtcDriftPpm;
+        driftWeight = rtcDriftWeight;
+    } else {
+        _configManager.getTimeSync(_lastSyncEpoch, driftPpm, driftWeight);
+    }
+    _driftModel.setPrior(driftPpm, driftWeight);
+    _persistedSyncEpoch = _lastSyncEpoch;
+    _persistedDriftPpm = driftPpm;
+    _lastCorrectionMs = millis();
+
+    LOG_INFO("Time", "last sync %ld, drift %.2f ppm (%.1f h), time %s",
+                  (long)_lastSyncEpoch, driftPpm, driftWeight, isTimeValid() ? "valid" : "not set");
+
+    // Плавная подстройка часов вместо скачков и периодическая ресинхронизация
+    sntp_set_sync_mode(SNTP_SYNC_MODE_SMOOTH);
+    sntp_set_sync_interval(NTP_SYNC_INTERVAL_MS);
+    sntp_set_time_sync_notification_cb(TimeManager::onTimeSync);
+}
+
+void TimeManager::startSync() {
+    configTime(0, 0, NTP_SERVER);
+}
+
+void TimeManager::onTimeSync(struct timeval* tv) {
+    if (activeTimeManager) {
+        activeTimeManager->handleSync(tv);
+    }
+}
+
+void TimeManager::handleSync(const struct timeval* tv) {
+    // Модель сравнивает эталон с монотонным таймером: на него не влияют
+    // ни adjtime, ни settimeofday, поэтому виден чистый уход кварца
+    int64_t localUs = esp_timer_get_time();
+    int64_t referenceUs = (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec;
+
+    portENTER_CRITICAL(&_lock);
+    if (!_driftModel.addSample(localUs, referenceUs)) {
+        // Скачок эталона - начинаем наблюдение заново
+        _driftModel.resetSession();
+        _driftModel.addSample(localUs, referenceUs);
+    }
+    _lastSyncEpoch = tv->tv_sec;
+    _syncCount++;
+    _persistPending = true;
+    portEXIT_CRITICAL(&_lock);
+}
+
+bool TimeManager::setManualTime(time_t epoch) {
+    if (epoch <= MIN_VALID_EPOCH) {
+        return false;
+    }
+    struct timeval tv = {epoch, 0};
+    settimeofday(&tv, NULL);
+    _manualTimeSet = true;
+    _lastCorrectionMs = millis();
+    _pendingCorrectionUs = 0;
+    LOG_INFO("Time", "time set manually to %ld", (long)epoch);
+    return true;
+}
+
+float TimeManager::getDriftPpm() {
+    portENTER_CRITICAL(&_lock);
+    float drift = _driftModel.getDriftPpm();
+    portEXIT_CRITICAL(&_lock);
+    return drift;
+}
+
+void TimeManager::update() {
+    applyDriftCorrection();
+
+    if (_persistPending) {
+        _persistPending = false;
+        persist();
+    }
+}
+
+void TimeManager::applyDriftCorrection() {
+    unsigned long now = millis();
+    unsigned long elapsedMs = now - _lastCorrectionMs;
+    if (elapsedMs < DRIFT_CORRECTION_INTERVAL_MS) return;
+    _lastCorrectionMs = now;
+
+    // Пока SNTP подстраивает часы, не вмешиваемся: adjtime заменил бы его поправку
+    if (!isTimeValid() || sntp_get_sync_status() == SNTP_SYNC_STATUS_IN_PROGRESS) {
+        _pendingCorrectionUs = 0;
+        return;
+    }
+
+    // Программные часы: системное время плюс поправка по откалиброванному дрейфу.
+    // Без сети это единственный источник точности после ручной установки.
+    _pendingCorrectionUs += getDriftPpm() * (float)elapsedMs / 1000.0f;
+    long correctionUs = (long)_pendingCorrectionUs;
+    if (correctionUs == 0) return;
+    _pendingCorrectionUs -= correctionUs;
+
+    struct timeval delta = {0, correctionUs};
+    adjtime(&delta, NULL);
+}
+
+void TimeManager::persist() {
+    portENTER_CRITICAL(&_lock);
+    time_t lastSync = _lastSyncEpoch;
+    float drift = _driftModel.getDriftPpm();
+    float weight = _driftModel.getWeightHours();
+    portEXIT_CRITICAL(&_lock);
+
+    rtcLastSyncEpoch = lastSync;
+    rtcDriftPpm = drift;
+    rtcDriftWeight = weight;
+    rtcTimeMagic = RTC_TIME_MAGIC;
+
+    // Во флеш пишем редко: при первой синхронизации в сессии,
+    // при заметном изменении дрейфа или раз в сутки
+    bool firstSync = _persistedSyncEpoch == 0 || _syncCount == 1;
+    bool driftChanged = fabsf(drift - _persistedDriftPpm) >= DRIFT_PERSIST_DELTA_PPM;
+    bool stale = lastSync - _persistedSyncEpoch >= 86400;
+    if (firstSync || driftChanged || stale) {
+        _configManager.setTimeSync(lastSync, drift, weight);
+        _persistedSyncEpoch = lastSync;
+        _persistedDriftPpm = drift;
+    }
+}
+
+bool TimeManager::isTimeValid() {
+    return time(nullptr) > MIN_VALID_EPOCH;
+}
+
+TimeConfidence TimeManager::getConfidence() {
+    if (!isTimeValid()) {
+        return TimeConfidence::NONE;
+    }
+    // После deep sleep часы шли от неточного RTC-генератора,
+    // поэтому "SYNCED" только при синхронизации в текущей сессии
+    if (_syncCount > 0 && time(nullptr) - _lastSyncEpoch < TIME_CONFIDENCE_MAX_AGE_SEC) {
+        return TimeConfidence::SYNCED;
+    }
+    return TimeConfidence::ESTIMATED;
+}
@@ -1,58 +1,77 @@
 #include "totp_generator.h"
-#include "config.h"
+#include "secret_store.h"
 #include <mbedtls/md.h>
 #include <time.h>
+#include "metrics.h"
 
-String TOTPGenerator::generateTOTP(const String& base32Secret) {
-    uint8_t key[64];
-    size_t keyLen = base32Decode(base32Secret, key);
+String TOTPGenerator::generateTOTP(const String& base32Secret, uint8_t digits, uint32_t period, OtpAlgorithm algorithm) {
+    uint8_t key[TOTP_MAX_SECRET_BYTES];
+    size_t keyLen = base32Decode(base32Secret, key, sizeof(key));
 
     if (keyLen == 0) {
+        SecretStore::wipe(key, sizeof(key)); // При переполнении часть байт уже записана
         return "DECODE ERROR";
     }
 
+    String code = generateTOTP(key, keyLen, digits, period, algorithm);
+    SecretStore::wipe(key, sizeof(key));
+    return code;
+}
+
+String TOTPGenerator::generateTOTP(const uint8_t* key, size_t keyLen, uint8_t digits, uint32_t period, OtpAlgorithm algorithm) {
+    METRIC_TIMER_BEGIN(totp);
+    time_t now;
+    time(&now);
+    String code = generateCode(key, keyLen, now / period, digits, algorithm);
+    METRIC_TIMER_END(METRIC_TIMER_TOTP, totp);
+    METRIC_ADD(METRIC_TOTP_GENERATED, 1);
+    return code;
+}
+
+int TOTPGenerator::getTimeRemaining(uint32_t period) {
     time_t now;
     time(&now);
-    uint64_t timeStep = now / CONFIG_TOTP_STEP_SIZE;
+    return period - (now % period);
+}
 
-    uint8_t timeBytes[8];
+String TOTPGenerator::generateCode(const uint8_t* key, size_t keyLen, uint64_t counter, uint8_t digits, OtpAlgorithm algorithm) {
+    uint8_t counterBytes[8];
     for (int i = 7; i >= 0; i--) {
-        timeBytes[i] = timeStep & 0xFF;
-        timeStep >>= 8;
+        counterBytes[i] = counter & 0xFF;
+        counter >>= 8;
     }
 
-    uint8_t hash[20];
-    hmacSha1(key, keyLen, timeBytes, 8, hash);
+    uint8_t hash[64];
+    size_t hashLen = hmac(algorithm, key, keyLen, counterBytes, 8, hash);
 
-    uint32_t code = dynamicTruncation(hash);
-    
-    code %= 1000000; // 6-значный код
+    uint32_t code = dynamicTruncation(hash, hashLen);
+    if (digits > 9) digits = 9; // 31 бит кода - не больше 9 значащих цифр
+    uint32_t modulus = 1;
+    for (int i = 0; i < digits; i++) modulus *= 10;
+    code %= modulus;
 
-    char codeStr[7];
-    sprintf(codeStr, "%06d", code);
+    char codeStr[11];
+    snprintf(codeStr, sizeof(codeStr), "%0*u", (int)digits, (unsigned)code);
     return String(codeStr);
 }
 
-int TOTPGenerator::getTimeRemaining() {
-    time_t now;
-    time(&now);
-    return CONFIG_TOTP_STEP_SIZE - (now % CONFIG_TOTP_STEP_SIZE);
-}
-
-void TOTPGenerator::hmacSha1(const uint8_t* key, size_t keyLen, const uint8_t* data, size_t dataLen, uint8_t* output) {
+size_t TOTPGenerator::hmac(OtpAlgorithm algorithm, const uint8_t* key, size_t keyLen, const uint8_t* data, size_t dataLen, uint8_t* output) {
+    mbedtls_md_type_t type = algorithm == OtpAlgorithm::SHA256 ? MBEDTLS_MD_SHA256
+                           : algorithm == OtpAlgorithm::SHA512 ? MBEDTLS_MD_SHA512 : MBEDTLS_MD_SHA1;
     mbedtls_md_context_t ctx;
-    const mbedtls_md_info_t* md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA1);
+    const mbedtls_md_info_t* md_info = mbedtls_md_info_from_type(type);
     
     mbedtls_md_init(&ctx);
     mbedtls_md_setup(&ctx, md_info, 1); // 1 for HMAC
     mbedtls_md_hmac_starts(&ctx, key, keyLen);
     mbedtls_md_hmac_update(&ctx, data, dataLen);
     mbedtls_md_hmac_finish(&ctx, output);
-    mbedtls_md_free(&ctx);
+    mbedtls_md_free(&ctx); // Затирает внутренние блоки HMAC с ключом
+    return mbedtls_md_get_size(md_info);
 }
 
-uint32_t TOTPGenerator::dynamicTruncation(uint8_t* hash) {
-    int offset = hash[19] & 0x0F;
+uint32_t TOTPGenerator::dynamicTruncation(const uint8_t* hash, size_t hashLen) {
+    int offset = hash[hashLen - 1] & 0x0F;
     return ((hash[offset] & 0x7F) << 24) |
            ((hash[offset + 1] & 0xFF) << 16) |
            ((hash[offset + 2] & 0xFF) << 8) |
@@ -60,7 +79,7 @@ uint32_t TOTPGenerator::dynamicTruncation(uint8_t* hash) {
 }
 
 // Улучшенная реализация декодирования Base32: гибкая и корректная.
-size_t TOTPGenerator::base32Decode(const String& base32, uint8_t* output) {
+size_t TOTPGenerator::base32Decode(const String& base32, uint8_t* output, size_t maxLen) {
     const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
     int buffer = 0;
     int bitsLeft = 0;
@@ -78,18 +97,37 @@ size_t TOTPGenerator::base32Decode(const String& base32, uint8_t* output) {
         }
 
         const char* p = strchr(table, c);
-        if (p == nullptr) {
+        if (p == nullptr || c == '\0') {
             // Если символ не в таблице (например, дефис), пропускаем его
             continue;
         }
 
-        buffer = (buffer << 5) | (p - table);
+        buffer = ((buffer << 5) | (p - table)) & 0xFFF; // Хватает на 12 бит до выдачи байта
         bitsLeft += 5;
 
         if (bitsLeft >= 8) {
+            if (count == maxLen) return 0; // Секрет длиннее буфера
             output[count++] = (buffer >> (bitsLeft - 8)) & 0xFF;
             bitsLeft -= 8;
         }
     }
     return count;
-}
\ No newline at end of file
+}
+
+String TOTPGenerator::base32Encode(const uint8_t* data, size_t length) {
+    const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+    String out;
+    out.reserve((length * 8 + 4) / 5);
+    uint32_t buffer = 0;
+    int bitsLeft = 0;
+    for (size_t i = 0; i < length; i++) {
+        buffer = (buffer << 8) | data[i];
+        bitsLeft += 8;
+        while (bitsLeft >= 5) {
+            out += table[(buffer >> (bitsLeft - 5)) & 0x1F];
+            bitsLeft -= 5;
+        }
+    }
+    if (bitsLeft > 0) out += table[(buffer << (5 - bitsLeft)) & 0x1F];
+    return out;
+}
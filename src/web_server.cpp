@@ -2,79 +2,307 @@
 #include <ArduinoJson.h>
 #include "config.h"
 #include <FS.h>
-#include "LittleFS.h"
+#include "flash_fs.h"
 #include "WiFi.h"
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include "rate_limiter.h"
+#include "metrics.h"
+#include "logger.h"
 #include "totp_generator.h"
+#include "otpauth.h"
+#include "qr_code.h"
+#include "migration_payload.h"
+#include "backup_file.h"
+#include "keys_response.h"
+#include <memory>
+#include <algorithm>
 #include "crypto_manager.h"
-#include "web_pages/page_login.h"
-#include "web_pages/page_index.h"
-#include "web_pages/page_wifi_setup.h"
-#include "web_pages/page_pin_settings.h"
+// Страницы сжимаются при сборке скриптом scripts/gzip_web_pages.py
+#include "web_pages/generated/login_html_gz.h"
+#include "web_pages/generated/index_html_gz.h"
+#include "web_pages/generated/wifi_setup_html_gz.h"
+#include "web_pages/generated/pin_settings_html_gz.h"
 
 AsyncWebServer server(WEB_SERVER_PORT);
+AsyncEventSource events("/api/events");
 KeyManager* pKeyManager;
 SplashScreenManager* pSplashManager;
 DisplayManager* pDisplayManager;
 PinManager* pPinManager;
 ConfigManager* pConfigManager; // New: Global pointer to ConfigManager
-TOTPGenerator webTotpGenerator;
+TimeManager* pTimeManager;
+WifiManager* pWifiManager;
+ThemeManager* pThemeManager;
+RateLimiter rateLimiter(WEB_RATE_CAPACITY, WEB_RATE_REFILL_PER_SEC, WEB_MAX_IN_FLIGHT, WEB_MIN_FREE_HEAP, WEB_MIN_HEAP_BLOCK);
 
-WebServerManager::WebServerManager(KeyManager& keyManager, SplashScreenManager& splashManager, DisplayManager& displayManager, PinManager& pinManager, ConfigManager& configManager) {
+// Состояние допущенного запроса между обработчиками загрузки и итоговым
+// обработчиком (request->_tempObject). Удаляется при отключении клиента:
+// деструктор запроса сам сделал бы только free().
+struct RequestState {
+    virtual ~RequestState() {}
+};
+
+// Загрузка /api/restore: ключи копятся до проверки манифеста
+struct RestoreState : RequestState {
+    std::unique_ptr<BackupReader> reader;
+    std::vector<TOTPKey> keys;
+    ~RestoreState() {
+        for (auto& key : keys) SecretStore::wipe(key.secret);
+    }
+};
+
+// Тело /api/export: "[", ключи через запятую, "]". В памяти - одна запись.
+class ExportStream {
+public:
+    ~ExportStream() { SecretStore::wipe(_pending); }
+
+    size_t read(uint8_t* buffer, size_t maxLen) {
+        size_t written = 0;
+        while (written < maxLen) {
+            if (_offset == _pending.length()) {
+                SecretStore::wipe(_pending);
+                _offset = 0;
+                if (!nextRecord()) break;
+            }
+            size_t count = std::min(maxLen - written, (size_t)(_pending.length() - _offset));
+            memcpy(buffer + written, _pending.c_str() + _offset, count);
+            _offset += count;
+            written += count;
+        }
+        return written;
+    }
+
+private:
+    int _next = 0;
+    bool _closed = false;
+    String _pending;
+    size_t _offset = 0;
+
+    bool nextRecord() {
+        if (_closed) return false;
+        TOTPKey key;
+        if (!pKeyManager->exportKey(_next, key)) {
+            _pending = _next == 0 ? "[]" : "]";
+            _closed = true;
+            return true;
+        }
+        JsonDocument doc;
+        KeyManager::keyToJson(key, doc.to<JsonObject>());
+        SecretStore::wipe(key.secret);
+        String record;
+        serializeJson(doc, record);
+        KeyManager::wipeSecret(doc.as<JsonObject>());
+        _pending = _next++ == 0 ? "[" : ",";
+        _pending += record;
+        SecretStore::wipe(record);
+        return true;
+    }
+};
+
+// Итерации PBKDF2 для резервной копии на этом устройстве, калибруются при первом обращении.
+// От них же считается предел при восстановлении (BACKUP_KDF_IMPORT_FACTOR).
+static uint32_t backupIterations() {
+    static uint32_t iterations = 0;
+    if (iterations == 0) {
+        iterations = std::min((uint32_t)BACKUP_KDF_MAX_ITERATIONS,
+                              CryptoManager::calibrateIterations(BACKUP_KDF_TARGET_MS, BACKUP_KDF_MIN_ITERATIONS));
+        LOG_INFO("Web", "backup KDF: %lu iterations", (unsigned long)iterations);
+    }
+    return iterations;
+}
+
+#if METRICS_ENABLED
+// Маршруты обоих режимов (панель и точка доступа настройки). Запросы к прочим
+// путям (404, сканеры) идут в строку "other" и не занимают таблицу метрик.
+static const char* const METRIC_ROUTES[] = {
+    "/", "/login", "/logout", "/pin", "/scan", "/settime", "/save",
+    "/api/events", "/api/keys", "/api/add", "/api/remove", "/api/export", "/api/import",
+    "/api/import_uris", "/api/backup", "/api/restore", "/api/show_qr", "/api/change_password",
+    "/api/upload_splash", "/api/delete_splash", "/api/pincode_settings", "/api/theme",
+    "/api/theme_upload", "/api/theme_delete", "/api/reboot", "/api/metrics", "/api/logs",
+};
+
+static const char* metricRoute(const String& url) {
+    for (const char* route : METRIC_ROUTES) {
+        if (url == route) return route;
+    }
+    return nullptr;
+}
+#endif
+
+static void releaseRequestState(AsyncWebServerRequest *request) {
+    delete (RequestState*)request->_tempObject;
+    request->_tempObject = nullptr;
+}
+
+// Первый обработчик сервера: решает, допускать ли запрос, до разбора тела
+// и до обработчиков, выделяющих память. Отказ отвечает 429/503 сам,
+// допущенный запрос уходит дальше к обычным обработчикам.
+class RequestGuard : public AsyncWebHandler {
+public:
+    bool canHandle(AsyncWebServerRequest *request) override {
+        const String& url = request->url();
+        METRIC_WEB_REQUEST(metricRoute(url));
+        bool isStream = url == "/api/events"; // Подписчиков ограничивает MAX_EVENT_CLIENTS
+        bool isHeavy = url == "/scan" || url == "/api/import" || url == "/api/import_uris" || url == "/api/export" ||
+                       url == "/api/backup" || url == "/api/restore" || url == "/api/logs";
+
+        Admission admission = rateLimiter.admit((uint32_t)request->client()->remoteIP(),
+                                                isHeavy ? WEB_HEAVY_REQUEST_COST : 1, millis(),
+                                                ESP.getFreeHeap(), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+                                                !isStream);
+        if (admission == Admission::ALLOW) {
+            if (!isStream) {
+                request->onDisconnect([request]() {
+                    rateLimiter.release();
+                    releaseRequestState(request);
+                });
+            }
+            return false;
+        }
+
+        // Решение хранится в самом запросе: между canHandle и handleRequest
+        // успевают прийти другие запросы. Память освободит деструктор запроса.
+        request->_tempObject = malloc(sizeof(Admission));
+        if (request->_tempObject) *(Admission*)request->_tempObject = admission;
+        return true;
+    }
+
+    void handleRequest(AsyncWebServerRequest *request) override {
+        bool isRateLimited = request->_tempObject && *(Admission*)request->_tempObject == Admission::RATE_LIMITED;
+        AsyncWebServerResponse *response = isRateLimited
+            ? request->beginResponse(429, "text/plain", "Too many requests")
+            : request->beginResponse(503, "text/plain", "Server busy");
+        response->addHeader("Retry-After", isRateLimited ? "1" : "2");
+        request->send(response);
+    }
+
+    // Тело отклоненного запроса (например, загрузки) не принимается
+    bool isRequestHandlerTrivial() override { return true; }
+};
+
+RequestGuard requestGuard;
+bool isRequestGuardInstalled = false;
+
+static void installRequestGuard() {
+    if (isRequestGuardInstalled) return;
+    server.addHandler(&requestGuard);
+    isRequestGuardInstalled = true;
+}
+
+WebServerManager::WebServerManager(KeyManager& keyManager, SplashScreenManager& splashManager, DisplayManager& displayManager, PinManager& pinManager, ConfigManager& configManager, TimeManager& timeManager, WifiManager& wifiManager, ThemeManager& themeManager) {
     pKeyManager = &keyManager;
     pSplashManager = &splashManager;
     pDisplayManager = &displayManager;
     pPinManager = &pinManager;
     pConfigManager = &configManager; // Initialize new pointer
-    session_created_time = 0;
+    pTimeManager = &timeManager;
+    pWifiManager = &wifiManager;
+    pThemeManager = &themeManager;
 }
 
-String WebServerManager::getAdminPasswordHash() {
-    if (LittleFS.exists("/auth.json")) {
-        fs::File authFile = LittleFS.open("/auth.json", "r");
-        if (authFile) {
-            JsonDocument doc;
-            deserializeJson(doc, authFile);
-            authFile.close();
-            if (!doc["password_hash"].isNull()) {
-                return doc["password_hash"].as<String>();
-            }
+// Отдает сжатую страницу; если у браузера та же версия - только 304
+static void sendAsset(AsyncWebServerRequest *request, const WebAsset& asset) {
+    AsyncWebHeader* ifNoneMatch = request->getHeader("If-None-Match");
+    if (ifNoneMatch && ifNoneMatch->value().equals(asset.etag)) {
+        AsyncWebServerResponse *response = request->beginResponse(304);
+        response->addHeader("ETag", asset.etag);
+        request->send(response);
+        return;
+    }
+
+    AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", asset.data, asset.length);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("ETag", asset.etag);
+    // Кэш можно использовать только после проверки ETag на устройстве
+    response->addHeader("Cache-Control", "private, no-cache");
+    request->send(response);
+}
+
+// --- УЧЕТНЫЕ ДАННЫЕ АДМИНИСТРАТОРА ---
+// /auth.json разбирается один раз (ConfigManager); дальше вход проверяется по записи в памяти
+void WebServerManager::loadAdminCredentials() {
+    adminRecord.iterations = 0;
+    legacyAdminHash = "";
+
+    pConfigManager->readSection(ConfigSection::AUTH, [this](const JsonDocument& doc) {
+        if (CryptoManager::fromHex(doc["salt"] | "", adminRecord.salt, KDF_SALT_LENGTH) &&
+            CryptoManager::fromHex(doc["hash"] | "", adminRecord.hash, KDF_HASH_LENGTH)) {
+            adminRecord.iterations = doc["iterations"] | 0;
+            if (adminRecord.iterations > 0) return;
+        }
+        // Формат до PBKDF2: переводится на новую запись при первом успешном входе
+        if (!doc["password_hash"].isNull()) {
+            legacyAdminHash = doc["password_hash"].as<String>();
         }
+    });
+
+    // Файла нет - пароль из прошивки, запись только в памяти
+    if (adminRecord.iterations == 0 && legacyAdminHash.length() == 0) {
+        setAdminPassword(ADMIN_PASSWORD);
     }
-    return CryptoManager::hashPassword(ADMIN_PASSWORD);
 }
 
-// --- УЛУЧШЕННАЯ ЛОГИКА АУТЕНТИФИКАЦИИ НА ОСНОВЕ СЕССИИ ---
-bool WebServerManager::isAuthenticated(AsyncWebServerRequest *request) {
-    // Проверка тайм-аута сессии
-    if (session_id.length() > 0 && (millis() - session_created_time > SESSION_TIMEOUT)) {
-        session_id = "";
-        session_created_time = 0;
+// Учетные данные пишутся сразу, а не с задержкой
+bool WebServerManager::saveAdminCredentials() {
+    return pConfigManager->writeSection(ConfigSection::AUTH, [this](JsonDocument& doc) {
+        doc.clear();
+        doc["kdf"] = "pbkdf2-sha256";
+        doc["iterations"] = adminRecord.iterations;
+        doc["salt"] = CryptoManager::toHex(adminRecord.salt, KDF_SALT_LENGTH);
+        doc["hash"] = CryptoManager::toHex(adminRecord.hash, KDF_HASH_LENGTH);
+    }, true);
+}
+
+void WebServerManager::setAdminPassword(const String& password) {
+    uint32_t iterations = CryptoManager::calibrateIterations(ADMIN_KDF_TARGET_MS, KDF_MIN_ITERATIONS);
+    CryptoManager::createPasswordRecord(password, iterations, adminRecord);
+    legacyAdminHash = "";
+    LOG_INFO("Web", "admin KDF: %lu iterations for ~%d ms", (unsigned long)iterations, ADMIN_KDF_TARGET_MS);
+}
+
+bool WebServerManager::verifyAdminPassword(const String& password) {
+    if (legacyAdminHash.length() > 0) {
+        if (!CryptoManager::verifyPassword(password, legacyAdminHash)) return false;
+        setAdminPassword(password);
+        saveAdminCredentials();
+        LOG_INFO("Web", "admin password migrated to PBKDF2");
+        return true;
     }
-    
+
+    int64_t start = esp_timer_get_time();
+    bool ok = CryptoManager::verifyPasswordRecord(password, adminRecord);
+    uint32_t elapsedMs = (esp_timer_get_time() - start) / 1000;
+
+    // Стоимость запроса = стоимость одной попытки подбора на этом устройстве
+    LOG_INFO("Web", "login verify: %lu ms, %lu iterations (~%.1f guesses/s per device)",
+             (unsigned long)elapsedMs, (unsigned long)adminRecord.iterations,
+             elapsedMs > 0 ? 1000.0f / elapsedMs : 0.0f);
+    return ok;
+}
+
+// --- АУТЕНТИФИКАЦИЯ ПО ТАБЛИЦЕ СЕССИЙ ---
+// Вызывается на каждый запрос и каждый чанк загрузки, поэтому работает
+// прямо по строкам заголовков, без копирования и выделения памяти
+bool WebServerManager::isAuthenticated(AsyncWebServerRequest *request) {
+    const char* token;
+    size_t length;
+
     // Проверка Cookie
-    if (request->hasHeader("Cookie")) {
-        String cookie = request->getHeader("Cookie")->value();
-        int sessionPos = cookie.indexOf("session=");
-        if (sessionPos != -1) {
-            int sessionStart = sessionPos + 8;
-            int sessionEnd = cookie.indexOf(";", sessionStart);
-            if (sessionEnd == -1) sessionEnd = cookie.length();
-            
-            String sessionFromCookie = cookie.substring(sessionStart, sessionEnd);
-            if (sessionFromCookie.length() > 0 && sessionFromCookie.equals(session_id)) {
-                return true;
-            }
+    AsyncWebHeader* cookie = request->getHeader("Cookie");
+    if (cookie && SessionManager::findCookie(cookie->value().c_str(), "session", &token, &length)) {
+        if (sessions.validate(token, length)) {
+            return true;
         }
     }
     
     // Проверка Authorization header (для загрузки файлов)
-    if (request->hasHeader("Authorization")) {
-        String auth = request->getHeader("Authorization")->value();
-        if (auth.startsWith("Bearer ")) {
-            String token = auth.substring(7);
-            if (token.length() > 0 && token.equals(session_id)) {
-                return true;
-            }
+    AsyncWebHeader* auth = request->getHeader("Authorization");
+    if (auth) {
+        const String& value = auth->value();
+        if (value.startsWith("Bearer ")) {
+            return sessions.validate(value.c_str() + 7, value.length() - 7);
         }
     }
     
@@ -82,11 +310,14 @@ bool WebServerManager::isAuthenticated(AsyncWebServerRequest *request) {
 }
 
 void WebServerManager::start() {
+    installRequestGuard();
+    loadAdminCredentials();
+
     // --- ЭНДПОИНТЫ, НЕ ТРЕБУЮЩИЕ АУТЕНТИФИКАЦИИ ---
 
     // Страница входа
     server.on("/login", HTTP_GET, [](AsyncWebServerRequest *request){
-        request->send_P(200, "text/html", login_html);
+        sendAsset(request, login_html_asset);
     });
 
     // Обработка данных формы входа
@@ -95,14 +326,13 @@ void WebServerManager::start() {
             String username = request->getParam("username", true)->value();
             String password = request->getParam("password", true)->value();
             
-            if (username.equals(ADMIN_USERNAME) && CryptoManager::verifyPassword(password, getAdminPasswordHash())) {
-                // Генерируем новую сессию
-                session_id = String(random(0, 0x7FFFFFFF), HEX) + String(random(0, 0x7FFFFFFF), HEX);
-                session_created_time = millis();
+            if (username.equals(ADMIN_USERNAME) && verifyAdminPassword(password)) {
+                // Новая сессия в таблице; остальные браузеры остаются в системе
+                const char* token = sessions.create();
                 
                 AsyncWebServerResponse *response = request->beginResponse(302, "text/plain", "Found");
                 response->addHeader("Location", "/");
-                response->addHeader("Set-Cookie", "session=" + session_id + "; Path=/; HttpOnly");
+                response->addHeader("Set-Cookie", String("session=") + token + "; Path=/; HttpOnly");
                 request->send(response);
                 return;
             }
@@ -121,13 +351,18 @@ void WebServerManager::start() {
             request->redirect("/login");
             return;
         }
-        request->send_P(200, "text/html", index_html);
+        sendAsset(request, index_html_asset);
     });
     
     // Выход из системы
     server.on("/logout", HTTP_GET, [this](AsyncWebServerRequest *request){
-        session_id = ""; // Сбрасываем сессию
-        session_created_time = 0;
+        // Завершаем только сессию этого браузера
+        AsyncWebHeader* cookie = request->getHeader("Cookie");
+        const char* token;
+        size_t length;
+        if (cookie && SessionManager::findCookie(cookie->value().c_str(), "session", &token, &length)) {
+            sessions.revoke(token, length);
+        }
         request->redirect("/login");
     });
 
@@ -136,12 +371,10 @@ void WebServerManager::start() {
         if (!isAuthenticated(request)) return request->send(401);
         if (request->hasParam("password", true)) {
             String newPassword = request->getParam("password", true)->value();
-            String newHash = CryptoManager::hashPassword(newPassword);
-            fs::File authFile = LittleFS.open("/auth.json", "w");
-            JsonDocument doc;
-            doc["password_hash"] = newHash;
-            serializeJson(doc, authFile);
-            authFile.close();
+            setAdminPassword(newPassword);
+            if (!saveAdminCredentials()) {
+                return request->send(500, "text/plain", "Failed to save password.");
+            }
             request->send(200, "text/plain", "Password changed successfully!");
         } else {
             request->send(400, "text/plain", "Password parameter missing.");
@@ -159,19 +392,19 @@ void WebServerManager::start() {
         [this](AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool is_final){
             // Проверяем аутентификацию на каждом чанке
             if (!isAuthenticated(request)) {
-                Serial.println("Upload chunk rejected: not authenticated");
+                LOG_WARN("Web", "upload chunk rejected: not authenticated");
                 return;
             }
             
-            static fs::File splashFile;
+            static FlashFile splashFile;
             static bool uploadError = false;
             
             if(index == 0){
                 uploadError = false;
-                Serial.println("Starting splash upload: " + filename);
-                splashFile = LittleFS.open(SPLASH_IMAGE_PATH, "w");
+                LOG_INFO("Web", "splash upload started: %s", filename.c_str());
+                splashFile = flashFS.open(SPLASH_IMAGE_PATH, "w");
                 if(!splashFile){ 
-                    Serial.println("Failed to open splash file for writing");
+                    LOG_ERROR("Web", "failed to open splash file for writing");
                     uploadError = true;
                     return; 
                 }
@@ -180,7 +413,7 @@ void WebServerManager::start() {
             if(len > 0 && splashFile && !uploadError){ 
                 size_t written = splashFile.write(data, len);
                 if (written != len) {
-                    Serial.println("Write error during upload");
+                    LOG_ERROR("Web", "write error during splash upload");
                     uploadError = true;
                 }
             }
@@ -189,10 +422,10 @@ void WebServerManager::start() {
                 if(splashFile) {
                     splashFile.close();
                     if (!uploadError) {
-                        Serial.println("Splash upload completed successfully");
+                        LOG_INFO("Web", "splash upload completed");
                     } else {
-                        Serial.println("Splash upload completed with errors");
-                        LittleFS.remove(SPLASH_IMAGE_PATH); // Удаляем поврежденный файл
+                        LOG_WARN("Web", "splash upload failed, file removed");
+                        flashFS.remove(SPLASH_IMAGE_PATH); // Удаляем поврежденный файл
                     }
                 }
             }
@@ -208,26 +441,76 @@ void WebServerManager::start() {
         }
     });
 
+    // Компактный список (формат в keys_response.h): общий шаг и остаток времени,
+    // имена, группы и коды по индексу. С ?since=<rev> возвращает только изменения
+    // после этой версии, а при совпадении If-None-Match (версия + шаг) - 304 без тела.
+    // С ?q=<текст> - только ключи, чье имя начинается с текста или чья группа
+    // равна ему: индексы, имена, группы, периоды и коды (коды считаются лишь для них).
     server.on("/api/keys", HTTP_GET, [this](AsyncWebServerRequest *request){
         if (!isAuthenticated(request)) return request->send(401);
+        time_t now = time(nullptr);
+        uint32_t revision = pKeyManager->getRevision();
+
+        if (request->hasParam("q") && !request->getParam("q")->value().isEmpty()) {
+            std::vector<int> matches;
+            pKeyManager->findMatching(request->getParam("q")->value(), matches);
+            JsonDocument doc;
+            KeysResponse::header(doc, revision, now);
+            JsonArray indices = doc["indices"].to<JsonArray>();
+            JsonArray names = doc["names"].to<JsonArray>();
+            JsonArray groups = doc["groups"].to<JsonArray>();
+            JsonArray periods = doc["periods"].to<JsonArray>();
+            JsonArray codes = doc["codes"].to<JsonArray>();
+            for (int index : matches) {
+                TOTPKey key;
+                if (!pKeyManager->getKey(index, key)) continue;
+                indices.add(index);
+                names.add(key.name);
+                groups.add(key.group);
+                periods.add(key.period);
+                codes.add(pKeyManager->computeCode(index));
+            }
+            String output;
+            serializeJson(doc, output);
+            AsyncWebServerResponse *response = request->beginResponse(200, "application/json", output);
+            response->addHeader("Cache-Control", "private, no-cache");
+            return request->send(response);
+        }
+
+        String etag = KeysResponse::etag(revision, now);
+        AsyncWebHeader* ifNoneMatch = request->getHeader("If-None-Match");
+        if (ifNoneMatch && ifNoneMatch->value().equals(etag)) {
+            AsyncWebServerResponse *response = request->beginResponse(304);
+            response->addHeader("ETag", etag);
+            return request->send(response);
+        }
+
+        KeyManager* keyManager = pKeyManager;
+        auto code = [keyManager](int index) { return keyManager->computeCode(index); };
         auto keys = pKeyManager->getAllKeys();
         JsonDocument doc;
-        JsonArray array = doc.to<JsonArray>();
-        for (const auto& key : keys) {
-            JsonObject obj = array.add<JsonObject>();
-            obj["name"] = key.name;
-            obj["code"] = webTotpGenerator.generateTOTP(key.secret);
-            obj["timeLeft"] = webTotpGenerator.getTimeRemaining();
+        std::vector<KeyChange> changes;
+        if (request->hasParam("since") &&
+            pKeyManager->getChangesSince(strtoul(request->getParam("since")->value().c_str(), NULL, 10), changes)) {
+            KeysResponse::delta(doc, revision, now, changes, keys.size(), code);
+        } else {
+            KeysResponse::full(doc, revision, now, keys, code);
         }
+
         String output;
         serializeJson(doc, output);
-        request->send(200, "application/json", output);
+        AsyncWebServerResponse *response = request->beginResponse(200, "application/json", output);
+        response->addHeader("ETag", etag);
+        response->addHeader("Cache-Control", "private, no-cache");
+        request->send(response);
     });
 
     server.on("/api/add", HTTP_POST, [this](AsyncWebServerRequest *request){
         if (!isAuthenticated(request)) return request->send(401);
         if (request->hasParam("name", true) && request->hasParam("secret", true)) {
-            pKeyManager->addKey(request->getParam("name", true)->value(), request->getParam("secret", true)->value());
+            String group = request->hasParam("group", true) ? request->getParam("group", true)->value() : "";
+            group.trim();
+            pKeyManager->addKey(request->getParam("name", true)->value(), request->getParam("secret", true)->value(), group);
             request->send(200);
         } else { request->send(400); }
     });
@@ -240,19 +523,15 @@ void WebServerManager::start() {
         } else { request->send(400); }
     });
 
+    // Экспорт идет по блокам, как резервная копия: JSON с секретами целиком в
+    // памяти не собирается, запись ключа затирается, как только скопирована в ответ
     server.on("/api/export", HTTP_GET, [this](AsyncWebServerRequest *request){
         if (!isAuthenticated(request)) return request->send(401);
-        auto keys = pKeyManager->getAllKeys();
-        JsonDocument doc;
-        JsonArray array = doc.to<JsonArray>();
-        for (const auto& key : keys) {
-            JsonObject obj = array.add<JsonObject>();
-            obj["name"] = key.name;
-            obj["secret"] = key.secret;
-        }
-        String output;
-        serializeJson(doc, output);
-        AsyncWebServerResponse *response = request->beginResponse(200, "application/json", output);
+        auto stream = std::make_shared<ExportStream>();
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+            [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return stream->read(buffer, maxLen);
+            });
         response->addHeader("Content-Disposition", "attachment; filename=\"keys_backup.json\"");
         request->send(response);
     });
@@ -269,26 +548,194 @@ void WebServerManager::start() {
             for(size_t i=0; i<len; i++) content += (char)data[i];
             if(is_final) {
                 if(!pKeyManager->replaceAllKeys(content)) {
-                    Serial.println("Import failed!");
+                    LOG_ERROR("Web", "key import failed");
                 }
+                SecretStore::wipe(content);
+            }
+        }
+    );
+
+    // Зашифрованная резервная копия (формат в backup_file.h). Ответ идет по
+    // блокам: ключи читаются по одному, пока клиент принимает данные.
+    server.on("/api/backup", HTTP_POST, [this](AsyncWebServerRequest *request){
+        if (!isAuthenticated(request)) return request->send(401);
+        if (!request->hasParam("passphrase", true) ||
+            request->getParam("passphrase", true)->value().length() < BACKUP_MIN_PASSPHRASE) {
+            return request->send(400, "text/plain", "Passphrase must be at least 8 characters.");
+        }
+        KeyManager* keyManager = pKeyManager;
+        int next = 0;
+        auto writer = std::make_shared<BackupWriter>(request->getParam("passphrase", true)->value(), backupIterations(),
+            [keyManager, next](String& record) mutable {
+                TOTPKey key;
+                if (!keyManager->exportKey(next++, key)) return false;
+                JsonDocument doc;
+                KeyManager::keyToJson(key, doc.to<JsonObject>());
+                serializeJson(doc, record); // Запись затирает BackupWriter
+                KeyManager::wipeSecret(doc.as<JsonObject>());
+                SecretStore::wipe(key.secret);
+                return true;
+            });
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/octet-stream",
+            [writer](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return writer->read(buffer, maxLen);
+            });
+        response->addHeader("Content-Disposition", "attachment; filename=\"keys_backup.tbk\"");
+        request->send(response);
+    });
+
+    // Восстановление из копии. Поле passphrase должно идти в форме раньше файла:
+    // файл расшифровывается по мере приема, а ключи применяются, только когда
+    // сошелся манифест. mode=merge сливает с текущими ключами, иначе они заменяются.
+    // Расшифровщик и ключи у каждой загрузки свои (RestoreState в запросе).
+    server.on("/api/restore", HTTP_POST,
+        [this](AsyncWebServerRequest *request){
+            if (!isAuthenticated(request)) return request->send(401);
+            RestoreState* state = (RestoreState*)request->_tempObject;
+            if (!state || !state->reader) return request->send(400, "text/plain", "Backup file or passphrase missing.");
+            if (!state->reader->finish()) {
+                request->send(400, "text/plain", state->reader->error());
+            } else if (request->hasParam("mode", true) && request->getParam("mode", true)->value() == "merge") {
+                std::vector<int> duplicates, rejected;
+                int added = pKeyManager->mergeKeys(state->keys, duplicates, rejected);
+                String message = "Restored " + String(added) + " keys, skipped " + String(duplicates.size()) + " duplicates.";
+                if (!rejected.empty()) message += " " + String(rejected.size()) + " keys could not be stored.";
+                request->send(rejected.empty() ? 200 : 500, "text/plain", message);
+            } else if (pKeyManager->replaceAllKeys(state->keys)) {
+                request->send(200, "text/plain", "Restored " + String(state->keys.size()) + " keys.");
+            } else {
+                request->send(500, "text/plain", "Failed to save keys.");
+            }
+            releaseRequestState(request);
+        },
+        [this](AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool is_final){
+            if (!isAuthenticated(request)) return;
+            if (index == 0) {
+                releaseRequestState(request); // Второй файл в той же форме начинает заново
+                if (!request->hasParam("passphrase", true)) return;
+                RestoreState* state = new RestoreState();
+                request->_tempObject = state;
+                uint32_t maxIterations = backupIterations() * BACKUP_KDF_IMPORT_FACTOR;
+                state->reader.reset(new BackupReader(request->getParam("passphrase", true)->value(), maxIterations,
+                    [state](const String& record) {
+                        JsonDocument doc;
+                        if (deserializeJson(doc, record) || !doc.is<JsonObject>()) return false;
+                        TOTPKey key;
+                        KeyManager::keyFromJson(doc.as<JsonObjectConst>(), key);
+                        KeyManager::wipeSecret(doc.as<JsonObject>());
+                        uint8_t secret[TOTP_MAX_SECRET_BYTES];
+                        bool valid = !key.name.isEmpty() && TOTPGenerator::base32Decode(key.secret, secret, sizeof(secret)) > 0;
+                        SecretStore::wipe(secret, sizeof(secret));
+                        if (valid) state->keys.push_back(key);
+                        SecretStore::wipe(key.secret);
+                        return valid;
+                    }));
+            }
+            RestoreState* state = (RestoreState*)request->_tempObject;
+            if (state && state->reader->error().isEmpty() && !state->reader->feed(data, len)) {
+                LOG_WARN("Web", "restore failed: %s", state->reader->error().c_str());
             }
         }
     );
 
+    // Массовый импорт: по одному otpauth:// или otpauth-migration:// (экспорт
+    // Google Authenticator) URI в строке. Ключи сливаются с текущими одним
+    // сохранением, повторы по имени или секрету пропускаются; строки и записи
+    // с ошибками перечисляются в ответе.
+    server.on("/api/import_uris", HTTP_POST, [this](AsyncWebServerRequest *request){
+        if (!isAuthenticated(request)) return request->send(401);
+        if (!request->hasParam("uris", true)) return request->send(400, "text/plain", "URIs parameter missing.");
+        const String& text = request->getParam("uris", true)->value();
+
+        JsonDocument doc;
+        JsonArray errors = doc["errors"].to<JsonArray>();
+        std::vector<TOTPKey> newKeys;
+        std::vector<int> lines;
+        int line = 0;
+        for (int start = 0; start < (int)text.length(); line++) {
+            int end = text.indexOf('\n', start);
+            if (end < 0) end = text.length();
+            String uri = text.substring(start, end);
+            start = end + 1;
+            uri.trim();
+            if (uri.isEmpty()) continue;
+
+            OtpAuthParams params;
+            TOTPKey key;
+            String error;
+            if (MigrationPayload::isMigrationUri(uri)) {
+                std::vector<String> skipped;
+                size_t before = newKeys.size();
+                // Поврежденная строка не добавляет ни одного ключа, даже разобранных до ошибки
+                if (!MigrationPayload::parse(uri, newKeys, skipped, error)) {
+                    JsonObject entry = errors.add<JsonObject>();
+                    entry["line"] = line + 1;
+                    entry["error"] = error;
+                    continue;
+                }
+                lines.resize(newKeys.size(), line + 1);
+                for (const String& reason : skipped) {
+                    JsonObject entry = errors.add<JsonObject>();
+                    entry["line"] = line + 1;
+                    entry["error"] = reason;
+                }
+                LOG_DEBUG("Web", "migration line %d: %u keys", line + 1, (unsigned)(newKeys.size() - before));
+            } else if (OtpAuthUri::parse(uri, params, error) && OtpAuthUri::toKey(params, key, error)) {
+                newKeys.push_back(key);
+                lines.push_back(line + 1);
+            } else {
+                JsonObject entry = errors.add<JsonObject>();
+                entry["line"] = line + 1;
+                entry["error"] = error;
+            }
+        }
+        std::vector<int> duplicates, rejected;
+        doc["added"] = pKeyManager->mergeKeys(newKeys, duplicates, rejected);
+        for (auto& key : newKeys) SecretStore::wipe(key.secret);
+        doc["duplicates"] = duplicates.size();
+        for (int index : rejected) {
+            JsonObject entry = errors.add<JsonObject>();
+            entry["line"] = lines[index];
+            entry["error"] = newKeys[index].name + ": could not be stored.";
+        }
+        String output;
+        serializeJson(doc, output);
+        request->send(200, "application/json", output);
+    });
+
+    // Показывает QR-код otpauth:// URI ключа на экране устройства для переноса на другое устройство
+    server.on("/api/show_qr", HTTP_POST, [this](AsyncWebServerRequest *request){
+        if (!isAuthenticated(request)) return request->send(401);
+        TOTPKey key;
+        if (!request->hasParam("index", true) || !pKeyManager->exportKey(request->getParam("index", true)->value().toInt(), key)) {
+            return request->send(400, "text/plain", "Key not found.");
+        }
+        String uri = OtpAuthUri::build(key);
+        SecretStore::wipe(key.secret);
+        QrCode qr;
+        bool encoded = qr.encode(uri);
+        SecretStore::wipe(uri);
+        if (encoded) pDisplayManager->showQrCode(qr, key.name);
+        SecretStore::wipe(&qr, sizeof(qr)); // Модули QR-кода - тот же секрет
+        if (!encoded) return request->send(400, "text/plain", "Key is too long for a QR code.");
+        request->send(200, "text/plain", "QR code shown on the device.");
+    });
+
     server.on("/pin", HTTP_GET, [this](AsyncWebServerRequest *request){
         if (!isAuthenticated(request)) {
             request->redirect("/login");
             return;
         }
-        request->send_P(200, "text/html", pin_settings_html);
+        sendAsset(request, pin_settings_html_asset);
     });
 
     server.on("/api/pincode_settings", HTTP_GET, [this](AsyncWebServerRequest *request){
         if (!isAuthenticated(request)) return request->send(401);
-        pPinManager->loadPinConfig();
         JsonDocument doc;
         doc["enabled"] = pPinManager->isPinEnabled();
         doc["length"] = pPinManager->getPinLength();
+        doc["wipe_after"] = pPinManager->getWipeAfter();
+        doc["failures"] = pPinManager->getFailedAttempts();
         String output;
         serializeJson(doc, output);
         request->send(200, "application/json", output);
@@ -304,6 +751,10 @@ void WebServerManager::start() {
             pPinManager->setPinLength(request->getParam("length", true)->value().toInt());
         }
 
+        if (request->hasParam("wipe_after", true)) {
+            pPinManager->setWipeAfter(request->getParam("wipe_after", true)->value().toInt());
+        }
+
         if (enabled) {
             if (request->hasParam("pin", true) && request->hasParam("pin_confirm", true)) {
                 String pin = request->getParam("pin", true)->value();
@@ -333,10 +784,9 @@ void WebServerManager::start() {
     // API to get current theme
     server.on("/api/theme", HTTP_GET, [this](AsyncWebServerRequest *request){
         if (!isAuthenticated(request)) return request->send(401);
-        Theme currentTheme = pConfigManager->loadTheme();
-        String themeName = (currentTheme == Theme::LIGHT) ? "light" : "dark"; // Use lowercase for consistency with JS
         JsonDocument doc;
-        doc["theme"] = themeName;
+        doc["theme"] = pConfigManager->getThemeName();
+        pThemeManager->listThemes(doc["themes"].to<JsonArray>());
         String output;
         serializeJson(doc, output);
         request->send(200, "application/json", output);
@@ -345,72 +795,192 @@ void WebServerManager::start() {
     // API to set theme
     server.on("/api/theme", HTTP_POST, [this](AsyncWebServerRequest *request){
         if (!isAuthenticated(request)) return request->send(401);
-        Serial.println("Received POST /api/theme request.");
         if (request->hasParam("theme", true)) {
-            String themeStr = request->getParam("theme", true)->value();
-            Serial.println("Requested theme: " + themeStr);
-            Theme newTheme = Theme::DARK;
-            if (themeStr == "light") { // Use lowercase "light"
-                newTheme = Theme::LIGHT;
-            }
-            Serial.println("Calling pConfigManager->saveTheme()...");
-            pConfigManager->saveTheme(newTheme);
-            Serial.println("pConfigManager->saveTheme() returned. Calling pDisplayManager->setTheme()...");
-            pDisplayManager->setTheme(newTheme);
-            Serial.println("pDisplayManager->setTheme() returned. Sending response.");
+            String themeName = request->getParam("theme", true)->value();
+            LOG_DEBUG("Web", "theme requested: %s", themeName.c_str());
+            const ThemeColors* colors = pThemeManager->find(themeName);
+            if (!colors) return request->send(400, "text/plain", "Unknown theme.");
+            pConfigManager->setThemeName(themeName);
+            pDisplayManager->setTheme(*colors);
             request->send(200, "text/plain", "Theme updated successfully!");
         } else {
-            Serial.println("Theme parameter missing in POST /api/theme.");
             request->send(400, "text/plain", "Theme parameter missing.");
         }
     });
 
+    // Загрузка темы: JSON в формате ThemeManager
+    server.on("/api/theme_upload", HTTP_POST, [this](AsyncWebServerRequest *request){
+        if (!isAuthenticated(request)) return request->send(401);
+        if (!request->hasParam("theme", true)) return request->send(400, "text/plain", "Theme parameter missing.");
+        String error;
+        if (!pThemeManager->importTheme(request->getParam("theme", true)->value(), error)) {
+            return request->send(400, "text/plain", error);
+        }
+        // Замена активной темы сразу видна на экране
+        const ThemeColors* active = pThemeManager->find(pConfigManager->getThemeName());
+        if (active) pDisplayManager->setTheme(*active);
+        request->send(200, "text/plain", "Theme uploaded successfully!");
+    });
+
+    server.on("/api/theme_delete", HTTP_POST, [this](AsyncWebServerRequest *request){
+        if (!isAuthenticated(request)) return request->send(401);
+        if (!request->hasParam("name", true)) return request->send(400, "text/plain", "Name parameter missing.");
+        String name = request->getParam("name", true)->value();
+        if (!pThemeManager->removeTheme(name)) return request->send(400, "text/plain", "Theme not found or built-in.");
+        if (pConfigManager->getThemeName() == name) {
+            pConfigManager->setThemeName(DEFAULT_THEME_NAME);
+            pDisplayManager->setTheme(DARK_THEME_COLORS);
+        }
+        request->send(200, "text/plain", "Theme deleted successfully!");
+    });
+
     server.on("/api/reboot", HTTP_POST, [this](AsyncWebServerRequest *request){
         if (!isAuthenticated(request)) return request->send(401);
         request->send(200, "text/plain", "Rebooting...");
+        pConfigManager->flush();
         delay(1000);
         ESP.restart();
     });
 
+    // Метрики устройства и ограничителя запросов в текстовом формате Prometheus
+    server.on("/api/metrics", HTTP_GET, [this](AsyncWebServerRequest *request){
+        if (!isAuthenticated(request)) return request->send(401);
+        const RateLimiterStats& stats = rateLimiter.getStats();
+        String body;
+        body.reserve(2048);
+        char line[384];
+        snprintf(line, sizeof(line),
+                 "web_requests_allowed_total %u\n"
+                 "web_requests_rejected_total{reason=\"rate_limited\"} %u\n"
+                 "web_requests_rejected_total{reason=\"busy\"} %u\n"
+                 "web_requests_rejected_total{reason=\"low_memory\"} %u\n"
+                 "web_requests_in_flight %u\n"
+                 "web_requests_in_flight_peak %u\n",
+                 (unsigned)stats.allowed, (unsigned)stats.rateLimited, (unsigned)stats.busy,
+                 (unsigned)stats.lowMemory, (unsigned)stats.inFlight, (unsigned)stats.peakInFlight);
+        body += line;
+        flashFS.appendPrometheus(body);
+#if METRICS_ENABLED
+        Metrics::appendPrometheus(body);
+#endif
+        request->send(200, "text/plain; version=0.0.4", body);
+    });
+
+    // Последние строки журнала из кольцевого буфера (без подключения к Serial)
+    server.on("/api/logs", HTTP_GET, [this](AsyncWebServerRequest *request){
+        if (!isAuthenticated(request)) return request->send(401);
+        request->send(200, "text/plain; charset=utf-8", Logger::dump());
+    });
+
+    // --- ПОТОК СОБЫТИЙ (SSE) ---
+    // Только с действующей сессией и не больше MAX_EVENT_CLIENTS подписчиков
+    events.setFilter([this](AsyncWebServerRequest *request) {
+        return events.count() < MAX_EVENT_CLIENTS && isAuthenticated(request);
+    });
+    events.onConnect([this](AsyncEventSourceClient *client) {
+        // Список клиентов AsyncEventSource меняется в задаче AsyncTCP без
+        // блокировки, поэтому и рассылка идет оттуда: из опроса соединения
+        // подписчика (раз в ~0.5 с), после штатного обработчика библиотеки
+        client->client()->onPoll([this](void *arg, AsyncClient *c) {
+            ((AsyncEventSourceClient *)arg)->_onPoll();
+            broadcastEvents();
+        }, client);
+        eventClientJoined = true; // Текущие коды уйдут при ближайшем опросе
+    });
+    server.addHandler(&events);
+
     server.begin();
 }
 
 void WebServerManager::startConfigServer() {
+    installRequestGuard();
     server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-        AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", wifi_setup_html);
-        response->addHeader("Cache-Control", "no-store, no-cache, must-revalidate, max-age=0");
-        response->addHeader("Pragma", "no-cache");
-        request->send(response);
+        sendAsset(request, wifi_setup_html_asset);
     });
+    // Отдает кэш последнего сканирования: блокирующий WiFi.scanNetworks()
+    // внутри обработчика останавливал бы задачу AsyncTCP
     server.on("/scan", HTTP_GET, [](AsyncWebServerRequest *request){
-        int n = WiFi.scanNetworks();
-        JsonDocument doc;
-        JsonArray array = doc.to<JsonArray>();
-        for (int i = 0; i < n; ++i) {
-            JsonObject net = array.add<JsonObject>();
-            net["ssid"] = WiFi.SSID(i);
-            net["rssi"] = WiFi.RSSI(i);
+        request->send(200, "application/json", pWifiManager->getScanResultsJson());
+    });
+    // Ручная установка времени для автономной работы без WiFi
+    server.on("/settime", HTTP_POST, [](AsyncWebServerRequest *request){
+        if (!request->hasParam("epoch", true)) {
+            return request->send(400, "text/plain", "Epoch parameter missing.");
         }
-        String output;
-        serializeJson(doc, output);
-        request->send(200, "application/json", output);
+        time_t epoch = (time_t)strtoll(request->getParam("epoch", true)->value().c_str(), NULL, 10);
+        if (!pTimeManager->setManualTime(epoch)) {
+            return request->send(400, "text/plain", "Invalid time.");
+        }
+        request->send(200, "text/plain", "Time set. Device is running in offline mode.");
     });
     server.on("/save", HTTP_POST, [](AsyncWebServerRequest *request){
         String ssid = request->arg("ssid");
         String password = request->arg("password");
-        JsonDocument doc;
-        doc["ssid"] = ssid;
-        doc["password"] = password;
-        fs::File configFile = LittleFS.open("/wifi_config.json", "w");
-        serializeJson(doc, configFile);
-        configFile.close();
+        int priority = request->hasArg("priority") ? request->arg("priority").toInt() : 0;
+        if (!pWifiManager->saveNetwork(ssid, password, priority)) {
+            return request->send(400, "text/plain", "Failed to save network.");
+        }
         request->send(200, "text/plain", "Credentials saved. Rebooting...");
+        pConfigManager->flush();
         delay(1000);
         ESP.restart();
     });
     server.begin();
 }
 
+String WebServerManager::buildCodesEvent(time_t now) {
+    size_t count = pKeyManager->getKeyCount();
+    String output = "{\"step\":" + String((uint32_t)(now / CONFIG_TOTP_STEP_SIZE)) +
+                    ",\"left\":" + String(CONFIG_TOTP_STEP_SIZE - now % CONFIG_TOTP_STEP_SIZE) + ",\"codes\":[";
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) output += ',';
+        output += '"';
+        output += pKeyManager->computeCode(i);
+        output += '"';
+    }
+    output += "]}";
+    return output;
+}
+
+// Коды пересчитываются раз в шаг TOTP (или при изменении ключей) и одной
+// строкой рассылаются всем подписчикам; между шагами идут только тики таймера.
+// Вызывается из опроса каждого подписчика, лишние вызовы ничего не шлют.
+void WebServerManager::broadcastEvents() {
+    uint32_t revision = pKeyManager->getRevision();
+    bool keysChanged = revision != lastEventRevision;
+    lastEventRevision = revision;
+
+    if (events.count() == 0 || !pTimeManager->isTimeValid()) {
+        return;
+    }
+
+    time_t now = time(nullptr);
+    time_t step = now / CONFIG_TOTP_STEP_SIZE;
+
+    if (keysChanged) {
+        events.send("{}", "keys");
+    }
+    if (step != lastEventStep || keysChanged) {
+        lastCodesEvent = buildCodesEvent(now);
+        lastEventStep = step;
+        lastTickSecond = now;
+        eventClientJoined = false;
+        events.send(lastCodesEvent.c_str(), "codes", (uint32_t)step);
+        return;
+    }
+    if (eventClientJoined) {
+        eventClientJoined = false;
+        events.send(lastCodesEvent.c_str(), "codes", (uint32_t)step);
+    }
+    if (now != lastTickSecond) {
+        lastTickSecond = now;
+        char tick[40];
+        snprintf(tick, sizeof(tick), "{\"step\":%lu,\"left\":%d}", (unsigned long)step,
+                 (int)(CONFIG_TOTP_STEP_SIZE - now % CONFIG_TOTP_STEP_SIZE));
+        events.send(tick, "tick");
+    }
+}
+
 void WebServerManager::stop() {
     server.end();
 }
\ No newline at end of file
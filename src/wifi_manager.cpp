@@ -1,84 +1,449 @@
 #include <WiFi.h>
-#include <LittleFS.h>
 #include <ArduinoJson.h>
+#include <algorithm>
 #include "wifi_manager.h"
+#include "logger.h"
 
-WifiManager::WifiManager(DisplayManager& display) : _display(display) {}
+// Кэш точки доступа переживает deep sleep
+RTC_DATA_ATTR static uint8_t rtcBssid[6];
+RTC_DATA_ATTR static uint8_t rtcChannel = 0;
+RTC_DATA_ATTR static uint32_t rtcSsidHash = 0;
 
-bool WifiManager::loadCredentials(String& ssid, String& password) {
-    if (!LittleFS.exists("/wifi_config.json")) {
+// FNV-1a: кэш в RTC относится только к той сети, для которой был получен
+static uint32_t ssidHash(const String& ssid) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < ssid.length(); i++) {
+        hash = (hash ^ (uint8_t)ssid[i]) * 16777619u;
+    }
+    return hash;
+}
+
+WifiManager::WifiManager(DisplayManager& display, ConfigManager& config) : _display(display), _config(config) {}
+
+// Формат файла: {"networks":[{"ssid","password","priority"}], "last_ssid", "bssid", "channel"}.
+// Старый формат с одной сетью ({"ssid","password"}) читается как список из одной сети.
+bool WifiManager::loadNetworks(std::vector<WifiNetwork>& networks) {
+    networks.clear();
+    _config.readSection(ConfigSection::WIFI, [&networks](const JsonDocument& doc) {
+        if (doc["networks"].is<JsonArrayConst>()) {
+            for (JsonObjectConst net : doc["networks"].as<JsonArrayConst>()) {
+                String ssid = net["ssid"].as<String>();
+                if (ssid.length() == 0) continue;
+                networks.push_back({ssid, net["password"].as<String>(), net["priority"] | 0});
+            }
+        } else if (doc["ssid"].is<const char*>()) {
+            String ssid = doc["ssid"].as<String>();
+            if (ssid.length() > 0) {
+                networks.push_back({ssid, doc["password"].as<String>(), 0});
+            }
+        }
+    });
+    return !networks.empty();
+}
+
+bool WifiManager::writeConfig(const std::vector<WifiNetwork>& networks) {
+    String lastSsid;
+    char bssid[18] = "";
+    if (_cachedNetwork >= 0 && _cachedNetwork < (int)_networks.size() && _cachedChannel != 0) {
+        lastSsid = _networks[_cachedNetwork].ssid;
+        snprintf(bssid, sizeof(bssid), "%02x:%02x:%02x:%02x:%02x:%02x", _cachedBssid[0], _cachedBssid[1],
+                 _cachedBssid[2], _cachedBssid[3], _cachedBssid[4], _cachedBssid[5]);
+    }
+
+    // Запись отложенная: портал перед перезагрузкой вызывает ConfigManager::flush()
+    return _config.writeSection(ConfigSection::WIFI, [&](JsonDocument& doc) {
+        doc.clear();
+        JsonArray array = doc["networks"].to<JsonArray>();
+        for (const auto& net : networks) {
+            JsonObject obj = array.add<JsonObject>();
+            obj["ssid"] = net.ssid;
+            obj["password"] = net.password;
+            obj["priority"] = net.priority;
+        }
+        if (bssid[0] != '\0') {
+            doc["last_ssid"] = lastSsid;
+            doc["bssid"] = bssid;
+            doc["channel"] = _cachedChannel;
+        }
+    });
+}
+
+bool WifiManager::saveNetwork(const String& ssid, const String& password, int priority) {
+    if (ssid.length() == 0) return false;
+
+    std::vector<WifiNetwork> networks;
+    loadNetworks(networks);
+    bool found = false;
+    for (auto& net : networks) {
+        if (net.ssid == ssid) {
+            net.password = password;
+            net.priority = priority;
+            found = true;
+        }
+    }
+    if (!found) {
+        if (networks.size() >= MAX_WIFI_NETWORKS) {
+            // Вытесняем сеть с наименьшим приоритетом
+            auto lowest = std::min_element(networks.begin(), networks.end(),
+                [](const WifiNetwork& a, const WifiNetwork& b) { return a.priority < b.priority; });
+            networks.erase(lowest);
+        }
+        networks.push_back({ssid, password, priority});
+    }
+    return writeConfig(networks);
+}
+
+void WifiManager::loadConnectionCache() {
+    // Кэш BSSID/канала: сначала из RTC-памяти, затем из настроек
+    _cachedNetwork = -1;
+    if (rtcChannel != 0) {
+        for (size_t i = 0; i < _networks.size(); i++) {
+            if (ssidHash(_networks[i].ssid) == rtcSsidHash) {
+                memcpy(_cachedBssid, rtcBssid, 6);
+                _cachedChannel = rtcChannel;
+                _cachedNetwork = i;
+                return;
+            }
+        }
+    }
+
+    String lastSsid;
+    String bssidStr;
+    int channel = 0;
+    _config.readSection(ConfigSection::WIFI, [&](const JsonDocument& doc) {
+        if (doc["bssid"].is<const char*>() && doc["channel"].is<int>()) {
+            lastSsid = doc["last_ssid"] | doc["ssid"].as<String>();
+            bssidStr = doc["bssid"].as<String>();
+            channel = doc["channel"].as<int>();
+        }
+    });
+    if (bssidStr.length() == 0) return;
+
+    unsigned int b[6];
+    if (sscanf(bssidStr.c_str(), "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) {
+        return;
+    }
+    for (size_t i = 0; i < _networks.size(); i++) {
+        if (_networks[i].ssid == lastSsid) {
+            for (int j = 0; j < 6; j++) _cachedBssid[j] = b[j];
+            _cachedChannel = channel;
+            _cachedNetwork = _cachedChannel != 0 ? (int)i : -1;
+            return;
+        }
+    }
+}
+
+void WifiManager::saveConnectionCache() {
+    memcpy(rtcBssid, _cachedBssid, 6);
+    rtcChannel = _cachedChannel;
+    rtcSsidHash = ssidHash(_networks[_cachedNetwork].ssid);
+
+    char bssid[18];
+    snprintf(bssid, sizeof(bssid), "%02x:%02x:%02x:%02x:%02x:%02x", _cachedBssid[0], _cachedBssid[1],
+             _cachedBssid[2], _cachedBssid[3], _cachedBssid[4], _cachedBssid[5]);
+    // Пишем во флеш, только если точка доступа сменилась
+    bool unchanged = false;
+    _config.readSection(ConfigSection::WIFI, [&](const JsonDocument& doc) {
+        unchanged = doc["bssid"] == bssid && doc["channel"] == _cachedChannel &&
+                    doc["last_ssid"] == _networks[_cachedNetwork].ssid;
+    });
+    if (unchanged) return;
+    writeConfig(_networks);
+}
+
+bool WifiManager::begin() {
+    _scanMutex = xSemaphoreCreateMutex();
+
+    if (!loadNetworks(_networks)) {
+        LOG_INFO("WiFi", "no config found");
+        _state = WifiState::NO_CONFIG;
         return false;
     }
-    File configFile = LittleFS.open("/wifi_config.json", "r");
-    if (!configFile) return false;
+    loadConnectionCache();
+
+    // Переподключением управляем сами, настройки во флеш SDK не пишем
+    WiFi.persistent(false);
+    WiFi.setAutoReconnect(false);
+    WiFi.mode(WIFI_STA); // Явно устанавливаем режим клиента
+    WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+        onWifiEvent(event, info);
+    });
+
+    // С известной точкой доступа подключаемся сразу, иначе сначала сканируем
+    if (_cachedNetwork >= 0) {
+        startAttempt(_cachedNetwork, true);
+    } else {
+        startScan();
+    }
+    return true;
+}
+
+// Вызывается в задаче событий WiFi: только фиксируем событие
+void WifiManager::onWifiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    portENTER_CRITICAL(&_lock);
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+            memcpy(_evBssid, info.wifi_sta_connected.bssid, 6);
+            _evChannel = info.wifi_sta_connected.channel;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            _ipAddress = info.got_ip.ip_info.ip.addr;
+            _evGotIp = true;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            _evDisconnectReason = info.wifi_sta_disconnected.reason;
+            _evDisconnected = true;
+            break;
+        default:
+            break;
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+void WifiManager::startScan() {
+    if (!_scanInProgress) {
+        WiFi.scanNetworks(true); // Асинхронно: результат заберет update()
+        _scanInProgress = true;
+        _scanStartMs = millis();
+    }
+    if (!_portalActive) {
+        _state = WifiState::SCANNING;
+    }
+}
 
+void WifiManager::handleScanResults(int count) {
+    // Видимые сети: лучший RSSI для каждого SSID
+    std::vector<std::pair<String, int>> visible;
+    for (int i = 0; i < count; i++) {
+        String ssid = WiFi.SSID(i);
+        int rssi = WiFi.RSSI(i);
+        if (ssid.length() == 0) continue;
+        bool merged = false;
+        for (auto& v : visible) {
+            if (v.first == ssid) {
+                if (rssi > v.second) v.second = rssi;
+                merged = true;
+                break;
+            }
+        }
+        if (!merged) visible.push_back({ssid, rssi});
+    }
+    WiFi.scanDelete();
+    std::sort(visible.begin(), visible.end(),
+        [](const std::pair<String, int>& a, const std::pair<String, int>& b) { return a.second > b.second; });
+
+    // Кэш для портала собираем вне мьютекса, под мьютексом только подменяем
     JsonDocument doc;
-    if (deserializeJson(doc, configFile)) {
-        configFile.close();
-        return false;
+    JsonArray array = doc.to<JsonArray>();
+    for (const auto& v : visible) {
+        JsonObject net = array.add<JsonObject>();
+        net["ssid"] = v.first;
+        net["rssi"] = v.second;
     }
-    configFile.close();
+    String json;
+    serializeJson(doc, json);
+    xSemaphoreTake(_scanMutex, portMAX_DELAY);
+    _scanJson = json;
+    _scanCompletedMs = millis();
+    _hasScanResults = true;
+    xSemaphoreGive(_scanMutex);
 
-    ssid = doc["ssid"].as<String>();
-    password = doc["password"].as<String>();
-    return ssid.length() > 0;
+    if (_portalActive) return;
+
+    // Кандидаты: сначала по приоритету, внутри приоритета - по уровню сигнала.
+    // Невидимые (в том числе скрытые) сети идут в конец очереди.
+    _candidates.clear();
+    std::vector<int> rssiOf(_networks.size(), -1000);
+    for (size_t i = 0; i < _networks.size(); i++) {
+        for (const auto& v : visible) {
+            if (v.first == _networks[i].ssid) rssiOf[i] = v.second;
+        }
+        _candidates.push_back(i);
+    }
+    std::stable_sort(_candidates.begin(), _candidates.end(), [this, &rssiOf](int a, int b) {
+        bool visibleA = rssiOf[a] > -1000;
+        bool visibleB = rssiOf[b] > -1000;
+        if (visibleA != visibleB) return visibleA;
+        if (_networks[a].priority != _networks[b].priority) return _networks[a].priority > _networks[b].priority;
+        return rssiOf[a] > rssiOf[b];
+    });
+    _nextCandidate = 0;
+    attemptNextCandidate();
 }
 
-bool WifiManager::connect() {
-    String ssid, password;
-    
-    _display.showMessage("Loading WiFi config...", 10, 50);
-    delay(500);
+void WifiManager::attemptNextCandidate() {
+    if (_nextCandidate >= _candidates.size()) {
+        scheduleRetry(); // Круг закончился - пауза и новое сканирование
+        return;
+    }
+    startAttempt(_candidates[_nextCandidate++], false);
+}
 
-    if (!loadCredentials(ssid, password)) {
-        _display.showMessage("No WiFi config found.", 10, 50, true);
-        delay(1500);
-        return false;
+void WifiManager::startAttempt(int networkIndex, bool fast) {
+    const WifiNetwork& net = _networks[networkIndex];
+    _currentNetwork = networkIndex;
+    _fastAttempt = fast;
+    if (fast) {
+        // Сразу на известную точку доступа, без сканирования всех каналов
+        LOG_INFO("WiFi", "fast connect to %s (channel %d)", net.ssid.c_str(), _cachedChannel);
+        WiFi.begin(net.ssid.c_str(), net.password.c_str(), _cachedChannel, _cachedBssid);
+    } else {
+        LOG_INFO("WiFi", "connecting to %s", net.ssid.c_str());
+        WiFi.begin(net.ssid.c_str(), net.password.c_str());
     }
+    _attemptStartMs = millis();
+    _state = WifiState::CONNECTING;
+}
 
-    _display.showMessage("Config loaded.", 10, 50);
-    _display.showMessage("Connecting to:", 10, 70);
-    _display.showMessage(ssid, 10, 90, false, 2);
+void WifiManager::scheduleRetry() {
+    _failedRounds++;
+    // Экспоненциальная пауза: 1, 2, 4 ... 60 секунд
+    uint32_t shift = _failedRounds - 1;
+    if (shift > 6) shift = 6;
+    unsigned long delayMs = RETRY_BASE_MS << shift;
+    if (delayMs > RETRY_MAX_MS) delayMs = RETRY_MAX_MS;
+    _retryAtMs = millis() + delayMs;
+    _state = WifiState::WAITING_RETRY;
+    LOG_WARN("WiFi", "round %u failed, retry in %lu ms", (unsigned)_failedRounds, delayMs);
+}
 
-    // --- Улучшенная логика подключения ---
-    WiFi.mode(WIFI_STA); // Явно устанавливаем режим клиента
-    WiFi.disconnect(true); // Очищаем предыдущую сессию
-    delay(100);
+void WifiManager::update() {
+    portENTER_CRITICAL(&_lock);
+    bool portalRequested = _evPortal;
+    _evPortal = false;
+    portEXIT_CRITICAL(&_lock);
+    if (portalRequested && !_portalActive) {
+        enterPortal();
+    }
 
-    WiFi.begin(ssid.c_str(), password.c_str());
+    // Сканирование обслуживается и в режиме портала (для страницы выбора сети)
+    if (_scanInProgress) {
+        int result = WiFi.scanComplete();
+        if (result >= 0) {
+            _scanInProgress = false;
+            handleScanResults(result);
+        } else if (result == WIFI_SCAN_FAILED || millis() - _scanStartMs > SCAN_TIMEOUT_MS) {
+            _scanInProgress = false;
+            WiFi.scanDelete();
+            handleScanResults(0); // Пробуем все сохраненные сети по приоритету
+        }
+    } else if (_scanRequested) {
+        _scanRequested = false;
+        startScan();
+    }
 
-    int attempts = 0;
-    // Увеличиваем время ожидания до 20 секунд (40 * 500 мс)
-    while (WiFi.status() != WL_CONNECTED && attempts < 40) {
-        delay(500);
-        attempts++;
+    if (_portalActive || _state == WifiState::NO_CONFIG || _state == WifiState::IDLE) {
+        return;
     }
 
-    if (WiFi.status() == WL_CONNECTED) {
-        _ipAddress = WiFi.localIP().toString();
-        return true; // Успех!
+    portENTER_CRITICAL(&_lock);
+    bool gotIp = _evGotIp;
+    bool disconnected = _evDisconnected;
+    uint8_t reason = _evDisconnectReason;
+    _evGotIp = false;
+    _evDisconnected = false;
+    portEXIT_CRITICAL(&_lock);
+
+    // Отключение сразу после старта попытки - это эхо WiFi.disconnect() от прошлой
+    if (disconnected && _state == WifiState::CONNECTING && millis() - _attemptStartMs < STALE_EVENT_MS) {
+        disconnected = false;
     }
-    
-    // Если не удалось, показываем ошибку и возвращаем false
-    _display.init();
-    _display.showMessage("Connection Failed!", 10, 50, true);
-    _display.showMessage("Check credentials.", 10, 70);
-    delay(2500);
-    WiFi.disconnect();
-    return false; // Неудача
+
+    bool attemptFailed = false;
+    if (disconnected && (_state == WifiState::CONNECTED || _state == WifiState::CONNECTING)) {
+        LOG_WARN("WiFi", "disconnected, reason %u", reason);
+        // Отключение во время попытки может прийти раньше, чем GOT_IP предыдущей
+        gotIp = gotIp && WiFi.status() == WL_CONNECTED;
+        if (_state == WifiState::CONNECTED) {
+            // Обрыв: сначала пробуем ту же точку доступа, затем полный круг
+            _failedRounds = 0;
+            startAttempt(_currentNetwork, _cachedNetwork == _currentNetwork);
+            return;
+        }
+        attemptFailed = true;
+    }
+
+    if (gotIp) {
+        portENTER_CRITICAL(&_lock);
+        memcpy(_cachedBssid, _evBssid, 6);
+        _cachedChannel = _evChannel;
+        portEXIT_CRITICAL(&_lock);
+        if (_cachedChannel != 0) {
+            _cachedNetwork = _currentNetwork;
+            saveConnectionCache();
+        }
+
+        _failedRounds = 0;
+        _connectCount++;
+        _state = WifiState::CONNECTED;
+        LOG_INFO("WiFi", "connected to %s, IP %s", _networks[_currentNetwork].ssid.c_str(), getIP().c_str());
+        return;
+    }
+
+    if (_state == WifiState::CONNECTING && millis() - _attemptStartMs > CONNECT_TIMEOUT_MS) {
+        WiFi.disconnect(); // Прерываем попытку, без очистки настроек
+        attemptFailed = true;
+    }
+
+    if (attemptFailed) {
+        if (_fastAttempt) {
+            // Точка доступа могла смениться - забываем кэш и сканируем эфир
+            _cachedNetwork = -1;
+            rtcChannel = 0;
+            startScan();
+        } else {
+            attemptNextCandidate();
+        }
+    } else if (_state == WifiState::WAITING_RETRY && (long)(millis() - _retryAtMs) >= 0) {
+        startScan();
+    }
+}
+
+String WifiManager::getScanResultsJson() {
+    if (_scanMutex == NULL) return "[]";
+
+    xSemaphoreTake(_scanMutex, portMAX_DELAY);
+    String json = _scanJson;
+    bool stale = !_hasScanResults || millis() - _scanCompletedMs > SCAN_CACHE_MAX_AGE_MS;
+    xSemaphoreGive(_scanMutex);
+
+    if (stale) {
+        _scanRequested = true; // Сканирование запустит сетевая задача
+    }
+    return json;
 }
 
+bool WifiManager::hasCredentials() {
+    std::vector<WifiNetwork> networks;
+    return loadNetworks(networks);
+}
+
+// Вызывается из основной задачи: экран рисуем здесь, а состояние и радио
+// переключает update() в сетевой задаче, чтобы идущая попытка подключения
+// не перезаписала PORTAL
 void WifiManager::startConfigPortal() {
-    const char* ap_ssid = "ESP32-TOTP-Setup";
     _display.init();
     _display.showMessage("WiFi Setup Mode", 10, 10, false, 2);
     _display.showMessage("1. Connect to WiFi:", 10, 40);
-    _display.showMessage(ap_ssid, 15, 60, false, 2);
+    _display.showMessage(PORTAL_SSID, 15, 60, false, 2);
     _display.showMessage("2. Go to 192.168.4.1", 10, 90);
+    _display.showMessage("or set time for offline use", 10, 110);
+
+    portENTER_CRITICAL(&_lock);
+    _evPortal = true;
+    portEXIT_CRITICAL(&_lock);
+}
 
-    WiFi.softAP(ap_ssid);
+void WifiManager::enterPortal() {
+    _portalActive = true;
+    _state = WifiState::PORTAL;
+    WiFi.disconnect(); // Останавливаем попытки подключения к сохраненной сети
+    WiFi.mode(WIFI_AP_STA); // STA нужен для сканирования из портала
+    WiFi.softAP(PORTAL_SSID);
+    _scanRequested = true; // Прогреваем кэш, пока пользователь подключается
+    LOG_INFO("WiFi", "config portal started");
 }
 
 String WifiManager::getIP() {
-    return _ipAddress;
-}
\ No newline at end of file
+    return IPAddress(_ipAddress).toString();
+}
@@ -0,0 +1,64 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <esp_timer.h>
+#include "config.h"
+#include "crypto_manager.h"
+
+// Замер на устройстве для пароля администратора: итерации калибруются так же,
+// как в WebServerManager::setAdminPassword. Время проверки - это и стоимость
+// запроса входа, и стоимость одной попытки подбора на самом устройстве.
+
+static const int RUNS = 5;
+
+static PasswordRecord record;
+
+static uint32_t verifyUs(const String& password, bool expected, uint32_t& worstUs) {
+    uint64_t totalUs = 0;
+    worstUs = 0;
+    for (int i = 0; i < RUNS; i++) {
+        int64_t start = esp_timer_get_time();
+        bool ok = CryptoManager::verifyPasswordRecord(password, record);
+        uint32_t elapsedUs = (uint32_t)(esp_timer_get_time() - start);
+        TEST_ASSERT_EQUAL(expected, ok);
+        totalUs += elapsedUs;
+        if (elapsedUs > worstUs) worstUs = elapsedUs;
+    }
+    return (uint32_t)(totalUs / RUNS);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_admin_verify_latency(void) {
+    uint32_t iterations = CryptoManager::calibrateIterations(ADMIN_KDF_TARGET_MS, KDF_MIN_ITERATIONS);
+    CryptoManager::createPasswordRecord("admin-password", iterations, record);
+
+    uint32_t acceptWorstUs, rejectWorstUs;
+    uint32_t acceptUs = verifyUs("admin-password", true, acceptWorstUs);
+    uint32_t rejectUs = verifyUs("admin-passwore", false, rejectWorstUs);
+
+    // Подбор через веб-интерфейс идет по одной проверке за раз
+    float guessesPerSecond = 1000000.0f / rejectUs;
+    char line[192];
+    snprintf(line, sizeof(line), "PBKDF2 %lu iterations, verify %lu ms avg / %lu ms worst (ok), %lu ms avg (wrong), "
+             "%.2f guesses/s, %lu guesses/day, target %d ms",
+             (unsigned long)iterations, (unsigned long)(acceptUs / 1000), (unsigned long)(acceptWorstUs / 1000),
+             (unsigned long)(rejectUs / 1000), guessesPerSecond, (unsigned long)(guessesPerSecond * 86400),
+             ADMIN_KDF_TARGET_MS);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(KDF_MIN_ITERATIONS, iterations);
+    TEST_ASSERT_UINT32_WITHIN(ADMIN_KDF_TARGET_MS / 2, ADMIN_KDF_TARGET_MS, acceptUs / 1000);
+    // Неверный пароль проверяется столько же: время не выдает, где ошибка
+    TEST_ASSERT_UINT32_WITHIN(ADMIN_KDF_TARGET_MS / 10, acceptUs / 1000, rejectUs / 1000);
+}
+
+void setup() {
+    delay(2000); // Монитор порта успевает подключиться после сброса
+    UNITY_BEGIN();
+    RUN_TEST(test_admin_verify_latency);
+    UNITY_END();
+}
+
+void loop() {}
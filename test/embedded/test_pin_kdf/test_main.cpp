@@ -0,0 +1,58 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <esp_timer.h>
+#include "crypto_manager.h"
+#include "pin_manager.h"
+
+// Замер на устройстве: число итераций калибруется так же, как при установке
+// PIN, и проверка верного и неверного PIN должна занимать около PIN_KDF_TARGET_MS
+
+static const int RUNS = 3;
+
+static PasswordRecord record;
+
+static uint32_t verifyMs(const String& pin, bool expected) {
+    uint32_t worstMs = 0;
+    for (int i = 0; i < RUNS; i++) {
+        int64_t start = esp_timer_get_time();
+        bool ok = CryptoManager::verifyPasswordRecord(pin, record);
+        uint32_t elapsedMs = (uint32_t)((esp_timer_get_time() - start) / 1000);
+        TEST_ASSERT_EQUAL(expected, ok);
+        if (elapsedMs > worstMs) worstMs = elapsedMs;
+    }
+    return worstMs;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_pin_verify_latency(void) {
+    int64_t start = esp_timer_get_time();
+    uint32_t iterations = CryptoManager::calibrateIterations(PIN_KDF_TARGET_MS, KDF_MIN_ITERATIONS);
+    uint32_t calibrationMs = (uint32_t)((esp_timer_get_time() - start) / 1000);
+    CryptoManager::createPasswordRecord("1234", iterations, record);
+
+    uint32_t acceptMs = verifyMs("1234", true);
+    uint32_t rejectMs = verifyMs("4321", false);
+
+    char line[128];
+    snprintf(line, sizeof(line), "PBKDF2 %lu iterations, calibration %lu ms, verify %lu ms (ok) / %lu ms (wrong), target %d ms",
+             (unsigned long)iterations, (unsigned long)calibrationMs,
+             (unsigned long)acceptMs, (unsigned long)rejectMs, PIN_KDF_TARGET_MS);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(KDF_MIN_ITERATIONS, iterations);
+    TEST_ASSERT_UINT32_WITHIN(PIN_KDF_TARGET_MS / 2, PIN_KDF_TARGET_MS, acceptMs);
+    // Неверный PIN проверяется столько же: время не выдает, где ошибка
+    TEST_ASSERT_UINT32_WITHIN(PIN_KDF_TARGET_MS / 10, acceptMs, rejectMs);
+}
+
+void setup() {
+    delay(2000); // Монитор порта успевает подключиться после сброса
+    UNITY_BEGIN();
+    RUN_TEST(test_pin_verify_latency);
+    UNITY_END();
+}
+
+void loop() {}
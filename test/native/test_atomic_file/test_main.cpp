@@ -0,0 +1,281 @@
+#include <unity.h>
+#include <string>
+#include "atomic_file.h"
+
+static const char* PATH = "/keys.json";
+
+// Память вместо LittleFS; cutPowerAfter() обрывает запись на любом шаге
+static fs::FS* storage;
+static FlashFS* flash;
+
+static const std::string CONTENTS[] = {
+    "",
+    "{\"a\":1}",
+    std::string(300, 'x'),
+    "{\"b\":2222222}",
+    "z",
+};
+static const int CONTENT_COUNT = sizeof(CONTENTS) / sizeof(CONTENTS[0]);
+
+static bool writeText(const std::string& text) {
+    return AtomicFile::write(*flash, PATH, (const uint8_t*)text.data(), text.size());
+}
+
+static bool readText(std::string& text) {
+    std::vector<uint8_t> out;
+    bool ok = AtomicFile::read(*flash, PATH, out);
+    text.assign(out.begin(), out.end());
+    return ok;
+}
+
+// Исходное состояние: текущее поколение old и резервное до него,
+// либо файл старого формата без концевика
+static void prepare(const std::string& old, const std::string& previous, bool legacy) {
+    if (legacy) {
+        File file = storage->open(PATH, "w");
+        file.write((const uint8_t*)old.data(), old.size());
+        file.close();
+        return;
+    }
+    TEST_ASSERT_TRUE(writeText(previous));
+    TEST_ASSERT_TRUE(writeText(old));
+}
+
+// После сбоя на шаге cut и восстановления виден ровно один из вариантов целиком
+static void checkRecovered(const std::string& old, const std::string& next, bool finished) {
+    AtomicFile::recover(*flash, PATH);
+    std::string text;
+    TEST_ASSERT_TRUE(readText(text));
+    if (finished) {
+        TEST_ASSERT_TRUE(text == next);
+    } else {
+        TEST_ASSERT_TRUE(text == old || text == next);
+    }
+    TEST_ASSERT_FALSE(storage->exists(String(PATH) + ".tmp"));
+
+    // Запись после восстановления снова работает
+    TEST_ASSERT_TRUE(writeText("next"));
+    TEST_ASSERT_TRUE(readText(text));
+    TEST_ASSERT_TRUE(text == "next");
+}
+
+void setUp(void) {
+    storage = new fs::FS();
+    flash = new FlashFS(*storage);
+}
+
+void tearDown(void) {
+    delete flash;
+    delete storage;
+}
+
+static void resetStorage() {
+    tearDown();
+    setUp();
+}
+
+void test_write_read_roundtrip(void) {
+    std::string text;
+    TEST_ASSERT_FALSE(AtomicFile::exists(*flash, PATH));
+    TEST_ASSERT_FALSE(readText(text));
+
+    TEST_ASSERT_TRUE(writeText("first"));
+    TEST_ASSERT_TRUE(writeText("second"));
+    TEST_ASSERT_TRUE(AtomicFile::exists(*flash, PATH));
+    TEST_ASSERT_TRUE(readText(text));
+    TEST_ASSERT_EQUAL_STRING("second", text.c_str());
+
+    std::vector<uint8_t>* current = storage->contents(PATH);
+    std::vector<uint8_t>* backup = storage->contents(String(PATH) + ".bak");
+    TEST_ASSERT_NOT_NULL(current);
+    TEST_ASSERT_NOT_NULL(backup);
+    TEST_ASSERT_EQUAL_size_t(strlen("second") + AtomicFile::TRAILER_SIZE, current->size());
+    TEST_ASSERT_EQUAL_MEMORY("first", backup->data(), 5);
+    TEST_ASSERT_FALSE(storage->exists(String(PATH) + ".tmp"));
+}
+
+void test_power_cut_at_every_step(void) {
+    int cutPoints = 0;
+    for (int legacy = 0; legacy < 2; legacy++) {
+        for (int o = 0; o < CONTENT_COUNT; o++) {
+            for (int n = 0; n < CONTENT_COUNT; n++) {
+                const std::string& old = CONTENTS[o];
+                const std::string& next = CONTENTS[n];
+                // Каждый записанный байт - отдельный шаг, так что сбой пробуется на каждом смещении
+                for (long cut = 0;; cut++) {
+                    resetStorage();
+                    prepare(old, CONTENTS[(o + 1) % CONTENT_COUNT], legacy);
+
+                    storage->cutPowerAfter(cut);
+                    bool finished = writeText(next);
+                    bool interrupted = storage->powerLost();
+                    storage->restorePower();
+                    TEST_ASSERT_FALSE(finished && interrupted);
+
+                    checkRecovered(old, next, finished);
+                    cutPoints++;
+                    if (!interrupted) break;
+                }
+            }
+        }
+    }
+    char message[48];
+    snprintf(message, sizeof(message), "%d cut points", cutPoints);
+    TEST_MESSAGE(message);
+}
+
+void test_power_cut_during_recovery(void) {
+    const std::string& old = CONTENTS[1];
+    const std::string& next = CONTENTS[2];
+    for (long writeCut = 0;; writeCut++) {
+        bool writeInterrupted = false;
+        for (long recoverCut = 0;; recoverCut++) {
+            resetStorage();
+            prepare(old, CONTENTS[0], false);
+            storage->cutPowerAfter(writeCut);
+            writeText(next);
+            writeInterrupted = storage->powerLost();
+
+            // Второй сбой - уже во время восстановления при загрузке
+            storage->cutPowerAfter(recoverCut);
+            AtomicFile::recover(*flash, PATH);
+            bool recoverInterrupted = storage->powerLost();
+            storage->restorePower();
+
+            checkRecovered(old, next, !writeInterrupted);
+            if (!recoverInterrupted) break;
+        }
+        if (!writeInterrupted) break;
+    }
+}
+
+void test_corrupt_primary_uses_backup(void) {
+    TEST_ASSERT_TRUE(writeText("one"));
+    TEST_ASSERT_TRUE(writeText("two"));
+    (*storage->contents(PATH))[1] ^= 1;
+
+    std::string text;
+    TEST_ASSERT_TRUE(readText(text));
+    TEST_ASSERT_EQUAL_STRING("one", text.c_str());
+
+    AtomicFile::recover(*flash, PATH);
+    TEST_ASSERT_FALSE(storage->exists(String(PATH) + ".bak"));
+    TEST_ASSERT_TRUE(readText(text));
+    TEST_ASSERT_EQUAL_STRING("one", text.c_str());
+
+    // Следующая запись продолжает нумерацию поколений после резервного
+    TEST_ASSERT_TRUE(writeText("three"));
+    TEST_ASSERT_TRUE(readText(text));
+    TEST_ASSERT_EQUAL_STRING("three", text.c_str());
+}
+
+void test_damaged_trailer_uses_backup(void) {
+    // Без целого концевика основной файл похож на старый формат, но рядом
+    // есть .bak, значит это поврежденное поколение, а не файл до миграции
+    for (int damage = 0; damage < 2; damage++) {
+        resetStorage();
+        TEST_ASSERT_TRUE(writeText("one"));
+        TEST_ASSERT_TRUE(writeText("two"));
+        std::vector<uint8_t>& current = *storage->contents(PATH);
+        if (damage == 0) {
+            current[current.size() - AtomicFile::TRAILER_SIZE] ^= 1; // Магия концевика
+        } else {
+            current.resize(current.size() - 5); // Обрезанный хвост
+        }
+
+        std::string text;
+        TEST_ASSERT_TRUE(readText(text));
+        TEST_ASSERT_EQUAL_STRING("one", text.c_str());
+
+        AtomicFile::recover(*flash, PATH);
+        TEST_ASSERT_FALSE(storage->exists(String(PATH) + ".bak"));
+        TEST_ASSERT_TRUE(readText(text));
+        TEST_ASSERT_EQUAL_STRING("one", text.c_str());
+    }
+
+    // Запись поверх поврежденного файла сохраняет целое резервное поколение
+    resetStorage();
+    TEST_ASSERT_TRUE(writeText("one"));
+    TEST_ASSERT_TRUE(writeText("two"));
+    storage->contents(PATH)->resize(2);
+    TEST_ASSERT_TRUE(writeText("three"));
+    std::vector<uint8_t>* backup = storage->contents(String(PATH) + ".bak");
+    TEST_ASSERT_NOT_NULL(backup);
+    TEST_ASSERT_EQUAL_MEMORY("one", backup->data(), 3);
+}
+
+void test_legacy_file_is_read_as_is(void) {
+    prepare("{\"legacy\":true}", "", true);
+    std::string text;
+    TEST_ASSERT_TRUE(readText(text));
+    TEST_ASSERT_EQUAL_STRING("{\"legacy\":true}", text.c_str());
+
+    TEST_ASSERT_TRUE(writeText("{}"));
+    std::vector<uint8_t>* backup = storage->contents(String(PATH) + ".bak");
+    TEST_ASSERT_NOT_NULL(backup);
+    TEST_ASSERT_EQUAL_size_t(strlen("{\"legacy\":true}"), backup->size());
+}
+
+void test_remove_never_resurrects(void) {
+    for (long cut = 0;; cut++) {
+        resetStorage();
+        TEST_ASSERT_TRUE(writeText("one"));
+        TEST_ASSERT_TRUE(writeText("two"));
+
+        storage->cutPowerAfter(cut);
+        AtomicFile::remove(*flash, PATH);
+        bool interrupted = storage->powerLost();
+        storage->restorePower();
+
+        AtomicFile::recover(*flash, PATH);
+        std::string text;
+        if (readText(text)) {
+            // Старое поколение не возвращается вместо удаляемого
+            TEST_ASSERT_TRUE(interrupted);
+            TEST_ASSERT_EQUAL_STRING("two", text.c_str());
+        }
+        if (!interrupted) {
+            TEST_ASSERT_FALSE(AtomicFile::exists(*flash, PATH));
+            TEST_ASSERT_EQUAL_size_t(0, storage->fileCount());
+            break;
+        }
+    }
+}
+
+void test_crc32_reference(void) {
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, AtomicFile::crc32((const uint8_t*)"123456789", 9));
+    TEST_ASSERT_EQUAL_HEX32(0, AtomicFile::crc32(nullptr, 0));
+    // Продолжение по частям дает тот же результат
+    uint32_t partial = AtomicFile::crc32((const uint8_t*)"1234", 4);
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, AtomicFile::crc32((const uint8_t*)"56789", 5, partial));
+}
+
+void test_flash_accounting(void) {
+    flash->begin(1 << 20);
+    std::string large(5000, 'k');
+    TEST_ASSERT_TRUE(writeText(large));
+    TEST_ASSERT_TRUE(writeText(large));
+
+    String metrics;
+    flash->appendPrometheus(metrics);
+    // Временный и резервный файлы учитываются вместе с основным
+    TEST_ASSERT_NOT_EQUAL(-1, metrics.indexOf("flash_file_write_bytes_total{path=\"/keys.json\"} 10032\n"));
+    TEST_ASSERT_NOT_EQUAL(-1, metrics.indexOf("flash_file_erase_blocks_total{path=\"/keys.json\"} 4\n"));
+    // Переименования: .tmp в основной, затем основной в .bak и .tmp в основной
+    TEST_ASSERT_NOT_EQUAL(-1, metrics.indexOf("flash_file_metadata_ops_total{path=\"/keys.json\"} 3\n"));
+    TEST_ASSERT_EQUAL_INT(-1, metrics.indexOf(".tmp"));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_write_read_roundtrip);
+    RUN_TEST(test_power_cut_at_every_step);
+    RUN_TEST(test_power_cut_during_recovery);
+    RUN_TEST(test_corrupt_primary_uses_backup);
+    RUN_TEST(test_damaged_trailer_uses_backup);
+    RUN_TEST(test_legacy_file_is_read_as_is);
+    RUN_TEST(test_remove_never_resurrects);
+    RUN_TEST(test_crc32_reference);
+    RUN_TEST(test_flash_accounting);
+    return UNITY_END();
+}
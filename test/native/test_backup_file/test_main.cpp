@@ -0,0 +1,238 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "backup_file.h"
+
+static const char* PASSPHRASE = "correct horse battery";
+static const uint32_t ITERATIONS = BACKUP_KDF_MIN_ITERATIONS;
+static const size_t CHUNK_OVERHEAD = 4 + 16; // Слово блока и тег GCM
+
+typedef std::vector<uint8_t> Bytes;
+
+static std::vector<std::string> records;
+static std::string error;
+
+// Копия записей source, читается порциями по step байт, как ответ сервера
+static Bytes writeBackup(const std::vector<std::string>& source, size_t step = 700) {
+    size_t next = 0;
+    BackupWriter writer(PASSPHRASE, ITERATIONS, [&](String& record) {
+        if (next == source.size()) return false;
+        record = source[next++].c_str();
+        return true;
+    });
+    Bytes file;
+    uint8_t buffer[1500];
+    while (size_t count = writer.read(buffer, step)) file.insert(file.end(), buffer, buffer + count);
+    return file;
+}
+
+// Разбор копии порциями по step байт, как загрузка файла; записи - в records
+static bool readBackup(const Bytes& file, size_t step = 512, const char* passphrase = PASSPHRASE,
+                       uint32_t maxIterations = ITERATIONS) {
+    records.clear();
+    BackupReader reader(passphrase, maxIterations, [](const String& record) {
+        records.push_back(record.c_str());
+        return true;
+    });
+    bool ok = true;
+    for (size_t offset = 0; ok && offset < file.size(); offset += step) {
+        ok = reader.feed(file.data() + offset, std::min(step, file.size() - offset));
+    }
+    ok = ok && reader.finish();
+    error = reader.error().c_str();
+    return ok;
+}
+
+// Границы блоков после заголовка: смещение начала каждого блока
+static std::vector<size_t> chunkOffsets(const Bytes& file) {
+    std::vector<size_t> offsets;
+    for (size_t offset = BACKUP_HEADER_SIZE; offset < file.size();) {
+        offsets.push_back(offset);
+        uint32_t length = (file[offset] | file[offset + 1] << 8 | file[offset + 2] << 16) & 0x7FFFFF;
+        offset += length + CHUNK_OVERHEAD;
+    }
+    return offsets;
+}
+
+// Записи на несколько блоков (count = 40 - четыре блока с манифестом),
+// часть записей пересекает границы блоков
+static std::vector<std::string> sampleRecords(int count = 40) {
+    std::vector<std::string> out;
+    for (int i = 0; i < count; i++) {
+        out.push_back("{\"name\":\"key" + std::to_string(i) + "\",\"secret\":\"" + std::string(30 + i, 'A') + "\"}");
+    }
+    return out;
+}
+
+void setUp(void) {
+    records.clear();
+    error.clear();
+}
+
+void tearDown(void) {}
+
+void test_roundtrip(void) {
+    std::vector<std::string> source = sampleRecords();
+    Bytes file = writeBackup(source);
+    TEST_ASSERT_EQUAL_MEMORY("TBK1", file.data(), 4);
+    TEST_ASSERT_GREATER_THAN(3, chunkOffsets(file).size());
+
+    // Результат не зависит от того, как файл нарезан на порции
+    const size_t steps[] = {1, 7, 36, 40, 1044, file.size()};
+    for (size_t step : steps) {
+        TEST_ASSERT_TRUE(readBackup(file, step));
+        TEST_ASSERT_EQUAL_size_t(source.size(), records.size());
+        for (size_t i = 0; i < source.size(); i++) TEST_ASSERT_TRUE(records[i] == source[i]);
+    }
+}
+
+void test_empty_backup(void) {
+    Bytes file = writeBackup({});
+    TEST_ASSERT_EQUAL_size_t(1, chunkOffsets(file).size()); // Только манифест
+    TEST_ASSERT_TRUE(readBackup(file));
+    TEST_ASSERT_EQUAL_size_t(0, records.size());
+}
+
+void test_each_backup_is_unique(void) {
+    // Соль и префикс nonce случайны: одни и те же ключи дают разные файлы
+    std::vector<std::string> source = {"{\"name\":\"a\"}"};
+    Bytes first = writeBackup(source);
+    Bytes second = writeBackup(source);
+    TEST_ASSERT_EQUAL_size_t(first.size(), second.size());
+    TEST_ASSERT_FALSE(first == second);
+}
+
+void test_oversized_record_is_skipped(void) {
+    std::vector<std::string> source = {"first", std::string(BACKUP_MAX_RECORD, 'x'), "last"};
+    TEST_ASSERT_TRUE(readBackup(writeBackup(source)));
+    TEST_ASSERT_EQUAL_size_t(2, records.size());
+    TEST_ASSERT_EQUAL_STRING("last", records[1].c_str());
+}
+
+void test_wrong_passphrase(void) {
+    Bytes file = writeBackup(sampleRecords());
+    TEST_ASSERT_FALSE(readBackup(file, 512, "correct horse battery!"));
+    TEST_ASSERT_EQUAL_STRING("Wrong passphrase or corrupted backup.", error.c_str());
+    TEST_ASSERT_EQUAL_size_t(0, records.size());
+}
+
+void test_iterations_above_limit(void) {
+    Bytes file = writeBackup({"{}"});
+    TEST_ASSERT_FALSE(readBackup(file, 512, PASSPHRASE, ITERATIONS - 1));
+    TEST_ASSERT_EQUAL_STRING("Key derivation is too slow for this device.", error.c_str());
+
+    file[8] = 0xFF; // Младший байт u32 LE: меньше минимума формата
+    file[9] = file[10] = file[11] = 0;
+    TEST_ASSERT_FALSE(readBackup(file));
+    TEST_ASSERT_EQUAL_STRING("Unsupported key derivation parameters.", error.c_str());
+}
+
+void test_every_bit_flip_is_detected(void) {
+    Bytes file = writeBackup({"{\"name\":\"a\",\"secret\":\"GEZDGNBV\"}", "{\"name\":\"b\"}"});
+    for (size_t i = 0; i < file.size(); i++) {
+        for (int bit = 0; bit < 8; bit += 3) {
+            Bytes damaged = file;
+            damaged[i] ^= 1 << bit;
+            TEST_ASSERT_FALSE(readBackup(damaged));
+        }
+    }
+    TEST_ASSERT_TRUE(readBackup(file));
+}
+
+void test_every_truncation_is_detected(void) {
+    Bytes file = writeBackup(sampleRecords(20));
+    TEST_ASSERT_EQUAL_size_t(3, chunkOffsets(file).size());
+    for (size_t length = 0; length < file.size(); length++) {
+        Bytes truncated(file.begin(), file.begin() + length);
+        TEST_ASSERT_FALSE(readBackup(truncated));
+    }
+    // Обрыв ровно на границе блока выдает только отсутствие манифеста
+    Bytes truncated(file.begin(), file.begin() + chunkOffsets(file).back());
+    TEST_ASSERT_FALSE(readBackup(truncated));
+    TEST_ASSERT_EQUAL_STRING("Backup is truncated.", error.c_str());
+}
+
+void test_reordered_and_dropped_chunks(void) {
+    Bytes file = writeBackup(sampleRecords());
+    std::vector<size_t> offsets = chunkOffsets(file);
+    offsets.push_back(file.size());
+    auto chunkSize = [&](size_t i) { return offsets[i + 1] - offsets[i]; };
+    auto append = [&](Bytes& out, size_t i) { out.insert(out.end(), file.begin() + offsets[i], file.begin() + offsets[i + 1]); };
+    Bytes header(file.begin(), file.begin() + BACKUP_HEADER_SIZE);
+
+    // Первые блоки одной длины: перестановка не меняет структуру, но ломает nonce
+    TEST_ASSERT_EQUAL_size_t(chunkSize(0), chunkSize(1));
+    Bytes swapped = header;
+    append(swapped, 1);
+    append(swapped, 0);
+    for (size_t i = 2; i + 1 < offsets.size(); i++) append(swapped, i);
+    TEST_ASSERT_FALSE(readBackup(swapped));
+    TEST_ASSERT_EQUAL_STRING("Wrong passphrase or corrupted backup.", error.c_str());
+    TEST_ASSERT_EQUAL_size_t(0, records.size());
+
+    for (size_t drop = 0; drop + 1 < offsets.size(); drop++) {
+        Bytes dropped = header;
+        for (size_t i = 0; i + 1 < offsets.size(); i++) {
+            if (i != drop) append(dropped, i);
+        }
+        TEST_ASSERT_FALSE(readBackup(dropped));
+    }
+
+    // Блок из другой копии с тем же паролем не подходит: в AAD заголовок
+    Bytes other = writeBackup(sampleRecords());
+    Bytes mixed = file;
+    std::copy(other.begin() + offsets[1], other.begin() + offsets[2], mixed.begin() + offsets[1]);
+    TEST_ASSERT_FALSE(readBackup(mixed));
+}
+
+void test_trailing_data(void) {
+    Bytes file = writeBackup({"{}"});
+    file.push_back(0);
+    TEST_ASSERT_FALSE(readBackup(file));
+    TEST_ASSERT_EQUAL_STRING("Unexpected data after the manifest.", error.c_str());
+
+    // И вторая копия, приклеенная к первой
+    Bytes twice = writeBackup({"{}"});
+    Bytes second = writeBackup({"{}"});
+    twice.insert(twice.end(), second.begin(), second.end());
+    TEST_ASSERT_FALSE(readBackup(twice, twice.size()));
+    TEST_ASSERT_EQUAL_STRING("Unexpected data after the manifest.", error.c_str());
+}
+
+void test_rejected_record_stops_reading(void) {
+    Bytes file = writeBackup(sampleRecords());
+    int seen = 0;
+    BackupReader reader(PASSPHRASE, ITERATIONS, [&](const String& record) { return ++seen < 3; });
+    TEST_ASSERT_FALSE(reader.feed(file.data(), file.size()));
+    TEST_ASSERT_FALSE(reader.finish());
+    TEST_ASSERT_EQUAL_STRING("Invalid record.", reader.error().c_str());
+    TEST_ASSERT_EQUAL_INT(3, seen);
+}
+
+void test_not_a_backup(void) {
+    Bytes file = writeBackup({"{}"});
+    file[0] = 'X';
+    TEST_ASSERT_FALSE(readBackup(file));
+    TEST_ASSERT_EQUAL_STRING("Not a backup file.", error.c_str());
+    file[0] = 'T';
+    file[4] = 2;
+    TEST_ASSERT_FALSE(readBackup(file));
+    TEST_ASSERT_EQUAL_STRING("Unsupported backup version.", error.c_str());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_roundtrip);
+    RUN_TEST(test_empty_backup);
+    RUN_TEST(test_each_backup_is_unique);
+    RUN_TEST(test_oversized_record_is_skipped);
+    RUN_TEST(test_wrong_passphrase);
+    RUN_TEST(test_iterations_above_limit);
+    RUN_TEST(test_every_bit_flip_is_detected);
+    RUN_TEST(test_every_truncation_is_detected);
+    RUN_TEST(test_reordered_and_dropped_chunks);
+    RUN_TEST(test_trailing_data);
+    RUN_TEST(test_rejected_record_stops_reading);
+    RUN_TEST(test_not_a_backup);
+    return UNITY_END();
+}
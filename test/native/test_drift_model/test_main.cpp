@@ -0,0 +1,122 @@
+#include <unity.h>
+#include "drift_model.h"
+
+static const int64_t HOUR_US = 3600LL * 1000000LL;
+static const int64_t EPOCH_US = 1700000000LL * 1000000LL;
+
+static uint32_t noiseState;
+
+// Детерминированный шум синхронизации в пределах +-amplitudeUs
+static int64_t noise(int64_t amplitudeUs) {
+    noiseState = noiseState * 1103515245u + 12345u;
+    return (int64_t)((noiseState >> 8) % (uint32_t)(2 * amplitudeUs + 1)) - amplitudeUs;
+}
+
+// Синтетическая трасса: синхронизация каждые intervalUs, эталон идет
+// быстрее часов устройства на ppm (ppm > 0 - устройство отстает)
+static void feedTrace(DriftModel& model, float ppm, int samples, int64_t intervalUs, int64_t jitterUs) {
+    int64_t local = 0;
+    for (int i = 0; i < samples; i++) {
+        int64_t reference = EPOCH_US + local + (int64_t)(local * (double)ppm / 1e6) + noise(jitterUs);
+        TEST_ASSERT_TRUE(model.addSample(local, reference));
+        local += intervalUs;
+    }
+}
+
+void setUp(void) {
+    noiseState = 1;
+}
+
+void tearDown(void) {}
+
+void test_recovers_slow_clock(void) {
+    DriftModel model;
+    feedTrace(model, 23.0f, DriftModel::MAX_SAMPLES, HOUR_US, 20000);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 23.0f, model.getDriftPpm());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, DriftModel::MAX_SAMPLES - 1, model.getWeightHours());
+}
+
+void test_recovers_fast_clock(void) {
+    DriftModel model;
+    feedTrace(model, -41.5f, 8, HOUR_US / 2, 20000);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, -41.5f, model.getDriftPpm());
+}
+
+void test_short_span_keeps_prior(void) {
+    DriftModel model;
+    model.setPrior(12.0f, 5.0f);
+    // Пять минут наблюдения меньше MIN_SPAN_US - оценка сессии не используется
+    feedTrace(model, 200.0f, 6, 60LL * 1000000LL, 0);
+    TEST_ASSERT_EQUAL_INT(6, model.getSampleCount());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.0f, model.getDriftPpm());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 5.0f, model.getWeightHours());
+}
+
+void test_rejects_outliers(void) {
+    DriftModel model;
+    feedTrace(model, 10.0f, 4, HOUR_US, 0);
+    float before = model.getDriftPpm();
+    int64_t local = 4 * HOUR_US;
+    int64_t reference = EPOCH_US + local + (int64_t)(local * 10.0 / 1e6);
+
+    // Скачок эталона на 20 с за час - это не дрейф кварца
+    TEST_ASSERT_FALSE(model.addSample(local, reference + 20000000LL));
+    // Монотонное время не может идти назад
+    TEST_ASSERT_FALSE(model.addSample(HOUR_US, reference));
+    TEST_ASSERT_EQUAL_INT(4, model.getSampleCount());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, before, model.getDriftPpm());
+
+    TEST_ASSERT_TRUE(model.addSample(local, reference));
+}
+
+void test_blends_prior_by_weight(void) {
+    DriftModel model;
+    model.setPrior(-20.0f, 48.0f);
+    feedTrace(model, 0.0f, 2, HOUR_US, 0);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -20.0f * 48.0f / 49.0f, model.getDriftPpm());
+    // Вес накопленной оценки ограничен
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, DriftModel::MAX_WEIGHT_HOURS, model.getWeightHours());
+}
+
+void test_prior_is_clamped(void) {
+    DriftModel model;
+    model.setPrior(1000.0f, -3.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, DriftModel::MAX_PPM, model.getDriftPpm());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, model.getWeightHours());
+    model.setPrior(0.0f, 1000.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, DriftModel::MAX_WEIGHT_HOURS, model.getWeightHours());
+}
+
+void test_keeps_latest_samples(void) {
+    DriftModel model;
+    feedTrace(model, 35.0f, 3 * DriftModel::MAX_SAMPLES, HOUR_US, 20000);
+    TEST_ASSERT_EQUAL_INT(DriftModel::MAX_SAMPLES, model.getSampleCount());
+    TEST_ASSERT_FLOAT_WITHIN(1.5f, 35.0f, model.getDriftPpm());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, DriftModel::MAX_SAMPLES - 1, model.getWeightHours());
+}
+
+void test_correction_and_reset(void) {
+    DriftModel model;
+    model.setPrior(50.0f, 10.0f);
+    TEST_ASSERT_EQUAL_INT64(180000, model.correctionUs(HOUR_US));
+    TEST_ASSERT_EQUAL_INT64(-180000, model.correctionUs(-HOUR_US));
+
+    feedTrace(model, -50.0f, 5, HOUR_US, 0);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, (50.0f * 10.0f - 50.0f * 4.0f) / 14.0f, model.getDriftPpm());
+    model.resetSession();
+    TEST_ASSERT_EQUAL_INT(0, model.getSampleCount());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 50.0f, model.getDriftPpm());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_recovers_slow_clock);
+    RUN_TEST(test_recovers_fast_clock);
+    RUN_TEST(test_short_span_keeps_prior);
+    RUN_TEST(test_rejects_outliers);
+    RUN_TEST(test_blends_prior_by_weight);
+    RUN_TEST(test_prior_is_clamped);
+    RUN_TEST(test_keeps_latest_samples);
+    RUN_TEST(test_correction_and_reset);
+    return UNITY_END();
+}
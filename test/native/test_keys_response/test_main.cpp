@@ -0,0 +1,127 @@
+#include <unity.h>
+#include "config.h"
+#include "keys_response.h"
+
+// Размеры тела /api/keys для 10, 100 и 1000 ключей с именами "Service N",
+// без групп, с шестизначными кодами
+static const uint32_t REVISION = 0x5A3C0000;
+static const time_t NOW = 1760000022; // 18 с до конца шага
+
+static std::vector<TOTPKey> makeKeys(int count) {
+    std::vector<TOTPKey> keys(count);
+    for (int i = 0; i < count; i++) {
+        keys[i].name = "Service " + String(i + 1);
+        keys[i].algorithm = OtpAlgorithm::SHA1;
+        keys[i].digits = 6;
+        keys[i].period = CONFIG_TOTP_STEP_SIZE;
+    }
+    return keys;
+}
+
+static String code(int index) {
+    char text[8];
+    snprintf(text, sizeof(text), "%06d", (index * 7919 + 123456) % 1000000);
+    return text;
+}
+
+static size_t fullSize(const std::vector<TOTPKey>& keys, String* body = nullptr) {
+    JsonDocument doc;
+    KeysResponse::full(doc, REVISION, NOW, keys, code);
+    String output;
+    serializeJson(doc, output);
+    if (body) *body = output;
+    return output.length();
+}
+
+// Дельта после добавления последнего ключа
+static size_t deltaSize(const std::vector<TOTPKey>& keys, String* body = nullptr) {
+    KeyChange change;
+    change.revision = REVISION;
+    change.type = KeyChangeType::ADD;
+    change.index = keys.size() - 1;
+    change.name = keys.back().name;
+    change.group = keys.back().group;
+    change.period = keys.back().period;
+    JsonDocument doc;
+    KeysResponse::delta(doc, REVISION, NOW, {change}, keys.size(), code);
+    String output;
+    serializeJson(doc, output);
+    if (body) *body = output;
+    return output.length();
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_full_format(void) {
+    std::vector<TOTPKey> keys = makeKeys(2);
+    keys[1].period = 60;
+    String body;
+    fullSize(keys, &body);
+    TEST_ASSERT_EQUAL_STRING("{\"rev\":1513881600,\"step\":58666667,\"left\":18,"
+                             "\"names\":[\"Service 1\",\"Service 2\"],\"groups\":[\"\",\"\"],"
+                             "\"periods\":[30,60],\"codes\":[\"123456\",\"131375\"]}",
+                             body.c_str());
+}
+
+void test_delta_format(void) {
+    std::vector<TOTPKey> keys = makeKeys(2);
+    keys[1].group = "Work";
+    keys[1].period = 90;
+    String body;
+    deltaSize(keys, &body);
+    TEST_ASSERT_EQUAL_STRING("{\"rev\":1513881600,\"step\":58666667,\"left\":18,"
+                             "\"ops\":[[\"+\",\"Service 2\",\"Work\",90]],\"codes\":[\"123456\",\"131375\"]}",
+                             body.c_str());
+
+    KeyChange removal;
+    removal.revision = REVISION;
+    removal.type = KeyChangeType::REMOVE;
+    removal.index = 0;
+    JsonDocument doc;
+    KeysResponse::delta(doc, REVISION, NOW, {removal}, 1, code);
+    serializeJson(doc, body);
+    TEST_ASSERT_EQUAL_STRING("{\"rev\":1513881600,\"step\":58666667,\"left\":18,\"ops\":[[\"-\",0]],\"codes\":[\"123456\"]}",
+                             body.c_str());
+}
+
+void test_etag(void) {
+    // Тот же шаг и та же версия - тот же ETag, и ответ 304 без тела
+    String etag = KeysResponse::etag(REVISION, NOW);
+    TEST_ASSERT_EQUAL_STRING("\"1513881600-58666667\"", etag.c_str());
+    TEST_ASSERT_TRUE(etag == KeysResponse::etag(REVISION, NOW + 17));
+    TEST_ASSERT_FALSE(etag == KeysResponse::etag(REVISION, NOW + 18));
+    TEST_ASSERT_FALSE(etag == KeysResponse::etag(REVISION + 1, NOW));
+}
+
+void test_payload_sizes(void) {
+    // Тело: полный список, дельта с одним добавлением, 304 (только ETag в заголовке)
+    struct Expected {
+        int keys;
+        size_t full;
+        size_t delta;
+    };
+    const Expected expected[] = {{10, 358, 177}, {100, 2879, 988}, {1000, 28980, 9089}};
+    size_t etagBytes = KeysResponse::etag(REVISION, NOW).length();
+    for (const Expected& e : expected) {
+        std::vector<TOTPKey> keys = makeKeys(e.keys);
+        size_t full = fullSize(keys);
+        size_t delta = deltaSize(keys);
+        char line[96];
+        snprintf(line, sizeof(line), "%4d keys: full %5u B, delta %5u B, 304 0 B (ETag %u B)",
+                 e.keys, (unsigned)full, (unsigned)delta, (unsigned)etagBytes);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_EQUAL_size_t(e.full, full);
+        TEST_ASSERT_EQUAL_size_t(e.delta, delta);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_format);
+    RUN_TEST(test_delta_format);
+    RUN_TEST(test_etag);
+    RUN_TEST(test_payload_sizes);
+    return UNITY_END();
+}
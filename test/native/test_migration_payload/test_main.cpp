@@ -0,0 +1,214 @@
+#include <unity.h>
+#include <string>
+#include "migration_payload.h"
+
+// Экспорт Google Authenticator ("Перенос аккаунтов") с одним ключом Example:alice@google.com
+static const char* EXPORT_EXAMPLE =
+    "otpauth-migration://offline?data=CjEKCkhlbGxvId6tvu8SGEV4YW1wbGU6YWxpY2VAZ29vZ2xlLmNvbRoHRXhhbXBsZSABKAEwAhABGAEgACiVvfj7Ag%3D%3D";
+// Синтетический экспорт, собранный по схеме MigrationPayload (не снят с приложения):
+// Acme:alice (SHA1, секрет RFC 4226), Bank:bob (SHA256, 8 цифр), hotpkey (HOTP), md5key (MD5),
+// затем version, batch_size, batch_index и batch_id
+static const char* EXPORT_MIXED =
+    "otpauth-migration://offline?data=CikKFDEyMzQ1Njc4OTAxMjM0NTY3ODkwEgVhbGljZRoEQWNtZSABKAEwAgoiCgoBAgMEBQYHCAkKEghCYW5rOmJvYhoE"
+    "QmFuayACKAIwAgofCgphYmNkZWZnaGlqEgdob3Rwa2V5GgAgASgBMAE4BQocCgphYmNkZWZnaGlqEgZtZDVrZXkaACAEKAEwAhABGAEgACiVmu86";
+// Две первые записи EXPORT_MIXED без служебных полей - сообщение кончается на границе записи
+static const char* MIXED_ENTRIES =
+    "CikKFDEyMzQ1Njc4OTAxMjM0NTY3ODkwEgVhbGljZRoEQWNtZSABKAEwAgoiCgoBAgMEBQYHCAkKEghCYW5rOmJvYhoEQmFuayACKAIwAg";
+
+static std::vector<TOTPKey> keys;
+static std::vector<String> skipped;
+static String error;
+
+static bool parse(const String& uri) {
+    return MigrationPayload::parse(uri, keys, skipped, error);
+}
+
+// Сборка сообщения MigrationPayload для записей, которых нет в образцах выше
+static const int FIELD_HIGH = 257;
+
+static std::string varint(uint64_t value) {
+    std::string out;
+    do {
+        out += (char)((value & 0x7F) | (value > 0x7F ? 0x80 : 0));
+        value >>= 7;
+    } while (value);
+    return out;
+}
+
+static std::string lengthField(int field, const std::string& data) {
+    return varint(field << 3 | 2) + varint(data.size()) + data;
+}
+
+static std::string varintField(int field, uint64_t value) {
+    return varint(field << 3) + varint(value);
+}
+
+// Запись otp_parameters: SHA1, 6 цифр, TOTP
+static std::string entry(const std::string& secret, const std::string& name, const std::string& issuer = "") {
+    std::string fields = lengthField(1, secret) + lengthField(2, name);
+    if (!issuer.empty()) fields += lengthField(3, issuer);
+    fields += varintField(4, 1) + varintField(5, 1) + varintField(6, 2);
+    return lengthField(1, fields);
+}
+
+static String toUri(const std::string& message) {
+    static const char* ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    String data;
+    for (size_t i = 0; i < message.size(); i += 3) {
+        uint32_t chunk = (uint8_t)message[i] << 16;
+        if (i + 1 < message.size()) chunk |= (uint8_t)message[i + 1] << 8;
+        if (i + 2 < message.size()) chunk |= (uint8_t)message[i + 2];
+        for (size_t j = 0; j < 4; j++) {
+            data += i + j <= message.size() + (j == 0) ? ALPHABET[(chunk >> (18 - 6 * j)) & 0x3F] : '=';
+        }
+    }
+    data.replace("+", "%2B");
+    data.replace("/", "%2F");
+    data.replace("=", "%3D");
+    return "otpauth-migration://offline?data=" + data;
+}
+
+void setUp(void) {
+    keys.clear();
+    skipped.clear();
+    error = "";
+}
+
+void tearDown(void) {}
+
+void test_is_migration_uri(void) {
+    TEST_ASSERT_TRUE(MigrationPayload::isMigrationUri(EXPORT_EXAMPLE));
+    TEST_ASSERT_TRUE(MigrationPayload::isMigrationUri("OTPAUTH-MIGRATION://offline?data="));
+    TEST_ASSERT_FALSE(MigrationPayload::isMigrationUri("otpauth://totp/x?secret=GEZDGNBV"));
+    TEST_ASSERT_FALSE(MigrationPayload::isMigrationUri("otpauth-migration:/"));
+    TEST_ASSERT_FALSE(MigrationPayload::isMigrationUri(""));
+}
+
+void test_parse_example_export(void) {
+    TEST_ASSERT_TRUE(parse(EXPORT_EXAMPLE));
+    TEST_ASSERT_EQUAL_size_t(1, keys.size());
+    TEST_ASSERT_EQUAL_size_t(0, skipped.size());
+    TEST_ASSERT_EQUAL_STRING("Example:alice@google.com", keys[0].name.c_str());
+    TEST_ASSERT_EQUAL_STRING("JBSWY3DPEHPK3PXP", keys[0].secret.c_str());
+    TEST_ASSERT_EQUAL_UINT8(6, keys[0].digits);
+    TEST_ASSERT_EQUAL_UINT16(30, keys[0].period);
+    TEST_ASSERT_TRUE(keys[0].algorithm == OtpAlgorithm::SHA1);
+}
+
+void test_parse_mixed_export(void) {
+    TEST_ASSERT_TRUE(parse(EXPORT_MIXED));
+    TEST_ASSERT_EQUAL_size_t(2, keys.size());
+    TEST_ASSERT_EQUAL_STRING("Acme:alice", keys[0].name.c_str());
+    TEST_ASSERT_EQUAL_STRING("GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ", keys[0].secret.c_str());
+    TEST_ASSERT_TRUE(keys[0].algorithm == OtpAlgorithm::SHA1);
+    // Издатель уже есть в name ("Bank:bob") и не дублируется
+    TEST_ASSERT_EQUAL_STRING("Bank:bob", keys[1].name.c_str());
+    TEST_ASSERT_EQUAL_STRING("AEBAGBAFAYDQQCIK", keys[1].secret.c_str());
+    TEST_ASSERT_EQUAL_UINT8(8, keys[1].digits);
+    TEST_ASSERT_TRUE(keys[1].algorithm == OtpAlgorithm::SHA256);
+
+    TEST_ASSERT_EQUAL_size_t(2, skipped.size());
+    TEST_ASSERT_EQUAL_STRING("hotpkey: HOTP keys are not supported.", skipped[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("md5key: Unsupported algorithm.", skipped[1].c_str());
+}
+
+void test_unsupported_entries_are_skipped(void) {
+    std::string message = entry("0123456789", std::string(MIGRATION_MAX_TEXT + 1, 'L'))
+                        + entry(std::string(TOTP_MAX_SECRET_BYTES + 1, '\0'), "big")
+                        + entry("", "nosecret")
+                        + entry("0123456789", "", "")
+                        + entry("0123456789", "ok", "Svc")
+                        + varintField(2, 1) + varintField(3, 2) + varintField(4, 0) + varintField(5, 7);
+    TEST_ASSERT_TRUE(parse(toUri(message)));
+    TEST_ASSERT_EQUAL_size_t(1, keys.size());
+    TEST_ASSERT_EQUAL_STRING("Svc:ok", keys[0].name.c_str());
+
+    TEST_ASSERT_EQUAL_size_t(4, skipped.size());
+    std::string tooLong = std::string(MIGRATION_MAX_TEXT, 'L') + ": Name or issuer is too long.";
+    TEST_ASSERT_EQUAL_STRING(tooLong.c_str(), skipped[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("big: Secret is too long.", skipped[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("nosecret: Missing secret.", skipped[2].c_str());
+    TEST_ASSERT_EQUAL_STRING(": Empty name.", skipped[3].c_str());
+}
+
+void test_unknown_fields_are_skipped(void) {
+    // Номер поля 257 в младших восьми битах совпадает с 1 (секрет и otp_parameters)
+    std::string fields = lengthField(FIELD_HIGH, "ABCDEFGHIJ") + lengthField(1, "0123456789") + lengthField(2, "a")
+                       + varintField(4, 1) + varintField(5, 1) + varintField(6, 2);
+    std::string message = lengthField(FIELD_HIGH, entry("zzzzzzzzzz", "ghost")) + lengthField(1, fields);
+    TEST_ASSERT_TRUE(parse(toUri(message)));
+    TEST_ASSERT_EQUAL_size_t(1, keys.size());
+    TEST_ASSERT_EQUAL_STRING("a", keys[0].name.c_str());
+    TEST_ASSERT_EQUAL_STRING("GAYTEMZUGU3DOOBZ", keys[0].secret.c_str());
+    TEST_ASSERT_EQUAL_size_t(0, skipped.size());
+
+    // Поле 257 после секрета не подменяет его
+    fields = lengthField(1, "0123456789") + lengthField(FIELD_HIGH, "ABCDEFGHIJ") + lengthField(2, "b");
+    keys.clear();
+    TEST_ASSERT_TRUE(parse(toUri(lengthField(1, fields))));
+    TEST_ASSERT_EQUAL_STRING("GAYTEMZUGU3DOOBZ", keys[0].secret.c_str());
+}
+
+void test_errors_keep_keys(void) {
+    TOTPKey existing = {"Existing", "GEZDGNBV", "", OtpAlgorithm::SHA1, 6, 30};
+    keys.push_back(existing);
+
+    TEST_ASSERT_FALSE(parse("otpauth://totp/x?secret=GEZDGNBV"));
+    TEST_ASSERT_EQUAL_STRING("Not an otpauth-migration:// URI.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth-migration://offline?x=1"));
+    TEST_ASSERT_EQUAL_STRING("Missing data parameter.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth-migration://offline?data=Cik*"));
+    TEST_ASSERT_EQUAL_STRING("Invalid Base64 data.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth-migration://offline?data=CikKFDEyMzQ1"));
+    TEST_ASSERT_EQUAL_STRING("Corrupted migration data.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth-migration://offline?data="));
+    TEST_ASSERT_EQUAL_STRING("No accounts in migration data.", error.c_str());
+
+    TEST_ASSERT_EQUAL_size_t(1, keys.size());
+    TEST_ASSERT_EQUAL_STRING("Existing", keys[0].name.c_str());
+
+    // Успешный разбор дописывает ключи в конец
+    TEST_ASSERT_TRUE(parse(EXPORT_EXAMPLE));
+    TEST_ASSERT_EQUAL_size_t(2, keys.size());
+    TEST_ASSERT_EQUAL_STRING("Existing", keys[0].name.c_str());
+}
+
+void test_data_after_other_parameters(void) {
+    String uri = EXPORT_EXAMPLE;
+    uri.replace("?data=", "?batch=1&data=");
+    TEST_ASSERT_TRUE(parse(uri));
+    TEST_ASSERT_EQUAL_size_t(1, keys.size());
+}
+
+void test_truncated_at_every_byte(void) {
+    String full = MIXED_ENTRIES;
+    TEST_ASSERT_TRUE(parse(String("otpauth-migration://offline?data=") + full));
+    TEST_ASSERT_EQUAL_size_t(2, keys.size());
+
+    // Обрезанный QR никогда не дает часть ключей: либо ошибка, либо целые записи
+    for (unsigned int n = 0; n < full.length(); n++) {
+        keys.clear();
+        skipped.clear();
+        bool ok = parse(String("otpauth-migration://offline?data=") + full.substring(0, n));
+        if (ok) {
+            TEST_ASSERT_EQUAL_size_t(1, keys.size());
+            TEST_ASSERT_EQUAL_STRING("Acme:alice", keys[0].name.c_str());
+        } else {
+            TEST_ASSERT_EQUAL_size_t(0, keys.size());
+            TEST_ASSERT_TRUE(error.length() > 0);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_is_migration_uri);
+    RUN_TEST(test_parse_example_export);
+    RUN_TEST(test_parse_mixed_export);
+    RUN_TEST(test_unsupported_entries_are_skipped);
+    RUN_TEST(test_unknown_fields_are_skipped);
+    RUN_TEST(test_errors_keep_keys);
+    RUN_TEST(test_data_after_other_parameters);
+    RUN_TEST(test_truncated_at_every_byte);
+    return UNITY_END();
+}
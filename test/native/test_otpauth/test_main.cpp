@@ -0,0 +1,181 @@
+#include <unity.h>
+#include "otpauth.h"
+#include "totp_generator.h"
+
+static const char* SECRET_SHA1 = "12345678901234567890";
+static const char* SECRET_SHA256 = "12345678901234567890123456789012";
+static const char* SECRET_SHA512 = "1234567890123456789012345678901234567890123456789012345678901234";
+
+static OtpAuthParams params;
+static String error;
+
+static String base32(const char* raw) {
+    return TOTPGenerator::base32Encode((const uint8_t*)raw, strlen(raw));
+}
+
+static bool parse(const String& uri) {
+    return OtpAuthUri::parse(uri, params, error);
+}
+
+void setUp(void) {
+    error = "";
+}
+
+void tearDown(void) {}
+
+void test_hotp_rfc4226(void) {
+    // RFC 4226, приложение D
+    const char* expected[] = {"755224", "287082", "359152", "969429", "338314",
+                              "254676", "287922", "162583", "399871", "520489"};
+    for (int counter = 0; counter < 10; counter++) {
+        String code = TOTPGenerator::generateCode((const uint8_t*)SECRET_SHA1, 20, counter, 6, OtpAlgorithm::SHA1);
+        TEST_ASSERT_EQUAL_STRING(expected[counter], code.c_str());
+    }
+}
+
+void test_totp_rfc6238(void) {
+    // RFC 6238, приложение B: 8 цифр, период 30 с
+    struct Vector {
+        uint64_t time;
+        const char* sha1;
+        const char* sha256;
+        const char* sha512;
+    };
+    const Vector vectors[] = {
+        {59, "94287082", "46119246", "90693936"},
+        {1111111109, "07081804", "68084774", "25091201"},
+        {1111111111, "14050471", "67062674", "99943326"},
+        {1234567890, "89005924", "91819424", "93441116"},
+        {2000000000, "69279037", "90698825", "38618901"},
+        {20000000000ULL, "65353130", "77737706", "47863826"},
+    };
+    for (const Vector& v : vectors) {
+        uint64_t counter = v.time / 30;
+        TEST_ASSERT_EQUAL_STRING(v.sha1, TOTPGenerator::generateCode((const uint8_t*)SECRET_SHA1, 20, counter, 8, OtpAlgorithm::SHA1).c_str());
+        TEST_ASSERT_EQUAL_STRING(v.sha256, TOTPGenerator::generateCode((const uint8_t*)SECRET_SHA256, 32, counter, 8, OtpAlgorithm::SHA256).c_str());
+        TEST_ASSERT_EQUAL_STRING(v.sha512, TOTPGenerator::generateCode((const uint8_t*)SECRET_SHA512, 64, counter, 8, OtpAlgorithm::SHA512).c_str());
+    }
+}
+
+void test_base32(void) {
+    uint8_t buffer[TOTP_MAX_SECRET_BYTES];
+    // Секрет SHA512 из RFC (64 байта) помещается, на байт длиннее - нет
+    TEST_ASSERT_EQUAL_size_t(64, TOTPGenerator::base32Decode(base32(SECRET_SHA512), buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_MEMORY(SECRET_SHA512, buffer, 64);
+    String tooLong = String(SECRET_SHA512) + "5";
+    TEST_ASSERT_EQUAL_size_t(0, TOTPGenerator::base32Decode(base32(tooLong.c_str()), buffer, sizeof(buffer)));
+
+    // Нижний регистр и пробелы, как секрет показывают сервисы
+    TEST_ASSERT_EQUAL_size_t(10, TOTPGenerator::base32Decode("jbsw y3dp ehpk 3pxp", buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_MEMORY("Hello!\xDE\xAD\xBE\xEF", buffer, 10);
+
+    for (size_t length = 1; length <= sizeof(buffer); length++) {
+        uint8_t input[TOTP_MAX_SECRET_BYTES];
+        for (size_t i = 0; i < length; i++) input[i] = (uint8_t)(i * 37 + length);
+        String encoded = TOTPGenerator::base32Encode(input, length);
+        TEST_ASSERT_EQUAL_size_t(length, TOTPGenerator::base32Decode(encoded, buffer, sizeof(buffer)));
+        TEST_ASSERT_EQUAL_MEMORY(input, buffer, length);
+    }
+}
+
+void test_parse_google_example(void) {
+    TEST_ASSERT_TRUE(parse("otpauth://totp/Example:alice@google.com?secret=JBSWY3DPEHPK3PXP&issuer=Example"));
+    TEST_ASSERT_FALSE(params.hotp);
+    TEST_ASSERT_EQUAL_STRING("Example", params.issuer.c_str());
+    TEST_ASSERT_EQUAL_STRING("alice@google.com", params.account.c_str());
+    TEST_ASSERT_EQUAL_STRING("JBSWY3DPEHPK3PXP", params.secret.c_str());
+    TEST_ASSERT_EQUAL_UINT8(6, params.digits);
+    TEST_ASSERT_EQUAL_UINT32(30, params.period);
+    TEST_ASSERT_TRUE(params.algorithm == OtpAlgorithm::SHA1);
+}
+
+void test_parse_all_parameters(void) {
+    TEST_ASSERT_TRUE(parse("OTPAUTH://TOTP/ACME%20Co:john.doe%40email.com?secret=hxdm vjec jjws rb3h wizr 4ifu gftm xboz"
+                           "&issuer=ACME%20Co&algorithm=SHA256&digits=8&period=60"));
+    TEST_ASSERT_EQUAL_STRING("ACME Co", params.issuer.c_str());
+    TEST_ASSERT_EQUAL_STRING("john.doe@email.com", params.account.c_str());
+    TEST_ASSERT_EQUAL_STRING("HXDMVJECJJWSRB3HWIZR4IFUGFTMXBOZ", params.secret.c_str());
+    TEST_ASSERT_TRUE(params.algorithm == OtpAlgorithm::SHA256);
+    TEST_ASSERT_EQUAL_UINT8(8, params.digits);
+    TEST_ASSERT_EQUAL_UINT32(60, params.period);
+
+    TEST_ASSERT_TRUE(parse("otpauth://hotp/Label?secret=GEZDGNBV&counter=18446744073709551615"));
+    TEST_ASSERT_TRUE(params.hotp);
+    TEST_ASSERT_TRUE(params.counter == 18446744073709551615ULL);
+    TEST_ASSERT_EQUAL_STRING("Label", params.account.c_str());
+
+    // Издатель только из метки, неизвестные параметры пропускаются
+    TEST_ASSERT_TRUE(parse("otpauth://totp/Issuer:?secret=GEZDGNBV&image=http%3A%2F%2Fx"));
+    TEST_ASSERT_EQUAL_STRING("Issuer", params.issuer.c_str());
+    TEST_ASSERT_EQUAL_STRING("", params.account.c_str());
+}
+
+void test_parse_rejects_invalid(void) {
+    TEST_ASSERT_FALSE(parse("http://totp/L?secret=GEZDGNBV"));
+    TEST_ASSERT_EQUAL_STRING("Not an otpauth:// URI.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth://totp/L"));
+    TEST_ASSERT_EQUAL_STRING("Missing or too long secret.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth://hotp/Label?secret=GEZDGNBV"));
+    TEST_ASSERT_EQUAL_STRING("HOTP URI without counter.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth://totp/L?secret=GEZ1"));
+    TEST_ASSERT_EQUAL_STRING("Secret is not Base32.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth://totp/L?secret=GEZDGNBV&digits=9"));
+    TEST_ASSERT_EQUAL_STRING("Digits must be 6 to 8.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth://totp/L?secret=GEZDGNBV&algorithm=MD5"));
+    TEST_ASSERT_EQUAL_STRING("Unsupported algorithm.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth://totp/L%2?secret=GEZDGNBV"));
+    TEST_ASSERT_EQUAL_STRING("Invalid label encoding.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth://totp/?secret=GEZDGNBV"));
+    TEST_ASSERT_EQUAL_STRING("Empty label.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth://motp/L?secret=GEZDGNBV"));
+    TEST_ASSERT_EQUAL_STRING("Unknown OTP type.", error.c_str());
+    TEST_ASSERT_FALSE(parse("otpauth://totp/L?secret=" + base32(SECRET_SHA512) + "GEZDGNBV"));
+    TEST_ASSERT_EQUAL_STRING("Missing or too long secret.", error.c_str());
+}
+
+void test_build_roundtrip(void) {
+    TOTPKey key;
+    TEST_ASSERT_TRUE(parse("otpauth://totp/GitHub:al%20ice?secret=JBSWY3DPEHPK3PXP&issuer=GitHub&digits=8&period=60&algorithm=SHA512"));
+    TEST_ASSERT_TRUE(OtpAuthUri::toKey(params, key, error));
+    TEST_ASSERT_EQUAL_STRING("GitHub:al ice", key.name.c_str());
+    TEST_ASSERT_EQUAL_UINT8(8, key.digits);
+    TEST_ASSERT_EQUAL_UINT16(60, key.period);
+    TEST_ASSERT_TRUE(key.algorithm == OtpAlgorithm::SHA512);
+
+    // Параметры по умолчанию не пишутся, остальные - в порядке algorithm, digits, period
+    String uri = OtpAuthUri::build(key);
+    TEST_ASSERT_EQUAL_STRING("otpauth://totp/GitHub:al%20ice?secret=JBSWY3DPEHPK3PXP&issuer=GitHub&algorithm=SHA512&digits=8&period=60",
+                             uri.c_str());
+
+    TOTPKey copy;
+    TEST_ASSERT_TRUE(parse(uri));
+    TEST_ASSERT_TRUE(OtpAuthUri::toKey(params, copy, error));
+    TEST_ASSERT_EQUAL_STRING(key.name.c_str(), copy.name.c_str());
+    TEST_ASSERT_EQUAL_STRING(key.secret.c_str(), copy.secret.c_str());
+    TEST_ASSERT_EQUAL_UINT8(key.digits, copy.digits);
+    TEST_ASSERT_EQUAL_UINT16(key.period, copy.period);
+    TEST_ASSERT_TRUE(copy.algorithm == key.algorithm);
+}
+
+void test_to_key_rejects_unsupported(void) {
+    TOTPKey key;
+    TEST_ASSERT_TRUE(parse("otpauth://totp/x?secret=GEZDGNBV&period=45"));
+    TEST_ASSERT_FALSE(OtpAuthUri::toKey(params, key, error));
+    TEST_ASSERT_EQUAL_STRING("Unsupported period.", error.c_str());
+    TEST_ASSERT_TRUE(parse("otpauth://hotp/x?secret=GEZDGNBV&counter=1"));
+    TEST_ASSERT_FALSE(OtpAuthUri::toKey(params, key, error));
+    TEST_ASSERT_EQUAL_STRING("HOTP keys are not supported.", error.c_str());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_hotp_rfc4226);
+    RUN_TEST(test_totp_rfc6238);
+    RUN_TEST(test_base32);
+    RUN_TEST(test_parse_google_example);
+    RUN_TEST(test_parse_all_parameters);
+    RUN_TEST(test_parse_rejects_invalid);
+    RUN_TEST(test_build_roundtrip);
+    RUN_TEST(test_to_key_rejects_unsupported);
+    return UNITY_END();
+}
@@ -0,0 +1,163 @@
+#include <unity.h>
+#include <string.h>
+#include "pin_entry.h"
+
+// Набирает цифры PIN по одной, как владелец кнопками: NEXT до нужной цифры, затем CONFIRM
+static void typeDigits(PinEntry& entry, const char* digits, unsigned long now) {
+    for (const char* p = digits; *p; p++) {
+        for (int i = 0; i < *p - '0'; i++) entry.press(PinButton::NEXT, now);
+        entry.press(PinButton::CONFIRM, now);
+    }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_enter_and_accept(void) {
+    PinEntry entry;
+    TEST_ASSERT_FALSE(entry.isActive());
+    entry.start(4, 0, 0);
+    TEST_ASSERT_TRUE(entry.isActive());
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::INPUT);
+
+    typeDigits(entry, "2001", 10);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::VERIFY);
+    TEST_ASSERT_EQUAL_STRING("2001", entry.getPin());
+
+    entry.setResult(true, 0, 100);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::ACCEPTED);
+    TEST_ASSERT_EQUAL_STRING("", entry.getPin());
+    entry.update(100 + PinEntry::ACCEPTED_MS - 1);
+    TEST_ASSERT_TRUE(entry.isActive());
+    entry.update(100 + PinEntry::ACCEPTED_MS);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::DONE);
+    TEST_ASSERT_FALSE(entry.isActive());
+}
+
+void test_digit_selector_wraps(void) {
+    PinEntry entry;
+    entry.start(1, 0, 0);
+    for (int i = 0; i < 13; i++) entry.press(PinButton::NEXT, 0);
+    TEST_ASSERT_EQUAL_INT(3, entry.getCurrentDigit());
+    entry.press(PinButton::CONFIRM, 0);
+    TEST_ASSERT_EQUAL_STRING("3", entry.getPin());
+}
+
+void test_redraws_only_changed_cells(void) {
+    PinEntry entry;
+    entry.start(4, 0, 0);
+    TEST_ASSERT_TRUE(entry.takeScreenDirty());
+    TEST_ASSERT_FALSE(entry.takeScreenDirty());
+
+    entry.press(PinButton::NEXT, 10);
+    TEST_ASSERT_TRUE(entry.takeDigitDirty());
+    TEST_ASSERT_EQUAL_UINT16(0, entry.takeDirtyCells());
+
+    entry.press(PinButton::CONFIRM, 20);
+    TEST_ASSERT_EQUAL_UINT16(0x1, entry.takeDirtyCells());
+    TEST_ASSERT_TRUE(entry.takeDigitDirty());
+    TEST_ASSERT_EQUAL_INT(0, entry.getCurrentDigit());
+
+    // Несколько нажатий между кадрами копятся в одной маске
+    entry.press(PinButton::CONFIRM, 30);
+    entry.press(PinButton::CONFIRM, 40);
+    TEST_ASSERT_EQUAL_UINT16(0x6, entry.takeDirtyCells());
+    TEST_ASSERT_EQUAL_UINT16(0, entry.takeDirtyCells());
+    TEST_ASSERT_FALSE(entry.takeScreenDirty());
+
+    // Смена состояния - полный экран, ячейки уже не нужны
+    entry.press(PinButton::CONFIRM, 50);
+    TEST_ASSERT_TRUE(entry.takeScreenDirty());
+    TEST_ASSERT_EQUAL_UINT16(0, entry.takeDirtyCells());
+    TEST_ASSERT_FALSE(entry.takeDigitDirty());
+}
+
+void test_wrong_pin_then_lockout(void) {
+    PinEntry entry;
+    entry.start(4, 0, 0);
+    typeDigits(entry, "1111", 50);
+    entry.setResult(false, 2000, 100);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::REJECTED);
+    TEST_ASSERT_EQUAL_INT(0, entry.getEnteredCount());
+
+    entry.update(100 + PinEntry::REJECTED_MS - 1);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::REJECTED);
+    entry.update(100 + PinEntry::REJECTED_MS);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::LOCKED);
+
+    // Во время задержки нажатия игнорируются
+    entry.press(PinButton::NEXT, 1200);
+    entry.press(PinButton::CONFIRM, 1200);
+    TEST_ASSERT_EQUAL_INT(0, entry.getEnteredCount());
+    TEST_ASSERT_EQUAL_INT(0, entry.getCurrentDigit());
+    TEST_ASSERT_EQUAL_UINT32(1500, entry.getLockoutRemainingMs(1600));
+
+    entry.update(3099);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::LOCKED);
+    entry.update(3100);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::INPUT);
+    TEST_ASSERT_EQUAL_UINT32(0, entry.getLockoutRemainingMs(3100));
+
+    typeDigits(entry, "2001", 3200);
+    TEST_ASSERT_EQUAL_STRING("2001", entry.getPin());
+}
+
+void test_wrong_pin_without_lockout(void) {
+    PinEntry entry;
+    entry.start(4, 0, 0);
+    typeDigits(entry, "0000", 0);
+    entry.setResult(false, 0, 100);
+    entry.update(100 + PinEntry::REJECTED_MS);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::INPUT);
+}
+
+void test_start_locked_after_reboot(void) {
+    // Задержка, сохраненная до перезагрузки, действует сразу
+    PinEntry entry;
+    entry.start(6, 30000, 5000);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::LOCKED);
+    TEST_ASSERT_EQUAL_UINT32(30000, entry.getLockoutRemainingMs(5000));
+    entry.update(35000);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::INPUT);
+    TEST_ASSERT_EQUAL_INT(6, entry.getLength());
+}
+
+void test_ignores_unexpected_events(void) {
+    PinEntry entry;
+    entry.press(PinButton::CONFIRM, 0);
+    entry.setResult(true, 0, 0);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::IDLE);
+
+    entry.start(2, 0, 0);
+    entry.setResult(true, 0, 0);  // Еще не набран
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::INPUT);
+
+    typeDigits(entry, "12", 0);
+    entry.press(PinButton::CONFIRM, 0);  // Лишнее нажатие во время проверки
+    TEST_ASSERT_EQUAL_STRING("12", entry.getPin());
+}
+
+void test_length_is_clamped(void) {
+    PinEntry entry;
+    entry.start(0, 0, 0);
+    TEST_ASSERT_EQUAL_INT(1, entry.getLength());
+    entry.start(42, 0, 0);
+    TEST_ASSERT_EQUAL_INT(PinEntry::MAX_LENGTH, entry.getLength());
+    typeDigits(entry, "9876543210", 0);
+    TEST_ASSERT_TRUE(entry.getState() == PinEntryState::VERIFY);
+    TEST_ASSERT_EQUAL_STRING("9876543210", entry.getPin());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_enter_and_accept);
+    RUN_TEST(test_digit_selector_wraps);
+    RUN_TEST(test_redraws_only_changed_cells);
+    RUN_TEST(test_wrong_pin_then_lockout);
+    RUN_TEST(test_wrong_pin_without_lockout);
+    RUN_TEST(test_start_locked_after_reboot);
+    RUN_TEST(test_ignores_unexpected_events);
+    RUN_TEST(test_length_is_clamped);
+    return UNITY_END();
+}
@@ -0,0 +1,248 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "qr_code.h"
+
+// Эталоны ISO/IEC 18004 для уровня коррекции M, версии 1..10
+static const int CAPACITY_BYTES[] = {0, 14, 26, 42, 62, 84, 106, 122, 152, 180, 213};
+static const int EC_PER_BLOCK[] = {0, 10, 16, 26, 18, 24, 16, 18, 22, 22, 26};
+static const int NUM_BLOCKS[] = {0, 1, 1, 1, 2, 2, 4, 4, 4, 5, 5};
+static const int TOTAL_CODEWORDS[] = {0, 26, 44, 70, 100, 134, 172, 196, 242, 292, 346};
+static const int ALIGNMENT[][3] = {{0}, {0}, {6, 18}, {6, 22}, {6, 26}, {6, 30}, {6, 34},
+                                   {6, 22, 38}, {6, 24, 42}, {6, 26, 46}, {6, 28, 50}};
+// Строки формата уровня M по маскам, бит 14 первым
+static const char* FORMAT_M[] = {"101010000010010", "101000100100101", "101111001111100", "101101101001011",
+                                 "100010111111001", "100000011001110", "100111110010111", "100101010100000"};
+
+static bool encodeText(QrCode& qr, const std::string& text) {
+    return qr.encode((const uint8_t*)text.data(), text.size());
+}
+
+static uint8_t gfMultiply(uint8_t x, uint8_t y) {
+    int z = 0;
+    for (int i = 7; i >= 0; i--) {
+        z = (z << 1) ^ ((z >> 7) * 0x11D);
+        z ^= ((y >> i) & 1) * x;
+    }
+    return z;
+}
+
+// Служебные модули по стандарту, независимо от кодировщика
+static bool isFunctionModule(int version, int size, int x, int y) {
+    if ((x < 9 && y < 9) || (x >= size - 8 && y < 9) || (x < 9 && y >= size - 8)) return true;
+    if (x == 6 || y == 6) return true;
+    if (version >= 7 && ((x < 6 && y >= size - 11 && y < size - 8) || (y < 6 && x >= size - 11 && x < size - 8))) {
+        return true;
+    }
+    int count = version == 1 ? 0 : version < 7 ? 2 : 3;
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < count; j++) {
+            int cx = ALIGNMENT[version][i], cy = ALIGNMENT[version][j];
+            if ((i == 0 && j == 0) || (i == 0 && j == count - 1) || (i == count - 1 && j == 0)) continue;
+            if (x >= cx - 2 && x <= cx + 2 && y >= cy - 2 && y <= cy + 2) return true;
+        }
+    }
+    return false;
+}
+
+static int readFormat(const QrCode& qr, bool second) {
+    int bits = 0;
+    int n = qr.size();
+    if (!second) {
+        for (int i = 0; i <= 5; i++) bits |= qr.module(8, i) << i;
+        bits |= qr.module(8, 7) << 6;
+        bits |= qr.module(8, 8) << 7;
+        bits |= qr.module(7, 8) << 8;
+        for (int i = 9; i < 15; i++) bits |= qr.module(14 - i, 8) << i;
+    } else {
+        for (int i = 0; i < 8; i++) bits |= qr.module(n - 1 - i, 8) << i;
+        for (int i = 8; i < 15; i++) bits |= qr.module(8, n - 15 + i) << i;
+    }
+    return bits;
+}
+
+static bool maskBit(int mask, int x, int y) {
+    switch (mask) {
+        case 0: return (x + y) % 2 == 0;
+        case 1: return y % 2 == 0;
+        case 2: return x % 3 == 0;
+        case 3: return (x + y) % 3 == 0;
+        case 4: return (x / 3 + y / 2) % 2 == 0;
+        case 5: return x * y % 2 + x * y % 3 == 0;
+        case 6: return (x * y % 2 + x * y % 3) % 2 == 0;
+        default: return ((x + y) % 2 + x * y % 3) % 2 == 0;
+    }
+}
+
+// Независимый декодер: формат -> маска, снятие маски, чтение зигзагом,
+// деинтерливинг блоков, проверка синдромов Рида-Соломона, байтовый сегмент
+static bool decode(const QrCode& qr, std::string& out) {
+    int n = qr.size();
+    int version = qr.version();
+    int format = readFormat(qr, false);
+    if (format != readFormat(qr, true)) return false;
+    format ^= 0x5412;
+    if ((format >> 13) != 0) return false;  // Не уровень M
+    int mask = (format >> 10) & 7;
+
+    std::vector<uint8_t> codewords;
+    int current = 0, bits = 0;
+    for (int right = n - 1; right >= 1; right -= 2) {
+        if (right == 6) right = 5;
+        for (int v = 0; v < n; v++) {
+            for (int j = 0; j < 2; j++) {
+                int x = right - j;
+                bool upward = ((right + 1) & 2) == 0;
+                int y = upward ? n - 1 - v : v;
+                if (isFunctionModule(version, n, x, y)) continue;
+                current = (current << 1) | (qr.module(x, y) ^ maskBit(mask, x, y));
+                if (++bits == 8) {
+                    codewords.push_back(current);
+                    current = 0;
+                    bits = 0;
+                }
+            }
+        }
+    }
+
+    int ec = EC_PER_BLOCK[version], blocks = NUM_BLOCKS[version], total = TOTAL_CODEWORDS[version];
+    if ((int)codewords.size() < total) return false;
+    int shortBlocks = blocks - total % blocks;
+    int shortData = total / blocks - ec;
+    std::vector<std::vector<uint8_t>> blockData(blocks), blockEc(blocks);
+    int k = 0;
+    for (int i = 0; i <= shortData; i++) {
+        for (int b = 0; b < blocks; b++) {
+            if (i == shortData && b < shortBlocks) continue;
+            blockData[b].push_back(codewords[k++]);
+        }
+    }
+    for (int i = 0; i < ec; i++) {
+        for (int b = 0; b < blocks; b++) blockEc[b].push_back(codewords[k++]);
+    }
+
+    std::vector<uint8_t> data;
+    for (int b = 0; b < blocks; b++) {
+        std::vector<uint8_t> all = blockData[b];
+        all.insert(all.end(), blockEc[b].begin(), blockEc[b].end());
+        uint8_t root = 1;
+        for (int s = 0; s < ec; s++) {
+            uint8_t syndrome = 0;
+            for (uint8_t c : all) syndrome = gfMultiply(syndrome, root) ^ c;
+            if (syndrome) return false;
+            root = gfMultiply(root, 2);
+        }
+        data.insert(data.end(), blockData[b].begin(), blockData[b].end());
+    }
+
+    int bit = 0;
+    auto readBits = [&](int count) {
+        int value = 0;
+        while (count--) {
+            value = (value << 1) | ((data[bit >> 3] >> (7 - (bit & 7))) & 1);
+            bit++;
+        }
+        return value;
+    };
+    if (readBits(4) != 4) return false;  // Байтовый режим
+    int length = readBits(version <= 9 ? 8 : 16);
+    out.clear();
+    for (int i = 0; i < length; i++) out += (char)readBits(8);
+    return true;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_reed_solomon_reference(void) {
+    // "HELLO WORLD" 1-M из стандарта
+    const uint8_t data[] = {32, 91, 11, 120, 209, 114, 220, 77, 67, 64, 236, 17, 236, 17, 236, 17};
+    const uint8_t expected[] = {196, 35, 39, 119, 235, 215, 231, 226, 93, 23};
+    uint8_t ec[10];
+    qrReedSolomon(data, sizeof(data), sizeof(ec), ec);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, ec, sizeof(ec));
+}
+
+void test_capacity_per_version(void) {
+    for (int version = 1; version <= QR_MAX_VERSION; version++) {
+        QrCode qr;
+        TEST_ASSERT_TRUE(encodeText(qr, std::string(CAPACITY_BYTES[version], 'x')));
+        TEST_ASSERT_EQUAL_INT(version, qr.version());
+        TEST_ASSERT_EQUAL_INT(17 + 4 * version, qr.size());
+        if (version < QR_MAX_VERSION) {
+            TEST_ASSERT_TRUE(encodeText(qr, std::string(CAPACITY_BYTES[version] + 1, 'x')));
+            TEST_ASSERT_EQUAL_INT(version + 1, qr.version());
+        }
+    }
+    QrCode qr;
+    TEST_ASSERT_FALSE(encodeText(qr, std::string(CAPACITY_BYTES[QR_MAX_VERSION] + 1, 'x')));
+}
+
+void test_version_information(void) {
+    // Версия 7: 000111 + BCH = 0x07C94, обе копии
+    QrCode qr;
+    TEST_ASSERT_TRUE(encodeText(qr, std::string(110, 'a')));
+    TEST_ASSERT_EQUAL_INT(7, qr.version());
+    long first = 0, second = 0;
+    for (int i = 0; i < 18; i++) {
+        first |= (long)qr.module(qr.size() - 11 + i % 3, i / 3) << i;
+        second |= (long)qr.module(i / 3, qr.size() - 11 + i % 3) << i;
+    }
+    TEST_ASSERT_EQUAL_HEX32(0x07C94, first);
+    TEST_ASSERT_EQUAL_HEX32(0x07C94, second);
+}
+
+void test_roundtrip_all_lengths(void) {
+    bool masksSeen[8] = {false};
+    for (int length = 0; length <= CAPACITY_BYTES[QR_MAX_VERSION]; length++) {
+        std::string text;
+        for (int i = 0; i < length; i++) text += (char)(33 + (i * 7 + length) % 90);
+        QrCode qr;
+        TEST_ASSERT_TRUE(encodeText(qr, text));
+
+        // Строка формата совпадает с таблицей стандарта для выбранной маски
+        char format[16];
+        int bits = readFormat(qr, false);
+        for (int i = 0; i < 15; i++) format[i] = '0' + ((bits >> (14 - i)) & 1);
+        format[15] = '\0';
+        TEST_ASSERT_EQUAL_STRING(FORMAT_M[qr.mask()], format);
+        masksSeen[qr.mask()] = true;
+
+        std::string decoded;
+        TEST_ASSERT_TRUE(decode(qr, decoded));
+        TEST_ASSERT_TRUE(decoded == text);
+    }
+    int distinct = 0;
+    for (bool seen : masksSeen) distinct += seen;
+    TEST_ASSERT_GREATER_THAN(1, distinct);
+}
+
+void test_function_patterns(void) {
+    QrCode qr;
+    TEST_ASSERT_TRUE(qr.encode("otpauth://totp/GitHub:alice?secret=JBSWY3DPEHPK3PXP&issuer=GitHub"));
+    int n = qr.size();
+    for (int i = 0; i < 7; i++) {
+        // Внешние рамки трех поисковых узоров
+        TEST_ASSERT_TRUE(qr.module(i, 0) && qr.module(0, i) && qr.module(6, i) && qr.module(i, 6));
+        TEST_ASSERT_TRUE(qr.module(n - 1 - i, 0) && qr.module(n - 1, i));
+        TEST_ASSERT_TRUE(qr.module(i, n - 1) && qr.module(0, n - 1 - i));
+        // Разделитель вокруг узора
+        TEST_ASSERT_FALSE(qr.module(7, i) || qr.module(i, 7));
+    }
+    for (int i = 8; i < n - 8; i++) {
+        TEST_ASSERT_EQUAL(i % 2 == 0, qr.module(i, 6));
+        TEST_ASSERT_EQUAL(i % 2 == 0, qr.module(6, i));
+    }
+    TEST_ASSERT_TRUE(qr.module(8, n - 8));  // Темный модуль
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_reed_solomon_reference);
+    RUN_TEST(test_capacity_per_version);
+    RUN_TEST(test_version_information);
+    RUN_TEST(test_roundtrip_all_lengths);
+    RUN_TEST(test_function_patterns);
+    return UNITY_END();
+}
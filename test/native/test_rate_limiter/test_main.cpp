@@ -0,0 +1,173 @@
+#include <unity.h>
+#include <string.h>
+#include "config.h"
+#include "rate_limiter.h"
+
+// Заглушка запроса AsyncWebServer: адрес клиента, путь и состояние соединения
+struct StubRequest {
+    uint32_t ip;
+    const char* url;
+    bool counted;  // Допущен с учетом в одновременных запросах, ждет отключения
+};
+
+static const uint32_t PLENTY_HEAP = 200000;
+static const uint32_t PLENTY_BLOCK = 100000;
+
+static RateLimiter* limiter;
+static unsigned long nowMs;
+static uint32_t freeHeap;
+static uint32_t largestBlock;
+
+// Классификация и решение как в RequestGuard::canHandle: 0 - запрос идет к
+// обработчику, иначе код ответа отказа
+static int guard(StubRequest& request) {
+    bool isStream = strcmp(request.url, "/api/events") == 0;
+    static const char* const heavy[] = {"/scan", "/api/import", "/api/import_uris", "/api/export",
+                                        "/api/backup", "/api/restore", "/api/logs"};
+    bool isHeavy = false;
+    for (const char* url : heavy) isHeavy = isHeavy || strcmp(request.url, url) == 0;
+    Admission admission = limiter->admit(request.ip, isHeavy ? WEB_HEAVY_REQUEST_COST : 1, nowMs,
+                                         freeHeap, largestBlock, !isStream);
+    request.counted = admission == Admission::ALLOW && !isStream;
+    if (admission == Admission::ALLOW) return 0;
+    return admission == Admission::RATE_LIMITED ? 429 : 503;
+}
+
+// onDisconnect запроса
+static void disconnect(StubRequest& request) {
+    if (request.counted) limiter->release();
+    request.counted = false;
+}
+
+// Запрос, обработанный и закрытый сразу
+static int serve(uint32_t ip, const char* url) {
+    StubRequest request = {ip, url, false};
+    int status = guard(request);
+    disconnect(request);
+    return status;
+}
+
+void setUp(void) {
+    limiter = new RateLimiter(WEB_RATE_CAPACITY, WEB_RATE_REFILL_PER_SEC, WEB_MAX_IN_FLIGHT,
+                              WEB_MIN_FREE_HEAP, WEB_MIN_HEAP_BLOCK);
+    nowMs = 100000;
+    freeHeap = PLENTY_HEAP;
+    largestBlock = PLENTY_BLOCK;
+}
+
+void tearDown(void) {
+    delete limiter;
+}
+
+void test_burst_then_refill(void) {
+    for (int i = 0; i < WEB_RATE_CAPACITY; i++) {
+        TEST_ASSERT_EQUAL_INT(0, serve(1, "/api/keys"));
+    }
+    TEST_ASSERT_EQUAL_INT(429, serve(1, "/api/keys"));
+
+    // Один токен пополняется за 1000 / WEB_RATE_REFILL_PER_SEC мс
+    nowMs += 1000 / WEB_RATE_REFILL_PER_SEC - 1;
+    TEST_ASSERT_EQUAL_INT(429, serve(1, "/api/keys"));
+    nowMs += 1;
+    TEST_ASSERT_EQUAL_INT(0, serve(1, "/api/keys"));
+    TEST_ASSERT_EQUAL_INT(429, serve(1, "/api/keys"));
+}
+
+void test_refill_is_capped(void) {
+    for (int i = 0; i < WEB_RATE_CAPACITY; i++) serve(1, "/api/keys");
+    nowMs += 3600000;
+    for (int i = 0; i < WEB_RATE_CAPACITY; i++) {
+        TEST_ASSERT_EQUAL_INT(0, serve(1, "/api/keys"));
+    }
+    TEST_ASSERT_EQUAL_INT(429, serve(1, "/api/keys"));
+}
+
+void test_heavy_requests_cost_more(void) {
+    int allowed = 0;
+    while (serve(1, "/api/export") == 0) allowed++;
+    TEST_ASSERT_EQUAL_INT(WEB_RATE_CAPACITY / WEB_HEAVY_REQUEST_COST, allowed);
+    // Остаток корзины еще хватает на легкие запросы
+    for (int i = 0; i < WEB_RATE_CAPACITY % WEB_HEAVY_REQUEST_COST; i++) {
+        TEST_ASSERT_EQUAL_INT(0, serve(1, "/api/keys"));
+    }
+    TEST_ASSERT_EQUAL_INT(429, serve(1, "/api/keys"));
+}
+
+void test_addresses_are_independent(void) {
+    while (serve(1, "/api/keys") == 0) {}
+    TEST_ASSERT_EQUAL_INT(0, serve(2, "/api/keys"));
+    TEST_ASSERT_EQUAL_INT(429, serve(1, "/api/keys"));
+}
+
+void test_in_flight_cap(void) {
+    StubRequest open[WEB_MAX_IN_FLIGHT];
+    for (int i = 0; i < WEB_MAX_IN_FLIGHT; i++) {
+        open[i] = {(uint32_t)(10 + i), "/api/import", false};
+        TEST_ASSERT_EQUAL_INT(0, guard(open[i]));
+    }
+    TEST_ASSERT_EQUAL_INT(503, serve(99, "/api/keys"));
+
+    // Подписка на события не занимает место обработчика
+    StubRequest events = {99, "/api/events", false};
+    TEST_ASSERT_EQUAL_INT(0, guard(events));
+
+    disconnect(open[0]);
+    TEST_ASSERT_EQUAL_INT(0, serve(99, "/api/keys"));
+    for (int i = 1; i < WEB_MAX_IN_FLIGHT; i++) disconnect(open[i]);
+
+    const RateLimiterStats& stats = limiter->getStats();
+    TEST_ASSERT_EQUAL_UINT16(0, stats.inFlight);
+    TEST_ASSERT_EQUAL_UINT16(WEB_MAX_IN_FLIGHT, stats.peakInFlight);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.busy);
+}
+
+void test_low_memory_rejects_before_handler(void) {
+    freeHeap = WEB_MIN_FREE_HEAP - 1;
+    TEST_ASSERT_EQUAL_INT(503, serve(1, "/api/keys"));
+    freeHeap = PLENTY_HEAP;
+    largestBlock = WEB_MIN_HEAP_BLOCK - 1;
+    TEST_ASSERT_EQUAL_INT(503, serve(1, "/api/keys"));
+    largestBlock = PLENTY_BLOCK;
+
+    // Отказ по памяти не тратит токены адреса
+    for (int i = 0; i < WEB_RATE_CAPACITY; i++) {
+        TEST_ASSERT_EQUAL_INT(0, serve(1, "/api/keys"));
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, limiter->getStats().lowMemory);
+    TEST_ASSERT_EQUAL_UINT16(0, limiter->getStats().inFlight);
+}
+
+void test_full_table_evicts_idle_address(void) {
+    while (serve(1, "/api/keys") == 0) {}
+    for (uint32_t ip = 2; ip <= RateLimiter::MAX_CLIENTS + 1; ip++) {
+        nowMs++;
+        TEST_ASSERT_EQUAL_INT(0, serve(ip, "/api/keys"));
+    }
+    // Адрес 1 вытеснен как самый давний и вернулся с полной корзиной
+    nowMs++;
+    TEST_ASSERT_EQUAL_INT(0, serve(1, "/api/keys"));
+}
+
+void test_stats(void) {
+    serve(1, "/api/keys");
+    while (serve(2, "/api/export") == 0) {}
+    limiter->release();  // Лишний release не уводит счетчик ниже нуля
+    const RateLimiterStats& stats = limiter->getStats();
+    TEST_ASSERT_EQUAL_UINT32(1 + WEB_RATE_CAPACITY / WEB_HEAVY_REQUEST_COST, stats.allowed);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.rateLimited);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.inFlight);
+    TEST_ASSERT_EQUAL_UINT16(1, stats.peakInFlight);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_burst_then_refill);
+    RUN_TEST(test_refill_is_capped);
+    RUN_TEST(test_heavy_requests_cost_more);
+    RUN_TEST(test_addresses_are_independent);
+    RUN_TEST(test_in_flight_cap);
+    RUN_TEST(test_low_memory_rejects_before_handler);
+    RUN_TEST(test_full_table_evicts_idle_address);
+    RUN_TEST(test_stats);
+    return UNITY_END();
+}
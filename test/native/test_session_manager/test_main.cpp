@@ -0,0 +1,168 @@
+#include <unity.h>
+#include <new>
+#include "session_manager.h"
+
+// Счетчик выделений кучи: проверка сессии не должна выделять память
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+static SessionManager* sessions;
+
+// Проверка запроса так же, как в WebServerManager: cookie из заголовка без копирования
+static bool authenticate(const char* cookieHeader) {
+    const char* value;
+    size_t length;
+    if (!SessionManager::findCookie(cookieHeader, "session", &value, &length)) return false;
+    return sessions->validate(value, length);
+}
+
+void setUp(void) {
+    sessions = new SessionManager();
+}
+
+void tearDown(void) {
+    delete sessions;
+}
+
+void test_token_format(void) {
+    char first[SessionManager::TOKEN_LENGTH + 1];
+    strcpy(first, sessions->create());
+    const char* second = sessions->create();
+
+    TEST_ASSERT_EQUAL_size_t(SessionManager::TOKEN_LENGTH, strlen(first));
+    for (size_t i = 0; i < SessionManager::TOKEN_LENGTH; i++) {
+        TEST_ASSERT_NOT_NULL(strchr("0123456789abcdef", first[i]));
+    }
+    // Первые два символа - номер слота
+    TEST_ASSERT_EQUAL_MEMORY("00", first, 2);
+    TEST_ASSERT_EQUAL_MEMORY("01", second, 2);
+    TEST_ASSERT_FALSE(memcmp(first + 2, second + 2, SessionManager::TOKEN_LENGTH - 2) == 0);
+}
+
+void test_thousands_of_requests_without_allocation(void) {
+    char tokens[SessionManager::MAX_SESSIONS][SessionManager::TOKEN_LENGTH + 1];
+    char headers[SessionManager::MAX_SESSIONS][96];
+    for (int i = 0; i < SessionManager::MAX_SESSIONS; i++) {
+        strcpy(tokens[i], sessions->create());
+        snprintf(headers[i], sizeof(headers[i]), "theme=dark; session=%s; lang=ru", tokens[i]);
+    }
+    char forged[96];
+    strcpy(forged, headers[0]);
+    forged[strlen("theme=dark; session=") + 10] ^= 1;
+
+    size_t before = allocations;
+    int accepted = 0;
+    for (int i = 0; i < 10000; i++) {
+        if (authenticate(headers[i % SessionManager::MAX_SESSIONS])) accepted++;
+        if (authenticate(forged)) accepted = -1000000;
+        if (authenticate("theme=dark")) accepted = -1000000;
+    }
+    TEST_ASSERT_EQUAL_size_t(0, allocations - before);
+    TEST_ASSERT_EQUAL_INT(10000, accepted);
+}
+
+void test_rejects_malformed_tokens(void) {
+    char token[SessionManager::TOKEN_LENGTH + 1];
+    strcpy(token, sessions->create());
+
+    TEST_ASSERT_FALSE(sessions->validate(nullptr, SessionManager::TOKEN_LENGTH));
+    TEST_ASSERT_FALSE(sessions->validate(token, SessionManager::TOKEN_LENGTH - 1));
+    TEST_ASSERT_FALSE(sessions->validate("", 0));
+
+    char other[SessionManager::TOKEN_LENGTH + 1];
+    strcpy(other, token);
+    other[0] = 'f';  // Несуществующий слот
+    TEST_ASSERT_FALSE(sessions->validate(other, SessionManager::TOKEN_LENGTH));
+    strcpy(other, token);
+    other[1] = 'X';
+    TEST_ASSERT_FALSE(sessions->validate(other, SessionManager::TOKEN_LENGTH));
+    strcpy(other, token);
+    other[SessionManager::TOKEN_LENGTH - 1] = other[SessionManager::TOKEN_LENGTH - 1] == '0' ? '1' : '0';
+    TEST_ASSERT_FALSE(sessions->validate(other, SessionManager::TOKEN_LENGTH));
+
+    TEST_ASSERT_TRUE(sessions->validate(token, SessionManager::TOKEN_LENGTH));
+}
+
+void test_full_table_evicts_oldest(void) {
+    char tokens[SessionManager::MAX_SESSIONS + 1][SessionManager::TOKEN_LENGTH + 1];
+    for (int i = 0; i <= SessionManager::MAX_SESSIONS; i++) {
+        strcpy(tokens[i], sessions->create());
+        hostAdvanceMillis(10);
+    }
+    TEST_ASSERT_FALSE(sessions->validate(tokens[0], SessionManager::TOKEN_LENGTH));
+    for (int i = 1; i <= SessionManager::MAX_SESSIONS; i++) {
+        TEST_ASSERT_TRUE(sessions->validate(tokens[i], SessionManager::TOKEN_LENGTH));
+    }
+}
+
+void test_expiry_and_revoke(void) {
+    char first[SessionManager::TOKEN_LENGTH + 1];
+    strcpy(first, sessions->create());
+    hostAdvanceMillis(SessionManager::SESSION_TIMEOUT / 2);
+    char second[SessionManager::TOKEN_LENGTH + 1];
+    strcpy(second, sessions->create());
+
+    sessions->revoke(second, SessionManager::TOKEN_LENGTH);
+    TEST_ASSERT_FALSE(sessions->validate(second, SessionManager::TOKEN_LENGTH));
+
+    hostAdvanceMillis(SessionManager::SESSION_TIMEOUT / 2 + 1);
+    TEST_ASSERT_FALSE(sessions->validate(first, SessionManager::TOKEN_LENGTH));
+
+    // Истекший слот занимается первым
+    const char* third = sessions->create();
+    TEST_ASSERT_EQUAL_MEMORY("00", third, 2);
+    TEST_ASSERT_TRUE(sessions->validate(third, SessionManager::TOKEN_LENGTH));
+}
+
+void test_find_cookie(void) {
+    const char* value;
+    size_t length;
+
+    TEST_ASSERT_TRUE(SessionManager::findCookie("session=abc", "session", &value, &length));
+    TEST_ASSERT_EQUAL_size_t(3, length);
+    TEST_ASSERT_EQUAL_MEMORY("abc", value, 3);
+
+    TEST_ASSERT_TRUE(SessionManager::findCookie("a=1;  session=xyz;b=2", "session", &value, &length));
+    TEST_ASSERT_EQUAL_size_t(3, length);
+    TEST_ASSERT_EQUAL_MEMORY("xyz", value, 3);
+
+    // Имя должно совпадать целиком
+    TEST_ASSERT_TRUE(SessionManager::findCookie("oldsession=1; session_id=2; session=3", "session", &value, &length));
+    TEST_ASSERT_EQUAL_size_t(1, length);
+    TEST_ASSERT_EQUAL_MEMORY("3", value, 1);
+
+    TEST_ASSERT_TRUE(SessionManager::findCookie("session=", "session", &value, &length));
+    TEST_ASSERT_EQUAL_size_t(0, length);
+    TEST_ASSERT_FALSE(SessionManager::findCookie("theme=dark; lang=ru", "session", &value, &length));
+    TEST_ASSERT_FALSE(SessionManager::findCookie("", "session", &value, &length));
+    TEST_ASSERT_FALSE(SessionManager::findCookie(nullptr, "session", &value, &length));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_token_format);
+    RUN_TEST(test_thousands_of_requests_without_allocation);
+    RUN_TEST(test_rejects_malformed_tokens);
+    RUN_TEST(test_full_table_evicts_oldest);
+    RUN_TEST(test_expiry_and_revoke);
+    RUN_TEST(test_find_cookie);
+    return UNITY_END();
+}